@@ -23,10 +23,53 @@ CreateWorkspace({name = "luaerror", abi_compatible = true})
 			"source/shared/main.cpp",
 			"source/server/server.cpp",
 			"source/server/server.hpp",
+			"source/common/rate_limit.cpp",
+			"source/common/rate_limit.hpp",
 			"source/shared/shared.cpp",
 			"source/shared/shared.hpp",
 			"source/common/common.cpp",
-			"source/common/common.hpp"
+			"source/common/common.hpp",
+			"source/common/small_vector.hpp",
+			"source/common/scan.cpp",
+			"source/common/scan.hpp",
+			"source/common/hash.hpp",
+			"source/common/fingerprint.cpp",
+			"source/common/fingerprint.hpp",
+			"source/common/duplicates.cpp",
+			"source/common/duplicates.hpp",
+			"source/common/spsc_queue.hpp",
+			"source/common/async_pipeline.cpp",
+			"source/common/async_pipeline.hpp",
+			"source/common/span.hpp",
+			"source/common/string_pool.cpp",
+			"source/common/string_pool.hpp",
+			"source/common/bytes.hpp",
+			"source/common/staging.cpp",
+			"source/common/staging.hpp",
+			"source/common/journal.cpp",
+			"source/common/journal.hpp",
+			"source/common/json.cpp",
+			"source/common/json.hpp",
+			"source/common/exporter.cpp",
+			"source/common/exporter.hpp",
+			"source/common/addon_index.cpp",
+			"source/common/addon_index.hpp",
+			"source/common/stats.cpp",
+			"source/common/stats.hpp",
+			"source/common/arena.cpp",
+			"source/common/arena.hpp",
+			"source/common/stack_groups.cpp",
+			"source/common/stack_groups.hpp",
+			"source/common/capture_budget.cpp",
+			"source/common/capture_budget.hpp",
+			"source/common/source_cache.cpp",
+			"source/common/source_cache.hpp",
+			"source/common/recent.cpp",
+			"source/common/recent.hpp",
+			"source/common/heavy_hitters.cpp",
+			"source/common/heavy_hitters.hpp",
+			"source/common/templates.cpp",
+			"source/common/templates.hpp"
 		})
 
 	CreateProject({serverside = false, manual_files = true})
@@ -43,7 +86,48 @@ CreateWorkspace({name = "luaerror", abi_compatible = true})
 			"source/shared/shared.cpp",
 			"source/shared/shared.hpp",
 			"source/common/common.cpp",
-			"source/common/common.hpp"
+			"source/common/common.hpp",
+			"source/common/small_vector.hpp",
+			"source/common/scan.cpp",
+			"source/common/scan.hpp",
+			"source/common/hash.hpp",
+			"source/common/fingerprint.cpp",
+			"source/common/fingerprint.hpp",
+			"source/common/duplicates.cpp",
+			"source/common/duplicates.hpp",
+			"source/common/spsc_queue.hpp",
+			"source/common/async_pipeline.cpp",
+			"source/common/async_pipeline.hpp",
+			"source/common/span.hpp",
+			"source/common/string_pool.cpp",
+			"source/common/string_pool.hpp",
+			"source/common/bytes.hpp",
+			"source/common/staging.cpp",
+			"source/common/staging.hpp",
+			"source/common/journal.cpp",
+			"source/common/journal.hpp",
+			"source/common/json.cpp",
+			"source/common/json.hpp",
+			"source/common/exporter.cpp",
+			"source/common/exporter.hpp",
+			"source/common/addon_index.cpp",
+			"source/common/addon_index.hpp",
+			"source/common/stats.cpp",
+			"source/common/stats.hpp",
+			"source/common/arena.cpp",
+			"source/common/arena.hpp",
+			"source/common/stack_groups.cpp",
+			"source/common/stack_groups.hpp",
+			"source/common/capture_budget.cpp",
+			"source/common/capture_budget.hpp",
+			"source/common/source_cache.cpp",
+			"source/common/source_cache.hpp",
+			"source/common/recent.cpp",
+			"source/common/recent.hpp",
+			"source/common/heavy_hitters.cpp",
+			"source/common/heavy_hitters.hpp",
+			"source/common/templates.cpp",
+			"source/common/templates.hpp"
 		})
 
 	project("testing")
@@ -52,9 +136,222 @@ CreateWorkspace({name = "luaerror", abi_compatible = true})
 		files({
 			"source/common/common.hpp",
 			"source/common/common.cpp",
-			"source/testing/main.cpp"
+			"source/common/small_vector.hpp",
+			"source/common/scan.hpp",
+			"source/common/scan.cpp",
+			"source/common/span.hpp",
+			"source/common/batch.hpp",
+			"source/common/batch.cpp",
+			"source/common/thread_pool.hpp",
+			"source/common/thread_pool.cpp",
+			"source/common/hash.hpp",
+			"source/common/string_pool.hpp",
+			"source/common/string_pool.cpp",
+			"source/common/fingerprint.hpp",
+			"source/common/fingerprint.cpp",
+			"source/common/duplicates.hpp",
+			"source/common/duplicates.cpp",
+			"source/common/rate_limit.hpp",
+			"source/common/rate_limit.cpp",
+			"source/common/spsc_queue.hpp",
+			"source/common/async_pipeline.hpp",
+			"source/common/async_pipeline.cpp",
+			"source/common/bytes.hpp",
+			"source/common/staging.hpp",
+			"source/common/staging.cpp",
+			"source/common/journal.hpp",
+			"source/common/journal.cpp",
+			"source/common/json.hpp",
+			"source/common/json.cpp",
+			"source/common/exporter.hpp",
+			"source/common/exporter.cpp",
+			"source/common/addon_index.hpp",
+			"source/common/addon_index.cpp",
+			"source/common/stats.hpp",
+			"source/common/stats.cpp",
+			"source/common/arena.hpp",
+			"source/common/arena.cpp",
+			"source/common/stack_groups.hpp",
+			"source/common/stack_groups.cpp",
+			"source/common/capture_budget.hpp",
+			"source/common/capture_budget.cpp",
+			"source/common/source_cache.hpp",
+			"source/common/source_cache.cpp",
+			"source/common/recent.hpp",
+			"source/common/recent.cpp",
+			"source/common/heavy_hitters.hpp",
+			"source/common/heavy_hitters.cpp",
+			"source/common/log_analysis.hpp",
+			"source/common/log_analysis.cpp",
+			"source/common/templates.hpp",
+			"source/common/templates.cpp",
+			"source/testing/main.cpp",
+			"source/testing/reference.hpp",
+			"source/testing/reference.cpp",
+			"source/testing/benchmark.hpp",
+			"source/testing/benchmark.cpp",
+			"source/testing/allocations.hpp",
+			"source/testing/allocations.cpp"
 		})
 		vpaths({
 			["Header files/*"] = "source/**.hpp",
 			["Source files/*"] = "source/**.cpp"
 		})
+
+		filter("system:linux or macosx")
+			links("pthread")
+
+	project("luaerror-dump")
+		kind("ConsoleApp")
+		includedirs("source/common")
+		files({
+			"source/common/common.hpp",
+			"source/common/common.cpp",
+			"source/common/small_vector.hpp",
+			"source/common/scan.hpp",
+			"source/common/scan.cpp",
+			"source/common/span.hpp",
+			"source/common/hash.hpp",
+			"source/common/string_pool.hpp",
+			"source/common/string_pool.cpp",
+			"source/common/fingerprint.hpp",
+			"source/common/fingerprint.cpp",
+			"source/common/bytes.hpp",
+			"source/common/staging.hpp",
+			"source/common/staging.cpp",
+			"source/common/journal.hpp",
+			"source/common/journal.cpp",
+			"source/common/json.hpp",
+			"source/common/json.cpp",
+			"source/common/stack_groups.hpp",
+			"source/common/stack_groups.cpp",
+			"source/dump/main.cpp"
+		})
+		vpaths({
+			["Header files/*"] = "source/**.hpp",
+			["Source files/*"] = "source/**.cpp"
+		})
+
+		filter("system:linux or macosx")
+			links("pthread")
+
+	project("luaerror-analyze")
+		kind("ConsoleApp")
+		includedirs("source/common")
+		files({
+			"source/common/common.hpp",
+			"source/common/common.cpp",
+			"source/common/small_vector.hpp",
+			"source/common/scan.hpp",
+			"source/common/scan.cpp",
+			"source/common/span.hpp",
+			"source/common/thread_pool.hpp",
+			"source/common/thread_pool.cpp",
+			"source/common/hash.hpp",
+			"source/common/string_pool.hpp",
+			"source/common/string_pool.cpp",
+			"source/common/fingerprint.hpp",
+			"source/common/fingerprint.cpp",
+			"source/common/bytes.hpp",
+			"source/common/staging.hpp",
+			"source/common/staging.cpp",
+			"source/common/json.hpp",
+			"source/common/json.cpp",
+			"source/common/stack_groups.hpp",
+			"source/common/stack_groups.cpp",
+			"source/common/mapped_file.hpp",
+			"source/common/mapped_file.cpp",
+			"source/common/log_analysis.hpp",
+			"source/common/log_analysis.cpp",
+			"source/analyze/main.cpp"
+		})
+		vpaths({
+			["Header files/*"] = "source/**.hpp",
+			["Source files/*"] = "source/**.cpp"
+		})
+
+		filter("system:linux or macosx")
+			links("pthread")
+
+	-- Runs the module on a plain LuaJIT state with stand-ins for the engine, to benchmark the error
+	-- paths without a server. Needs the LuaJIT development package (libluajit-5.1-dev on Debian).
+	if os.istarget("linux") then
+		project("luaerror-harness")
+			kind("ConsoleApp")
+			defines("LUAERROR_SERVER")
+			-- the stand-in garrysmod_common headers come first
+			includedirs({"source/harness/include", "source", "source/common", "/usr/include/luajit-2.1"})
+			files({
+				"source/shared/main.cpp",
+				"source/server/server.cpp",
+				"source/server/server.hpp",
+				"source/common/rate_limit.cpp",
+				"source/common/rate_limit.hpp",
+				"source/shared/shared.cpp",
+				"source/shared/shared.hpp",
+				"source/common/common.cpp",
+				"source/common/common.hpp",
+				"source/common/small_vector.hpp",
+				"source/common/scan.cpp",
+				"source/common/scan.hpp",
+				"source/common/hash.hpp",
+				"source/common/fingerprint.cpp",
+				"source/common/fingerprint.hpp",
+				"source/common/duplicates.cpp",
+				"source/common/duplicates.hpp",
+				"source/common/spsc_queue.hpp",
+				"source/common/async_pipeline.cpp",
+				"source/common/async_pipeline.hpp",
+				"source/common/span.hpp",
+				"source/common/string_pool.cpp",
+				"source/common/string_pool.hpp",
+				"source/common/bytes.hpp",
+				"source/common/staging.cpp",
+				"source/common/staging.hpp",
+				"source/common/journal.cpp",
+				"source/common/journal.hpp",
+				"source/common/json.cpp",
+				"source/common/json.hpp",
+				"source/common/exporter.cpp",
+				"source/common/exporter.hpp",
+				"source/common/addon_index.cpp",
+				"source/common/addon_index.hpp",
+				"source/common/stats.cpp",
+				"source/common/stats.hpp",
+				"source/common/arena.cpp",
+				"source/common/arena.hpp",
+				"source/common/stack_groups.cpp",
+				"source/common/stack_groups.hpp",
+				"source/common/capture_budget.cpp",
+				"source/common/capture_budget.hpp",
+				"source/common/source_cache.cpp",
+				"source/common/source_cache.hpp",
+				"source/common/recent.cpp",
+				"source/common/recent.hpp",
+				"source/common/heavy_hitters.cpp",
+				"source/common/heavy_hitters.hpp",
+				"source/common/templates.cpp",
+				"source/common/templates.hpp",
+				"source/harness/include/GarrysMod/Lua/Interface.h",
+				"source/harness/include/GarrysMod/Lua/LuaInterface.h",
+				"source/harness/include/GarrysMod/Lua/LuaGameCallback.h",
+				"source/harness/include/GarrysMod/Lua/AutoReference.h",
+				"source/harness/include/GarrysMod/Lua/Helpers.hpp",
+				"source/harness/include/GarrysMod/InterfacePointers.hpp",
+				"source/harness/include/GarrysMod/FunctionPointers.hpp",
+				"source/harness/include/detouring/hook.hpp",
+				"source/harness/include/filesystem_stdio.h",
+				"source/harness/include/eiface.h",
+				"source/harness/include/player.h",
+				"source/harness/lua_interface.cpp",
+				"source/harness/stand_ins.hpp",
+				"source/harness/stand_ins.cpp",
+				"source/harness/main.cpp"
+			})
+			vpaths({
+				["Header files/*"] = {"source/**.hpp", "source/**.h"},
+				["Source files/*"] = "source/**.cpp"
+			})
+
+			links({"luajit-5.1", "pthread", "dl"})
+	end
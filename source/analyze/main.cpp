@@ -0,0 +1,184 @@
+#include <log_analysis.hpp>
+#include <mapped_file.hpp>
+#include <thread_pool.hpp>
+#include <fingerprint.hpp>
+#include <json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+static std::vector<const char *> files;
+
+static void print_occurrence( const char *name, const common::LogAnalysis::Occurrence &occurrence )
+{
+	std::printf( "  %s %s:%llu", name, files[occurrence.file], static_cast<unsigned long long>( occurrence.line ) );
+	if( !occurrence.time.empty( ) )
+		std::printf( " (%s)", occurrence.time.c_str( ) );
+}
+
+static void print_text( const common::LogAnalysis &analysis, const size_t top )
+{
+	const auto errors = analysis.GetErrors( );
+	std::printf( "%llu errors, %zu distinct\n", static_cast<unsigned long long>( analysis.GetErrorCount( ) ), errors.size( ) );
+
+	std::printf( "\nby fingerprint:\n" );
+	for( size_t k = 0; k < errors.size( ) && ( top == 0 || k < top ); ++k )
+	{
+		const common::LogAnalysis::ErrorGroup &error = *errors[k];
+		char fingerprint[17];
+		common::FormatFingerprint( error.fingerprint, fingerprint );
+		std::printf( "%10llu %s [%s]", static_cast<unsigned long long>( error.count ), fingerprint, error.addon_name.c_str( ) );
+		print_occurrence( "first", error.first );
+		print_occurrence( "last", error.last );
+
+		if( error.source_file.empty( ) )
+			std::printf( "\n  %s\n", error.error_string.c_str( ) );
+		else
+			std::printf( "\n  %s:%d: %s\n", error.source_file.c_str( ), error.source_line, error.error_string.c_str( ) );
+	}
+
+	const auto addons = analysis.GetAddons( );
+	std::printf( "\nby addon:\n" );
+	for( size_t k = 0; k < addons.size( ) && ( top == 0 || k < top ); ++k )
+	{
+		const common::LogAnalysis::AddonGroup &addon = addons[k];
+		std::printf( "%10llu [%s] %zu distinct", static_cast<unsigned long long>( addon.count ), addon.name.c_str( ), addon.errors );
+		print_occurrence( "first", addon.first );
+		print_occurrence( "last", addon.last );
+		std::printf( "\n" );
+	}
+}
+
+static void append_occurrence( std::string &line, const char *name, const common::LogAnalysis::Occurrence &occurrence )
+{
+	line += ",\"";
+	line += name;
+	line += "\":{\"file\":";
+	common::AppendJsonString( line, files[occurrence.file] );
+	line += ",\"line\":";
+	line += std::to_string( occurrence.line );
+	if( !occurrence.time.empty( ) )
+	{
+		line += ",\"time\":";
+		common::AppendJsonString( line, occurrence.time );
+	}
+
+	line += '}';
+}
+
+static void print_json( const common::LogAnalysis &analysis, const size_t top )
+{
+	std::string line;
+	const auto errors = analysis.GetErrors( );
+	for( size_t k = 0; k < errors.size( ) && ( top == 0 || k < top ); ++k )
+	{
+		const common::LogAnalysis::ErrorGroup &error = *errors[k];
+		char fingerprint[17];
+		common::FormatFingerprint( error.fingerprint, fingerprint );
+
+		line = "{\"group\":\"fingerprint\",\"fingerprint\":\"";
+		line += fingerprint;
+		line += "\",\"count\":";
+		line += std::to_string( error.count );
+		line += ",\"addon\":";
+		common::AppendJsonString( line, error.addon_name );
+		line += ",\"sourcefile\":";
+		common::AppendJsonString( line, error.source_file );
+		line += ",\"sourceline\":";
+		line += std::to_string( error.source_line );
+		line += ",\"errorstr\":";
+		common::AppendJsonString( line, error.error_string );
+		append_occurrence( line, "first", error.first );
+		append_occurrence( line, "last", error.last );
+		line += "}\n";
+		std::fwrite( line.data( ), 1, line.size( ), stdout );
+	}
+
+	const auto addons = analysis.GetAddons( );
+	for( size_t k = 0; k < addons.size( ) && ( top == 0 || k < top ); ++k )
+	{
+		const common::LogAnalysis::AddonGroup &addon = addons[k];
+		line = "{\"group\":\"addon\",\"addon\":";
+		common::AppendJsonString( line, addon.name );
+		line += ",\"count\":";
+		line += std::to_string( addon.count );
+		line += ",\"distinct\":";
+		line += std::to_string( addon.errors );
+		append_occurrence( line, "first", addon.first );
+		append_occurrence( line, "last", addon.last );
+		line += "}\n";
+		std::fwrite( line.data( ), 1, line.size( ), stdout );
+	}
+}
+
+int main( const int argc, const char *argv[] )
+{
+	bool json = false;
+	size_t top = 0;
+	size_t threads = 0;
+	int first = 1;
+	for( ; first < argc && std::strncmp( argv[first], "--", 2 ) == 0; ++first )
+		if( std::strcmp( argv[first], "--json" ) == 0 )
+			json = true;
+		else if( std::strcmp( argv[first], "--top" ) == 0 && first + 1 < argc )
+			top = std::strtoul( argv[++first], nullptr, 10 );
+		else if( std::strcmp( argv[first], "--threads" ) == 0 && first + 1 < argc )
+			threads = std::strtoul( argv[++first], nullptr, 10 );
+		else
+			break;
+
+	if( first >= argc )
+	{
+		std::fprintf( stderr, "usage: %s [--json] [--top n] [--threads n] <log> [log...]\n", argv[0] );
+		return 1;
+	}
+
+	// every hardware thread by default, the caller takes part in the work too
+	std::unique_ptr<common::ThreadPool> own_pool;
+	if( threads != 0 )
+		own_pool = std::make_unique<common::ThreadPool>( threads - 1 );
+
+	common::ThreadPool &pool = own_pool != nullptr ? *own_pool : common::ThreadPool::GetDefault( );
+
+	// files are given in order (oldest first) for the first and last occurrences to make sense
+	int ret = 0;
+	uint64_t bytes = 0;
+	const auto start = std::chrono::steady_clock::now( );
+	common::LogAnalysis analysis;
+	common::MappedFile file;
+	for( int k = first; k < argc; ++k )
+	{
+		if( !file.Open( argv[k] ) )
+		{
+			std::fprintf( stderr, "%s: unable to open or map log\n", argv[k] );
+			ret = 2;
+			continue;
+		}
+
+		files.push_back( argv[k] );
+		analysis.Analyze( file.GetContents( ), files.size( ) - 1, &pool );
+		bytes += file.GetContents( ).size( );
+		file.Close( );
+	}
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now( ) - start;
+	std::fprintf(
+		stderr,
+		"analyzed %.1f MiB in %.2f seconds with %zu threads\n",
+		static_cast<double>( bytes ) / ( 1024.0 * 1024.0 ),
+		elapsed.count( ),
+		pool.GetConcurrency( )
+	);
+
+	if( json )
+		print_json( analysis, top );
+	else
+		print_text( analysis, top );
+
+	return ret;
+}
@@ -0,0 +1,293 @@
+#include "addon_index.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace common
+{
+
+// longest path component Find can look up, longer ones can't be in any addon anyway
+static constexpr size_t max_component_size = 256;
+
+inline char ToLower( const char c )
+{
+	return c >= 'A' && c <= 'Z' ? static_cast<char>( c - 'A' + 'a' ) : c;
+}
+
+inline bool IsSeparator( const char c )
+{
+	return c == '/' || c == '\\';
+}
+
+AddonIndex::AddonIndex( ) :
+	owners( 1, invalid_addon )
+{ }
+
+AddonIndex::AddonId AddonIndex::AddAddon( std::string_view title, const uint64_t wsid )
+{
+	addons.push_back( { std::string( title ), wsid } );
+	return static_cast<AddonId>( addons.size( ) - 1 );
+}
+
+void AddonIndex::AddFile( const AddonId addon, std::string_view path )
+{
+	if( addon >= addons.size( ) )
+		return;
+
+	Node node = root;
+	std::string component;
+	size_t k = 0;
+	while( k < path.size( ) )
+	{
+		while( k < path.size( ) && IsSeparator( path[k] ) )
+			++k;
+
+		component.clear( );
+		for( ; k < path.size( ) && !IsSeparator( path[k] ); ++k )
+			component += ToLower( path[k] );
+
+		if( component.empty( ) )
+			break;
+
+		const uint64_t key = static_cast<uint64_t>( node ) << 32 | components.Intern( component );
+		const auto child = children.find( key );
+		if( child != children.end( ) )
+			node = child->second;
+		else
+		{
+			const Node new_node = static_cast<Node>( owners.size( ) );
+			owners.push_back( invalid_addon );
+			children.emplace( key, new_node );
+			node = new_node;
+		}
+	}
+
+	if( node != root && owners[node] == invalid_addon )
+	{
+		owners[node] = addon;
+		++files;
+	}
+}
+
+void AddonIndex::SetIncomplete( )
+{
+	incomplete = true;
+}
+
+bool AddonIndex::IsIncomplete( ) const
+{
+	return incomplete;
+}
+
+const AddonIndex::Addon *AddonIndex::Find( std::string_view path ) const
+{
+	if( !path.empty( ) && path[0] == '@' )
+		path.remove_prefix( 1 );
+
+	Node node = root;
+	char component[max_component_size];
+	size_t k = 0;
+	while( k < path.size( ) )
+	{
+		while( k < path.size( ) && IsSeparator( path[k] ) )
+			++k;
+
+		size_t size = 0;
+		for( ; k < path.size( ) && !IsSeparator( path[k] ); ++k )
+		{
+			if( size == max_component_size )
+				return nullptr;
+
+			component[size++] = ToLower( path[k] );
+		}
+
+		if( size == 0 )
+			break;
+
+		const StringPool::Id id = components.Find( std::string_view( component, size ) );
+		if( id == StringPool::invalid_id )
+			return nullptr;
+
+		const auto child = children.find( static_cast<uint64_t>( node ) << 32 | id );
+		if( child == children.end( ) )
+			return nullptr;
+
+		node = child->second;
+	}
+
+	const AddonId owner = owners[node];
+	return owner != invalid_addon ? &addons[owner] : nullptr;
+}
+
+size_t AddonIndex::GetAddonCount( ) const
+{
+	return addons.size( );
+}
+
+size_t AddonIndex::GetFileCount( ) const
+{
+	return files;
+}
+
+AddonLookupCache::AddonLookupCache( const size_t capacity )
+{
+	size_t size = 1;
+	while( size < capacity )
+		size <<= 1;
+
+	entries.resize( size );
+	mask = size - 1;
+}
+
+const AddonIndex::Addon *AddonLookupCache::Find( const AddonIndex &index, std::string_view path )
+{
+	const uint64_t hash = Hash( path );
+	Entry &entry = entries[static_cast<size_t>( hash ^ ( hash >> 32 ) ) & mask];
+	if( entry.used && entry.hash == hash && entry.path == path )
+		return entry.owner;
+
+	// assigning reuses the capacity left by the previous path of this entry
+	entry.hash = hash;
+	entry.path.assign( path.data( ), path.size( ) );
+	entry.owner = index.Find( path );
+	entry.used = true;
+	return entry.owner;
+}
+
+void AddonLookupCache::Clear( )
+{
+	for( Entry &entry : entries )
+	{
+		entry.used = false;
+		entry.owner = nullptr;
+	}
+}
+
+const char *FormatWorkshopId( uint64_t wsid, char ( &buffer )[21] )
+{
+	char *end = buffer + sizeof( buffer ) - 1;
+	char *begin = end;
+	*end = '\0';
+	do
+	{
+		*--begin = static_cast<char>( '0' + wsid % 10 );
+		wsid /= 10;
+	}
+	while( wsid != 0 );
+
+	// keep the text at the start of the buffer
+	std::memmove( buffer, begin, static_cast<size_t>( end - begin ) + 1 );
+	return buffer;
+}
+
+// Buffered reads of a .gma header, strings are found with memchr instead of reading byte by byte.
+class GmaReader
+{
+public:
+	explicit GmaReader( std::FILE *gma_file ) :
+		file( gma_file )
+	{ }
+
+	bool ReadBytes( void *data, size_t size )
+	{
+		auto output = static_cast<uint8_t *>( data );
+		while( size != 0 )
+		{
+			if( position == end && !Fill( ) )
+				return false;
+
+			const size_t count = std::min( size, end - position );
+			std::memcpy( output, buffer + position, count );
+			position += count;
+			output += count;
+			size -= count;
+		}
+
+		return true;
+	}
+
+	// Reads a null terminated string, into text if it's not nullptr.
+	bool ReadString( std::string *text )
+	{
+		if( text != nullptr )
+			text->clear( );
+
+		while( true )
+		{
+			if( position == end && !Fill( ) )
+				return false;
+
+			const auto begin = reinterpret_cast<const char *>( buffer + position );
+			const auto terminator = static_cast<const char *>( std::memchr( begin, '\0', end - position ) );
+			const size_t count = terminator != nullptr ? static_cast<size_t>( terminator - begin ) : end - position;
+			if( text != nullptr )
+				text->append( begin, count );
+
+			position += count;
+			if( terminator != nullptr )
+			{
+				++position;
+				return true;
+			}
+		}
+	}
+
+private:
+	bool Fill( )
+	{
+		position = 0;
+		end = std::fread( buffer, 1, sizeof( buffer ), file );
+		return end != 0;
+	}
+
+	std::FILE *file;
+	uint8_t buffer[16384];
+	size_t position = 0;
+	size_t end = 0;
+};
+
+bool ReadGmaFileList( std::FILE *file, const std::function<void( std::string_view path )> &function )
+{
+	GmaReader reader( file );
+
+	// "GMAD", format version (8 bits), author SteamID and timestamp (64 bits each)
+	uint8_t header[4 + 1 + 8 + 8];
+	if( !reader.ReadBytes( header, sizeof( header ) ) ||
+		header[0] != 'G' || header[1] != 'M' || header[2] != 'A' || header[3] != 'D' )
+		return false;
+
+	std::string text;
+
+	// required content, a list of strings ended by an empty one
+	if( header[4] > 1 )
+		do
+			if( !reader.ReadString( &text ) )
+				return false;
+		while( !text.empty( ) );
+
+	// name, description, author and addon version (32 bits)
+	uint8_t version[4];
+	if( !reader.ReadString( nullptr ) || !reader.ReadString( nullptr ) || !reader.ReadString( nullptr ) ||
+		!reader.ReadBytes( version, sizeof( version ) ) )
+		return false;
+
+	// file entries: number (32 bits, 0 ends the list), path, size (64 bits) and CRC (32 bits)
+	while( true )
+	{
+		uint8_t number[4];
+		if( !reader.ReadBytes( number, sizeof( number ) ) )
+			return false;
+
+		if( number[0] == 0 && number[1] == 0 && number[2] == 0 && number[3] == 0 )
+			return true;
+
+		uint8_t size_crc[8 + 4];
+		if( !reader.ReadString( &text ) || !reader.ReadBytes( size_crc, sizeof( size_crc ) ) )
+			return false;
+
+		function( text );
+	}
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "string_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+
+// Maps the files mounted by workshop addons to the addon that owns them, through a trie of path
+// components built from the file lists of the addons. Lookups cost a hash lookup per component
+// instead of a search through every file of every addon. Nothing changes it once it's built, so
+// any thread can look up files in it.
+class AddonIndex
+{
+public:
+	struct Addon
+	{
+		std::string title;
+		uint64_t wsid = 0;
+	};
+
+	typedef uint32_t AddonId;
+
+	static constexpr AddonId invalid_addon = UINT32_MAX;
+
+	AddonIndex( );
+
+	AddonId AddAddon( std::string_view title, uint64_t wsid );
+
+	// Files already owned by another addon keep their owner, the same as searching the addons in
+	// the order they were added.
+	void AddFile( AddonId addon, std::string_view path );
+
+	// Addons whose file list couldn't be read, lookups that miss can't tell they aren't theirs.
+	void SetIncomplete( );
+	bool IsIncomplete( ) const;
+
+	// Returns the owner of path, nullptr if no addon has it. Paths are compared case insensitively,
+	// '\\' is the same as '/' and a leading '@' (like the sources of Lua functions) is ignored.
+	const Addon *Find( std::string_view path ) const;
+
+	size_t GetAddonCount( ) const;
+	size_t GetFileCount( ) const;
+
+private:
+	typedef uint32_t Node;
+
+	static constexpr Node root = 0;
+
+	std::vector<Addon> addons;
+	StringPool components;
+	// (parent node << 32 | component id) to child node
+	std::unordered_map<uint64_t, Node> children;
+	// owner of every node, only files have one
+	std::vector<AddonId> owners;
+	size_t files = 0;
+	bool incomplete = false;
+};
+
+// Remembers the owners of recently looked up paths in a direct mapped table, so attributing
+// the same sources over and over costs a hash and a compare. Not thread safe.
+class AddonLookupCache
+{
+public:
+	explicit AddonLookupCache( size_t capacity = 1024 );
+
+	// Looks path up in index, through the cache. Clear must be called when index changes.
+	const AddonIndex::Addon *Find( const AddonIndex &index, std::string_view path );
+
+	void Clear( );
+
+private:
+	struct Entry
+	{
+		uint64_t hash = 0;
+		std::string path;
+		const AddonIndex::Addon *owner = nullptr;
+		bool used = false;
+	};
+
+	std::vector<Entry> entries;
+	size_t mask = 0;
+};
+
+// Writes wsid in decimal, the way workshop IDs are handed to Lua (they don't fit a double), and
+// returns buffer.
+const char *FormatWorkshopId( uint64_t wsid, char ( &buffer )[21] );
+
+// Calls function with the path of every file packed in a .gma (Garry's Mod addon) file, reading
+// only its header. Returns false if file isn't a .gma or its header is truncated.
+bool ReadGmaFileList( std::FILE *file, const std::function<void( std::string_view path )> &function );
+
+}
@@ -0,0 +1,60 @@
+#include "arena.hpp"
+
+#include <cstring>
+
+namespace common
+{
+
+ErrorArena::ErrorArena( const size_t size ) :
+	block_size( size != 0 ? size : 1024 )
+{ }
+
+void *ErrorArena::Allocate( const size_t size, const size_t alignment )
+{
+	// the same sequence of allocations walks the same blocks, so it never appends after warming up
+	for( ; current < blocks.size( ); ++current, used = 0 )
+	{
+		Block &block = blocks[current];
+		const uintptr_t base = reinterpret_cast<uintptr_t>( block.data.get( ) );
+		const uintptr_t aligned = ( base + used + alignment - 1 ) & ~static_cast<uintptr_t>( alignment - 1 );
+		const size_t offset = static_cast<size_t>( aligned - base );
+		if( offset <= block.size && block.size - offset >= size )
+		{
+			used = offset + size;
+			return block.data.get( ) + offset;
+		}
+	}
+
+	const size_t new_size = size + alignment > block_size ? size + alignment : block_size;
+	blocks.push_back( { std::unique_ptr<uint8_t[]>( new uint8_t[new_size] ), new_size } );
+	current = blocks.size( ) - 1;
+	used = 0;
+	return Allocate( size, alignment );
+}
+
+const char *ErrorArena::CopyString( std::string_view text )
+{
+	char *copy = static_cast<char *>( Allocate( text.size( ) + 1, 1 ) );
+	if( !text.empty( ) )
+		std::memcpy( copy, text.data( ), text.size( ) );
+
+	copy[text.size( )] = '\0';
+	return copy;
+}
+
+void ErrorArena::Reset( )
+{
+	current = 0;
+	used = 0;
+}
+
+size_t ErrorArena::GetCapacity( ) const
+{
+	size_t capacity = 0;
+	for( const Block &block : blocks )
+		capacity += block.size;
+
+	return capacity;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// Bump allocator for the data of the error being dispatched, reset once it's done. Blocks are
+// kept across resets, so once the arena has grown to fit the largest error it's given, handling
+// errors doesn't touch the global allocator anymore.
+class ErrorArena
+{
+public:
+	explicit ErrorArena( size_t block_size = 16 * 1024 );
+
+	ErrorArena( const ErrorArena & ) = delete;
+	ErrorArena &operator=( const ErrorArena & ) = delete;
+
+	void *Allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+
+	// Null terminated copy of text, for APIs that want C strings (like pushing to Lua).
+	const char *CopyString( std::string_view text );
+
+	// Makes every allocation available again, keeping the blocks.
+	void Reset( );
+
+	// Bytes held by the blocks.
+	size_t GetCapacity( ) const;
+
+	// Resets the arena when leaving the scope of a dispatch.
+	class Scope
+	{
+	public:
+		explicit Scope( ErrorArena &target ) :
+			arena( target )
+		{ }
+
+		~Scope( )
+		{
+			arena.Reset( );
+		}
+
+		Scope( const Scope & ) = delete;
+		Scope &operator=( const Scope & ) = delete;
+
+	private:
+		ErrorArena &arena;
+	};
+
+private:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> data;
+		size_t size;
+	};
+
+	size_t block_size;
+	std::vector<Block> blocks;
+	size_t current = 0;
+	size_t used = 0;
+};
+
+}
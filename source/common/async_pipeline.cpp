@@ -0,0 +1,185 @@
+#include "async_pipeline.hpp"
+#include "fingerprint.hpp"
+
+#include <utility>
+
+namespace common
+{
+
+// Upper bound on how long a wake up can be missed, the producer doesn't lock anything when
+// notifying so the worker may start sleeping right after a record was pushed.
+static constexpr std::chrono::milliseconds worker_sleep( 5 );
+
+AsyncErrorPipeline::AsyncErrorPipeline( const size_t capacity ) :
+	input( capacity ),
+	output( capacity )
+{ }
+
+AsyncErrorPipeline::~AsyncErrorPipeline( )
+{
+	Stop( );
+}
+
+void AsyncErrorPipeline::SetAddonResolver( AddonResolver resolver )
+{
+	const bool running = IsRunning( );
+	if( running )
+		Stop( );
+
+	addon_resolver = std::move( resolver );
+
+	if( running )
+		Start( );
+}
+
+void AsyncErrorPipeline::Start( )
+{
+	if( worker.joinable( ) )
+		return;
+
+	stopping.store( false, std::memory_order_relaxed );
+	worker = std::thread( &AsyncErrorPipeline::WorkerLoop, this );
+}
+
+void AsyncErrorPipeline::Stop( )
+{
+	if( !worker.joinable( ) )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( wake_mutex );
+		stopping.store( true, std::memory_order_relaxed );
+	}
+
+	wake_condition.notify_one( );
+	worker.join( );
+}
+
+bool AsyncErrorPipeline::IsRunning( ) const
+{
+	return worker.joinable( );
+}
+
+AsyncErrorPipeline::Record *AsyncErrorPipeline::Prepare( )
+{
+	Record *record = input.Prepare( );
+	if( record == nullptr )
+		dropped.fetch_add( 1, std::memory_order_relaxed );
+
+	return record;
+}
+
+void AsyncErrorPipeline::Push( )
+{
+	input.Push( );
+	pushed.fetch_add( 1, std::memory_order_relaxed );
+	if( sleeping.load( std::memory_order_acquire ) )
+		wake_condition.notify_one( );
+}
+
+bool AsyncErrorPipeline::HasOutput( ) const
+{
+	return !output.IsEmpty( );
+}
+
+bool AsyncErrorPipeline::Flush( const std::chrono::milliseconds timeout )
+{
+	const auto deadline = std::chrono::steady_clock::now( ) + timeout;
+	const uint64_t target = pushed.load( std::memory_order_relaxed );
+	while( processed.load( std::memory_order_acquire ) < target )
+	{
+		if( !IsRunning( ) || std::chrono::steady_clock::now( ) >= deadline )
+			return false;
+
+		std::this_thread::yield( );
+	}
+
+	return true;
+}
+
+AsyncErrorPipeline::Stats AsyncErrorPipeline::GetStats( ) const
+{
+	Stats stats;
+	stats.pushed = pushed.load( std::memory_order_relaxed );
+	stats.dropped = dropped.load( std::memory_order_relaxed );
+	stats.processed = processed.load( std::memory_order_relaxed );
+	stats.delivered = delivered.load( std::memory_order_relaxed );
+	return stats;
+}
+
+void AsyncErrorPipeline::WorkerLoop( )
+{
+	while( !stopping.load( std::memory_order_relaxed ) )
+	{
+		Record *record = input.Front( );
+		Record *result = record != nullptr ? output.Prepare( ) : nullptr;
+		if( result == nullptr )
+		{
+			std::unique_lock<std::mutex> lock( wake_mutex );
+			sleeping.store( true, std::memory_order_seq_cst );
+			// check again now that producers can see we're about to sleep
+			if( !stopping.load( std::memory_order_relaxed ) &&
+				( input.IsEmpty( ) || output.Prepare( ) == nullptr ) )
+				wake_condition.wait_for( lock, worker_sleep );
+
+			sleeping.store( false, std::memory_order_relaxed );
+			continue;
+		}
+
+		// swapping hands the result slot's old buffers back to the input queue
+		std::swap( *record, *result );
+		input.Pop( );
+
+		Process( *result );
+		output.Push( );
+		processed.fetch_add( 1, std::memory_order_release );
+	}
+}
+
+void AsyncErrorPipeline::Process( Record &record )
+{
+	ParsedErrorWithStackTrace &parsed_error = record.parsed_error;
+	if( record.client >= 0 )
+	{
+		record.parsed = ParseErrorWithStackTrace( record.error, parsed_error );
+		if( !record.parsed )
+		{
+			parsed_error.source_file.clear( );
+			parsed_error.source_line = -1;
+			parsed_error.error_string.clear( );
+			parsed_error.addon_name.clear( );
+			parsed_error.stack_trace.clear( );
+		}
+	}
+	else
+	{
+		ParsedErrorView parsed_error_view;
+		record.parsed = ParseError( std::string_view( record.error ), parsed_error_view );
+		if( !record.parsed )
+		{
+			parsed_error_view = ParsedErrorView( );
+			parsed_error_view.error_string = record.error;
+		}
+
+		parsed_error.source_file.assign( parsed_error_view.source_file.data( ), parsed_error_view.source_file.size( ) );
+		parsed_error.source_line = parsed_error_view.source_line;
+		parsed_error.error_string.assign( parsed_error_view.error_string.data( ), parsed_error_view.error_string.size( ) );
+	}
+
+	uint64_t fingerprint = FingerprintError( parsed_error.source_file, parsed_error.source_line, parsed_error.error_string );
+	for( const auto &frame : parsed_error.stack_trace )
+		fingerprint = FingerprintStackFrame( fingerprint, frame.source, frame.currentline );
+
+	record.fingerprint = fingerprint;
+
+	record.addon_title.clear( );
+	record.addon_wsid = 0;
+	if( record.client < 0 && addon_resolver && !parsed_error.source_file.empty( ) &&
+		!addon_resolver( parsed_error.source_file, record.addon_title, record.addon_wsid ) )
+	{
+		record.addon_title.clear( );
+		record.addon_wsid = 0;
+	}
+}
+
+}
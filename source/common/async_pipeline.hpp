@@ -0,0 +1,127 @@
+#pragma once
+
+#include "common.hpp"
+#include "spsc_queue.hpp"
+#include "staging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace common
+{
+
+// Moves parsing, fingerprinting and addon attribution of errors off the game thread.
+// The game thread fills records with the raw error (and, for Lua errors, the stack it captured)
+// and pushes them into a lock-free queue, a worker thread processes them into a second queue,
+// which the game thread drains whenever it wants to deliver them (like once per tick).
+// Records are preallocated and their strings keep their capacity as they go around both queues.
+class AsyncErrorPipeline
+{
+public:
+	struct Record
+	{
+		// Filled by the producer
+
+		std::string error;
+		bool runtime = false;
+		// Entity index of the client that sent the error, -1 for errors of this realm
+		int32_t client = -1;
+		// Client errors carry their stack trace in error, it's parsed from there by the worker.
+		// Errors of this realm have their stack captured natively by the producer into parsed_error.stack_trace.
+		ParsedErrorWithStackTrace parsed_error;
+
+		// Filled by the worker
+
+		bool parsed = false;
+		uint64_t fingerprint = 0;
+		std::string addon_title;
+		uint64_t addon_wsid = 0;
+	};
+
+	struct Stats
+	{
+		uint64_t pushed = 0;
+		// Records that didn't fit in the input queue
+		uint64_t dropped = 0;
+		uint64_t processed = 0;
+		uint64_t delivered = 0;
+	};
+
+	// capacity is rounded up to a power of two and is the size of each of the queues
+	explicit AsyncErrorPipeline( size_t capacity = 1024 );
+	~AsyncErrorPipeline( );
+
+	AsyncErrorPipeline( const AsyncErrorPipeline & ) = delete;
+	AsyncErrorPipeline &operator=( const AsyncErrorPipeline & ) = delete;
+
+	// The resolver runs on the worker thread.
+	void SetAddonResolver( AddonResolver resolver );
+
+	// Starts or stops the worker thread. Records pushed while it's stopped are processed once it starts.
+	void Start( );
+	void Stop( );
+	bool IsRunning( ) const;
+
+	// Producer thread only. Returns the record to fill or nullptr (counted as dropped) when the
+	// input queue is full. The record is only handed to the worker once Push is called.
+	Record *Prepare( );
+	void Push( );
+
+	// Consumer thread only. Calls function with up to max_records processed records (in order)
+	// and returns how many it went through. Records are reused once function returns.
+	template<typename Function>
+	size_t Drain( Function function, size_t max_records = SIZE_MAX )
+	{
+		size_t count = 0;
+		Record *record = nullptr;
+		while( count < max_records && ( record = output.Front( ) ) != nullptr )
+		{
+			function( static_cast<const Record &>( *record ) );
+			output.Pop( );
+			++count;
+		}
+
+		delivered.fetch_add( count, std::memory_order_relaxed );
+		// the worker may be waiting for room in the output queue
+		if( count != 0 && sleeping.load( std::memory_order_acquire ) )
+			wake_condition.notify_one( );
+
+		return count;
+	}
+
+	bool HasOutput( ) const;
+
+	// Blocks until every pushed record was processed, for tests and shutdown paths.
+	// Returns false if the worker isn't running or the output queue is full.
+	bool Flush( std::chrono::milliseconds timeout );
+
+	Stats GetStats( ) const;
+
+private:
+	void WorkerLoop( );
+	void Process( Record &record );
+
+	SpscQueue<Record> input;
+	SpscQueue<Record> output;
+	AddonResolver addon_resolver;
+
+	std::thread worker;
+	std::mutex wake_mutex;
+	std::condition_variable wake_condition;
+	std::atomic<bool> stopping{ false };
+	std::atomic<bool> sleeping{ false };
+
+	std::atomic<uint64_t> pushed{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+	std::atomic<uint64_t> processed{ 0 };
+	std::atomic<uint64_t> delivered{ 0 };
+};
+
+}
@@ -0,0 +1,50 @@
+#include "batch.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace common
+{
+
+static constexpr size_t batch_grain = 64;
+
+inline size_t ParseErrorsRange(
+	const Span<const std::string_view> &errors,
+	const Span<BatchParseResult> &results,
+	const size_t begin,
+	const size_t end
+)
+{
+	thread_local ParsedErrorWithStackTraceView parsed_error_view;
+
+	size_t parsed = 0;
+	for( size_t k = begin; k < end; ++k )
+	{
+		BatchParseResult &result = results[k];
+		result.success = ParseErrorWithStackTrace( errors[k], parsed_error_view );
+		if( result.success )
+		{
+			CopyParsedError( parsed_error_view, result.parsed_error );
+			++parsed;
+		}
+	}
+
+	return parsed;
+}
+
+size_t ParseErrorsBatch( Span<const std::string_view> errors, Span<BatchParseResult> results, ThreadPool *pool )
+{
+	const size_t count = std::min( errors.size( ), results.size( ) );
+	if( pool == nullptr || pool->GetConcurrency( ) == 1 || count <= batch_grain )
+		return ParseErrorsRange( errors, results, 0, count );
+
+	std::atomic<size_t> parsed( 0 );
+	pool->ParallelFor( count, batch_grain, [&] ( const size_t begin, const size_t end )
+	{
+		parsed.fetch_add( ParseErrorsRange( errors, results, begin, end ), std::memory_order_relaxed );
+	} );
+	return parsed.load( std::memory_order_relaxed );
+}
+
+}
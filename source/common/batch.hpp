@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.hpp"
+#include "span.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace common
+{
+
+class ThreadPool;
+
+struct BatchParseResult
+{
+	bool success = false;
+	ParsedErrorWithStackTrace parsed_error;
+};
+
+// Parses errors[k] into results[k] with ParseErrorWithStackTrace, for as many errors as there are results.
+// The work is spread over pool when one is given, otherwise everything runs on the calling thread.
+// Every thread parses into its own reused scratch space and results keep their string capacity,
+// so parsing into the same results over and over barely allocates. Returns how many errors were parsed.
+size_t ParseErrorsBatch( Span<const std::string_view> errors, Span<BatchParseResult> results, ThreadPool *pool = nullptr );
+
+}
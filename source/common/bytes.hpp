@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// Little endian encoding helpers shared by the binary formats (staged errors, journals).
+
+inline void PutBytes( std::vector<uint8_t> &buffer, const uint64_t value, const size_t size )
+{
+	for( size_t k = 0; k < size; ++k )
+		buffer.push_back( static_cast<uint8_t>( value >> ( k * 8 ) ) );
+}
+
+// 32 bits size followed by the bytes of text.
+inline void PutString( std::vector<uint8_t> &buffer, std::string_view text )
+{
+	PutBytes( buffer, text.size( ), 4 );
+	buffer.insert( buffer.end( ), text.begin( ), text.end( ) );
+}
+
+inline uint64_t GetBytes( const uint8_t *data, const size_t size )
+{
+	uint64_t value = 0;
+	for( size_t k = 0; k < size; ++k )
+		value |= static_cast<uint64_t>( data[k] ) << ( k * 8 );
+
+	return value;
+}
+
+// Reads from a buffer, failing instead of going past its end.
+class ByteReader
+{
+public:
+	ByteReader( const uint8_t *data, const size_t size ) :
+		current( data ),
+		end( data + size )
+	{ }
+
+	bool Read( uint64_t &value, const size_t size )
+	{
+		if( static_cast<size_t>( end - current ) < size )
+			return false;
+
+		value = GetBytes( current, size );
+		current += size;
+		return true;
+	}
+
+	bool ReadString( std::string_view &text )
+	{
+		uint64_t size = 0;
+		if( !Read( size, 4 ) || static_cast<uint64_t>( end - current ) < size )
+			return false;
+
+		text = std::string_view( reinterpret_cast<const char *>( current ), static_cast<size_t>( size ) );
+		current += size;
+		return true;
+	}
+
+private:
+	const uint8_t *current;
+	const uint8_t *end;
+};
+
+}
@@ -0,0 +1,89 @@
+#include "capture_budget.hpp"
+
+namespace common
+{
+
+void CaptureBudget::SetLimits( const Limits &new_limits )
+{
+	limits = new_limits;
+	if( limits.time < Clock::duration::zero( ) )
+		limits.time = Clock::duration::zero( );
+}
+
+const CaptureBudget::Limits &CaptureBudget::GetLimits( ) const
+{
+	return limits;
+}
+
+bool CaptureBudget::IsEnabled( ) const
+{
+	return limits.time != Clock::duration::zero( ) || limits.bytes != 0;
+}
+
+size_t CaptureBudget::GetSpentLimits( ) const
+{
+	size_t spent = 0;
+	if( limits.time != Clock::duration::zero( ) )
+		spent = static_cast<size_t>( spent_time / limits.time );
+
+	if( limits.bytes != 0 && spent_bytes / limits.bytes > spent )
+		spent = spent_bytes / limits.bytes;
+
+	return spent;
+}
+
+CaptureBudget::Level CaptureBudget::Select( ) const
+{
+	if( !IsEnabled( ) )
+		return Level::Full;
+
+	// the frames only level gets as much budget again as the full one
+	const size_t spent = GetSpentLimits( );
+	if( spent == 0 )
+		return Level::Full;
+
+	return spent == 1 ? Level::Frames : Level::TopFrame;
+}
+
+void CaptureBudget::Spend( const Level level, const Clock::duration time, const size_t bytes )
+{
+	++counts[static_cast<size_t>( level )];
+	if( time > Clock::duration::zero( ) )
+		spent_time += time;
+
+	spent_bytes += bytes;
+}
+
+void CaptureBudget::Reset( )
+{
+	spent_time = Clock::duration::zero( );
+	spent_bytes = 0;
+}
+
+uint64_t CaptureBudget::GetCount( const Level level ) const
+{
+	return counts[static_cast<size_t>( level )];
+}
+
+void CaptureBudget::ClearCounts( )
+{
+	for( uint64_t &count : counts )
+		count = 0;
+}
+
+const char *CaptureBudget::GetLevelName( const Level level )
+{
+	switch( level )
+	{
+		case Level::Full:
+			return "full";
+
+		case Level::Frames:
+			return "frames";
+
+		default:
+			return "top";
+	}
+}
+
+}
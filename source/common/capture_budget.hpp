@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace common
+{
+
+// Limits how much time and memory capturing stacks can take per tick, so error storms (mass addon
+// failures, compile errors at map load, runaway timers) don't eat the frame. Captures get the full
+// stack until the tick's budget is spent, then only the fields of every frame until it's spent
+// again, then only the top frame until the next tick. Game thread only.
+class CaptureBudget
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	enum class Level : uint8_t
+	{
+		// every frame with its locals, upvalues and function
+		Full,
+		// every frame, without locals, upvalues or function
+		Frames,
+		// only the frame that raised the error
+		TopFrame
+	};
+
+	static constexpr size_t level_count = 3;
+
+	struct Limits
+	{
+		// zero doesn't limit time
+		Clock::duration time = Clock::duration::zero( );
+		// zero doesn't limit bytes
+		size_t bytes = 0;
+	};
+
+	void SetLimits( const Limits &limits );
+	const Limits &GetLimits( ) const;
+
+	// Whether any limit is set, captures are always full otherwise.
+	bool IsEnabled( ) const;
+
+	// Level the next capture should get, given what was spent this tick.
+	Level Select( ) const;
+
+	// Charges a capture of level to this tick.
+	void Spend( Level level, Clock::duration time, size_t bytes );
+
+	// Starts a new tick.
+	void Reset( );
+
+	// Captures of level since the budget was created or the counts were cleared.
+	uint64_t GetCount( Level level ) const;
+	void ClearCounts( );
+
+	// Text handed to Lua for level: "full", "frames" or "top".
+	static const char *GetLevelName( Level level );
+
+private:
+	// how many times its limit the tick has spent, the highest of time and bytes
+	size_t GetSpentLimits( ) const;
+
+	Limits limits;
+	Clock::duration spent_time = Clock::duration::zero( );
+	size_t spent_bytes = 0;
+	uint64_t counts[level_count] = { };
+};
+
+}
@@ -1,106 +1,252 @@
 #include "common.hpp"
+#include "scan.hpp"
 
-#include <cctype>
-#include <cstdlib>
-#include <functional>
-#include <regex>
-#include <sstream>
+#include <cstdint>
 
 namespace common
 {
 
-inline int32_t StringToInteger( const std::string &strint )
+inline bool IsSpace( const char c )
 {
-	try
+	return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+inline std::string_view Trim( std::string_view s )
+{
+	// remove initial "spaces"
+	while( !s.empty( ) && IsSpace( s.front( ) ) )
+		s.remove_prefix( 1 );
+
+	// remove trailing "spaces"
+	while( !s.empty( ) && IsSpace( s.back( ) ) )
+		s.remove_suffix( 1 );
+
+	return s;
+}
+
+inline bool IsDigit( const char c )
+{
+	return c >= '0' && c <= '9';
+}
+
+// Behaves like StringToInteger for strings matching "-?\d+", returning 0 on overflow.
+inline int32_t DigitsToInteger( std::string_view digits )
+{
+	bool negative = false;
+	if( !digits.empty( ) && digits.front( ) == '-' )
 	{
-		return std::stoi( strint );
+		negative = true;
+		digits.remove_prefix( 1 );
 	}
-	catch( const std::exception & )
-	{
+
+	while( digits.size( ) > 1 && digits.front( ) == '0' )
+		digits.remove_prefix( 1 );
+
+	if( digits.size( ) > 10 )
 		return 0;
-	}
+
+	int64_t value = 0;
+	for( const char c : digits )
+		value = value * 10 + ( c - '0' );
+
+	if( negative )
+		value = -value;
+
+	if( value < INT32_MIN || value > INT32_MAX )
+		return 0;
+
+	return static_cast<int32_t>( value );
 }
 
-inline std::string Trim( const std::string &s )
+bool ParseError( const std::string &error, ParsedError &parsed_error )
 {
-	std::string c = s;
-	auto not_isspace = std::not_fn( isspace );
-	// remote trailing "spaces"
-	c.erase( std::find_if( c.rbegin( ), c.rend( ), not_isspace ).base( ), c.end( ) );
-	// remote initial "spaces"
-	c.erase( c.begin( ), std::find_if( c.begin( ), c.end( ), not_isspace ) );
-	return c;
+	ParsedErrorView parsed_error_view;
+	if( !ParseError( std::string_view( error ), parsed_error_view ) )
+		return false;
+
+	parsed_error.source_file = parsed_error_view.source_file;
+	parsed_error.source_line = parsed_error_view.source_line;
+	parsed_error.error_string = parsed_error_view.error_string;
+	return true;
 }
 
-bool ParseError( const std::string &error, ParsedError &parsed_error )
+// Single pass equivalent of matching "^(.+):(\d+): (.+)$" (ECMAScript) on a line that is known
+// to not contain line terminators ('.' doesn't match them). The first group is greedy, so the
+// rightmost ":<digits>: " followed by at least one character is the separator.
+inline bool ParseErrorLine( std::string_view error, ParsedErrorView &parsed_error )
 {
-	static const std::regex error_parts_regex(
-		"^(.+):(\\d+): (.+)$",
-		std::regex::ECMAScript | std::regex::optimize
-	);
+	const size_t size = error.size( );
+	size_t separator = std::string_view::npos;
+	size_t digits_end = 0;
+	size_t i = error.find( ':', 1 );
+	while( i != std::string_view::npos )
+	{
+		size_t j = i + 1;
+		while( j < size && IsDigit( error[j] ) )
+			++j;
+
+		if( j != i + 1 && j + 2 < size && error[j] == ':' && error[j + 1] == ' ' )
+		{
+			separator = i;
+			digits_end = j;
+		}
+
+		// error[j] might be the start of the next separator
+		i = error.find( ':', j );
+	}
 
-	std::smatch matches;
-	if( !std::regex_search( error, matches, error_parts_regex ) )
+	if( separator == std::string_view::npos )
 		return false;
 
-	parsed_error.source_file = matches[1];
-	parsed_error.source_line = StringToInteger( matches[2] );
-	parsed_error.error_string = matches[3];
+	parsed_error.source_file = error.substr( 0, separator );
+	parsed_error.source_line = DigitsToInteger( error.substr( separator + 1, digits_end - separator - 1 ) );
+	parsed_error.error_string = error.substr( digits_end + 2 );
 	return true;
 }
 
-bool ParseErrorWithStackTrace( const std::string &error, ParsedErrorWithStackTrace &parsed_error )
+bool ParseError( std::string_view error, ParsedErrorView &parsed_error )
 {
-	std::istringstream error_stream( Trim( error ) );
-
-	std::string error_first_line;
-	if( !std::getline( error_stream, error_first_line ) )
+	if( error.find( '\n' ) != std::string_view::npos || error.find( '\r' ) != std::string_view::npos )
 		return false;
 
-	ParsedErrorWithStackTrace temp_parsed_error;
+	return ParseErrorLine( error, parsed_error );
+}
 
-	{
-		static const std::regex client_error_addon_matcher(
-			"^\\[(.+)\\] ",
-			std::regex::ECMAScript | std::regex::optimize
-		);
+// Equivalent to matching "^\[(.+)\] " on the first line of an error.
+inline bool ParseAddonName( std::string_view &line, std::string_view &addon_name )
+{
+	if( line.size( ) < 4 || line[0] != '[' )
+		return false;
+
+	size_t limit = line.find( '\r' );
+	if( limit == std::string_view::npos )
+		limit = line.size( );
 
-		std::smatch matches;
-		if( std::regex_search( error_first_line, matches, client_error_addon_matcher ) )
+	// rightmost "] " that leaves a non-empty name
+	for( size_t k = limit - 1; k >= 3; --k )
+		if( line[k] == ' ' && line[k - 1] == ']' )
 		{
-			temp_parsed_error.addon_name = matches[1];
-			error_first_line.erase( 0, 1 + temp_parsed_error.addon_name.size( ) + 1 + 1 ); // [addon]:space:
+			addon_name = line.substr( 1, k - 2 );
+			line.remove_prefix( k + 1 );
+			return true;
 		}
-	}
 
-	if( !ParseError( error_first_line, temp_parsed_error ) )
-		temp_parsed_error.error_string = error_first_line;
+	return false;
+}
 
-	while( error_stream )
-	{
-		static const std::regex frame_parts_regex(
-			"^\\s+(\\d+)\\. (.+) \\- (.+):(\\-?\\d+)$",
-			std::regex::ECMAScript | std::regex::optimize
-		);
+// Equivalent to matching "^\s+(\d+)\. (.+) \- (.+):(\-?\d+)$" on a stack frame line.
+// Only the level prefix and the line number suffix are read, the rest comes from the delimiters.
+inline bool ParseStackFrame(
+	std::string_view text,
+	const scan::LineDelimiters &delimiters,
+	ParsedErrorWithStackTraceView::StackFrame &frame
+)
+{
+	const size_t end = delimiters.end;
+
+	size_t i = delimiters.begin;
+	while( i < end && IsSpace( text[i] ) )
+		++i;
+
+	const size_t level_start = i;
+	while( i < end && IsDigit( text[i] ) )
+		++i;
+
+	if( level_start == delimiters.begin || i == level_start || i + 1 >= end || text[i] != '.' || text[i + 1] != ' ' )
+		return false;
 
-		std::string frame_line;
-		if( !std::getline( error_stream, frame_line ) )
-			break;
+	const size_t level_end = i;
+	const size_t name_start = i + 2;
+
+	const size_t colon = delimiters.last_colon;
+	if( colon == scan::npos || colon < name_start + 5 )
+		return false;
+
+	size_t line_start = colon + 1;
+	if( line_start < end && text[line_start] == '-' )
+		++line_start;
+
+	if( line_start == end )
+		return false;
 
-		std::smatch matches;
-		if( !std::regex_search( frame_line, matches, frame_parts_regex ) )
+	for( size_t k = line_start; k < end; ++k )
+		if( !IsDigit( text[k] ) )
 			return false;
 
-		temp_parsed_error.stack_trace.emplace_back( ParsedErrorWithStackTrace::StackFrame {
-			StringToInteger( matches[1] ),
-			matches[2],
-			matches[3],
-			StringToInteger( matches[4] )
-		} );
+	const size_t separator = delimiters.separator;
+	if( separator == scan::npos || separator < name_start + 1 )
+		return false;
+
+	if( delimiters.last_carriage_return != scan::npos && delimiters.last_carriage_return >= name_start )
+		return false;
+
+	frame.level = DigitsToInteger( text.substr( level_start, level_end - level_start ) );
+	frame.name = text.substr( name_start, separator - name_start );
+	frame.source = text.substr( separator + 3, colon - separator - 3 );
+	frame.currentline = DigitsToInteger( text.substr( colon + 1, end - colon - 1 ) );
+	return true;
+}
+
+bool ParseErrorWithStackTrace( const std::string &error, ParsedErrorWithStackTrace &parsed_error )
+{
+	// per thread scratch space, so deep stack traces don't reallocate frame storage every time
+	thread_local ParsedErrorWithStackTraceView parsed_error_view;
+	if( !ParseErrorWithStackTrace( std::string_view( error ), parsed_error_view ) )
+		return false;
+
+	CopyParsedError( parsed_error_view, parsed_error );
+	return true;
+}
+
+bool ParseErrorWithStackTrace( std::string_view error, ParsedErrorWithStackTraceView &parsed_error )
+{
+	error = Trim( error );
+	if( error.empty( ) )
+		return false;
+
+	thread_local scan::LineDelimitersBuffer lines;
+	if( !scan::FindLineDelimiters( error, lines ) )
+		return false;
+
+	std::string_view error_first_line = error.substr( 0, lines[0].end );
+
+	parsed_error.addon_name = std::string_view( );
+	ParseAddonName( error_first_line, parsed_error.addon_name );
+
+	// the line delimiters already tell whether there's a carriage return in the first line
+	if( lines[0].last_carriage_return != scan::npos ||
+		!ParseErrorLine( error_first_line, static_cast<ParsedErrorView &>( parsed_error ) ) )
+	{
+		parsed_error.source_file = std::string_view( );
+		parsed_error.source_line = -1;
+		parsed_error.error_string = error_first_line;
 	}
 
-	parsed_error = std::move( temp_parsed_error );
+	parsed_error.stack_trace.clear( );
+	for( size_t k = 1; k < lines.size( ); ++k )
+		if( !ParseStackFrame( error, lines[k], parsed_error.stack_trace.emplace_back( ) ) )
+			return false;
+
 	return true;
 }
 
+void CopyParsedError( const ParsedErrorWithStackTraceView &parsed_error_view, ParsedErrorWithStackTrace &parsed_error )
+{
+	parsed_error.source_file = parsed_error_view.source_file;
+	parsed_error.source_line = parsed_error_view.source_line;
+	parsed_error.error_string = parsed_error_view.error_string;
+	parsed_error.addon_name = parsed_error_view.addon_name;
+
+	parsed_error.stack_trace.resize( parsed_error_view.stack_trace.size( ) );
+	for( size_t k = 0; k < parsed_error_view.stack_trace.size( ); ++k )
+	{
+		const auto &frame_view = parsed_error_view.stack_trace[k];
+		auto &frame = parsed_error.stack_trace[k];
+		frame.level = frame_view.level;
+		frame.name = frame_view.name;
+		frame.source = frame_view.source;
+		frame.currentline = frame_view.currentline;
+	}
+}
+
 }
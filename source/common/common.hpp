@@ -1,7 +1,10 @@
 #pragma once
 
+#include "small_vector.hpp"
+
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace common
@@ -21,6 +24,22 @@ struct ParsedError
 	}
 };
 
+// Same as ParsedError, except the strings point into the buffer that was parsed,
+// which must outlive this object.
+struct ParsedErrorView
+{
+	std::string_view source_file;
+	int32_t source_line = -1;
+	std::string_view error_string;
+
+	inline bool operator==( const ParsedErrorView &rhs ) const
+	{
+		return source_file == rhs.source_file &&
+			source_line == rhs.source_line &&
+			error_string == rhs.error_string;
+	}
+};
+
 struct ParsedErrorWithStackTrace : public ParsedError
 {
 	struct StackFrame
@@ -52,7 +71,47 @@ struct ParsedErrorWithStackTrace : public ParsedError
 	}
 };
 
+// Same as ParsedErrorWithStackTrace, with every string pointing into the parsed buffer.
+// Stack traces of up to 32 frames are kept inline, so typical errors need no allocations.
+struct ParsedErrorWithStackTraceView : public ParsedErrorView
+{
+	struct StackFrame
+	{
+		int32_t level = 0;
+		std::string_view name;
+		std::string_view source;
+		int32_t currentline = -1;
+
+		inline bool operator==( const StackFrame &rhs ) const
+		{
+			return level == rhs.level &&
+				name == rhs.name &&
+				source == rhs.source &&
+				currentline == rhs.currentline;
+		}
+	};
+
+	std::string_view addon_name;
+	SmallVector<StackFrame, 32> stack_trace;
+
+	inline bool operator==( const ParsedErrorWithStackTraceView &rhs ) const
+	{
+		return source_file == rhs.source_file &&
+			source_line == rhs.source_line &&
+			error_string == rhs.error_string &&
+			addon_name == rhs.addon_name &&
+			stack_trace == rhs.stack_trace;
+	}
+};
+
 bool ParseError( const std::string &error, ParsedError &parsed_error );
+bool ParseError( std::string_view error, ParsedErrorView &parsed_error );
 bool ParseErrorWithStackTrace( const std::string &error, ParsedErrorWithStackTrace &parsed_error );
 
+// On failure, parsed_error is left in an unspecified state.
+bool ParseErrorWithStackTrace( std::string_view error, ParsedErrorWithStackTraceView &parsed_error );
+
+// Copies a view into owned strings, reusing whatever capacity parsed_error already has.
+void CopyParsedError( const ParsedErrorWithStackTraceView &parsed_error_view, ParsedErrorWithStackTrace &parsed_error );
+
 }
@@ -0,0 +1,72 @@
+#include "duplicates.hpp"
+
+namespace common
+{
+
+DuplicateFilter::DuplicateFilter( const size_t capacity )
+{
+	size_t sets = 1;
+	while( sets * set_size < capacity )
+		sets *= 2;
+
+	entries.resize( sets * set_size );
+	set_mask = sets - 1;
+}
+
+void DuplicateFilter::SetWindow( const Clock::duration new_window )
+{
+	window = new_window > Clock::duration::zero( ) ? new_window : Clock::duration::zero( );
+}
+
+DuplicateFilter::Clock::duration DuplicateFilter::GetWindow( ) const
+{
+	return window;
+}
+
+bool DuplicateFilter::Check( const uint64_t fingerprint, const Clock::time_point now, uint32_t &repeats )
+{
+	repeats = 0;
+	if( window == Clock::duration::zero( ) )
+		return true;
+
+	// fingerprints are hashes already, the top bits pick the set
+	Entry *set = &entries[( ( fingerprint >> 32 ) & set_mask ) * set_size];
+	Entry *victim = set;
+	for( size_t k = 0; k < set_size; ++k )
+	{
+		Entry &entry = set[k];
+		if( entry.used && entry.fingerprint == fingerprint )
+		{
+			entry.last_seen = now;
+			if( now - entry.last_dispatch < window )
+			{
+				++entry.suppressed;
+				++entry.total_suppressed;
+				return false;
+			}
+
+			repeats = entry.suppressed;
+			entry.suppressed = 0;
+			entry.last_dispatch = now;
+			return true;
+		}
+
+		if( victim->used && ( !entry.used || entry.last_seen < victim->last_seen ) )
+			victim = &entry;
+	}
+
+	*victim = Entry( );
+	victim->fingerprint = fingerprint;
+	victim->last_dispatch = now;
+	victim->last_seen = now;
+	victim->used = true;
+	return true;
+}
+
+void DuplicateFilter::Clear( )
+{
+	for( auto &entry : entries )
+		entry = Entry( );
+}
+
+}
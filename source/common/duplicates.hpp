@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace common
+{
+
+// Remembers recently dispatched error fingerprints in a fixed size, 4-way set associative table
+// (the least recently seen entry of a set is evicted) and suppresses repeats inside a time window.
+// Suppressed repeats are only reported by the next Check that dispatches the same fingerprint, the
+// count of an entry that's evicted or never seen again stays pending until then and is lost with it.
+class DuplicateFilter
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Entry
+	{
+		uint64_t fingerprint = 0;
+		Clock::time_point last_dispatch;
+		Clock::time_point last_seen;
+		// suppressed since the last dispatch
+		uint32_t suppressed = 0;
+		uint64_t total_suppressed = 0;
+		bool used = false;
+	};
+
+	// capacity is rounded up to a multiple of the set size
+	explicit DuplicateFilter( size_t capacity = 1024 );
+
+	// A window of zero disables suppression.
+	void SetWindow( Clock::duration window );
+	Clock::duration GetWindow( ) const;
+
+	// Returns whether an error with this fingerprint should be dispatched at time now.
+	// When it should, repeats is set to how many times it was suppressed since its last dispatch.
+	bool Check( uint64_t fingerprint, Clock::time_point now, uint32_t &repeats );
+
+	template<typename Function>
+	void ForEach( Function function ) const
+	{
+		for( const auto &entry : entries )
+			if( entry.used )
+				function( entry );
+	}
+
+	void Clear( );
+
+private:
+	static constexpr size_t set_size = 4;
+
+	Clock::duration window = Clock::duration::zero( );
+	std::vector<Entry> entries;
+	size_t set_mask = 0;
+};
+
+}
@@ -0,0 +1,305 @@
+#include "exporter.hpp"
+#include "json.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#if !defined _WIN32
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#endif
+
+namespace common
+{
+
+#if defined _WIN32
+
+struct ErrorExporter::Peer
+{ };
+
+#else
+
+struct ErrorExporter::Peer
+{
+	sockaddr_storage address;
+	socklen_t size = 0;
+};
+
+static bool ParseAddress( std::string_view text, sockaddr_storage &address, socklen_t &size, std::string &error )
+{
+	std::memset( &address, 0, sizeof( address ) );
+
+	if( text.compare( 0, 5, "unix:" ) == 0 )
+	{
+		const std::string_view path = text.substr( 5 );
+		sockaddr_un &unix_address = reinterpret_cast<sockaddr_un &>( address );
+		if( path.empty( ) || path.size( ) >= sizeof( unix_address.sun_path ) )
+		{
+			error = "invalid unix socket path";
+			return false;
+		}
+
+		unix_address.sun_family = AF_UNIX;
+		std::memcpy( unix_address.sun_path, path.data( ), path.size( ) );
+		size = static_cast<socklen_t>( offsetof( sockaddr_un, sun_path ) + path.size( ) + 1 );
+		return true;
+	}
+
+	if( text.compare( 0, 4, "udp:" ) == 0 )
+	{
+		const std::string_view host_port = text.substr( 4 );
+		const size_t colon = host_port.rfind( ':' );
+		sockaddr_in &inet_address = reinterpret_cast<sockaddr_in &>( address );
+		inet_address.sin_family = AF_INET;
+
+		uint32_t port = 0;
+		bool valid = colon != std::string_view::npos && colon + 1 < host_port.size( ) && host_port.size( ) - colon - 1 <= 5;
+		for( size_t k = colon + 1; valid && k < host_port.size( ); ++k )
+		{
+			valid = host_port[k] >= '0' && host_port[k] <= '9';
+			port = port * 10 + static_cast<uint32_t>( host_port[k] - '0' );
+		}
+
+		const std::string host( valid ? host_port.substr( 0, colon ) : std::string_view( ) );
+		if( !valid || port == 0 || port > 65535 || inet_pton( AF_INET, host.c_str( ), &inet_address.sin_addr ) != 1 )
+		{
+			error = "invalid udp address, expected udp:<ipv4 address>:<port>";
+			return false;
+		}
+
+		inet_address.sin_port = htons( static_cast<uint16_t>( port ) );
+		size = sizeof( sockaddr_in );
+		return true;
+	}
+
+	error = "unknown address scheme, expected unix:<path> or udp:<ipv4 address>:<port>";
+	return false;
+}
+
+#endif
+
+ErrorExporter::ErrorExporter( ) :
+	peer( new Peer )
+{ }
+
+ErrorExporter::~ErrorExporter( )
+{
+	Close( );
+}
+
+bool ErrorExporter::IsSupported( )
+{
+#if defined _WIN32
+	return false;
+#else
+	return true;
+#endif
+}
+
+void ErrorExporter::SetAddonResolver( AddonResolver resolver )
+{
+	if( !exporter.joinable( ) )
+		addon_resolver = std::move( resolver );
+}
+
+bool ErrorExporter::Open( const Options &new_options, std::string &error )
+{
+	if( exporter.joinable( ) )
+	{
+		error = "exporter is already open";
+		return false;
+	}
+
+#if defined _WIN32
+
+	(void)new_options;
+	error = "exporting errors isn't supported on this platform";
+	return false;
+
+#else
+
+	if( !ParseAddress( new_options.address, peer->address, peer->size, error ) )
+		return false;
+
+	// not connected, so the collector can come up (or restart) after the exporter was opened
+	socket = ::socket( peer->address.ss_family, SOCK_DGRAM, 0 );
+	if( socket == -1 )
+	{
+		error = "unable to create socket: ";
+		error += std::strerror( errno );
+		return false;
+	}
+
+	const int flags = fcntl( socket, F_GETFL, 0 );
+	if( flags == -1 || fcntl( socket, F_SETFL, flags | O_NONBLOCK ) == -1 ||
+		fcntl( socket, F_SETFD, FD_CLOEXEC ) == -1 )
+	{
+		error = "unable to make socket non-blocking: ";
+		error += std::strerror( errno );
+		::close( socket );
+		socket = -1;
+		return false;
+	}
+
+	options = new_options;
+	if( options.max_batch_records == 0 )
+		options.max_batch_records = 1;
+
+	line.reserve( 4096 );
+	datagram.reserve( options.max_datagram_bytes );
+	datagram_records = 0;
+	stager.Open( options.buffer_bytes, options.max_batch_records );
+	exporter = std::thread( &ErrorExporter::ExporterLoop, this );
+	return true;
+
+#endif
+}
+
+void ErrorExporter::Close( )
+{
+	if( !exporter.joinable( ) )
+		return;
+
+	stager.Close( );
+	exporter.join( );
+
+#if !defined _WIN32
+	::close( socket );
+#endif
+	socket = -1;
+}
+
+bool ErrorExporter::IsOpen( ) const
+{
+	return exporter.joinable( );
+}
+
+bool ErrorExporter::Append(
+	const uint64_t time,
+	const bool runtime,
+	const int32_t client,
+	std::string_view error,
+	Span<const ParsedErrorWithStackTraceView::StackFrame> stack
+)
+{
+	return stager.Append( time, runtime, client, error, stack );
+}
+
+bool ErrorExporter::Flush( const std::chrono::milliseconds timeout )
+{
+	return exporter.joinable( ) && stager.Flush( timeout );
+}
+
+ErrorExporter::Stats ErrorExporter::GetStats( ) const
+{
+	Stats stats;
+	stats.appended = stager.GetAppended( );
+	stats.dropped = stager.GetDropped( );
+	stats.sent_records = sent_records.load( std::memory_order_relaxed );
+	stats.sent_batches = sent_batches.load( std::memory_order_relaxed );
+	stats.dropped_records = dropped_records.load( std::memory_order_relaxed );
+	stats.send_errors = send_errors.load( std::memory_order_relaxed );
+	return stats;
+}
+
+void ErrorExporter::ExporterLoop( )
+{
+	do
+	{
+		stager.Take( batch, options.max_batch_delay );
+		if( !batch.rows.empty( ) )
+			SendStaged( batch.rows );
+
+		stager.Release( batch );
+	}
+	while( !batch.last );
+}
+
+void ErrorExporter::SendStaged( const std::vector<uint8_t> &staged )
+{
+	StagedErrorReader reader( staged.data( ), staged.size( ), &addon_resolver );
+	while( reader.Next( record ) )
+	{
+		line.clear( );
+		AppendErrorJson( line, record, options.tag, options.fold_stack );
+		line += '\n';
+
+		if( line.size( ) > options.max_datagram_bytes )
+		{
+			dropped_records.fetch_add( 1, std::memory_order_relaxed );
+			continue;
+		}
+
+		if( datagram.size( ) + line.size( ) > options.max_datagram_bytes )
+			SendBatch( );
+
+		datagram += line;
+		if( ++datagram_records >= options.max_batch_records )
+			SendBatch( );
+	}
+
+	SendBatch( );
+}
+
+void ErrorExporter::SendBatch( )
+{
+	if( datagram_records == 0 )
+		return;
+
+#if !defined _WIN32
+
+	const auto deadline = std::chrono::steady_clock::now( ) + options.backpressure_timeout;
+	std::chrono::milliseconds backoff( 1 );
+	while( true )
+	{
+		const ssize_t sent = sendto(
+			socket,
+			datagram.data( ),
+			datagram.size( ),
+			0,
+			reinterpret_cast<const sockaddr *>( &peer->address ),
+			peer->size
+		);
+		if( sent >= 0 )
+		{
+			sent_records.fetch_add( datagram_records, std::memory_order_relaxed );
+			sent_batches.fetch_add( 1, std::memory_order_relaxed );
+			break;
+		}
+
+		if( errno == EINTR )
+			continue;
+
+		// the collector isn't reading fast enough, give it a moment before dropping the batch
+		const bool backpressure = errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+		if( backpressure && std::chrono::steady_clock::now( ) + backoff <= deadline )
+		{
+			std::this_thread::sleep_for( backoff );
+			if( backoff < std::chrono::milliseconds( 16 ) )
+				backoff *= 2;
+
+			continue;
+		}
+
+		if( !backpressure )
+			send_errors.fetch_add( 1, std::memory_order_relaxed );
+
+		dropped_records.fetch_add( datagram_records, std::memory_order_relaxed );
+		break;
+	}
+
+#endif
+
+	datagram.clear( );
+	datagram_records = 0;
+}
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "common.hpp"
+#include "span.hpp"
+#include "staging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+
+// Sends errors to an external collector as batches of JSON lines (see AppendErrorJson), one batch
+// per datagram. Producers only stage the raw error like JournalWriter does, the exporter thread
+// parses, fingerprints, attributes, serializes and sends them. The socket is non-blocking: a
+// collector that can't keep up gets a short grace period, then batches are dropped and counted,
+// the game never waits on it.
+class ErrorExporter
+{
+public:
+	struct Options
+	{
+		// "unix:<path>" for a Unix domain datagram socket or "udp:<ipv4 address>:<port>"
+		std::string address;
+		// Added to every error as the "server" field, empty to leave it out
+		std::string tag;
+		// A batch is sent once it has this many errors or after max_batch_delay, whichever comes first
+		size_t max_batch_records = 64;
+		std::chrono::milliseconds max_batch_delay = std::chrono::milliseconds( 1000 );
+		// Batches are split so no datagram is larger than this, errors that serialize to more than
+		// this on their own are dropped (and counted in dropped_records)
+		size_t max_datagram_bytes = 60000;
+		// How long a batch is retried while the collector's socket buffer is full, zero drops it right away
+		std::chrono::milliseconds backpressure_timeout = std::chrono::milliseconds( 100 );
+		// Size of the staging buffer, errors that don't fit are dropped
+		size_t buffer_bytes = 1024 * 1024;
+		// Write frames repeated back to back (deep recursion) once, see AppendErrorJson
+		bool fold_stack = false;
+	};
+
+	struct Stats
+	{
+		uint64_t appended = 0;
+		// Errors that didn't fit the staging buffer
+		uint64_t dropped = 0;
+		uint64_t sent_records = 0;
+		uint64_t sent_batches = 0;
+		// Errors of batches the collector didn't take (backpressure, unreachable, too large)
+		uint64_t dropped_records = 0;
+		uint64_t send_errors = 0;
+	};
+
+	ErrorExporter( );
+	~ErrorExporter( );
+
+	ErrorExporter( const ErrorExporter & ) = delete;
+	ErrorExporter &operator=( const ErrorExporter & ) = delete;
+
+	// Whether this platform has the sockets the exporter needs.
+	static bool IsSupported( );
+
+	// Runs on the exporter thread, only used for errors that aren't from clients. Ignored while open.
+	void SetAddonResolver( AddonResolver resolver );
+
+	// Creates the socket and starts the exporter thread. Returns false with a reason in error if
+	// the address is invalid, the socket can't be created or the exporter is already open.
+	bool Open( const Options &options, std::string &error );
+	// Sends whatever is staged and stops the exporter thread.
+	void Close( );
+	bool IsOpen( ) const;
+
+	// Any thread, same contract as JournalWriter::Append.
+	bool Append(
+		uint64_t time,
+		bool runtime,
+		int32_t client,
+		std::string_view error,
+		Span<const ParsedErrorWithStackTraceView::StackFrame> stack = Span<const ParsedErrorWithStackTraceView::StackFrame>( )
+	);
+
+	// Blocks until everything appended so far was sent or dropped, for tests and shutdown paths.
+	bool Flush( std::chrono::milliseconds timeout );
+
+	Stats GetStats( ) const;
+
+private:
+	void ExporterLoop( );
+	void SendStaged( const std::vector<uint8_t> &staged );
+	void SendBatch( );
+
+	struct Peer;
+
+	Options options;
+	AddonResolver addon_resolver;
+	int socket = -1;
+	std::unique_ptr<Peer> peer;
+
+	std::thread exporter;
+	ErrorStager stager;
+
+	// exporter thread only
+	ErrorStager::Batch batch;
+	ErrorRecord record;
+	std::string line;
+	std::string datagram;
+	size_t datagram_records = 0;
+
+	std::atomic<uint64_t> sent_records{ 0 };
+	std::atomic<uint64_t> sent_batches{ 0 };
+	std::atomic<uint64_t> dropped_records{ 0 };
+	std::atomic<uint64_t> send_errors{ 0 };
+};
+
+}
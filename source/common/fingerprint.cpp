@@ -0,0 +1,62 @@
+#include "fingerprint.hpp"
+#include "hash.hpp"
+
+namespace common
+{
+
+uint64_t FingerprintError( std::string_view source_file, const int32_t source_line, std::string_view error_string )
+{
+	uint64_t fingerprint = Hash( source_file );
+	fingerprint = Hash( static_cast<uint64_t>( static_cast<uint32_t>( source_line ) ), fingerprint );
+	return Hash( error_string, fingerprint );
+}
+
+uint64_t FingerprintStackFrame( const uint64_t fingerprint, std::string_view source, const int32_t currentline )
+{
+	return Hash( static_cast<uint64_t>( static_cast<uint32_t>( currentline ) ), Hash( source, fingerprint ) );
+}
+
+uint64_t FingerprintParsedError( const ParsedErrorWithStackTraceView &parsed_error )
+{
+	uint64_t fingerprint = FingerprintError( parsed_error.source_file, parsed_error.source_line, parsed_error.error_string );
+	for( const auto &frame : parsed_error.stack_trace )
+		fingerprint = FingerprintStackFrame( fingerprint, frame.source, frame.currentline );
+
+	return fingerprint;
+}
+
+void FormatFingerprint( const uint64_t fingerprint, char ( &buffer )[17] )
+{
+	static const char digits[] = "0123456789abcdef";
+	for( size_t k = 0; k < 16; ++k )
+		buffer[k] = digits[( fingerprint >> ( ( 15 - k ) * 4 ) ) & 0xF];
+
+	buffer[16] = '\0';
+}
+
+bool ParseFingerprint( std::string_view text, uint64_t &fingerprint )
+{
+	if( text.size( ) != 16 )
+		return false;
+
+	uint64_t value = 0;
+	for( const char c : text )
+	{
+		uint64_t digit = 0;
+		if( c >= '0' && c <= '9' )
+			digit = static_cast<uint64_t>( c - '0' );
+		else if( c >= 'a' && c <= 'f' )
+			digit = static_cast<uint64_t>( c - 'a' + 10 );
+		else if( c >= 'A' && c <= 'F' )
+			digit = static_cast<uint64_t>( c - 'A' + 10 );
+		else
+			return false;
+
+		value = value << 4 | digit;
+	}
+
+	fingerprint = value;
+	return true;
+}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+namespace common
+{
+
+// Stable identity of an error, built from its source, line and message and then
+// extended frame by frame with the stack it was raised from.
+uint64_t FingerprintError( std::string_view source_file, int32_t source_line, std::string_view error_string );
+uint64_t FingerprintStackFrame( uint64_t fingerprint, std::string_view source, int32_t currentline );
+uint64_t FingerprintParsedError( const ParsedErrorWithStackTraceView &parsed_error );
+
+// Writes the fingerprint as 16 lowercase hexadecimal digits plus a null terminator.
+void FormatFingerprint( uint64_t fingerprint, char ( &buffer )[17] );
+bool ParseFingerprint( std::string_view text, uint64_t &fingerprint );
+
+}
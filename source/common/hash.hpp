@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace common
+{
+
+static constexpr uint64_t hash_seed = 14695981039346656037ull;
+
+// 64 bits FNV-1a, stable across runs and platforms.
+inline uint64_t Hash( std::string_view text, uint64_t hash = hash_seed )
+{
+	for( const char c : text )
+	{
+		hash ^= static_cast<uint8_t>( c );
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+inline uint64_t Hash( const uint64_t value, uint64_t hash = hash_seed )
+{
+	for( int32_t k = 0; k < 8; ++k )
+	{
+		hash ^= static_cast<uint8_t>( value >> ( k * 8 ) );
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+}
@@ -0,0 +1,210 @@
+#include "heavy_hitters.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+
+namespace common
+{
+
+HeavyHitters::HeavyHitters( const size_t capacity, const size_t bytes ) :
+	label_bytes( bytes )
+{
+	Configure( capacity, bytes );
+}
+
+void HeavyHitters::Configure( const size_t capacity, const size_t bytes )
+{
+	label_bytes = bytes;
+	size = 0;
+	total = 0;
+
+	size_t slot_count = capacity != 0 ? 2 : 0;
+	while( slot_count != 0 && slot_count < capacity * 2 )
+		slot_count *= 2;
+
+	// swapping actually frees the memory when disabling
+	std::vector<Counter>( capacity ).swap( counters );
+	std::vector<uint32_t>( capacity ).swap( heap );
+	std::vector<uint32_t>( capacity ).swap( positions );
+	std::vector<uint32_t>( slot_count, empty_slot ).swap( slots );
+
+	for( Counter &counter : counters )
+		counter.label.reserve( label_bytes );
+}
+
+bool HeavyHitters::IsEnabled( ) const
+{
+	return !counters.empty( );
+}
+
+size_t HeavyHitters::GetCapacity( ) const
+{
+	return counters.size( );
+}
+
+void HeavyHitters::Add( const uint64_t key, const std::string_view label, const uint64_t weight )
+{
+	if( counters.empty( ) )
+		return;
+
+	total += weight;
+
+	uint32_t index = Find( key );
+	if( index != empty_slot )
+	{
+		counters[index].count += weight;
+		SiftDown( positions[index] );
+		return;
+	}
+
+	if( size < counters.size( ) )
+	{
+		index = static_cast<uint32_t>( size );
+		Counter &counter = counters[index];
+		counter.count = weight;
+		counter.error = 0;
+		heap[size] = index;
+		positions[index] = static_cast<uint32_t>( size );
+		++size;
+		SiftUp( size - 1 );
+	}
+	else
+	{
+		// the key takes over the counter with the lowest count, which bounds how much it missed
+		index = heap[0];
+		Counter &counter = counters[index];
+		Erase( counter.key );
+		counter.error = counter.count;
+		counter.count += weight;
+		SiftDown( 0 );
+	}
+
+	Counter &counter = counters[index];
+	counter.key = key;
+	counter.label.assign( label.data( ), std::min( label.size( ), label_bytes ) );
+	Insert( index );
+}
+
+void HeavyHitters::Clear( )
+{
+	size = 0;
+	total = 0;
+	std::fill( slots.begin( ), slots.end( ), empty_slot );
+}
+
+size_t HeavyHitters::GetSize( ) const
+{
+	return size;
+}
+
+uint64_t HeavyHitters::GetTotal( ) const
+{
+	return total;
+}
+
+void HeavyHitters::GetTop( const size_t k, std::vector<const Counter *> &top ) const
+{
+	top.clear( );
+	for( size_t index = 0; index < size; ++index )
+		top.push_back( &counters[index] );
+
+	const size_t count = std::min( k, top.size( ) );
+	std::partial_sort( top.begin( ), top.begin( ) + static_cast<std::ptrdiff_t>( count ), top.end( ),
+		[]( const Counter *lhs, const Counter *rhs )
+		{
+			// on equal counts, the most certain one first
+			return lhs->count != rhs->count ? lhs->count > rhs->count : lhs->error < rhs->error;
+		}
+	);
+	top.resize( count );
+}
+
+uint32_t HeavyHitters::Find( const uint64_t key ) const
+{
+	const size_t mask = slots.size( ) - 1;
+	for( size_t slot = static_cast<size_t>( Hash( key ) ) & mask; slots[slot] != empty_slot; slot = ( slot + 1 ) & mask )
+		if( counters[slots[slot]].key == key )
+			return slots[slot];
+
+	return empty_slot;
+}
+
+void HeavyHitters::Insert( const uint32_t counter )
+{
+	const size_t mask = slots.size( ) - 1;
+	size_t slot = static_cast<size_t>( Hash( counters[counter].key ) ) & mask;
+	while( slots[slot] != empty_slot )
+		slot = ( slot + 1 ) & mask;
+
+	slots[slot] = counter;
+}
+
+// Removes key from the index, moving back the entries after it that would become unreachable.
+void HeavyHitters::Erase( const uint64_t key )
+{
+	const size_t mask = slots.size( ) - 1;
+	size_t slot = static_cast<size_t>( Hash( key ) ) & mask;
+	while( slots[slot] != empty_slot && counters[slots[slot]].key != key )
+		slot = ( slot + 1 ) & mask;
+
+	if( slots[slot] == empty_slot )
+		return;
+
+	size_t next = ( slot + 1 ) & mask;
+	while( slots[next] != empty_slot )
+	{
+		const size_t home = static_cast<size_t>( Hash( counters[slots[next]].key ) ) & mask;
+		// move it back unless its home lies cyclically in ( slot, next ]
+		if( ( ( next - home ) & mask ) >= ( ( next - slot ) & mask ) )
+		{
+			slots[slot] = slots[next];
+			slot = next;
+		}
+
+		next = ( next + 1 ) & mask;
+	}
+
+	slots[slot] = empty_slot;
+}
+
+void HeavyHitters::SiftUp( size_t position )
+{
+	while( position != 0 )
+	{
+		const size_t parent = ( position - 1 ) / 2;
+		if( counters[heap[parent]].count <= counters[heap[position]].count )
+			return;
+
+		Swap( parent, position );
+		position = parent;
+	}
+}
+
+void HeavyHitters::SiftDown( size_t position )
+{
+	while( true )
+	{
+		size_t smallest = position;
+		const size_t left = position * 2 + 1, right = left + 1;
+		if( left < size && counters[heap[left]].count < counters[heap[smallest]].count )
+			smallest = left;
+
+		if( right < size && counters[heap[right]].count < counters[heap[smallest]].count )
+			smallest = right;
+
+		if( smallest == position )
+			return;
+
+		Swap( position, smallest );
+		position = smallest;
+	}
+}
+
+void HeavyHitters::Swap( const size_t a, const size_t b )
+{
+	std::swap( heap[a], heap[b] );
+	positions[heap[a]] = static_cast<uint32_t>( a );
+	positions[heap[b]] = static_cast<uint32_t>( b );
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// Approximate most frequent keys of an unbounded stream in fixed memory (the Space-Saving
+// algorithm). Every key with more than total / capacity occurrences is guaranteed to have a
+// counter, whose count overestimates its occurrences by at most its error. A key that doesn't
+// have a counter takes over the one with the lowest count once they're all used. Counters and
+// their labels are allocated up front, so adding never allocates. Not thread safe.
+class HeavyHitters
+{
+public:
+	struct Counter
+	{
+		uint64_t key = 0;
+		uint64_t count = 0;
+		// count the key inherited when it took over the counter
+		uint64_t error = 0;
+		// text describing the key, cut to the label size
+		std::string label;
+	};
+
+	explicit HeavyHitters( size_t capacity = 0, size_t label_bytes = 128 );
+
+	HeavyHitters( const HeavyHitters & ) = delete;
+	HeavyHitters &operator=( const HeavyHitters & ) = delete;
+
+	// Allocates capacity counters with labels of up to label_bytes bytes, forgetting every key.
+	// A capacity of zero frees them and disables counting.
+	void Configure( size_t capacity, size_t label_bytes = 128 );
+
+	bool IsEnabled( ) const;
+	size_t GetCapacity( ) const;
+
+	void Add( uint64_t key, std::string_view label, uint64_t weight = 1 );
+
+	// Forgets every key, keeping the counters allocated.
+	void Clear( );
+
+	// Counters in use, at most GetCapacity.
+	size_t GetSize( ) const;
+	// Sum of the weights added since the last Configure or Clear.
+	uint64_t GetTotal( ) const;
+
+	// Replaces the contents of top with the k counters with the highest counts, highest first.
+	void GetTop( size_t k, std::vector<const Counter *> &top ) const;
+
+private:
+	static constexpr uint32_t empty_slot = UINT32_MAX;
+
+	uint32_t Find( uint64_t key ) const;
+	void Insert( uint32_t counter );
+	void Erase( uint64_t key );
+
+	void SiftUp( size_t position );
+	void SiftDown( size_t position );
+	void Swap( size_t a, size_t b );
+
+	size_t label_bytes;
+	size_t size = 0;
+	uint64_t total = 0;
+	std::vector<Counter> counters;
+	// min-heap of counter indices by count and the position of every counter in it
+	std::vector<uint32_t> heap;
+	std::vector<uint32_t> positions;
+	// open addressing index of counters by key, a power of two at least twice the capacity
+	std::vector<uint32_t> slots;
+};
+
+}
@@ -0,0 +1,477 @@
+#include "journal.hpp"
+#include "bytes.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace common
+{
+
+static constexpr size_t header_size = sizeof( journal_magic ) + 4;
+static constexpr size_t block_header_size = 5;
+// time, flags, client, fingerprint, source file, source line, error string, addon and frame count
+static constexpr size_t record_columns_size = 8 + 1 + 4 + 8 + 4 + 4 + 4 + 4 + 4;
+// name, source and current line
+static constexpr size_t frame_columns_size = 4 + 4 + 4;
+
+template<typename T>
+inline void PutColumn( std::vector<uint8_t> &buffer, const std::vector<T> &column )
+{
+	for( const T value : column )
+		PutBytes( buffer, static_cast<uint64_t>( value ), sizeof( T ) );
+}
+
+void JournalWriter::Columns::Clear( )
+{
+	times.clear( );
+	flags.clear( );
+	clients.clear( );
+	fingerprints.clear( );
+	source_files.clear( );
+	source_lines.clear( );
+	error_strings.clear( );
+	addons.clear( );
+	frame_counts.clear( );
+	frame_names.clear( );
+	frame_sources.clear( );
+	frame_lines.clear( );
+}
+
+JournalWriter::~JournalWriter( )
+{
+	Close( );
+}
+
+void JournalWriter::SetAddonResolver( AddonResolver resolver )
+{
+	if( !writer.joinable( ) )
+		addon_resolver = std::move( resolver );
+}
+
+bool JournalWriter::Open( const Options &new_options )
+{
+	if( writer.joinable( ) || new_options.path.empty( ) )
+		return false;
+
+	options = new_options;
+	stager.Open( options.buffer_bytes );
+	writer = std::thread( &JournalWriter::WriterLoop, this );
+	return true;
+}
+
+void JournalWriter::Close( )
+{
+	if( !writer.joinable( ) )
+		return;
+
+	stager.Close( );
+	writer.join( );
+}
+
+bool JournalWriter::IsOpen( ) const
+{
+	return writer.joinable( );
+}
+
+bool JournalWriter::Append(
+	const uint64_t time,
+	const bool runtime,
+	const int32_t client,
+	std::string_view error,
+	Span<const ParsedErrorWithStackTraceView::StackFrame> stack
+)
+{
+	return stager.Append( time, runtime, client, error, stack );
+}
+
+bool JournalWriter::Flush( const std::chrono::milliseconds timeout )
+{
+	return writer.joinable( ) && stager.Flush( timeout );
+}
+
+JournalWriter::Stats JournalWriter::GetStats( ) const
+{
+	Stats stats;
+	stats.appended = stager.GetAppended( );
+	stats.dropped = stager.GetDropped( );
+	stats.written_records = written_records.load( std::memory_order_relaxed );
+	stats.written_bytes = written_bytes.load( std::memory_order_relaxed );
+	stats.rotations = rotations.load( std::memory_order_relaxed );
+	stats.write_errors = write_errors.load( std::memory_order_relaxed );
+	return stats;
+}
+
+uint64_t JournalWriter::Now( )
+{
+	return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now( ).time_since_epoch( )
+	).count( ) );
+}
+
+void JournalWriter::WriterLoop( )
+{
+	OpenFile( );
+
+	do
+	{
+		stager.Take( batch, options.flush_interval );
+		if( !batch.rows.empty( ) )
+			WriteStaged( batch.rows );
+
+		if( file != nullptr && std::fflush( file ) != 0 )
+			write_errors.fetch_add( 1, std::memory_order_relaxed );
+
+		stager.Release( batch );
+	}
+	while( !batch.last );
+
+	if( file != nullptr )
+	{
+		std::fclose( file );
+		file = nullptr;
+	}
+}
+
+void JournalWriter::WriteStaged( const std::vector<uint8_t> &staged )
+{
+	if( file == nullptr && !OpenFile( ) )
+	{
+		write_errors.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	if( file_bytes >= options.max_file_bytes )
+		Rotate( );
+
+	columns.Clear( );
+
+	StagedErrorReader reader( staged.data( ), staged.size( ), &addon_resolver );
+	while( reader.Next( record ) )
+		AddRecord( record );
+
+	if( columns.times.empty( ) )
+		return;
+
+	const StringPool::Id strings = static_cast<StringPool::Id>( dictionary.GetCount( ) );
+	if( strings > written_strings )
+	{
+		block.clear( );
+		PutBytes( block, written_strings, 4 );
+		PutBytes( block, strings - written_strings, 4 );
+		for( StringPool::Id id = written_strings; id < strings; ++id )
+			PutString( block, dictionary.Get( id ) );
+
+		if( !WriteBlock( JournalBlock::Strings, block ) )
+			return;
+
+		written_strings = strings;
+	}
+
+	block.clear( );
+	PutBytes( block, columns.times.size( ), 4 );
+	PutBytes( block, columns.frame_names.size( ), 4 );
+	PutColumn( block, columns.times );
+	PutColumn( block, columns.flags );
+	PutColumn( block, columns.clients );
+	PutColumn( block, columns.fingerprints );
+	PutColumn( block, columns.source_files );
+	PutColumn( block, columns.source_lines );
+	PutColumn( block, columns.error_strings );
+	PutColumn( block, columns.addons );
+	PutColumn( block, columns.frame_counts );
+	PutColumn( block, columns.frame_names );
+	PutColumn( block, columns.frame_sources );
+	PutColumn( block, columns.frame_lines );
+	if( WriteBlock( JournalBlock::Records, block ) )
+		written_records.fetch_add( columns.times.size( ), std::memory_order_relaxed );
+}
+
+void JournalWriter::AddRecord( const JournalRecord &record )
+{
+	const ParsedErrorWithStackTraceView &error = record.error;
+	columns.times.push_back( record.time );
+	columns.flags.push_back( record.flags );
+	columns.clients.push_back( record.client );
+	columns.fingerprints.push_back( record.fingerprint );
+	columns.source_files.push_back( Intern( error.source_file ) );
+	columns.source_lines.push_back( error.source_line );
+	columns.error_strings.push_back( Intern( error.error_string ) );
+	columns.addons.push_back( Intern( error.addon_name ) );
+	columns.frame_counts.push_back( static_cast<uint32_t>( error.stack_trace.size( ) ) );
+	for( const auto &frame : error.stack_trace )
+	{
+		columns.frame_names.push_back( Intern( frame.name ) );
+		columns.frame_sources.push_back( Intern( frame.source ) );
+		columns.frame_lines.push_back( frame.currentline );
+	}
+}
+
+uint32_t JournalWriter::Intern( std::string_view text )
+{
+	const StringPool::Id id = dictionary.Intern( text );
+	return id != StringPool::invalid_id ? id : StringPool::empty_id;
+}
+
+bool JournalWriter::WriteBlock( const JournalBlock type, const std::vector<uint8_t> &payload )
+{
+	if( file == nullptr )
+		return false;
+
+	uint8_t header[block_header_size];
+	for( size_t k = 0; k < 4; ++k )
+		header[k] = static_cast<uint8_t>( payload.size( ) >> ( k * 8 ) );
+
+	header[4] = static_cast<uint8_t>( type );
+	if( std::fwrite( header, 1, sizeof( header ), file ) != sizeof( header ) ||
+		std::fwrite( payload.data( ), 1, payload.size( ), file ) != payload.size( ) )
+	{
+		write_errors.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	file_bytes += sizeof( header ) + payload.size( );
+	written_bytes.fetch_add( sizeof( header ) + payload.size( ), std::memory_order_relaxed );
+	return true;
+}
+
+bool JournalWriter::OpenFile( const bool rotate_existing )
+{
+	std::FILE *existing = rotate_existing ? std::fopen( options.path.c_str( ), "rb" ) : nullptr;
+	if( existing != nullptr )
+	{
+		const bool empty = std::fgetc( existing ) == EOF;
+		std::fclose( existing );
+		if( !empty )
+		{
+			Rotate( );
+			return file != nullptr;
+		}
+	}
+
+	file = std::fopen( options.path.c_str( ), "wb" );
+	if( file == nullptr )
+	{
+		write_errors.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	uint8_t header[header_size];
+	std::memcpy( header, journal_magic, sizeof( journal_magic ) );
+	for( size_t k = 0; k < 4; ++k )
+		header[sizeof( journal_magic ) + k] = static_cast<uint8_t>( journal_version >> ( k * 8 ) );
+
+	if( std::fwrite( header, 1, sizeof( header ), file ) != sizeof( header ) )
+		write_errors.fetch_add( 1, std::memory_order_relaxed );
+
+	file_bytes = sizeof( header );
+	dictionary.Clear( );
+	written_strings = 1;
+	return true;
+}
+
+void JournalWriter::Rotate( )
+{
+	if( file != nullptr )
+	{
+		std::fclose( file );
+		file = nullptr;
+	}
+
+	if( options.max_rotated_files == 0 )
+		std::remove( options.path.c_str( ) );
+	else
+	{
+		std::remove( ( options.path + '.' + std::to_string( options.max_rotated_files ) ).c_str( ) );
+		for( size_t k = options.max_rotated_files - 1; k >= 1; --k )
+			std::rename(
+				( options.path + '.' + std::to_string( k ) ).c_str( ),
+				( options.path + '.' + std::to_string( k + 1 ) ).c_str( )
+			);
+
+		std::rename( options.path.c_str( ), ( options.path + ".1" ).c_str( ) );
+	}
+
+	rotations.fetch_add( 1, std::memory_order_relaxed );
+	OpenFile( false );
+}
+
+JournalReader::~JournalReader( )
+{
+	Close( );
+}
+
+bool JournalReader::Open( const std::string &path )
+{
+	Close( );
+
+	file = std::fopen( path.c_str( ), "rb" );
+	if( file == nullptr )
+		return false;
+
+	uint8_t header[header_size];
+	if( std::fread( header, 1, sizeof( header ), file ) != sizeof( header ) ||
+		std::memcmp( header, journal_magic, sizeof( journal_magic ) ) != 0 ||
+		GetBytes( header + sizeof( journal_magic ), 4 ) != journal_version )
+	{
+		Close( );
+		return false;
+	}
+
+	strings.emplace_back( );
+	return true;
+}
+
+void JournalReader::Close( )
+{
+	if( file != nullptr )
+	{
+		std::fclose( file );
+		file = nullptr;
+	}
+
+	corrupted = false;
+	strings.clear( );
+	record_count = record_index = frame_index = 0;
+}
+
+bool JournalReader::Next( JournalRecord &record )
+{
+	while( record_index == record_count )
+	{
+		JournalBlock type;
+		if( file == nullptr || !ReadBlock( type ) )
+			return false;
+
+		const bool valid = type == JournalBlock::Strings ? ParseStrings( ) :
+			type == JournalBlock::Records ? ParseRecords( ) : true;
+		if( !valid )
+		{
+			corrupted = true;
+			return false;
+		}
+	}
+
+	const size_t k = record_index++;
+	record.time = GetBytes( columns[0] + k * 8, 8 );
+	record.flags = columns[1][k];
+	record.client = static_cast<int32_t>( static_cast<uint32_t>( GetBytes( columns[2] + k * 4, 4 ) ) );
+	record.fingerprint = GetBytes( columns[3] + k * 8, 8 );
+	record.error.source_line = static_cast<int32_t>( static_cast<uint32_t>( GetBytes( columns[5] + k * 4, 4 ) ) );
+
+	const size_t frames = static_cast<size_t>( GetBytes( columns[8] + k * 4, 4 ) );
+	const size_t total_frames = static_cast<size_t>( GetBytes( payload.data( ) + 4, 4 ) );
+	if( !GetString( static_cast<uint32_t>( GetBytes( columns[4] + k * 4, 4 ) ), record.error.source_file ) ||
+		!GetString( static_cast<uint32_t>( GetBytes( columns[6] + k * 4, 4 ) ), record.error.error_string ) ||
+		!GetString( static_cast<uint32_t>( GetBytes( columns[7] + k * 4, 4 ) ), record.error.addon_name ) ||
+		frames > total_frames - frame_index )
+	{
+		corrupted = true;
+		return false;
+	}
+
+	record.error.stack_trace.clear( );
+	for( size_t f = 0; f < frames; ++f, ++frame_index )
+	{
+		ParsedErrorWithStackTraceView::StackFrame frame;
+		frame.level = static_cast<int32_t>( f + 1 );
+		frame.currentline = static_cast<int32_t>( static_cast<uint32_t>( GetBytes( columns[11] + frame_index * 4, 4 ) ) );
+		if( !GetString( static_cast<uint32_t>( GetBytes( columns[9] + frame_index * 4, 4 ) ), frame.name ) ||
+			!GetString( static_cast<uint32_t>( GetBytes( columns[10] + frame_index * 4, 4 ) ), frame.source ) )
+		{
+			corrupted = true;
+			return false;
+		}
+
+		record.error.stack_trace.push_back( frame );
+	}
+
+	return true;
+}
+
+bool JournalReader::IsCorrupted( ) const
+{
+	return corrupted;
+}
+
+bool JournalReader::ReadBlock( JournalBlock &type )
+{
+	uint8_t header[block_header_size];
+	const size_t read = std::fread( header, 1, sizeof( header ), file );
+	if( read != sizeof( header ) )
+	{
+		// a clean end of file falls exactly between blocks
+		corrupted = read != 0;
+		return false;
+	}
+
+	payload.resize( static_cast<size_t>( GetBytes( header, 4 ) ) );
+	type = static_cast<JournalBlock>( header[4] );
+	if( std::fread( payload.data( ), 1, payload.size( ), file ) != payload.size( ) )
+	{
+		corrupted = true;
+		return false;
+	}
+
+	return true;
+}
+
+bool JournalReader::ParseStrings( )
+{
+	if( payload.size( ) < 8 || GetBytes( payload.data( ), 4 ) != strings.size( ) )
+		return false;
+
+	ByteReader reader( payload.data( ) + 8, payload.size( ) - 8 );
+	const size_t count = static_cast<size_t>( GetBytes( payload.data( ) + 4, 4 ) );
+	for( size_t k = 0; k < count; ++k )
+	{
+		std::string_view text;
+		if( !reader.ReadString( text ) )
+			return false;
+
+		strings.emplace_back( text );
+	}
+
+	return true;
+}
+
+bool JournalReader::ParseRecords( )
+{
+	if( payload.size( ) < 8 )
+		return false;
+
+	const uint64_t count = GetBytes( payload.data( ), 4 );
+	const uint64_t frames = GetBytes( payload.data( ) + 4, 4 );
+	if( payload.size( ) != 8 + count * record_columns_size + frames * frame_columns_size )
+		return false;
+
+	static const size_t record_widths[] = { 8, 1, 4, 8, 4, 4, 4, 4, 4 };
+	const uint8_t *column = payload.data( ) + 8;
+	size_t k = 0;
+	for( const size_t width : record_widths )
+	{
+		columns[k++] = column;
+		column += width * count;
+	}
+
+	for( ; k < 12; ++k )
+	{
+		columns[k] = column;
+		column += 4 * frames;
+	}
+
+	record_count = static_cast<size_t>( count );
+	record_index = 0;
+	frame_index = 0;
+	return true;
+}
+
+bool JournalReader::GetString( const uint32_t id, std::string_view &text ) const
+{
+	if( id >= strings.size( ) )
+		return false;
+
+	text = strings[id];
+	return true;
+}
+
+}
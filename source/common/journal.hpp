@@ -0,0 +1,195 @@
+#pragma once
+
+#include "common.hpp"
+#include "span.hpp"
+#include "string_pool.hpp"
+#include "staging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+
+// Journal files start with journal_magic and a 32 bits version, followed by blocks. Each block is
+// a 32 bits payload size, a 8 bits block type and the payload. Every integer is little endian.
+//
+// Strings blocks add to the dictionary of the file: the id of the first string (32 bits), the
+// amount of strings (32 bits) and then each string as a 32 bits size followed by its bytes.
+// Ids are given in order and id 0 is always the empty string. Every file has its own dictionary.
+//
+// Records blocks hold a batch of errors stored column by column: the amount of records and of
+// frames (32 bits each), then the time (64 bits, milliseconds since the UNIX epoch), flags
+// (8 bits, see ErrorRecord), client (32 bits), fingerprint (64 bits), source file (string id),
+// source line (32 bits), error string (string id), addon (string id) and frame count (32 bits)
+// columns, one entry per record, and the frame name (string id), source (string id) and
+// current line (32 bits) columns, one entry per frame of every record in order.
+static constexpr char journal_magic[8] = { 'L', 'U', 'A', 'E', 'R', 'R', 'J', '\0' };
+static constexpr uint32_t journal_version = 1;
+
+enum class JournalBlock : uint8_t
+{
+	Strings = 1,
+	Records = 2
+};
+
+typedef ErrorRecord JournalRecord;
+
+// Appends errors to a rotating journal file from a background thread. Producers only copy the
+// raw error and its stack into a preallocated staging buffer, the writer thread parses,
+// fingerprints and attributes them, keeps the string dictionary and does every file operation.
+class JournalWriter
+{
+public:
+	struct Options
+	{
+		std::string path;
+		// Once the file grows past this, it's renamed to path.1 (path.1 to path.2 and so on)
+		size_t max_file_bytes = 64 * 1024 * 1024;
+		// Rotated files kept besides the current one
+		size_t max_rotated_files = 4;
+		// Size of each of the two staging buffers, errors that don't fit are dropped
+		size_t buffer_bytes = 1024 * 1024;
+		std::chrono::milliseconds flush_interval = std::chrono::milliseconds( 1000 );
+	};
+
+	struct Stats
+	{
+		uint64_t appended = 0;
+		uint64_t dropped = 0;
+		uint64_t written_records = 0;
+		uint64_t written_bytes = 0;
+		uint64_t rotations = 0;
+		uint64_t write_errors = 0;
+	};
+
+	JournalWriter( ) = default;
+	~JournalWriter( );
+
+	JournalWriter( const JournalWriter & ) = delete;
+	JournalWriter &operator=( const JournalWriter & ) = delete;
+
+	// Runs on the writer thread, only used for errors that aren't from clients. Ignored while open.
+	void SetAddonResolver( AddonResolver resolver );
+
+	// Starts the writer thread, which opens the file. An existing file is rotated out of the way first,
+	// since every file has its own dictionary. Returns false if already open.
+	bool Open( const Options &options );
+	// Writes whatever is staged and stops the writer thread.
+	void Close( );
+	bool IsOpen( ) const;
+
+	// Any thread. Copies the raw error, with the stack captured by the caller for errors of this
+	// realm (client errors carry theirs in error). Returns false when the staging buffer is full.
+	bool Append(
+		uint64_t time,
+		bool runtime,
+		int32_t client,
+		std::string_view error,
+		Span<const ParsedErrorWithStackTraceView::StackFrame> stack = Span<const ParsedErrorWithStackTraceView::StackFrame>( )
+	);
+
+	// Blocks until everything appended so far was written, for tests and shutdown paths.
+	bool Flush( std::chrono::milliseconds timeout );
+
+	Stats GetStats( ) const;
+
+	// Milliseconds since the UNIX epoch, the time column unit.
+	static uint64_t Now( );
+
+private:
+	struct Columns
+	{
+		std::vector<uint64_t> times;
+		std::vector<uint8_t> flags;
+		std::vector<int32_t> clients;
+		std::vector<uint64_t> fingerprints;
+		std::vector<uint32_t> source_files;
+		std::vector<int32_t> source_lines;
+		std::vector<uint32_t> error_strings;
+		std::vector<uint32_t> addons;
+		std::vector<uint32_t> frame_counts;
+		std::vector<uint32_t> frame_names;
+		std::vector<uint32_t> frame_sources;
+		std::vector<int32_t> frame_lines;
+
+		void Clear( );
+	};
+
+	void WriterLoop( );
+	void WriteStaged( const std::vector<uint8_t> &staged );
+	void AddRecord( const JournalRecord &record );
+	uint32_t Intern( std::string_view text );
+	bool WriteBlock( JournalBlock type, const std::vector<uint8_t> &payload );
+	bool OpenFile( bool rotate_existing = true );
+	void Rotate( );
+
+	Options options;
+	AddonResolver addon_resolver;
+
+	std::thread writer;
+	ErrorStager stager;
+
+	// writer thread only
+	ErrorStager::Batch batch;
+	std::FILE *file = nullptr;
+	size_t file_bytes = 0;
+	StringPool dictionary;
+	StringPool::Id written_strings = 1;
+	Columns columns;
+	std::vector<uint8_t> block;
+	JournalRecord record;
+
+	std::atomic<uint64_t> written_records{ 0 };
+	std::atomic<uint64_t> written_bytes{ 0 };
+	std::atomic<uint64_t> rotations{ 0 };
+	std::atomic<uint64_t> write_errors{ 0 };
+};
+
+// Reads journal files written by JournalWriter.
+class JournalReader
+{
+public:
+	JournalReader( ) = default;
+	~JournalReader( );
+
+	JournalReader( const JournalReader & ) = delete;
+	JournalReader &operator=( const JournalReader & ) = delete;
+
+	// Returns false if the file can't be opened or isn't a journal of a known version.
+	bool Open( const std::string &path );
+	void Close( );
+
+	// Reads the next record, false at the end of the file or on truncated or corrupted blocks
+	// (IsCorrupted tells them apart). Strings stay valid until the reader is closed.
+	bool Next( JournalRecord &record );
+	bool IsCorrupted( ) const;
+
+private:
+	bool ReadBlock( JournalBlock &type );
+	bool ParseStrings( );
+	bool ParseRecords( );
+	bool GetString( uint32_t id, std::string_view &text ) const;
+
+	std::FILE *file = nullptr;
+	bool corrupted = false;
+	std::vector<uint8_t> payload;
+	// a deque, so views into strings survive more strings being added
+	std::deque<std::string> strings;
+
+	// current records block
+	size_t record_count = 0;
+	size_t record_index = 0;
+	size_t frame_index = 0;
+	const uint8_t *columns[12] = { };
+};
+
+}
@@ -0,0 +1,189 @@
+#include "json.hpp"
+#include "fingerprint.hpp"
+#include "stack_groups.hpp"
+
+#include <ctime>
+
+namespace common
+{
+
+static void AppendNumber( std::string &out, const int64_t value )
+{
+	char buffer[24];
+	char *end = buffer + sizeof( buffer );
+	char *begin = end;
+	uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>( value ) : static_cast<uint64_t>( value );
+	do
+	{
+		*--begin = static_cast<char>( '0' + magnitude % 10 );
+		magnitude /= 10;
+	}
+	while( magnitude != 0 );
+
+	if( value < 0 )
+		*--begin = '-';
+
+	out.append( begin, static_cast<size_t>( end - begin ) );
+}
+
+static void AppendTime( std::string &out, const uint64_t time )
+{
+	const std::time_t seconds = static_cast<std::time_t>( time / 1000 );
+	std::tm utc = { };
+#if defined _WIN32
+	gmtime_s( &utc, &seconds );
+#else
+	gmtime_r( &seconds, &utc );
+#endif
+
+	char buffer[32];
+	const size_t size = std::strftime( buffer, sizeof( buffer ), "%Y-%m-%dT%H:%M:%S", &utc );
+	out.append( buffer, size );
+	out += '.';
+	const unsigned int milliseconds = static_cast<unsigned int>( time % 1000 );
+	out += static_cast<char>( '0' + milliseconds / 100 );
+	out += static_cast<char>( '0' + milliseconds / 10 % 10 );
+	out += static_cast<char>( '0' + milliseconds % 10 );
+	out += 'Z';
+}
+
+void AppendJsonString( std::string &out, std::string_view text )
+{
+	static const char digits[] = "0123456789abcdef";
+
+	out += '"';
+	for( const char c : text )
+		switch( c )
+		{
+		case '"':
+			out += "\\\"";
+			break;
+
+		case '\\':
+			out += "\\\\";
+			break;
+
+		case '\n':
+			out += "\\n";
+			break;
+
+		case '\r':
+			out += "\\r";
+			break;
+
+		case '\t':
+			out += "\\t";
+			break;
+
+		default:
+			if( static_cast<unsigned char>( c ) < 0x20 )
+			{
+				out += "\\u00";
+				out += digits[static_cast<unsigned char>( c ) >> 4];
+				out += digits[static_cast<unsigned char>( c ) & 0xF];
+			}
+			else
+				out += c;
+
+			break;
+		}
+
+	out += '"';
+}
+
+static void AppendStackFrameJson(
+	std::string &out,
+	const ParsedErrorWithStackTraceView::StackFrame &frame,
+	const StackGroup *group
+)
+{
+	out += "{\"level\":";
+	AppendNumber( out, frame.level );
+	out += ",\"name\":";
+	AppendJsonString( out, frame.name );
+	out += ",\"source\":";
+	AppendJsonString( out, frame.source );
+	out += ",\"currentline\":";
+	AppendNumber( out, frame.currentline );
+	if( group != nullptr )
+	{
+		out += ",\"repeats\":";
+		AppendNumber( out, static_cast<int64_t>( group->repeats ) );
+		out += ",\"period\":";
+		AppendNumber( out, static_cast<int64_t>( group->length ) );
+	}
+
+	out += '}';
+}
+
+void AppendErrorJson( std::string &out, const ErrorRecord &record, std::string_view tag, const bool fold_stack )
+{
+	const ParsedErrorWithStackTraceView &error = record.error;
+
+	out += '{';
+	if( !tag.empty( ) )
+	{
+		out += "\"server\":";
+		AppendJsonString( out, tag );
+		out += ',';
+	}
+
+	out += "\"time\":\"";
+	AppendTime( out, record.time );
+	out += "\",\"kind\":\"";
+	if( ( record.flags & ErrorRecord::Client ) != 0 )
+		out += "client";
+	else
+		out += ( record.flags & ErrorRecord::Runtime ) != 0 ? "runtime" : "compiletime";
+
+	out += "\",\"parsed\":";
+	out += ( record.flags & ErrorRecord::Parsed ) != 0 ? "true" : "false";
+	out += ",\"client\":";
+	AppendNumber( out, record.client );
+
+	char fingerprint[17];
+	FormatFingerprint( record.fingerprint, fingerprint );
+	out += ",\"fingerprint\":\"";
+	out += fingerprint;
+	out += "\",\"sourcefile\":";
+	AppendJsonString( out, error.source_file );
+	out += ",\"sourceline\":";
+	AppendNumber( out, error.source_line );
+	out += ",\"errorstr\":";
+	AppendJsonString( out, error.error_string );
+	out += ",\"addon\":";
+	AppendJsonString( out, error.addon_name );
+	out += ",\"stack\":[";
+	if( !fold_stack )
+	{
+		for( size_t k = 0; k < error.stack_trace.size( ); ++k )
+		{
+			if( k != 0 )
+				out += ',';
+
+			AppendStackFrameJson( out, error.stack_trace[k], nullptr );
+		}
+	}
+	else
+	{
+		thread_local std::vector<uint64_t> hashes;
+		thread_local std::vector<StackGroup> groups;
+		FoldStackTrace( error.stack_trace, hashes, groups );
+
+		bool first = true;
+		for( const StackGroup &group : groups )
+			for( size_t k = 0; k < group.length; ++k )
+			{
+				if( !first )
+					out += ',';
+
+				first = false;
+				const bool starts_repeat = k == 0 && group.repeats > 1;
+				AppendStackFrameJson( out, error.stack_trace[group.first + k], starts_repeat ? &group : nullptr );
+			}
+	}
+
+	out += "]}";
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "staging.hpp"
+
+#include <string>
+#include <string_view>
+
+namespace common
+{
+
+void AppendJsonString( std::string &out, std::string_view text );
+
+// Appends record as a single line JSON object (without the line break). A non empty tag is
+// added as the "server" field, so collectors can tell where the error came from. With fold_stack,
+// frames repeated back to back (see FoldStackRepeats) are only written once: the first frame of a
+// repeated sequence gets "repeats" (times the sequence is repeated) and "period" (its frames).
+void AppendErrorJson(
+	std::string &out,
+	const ErrorRecord &record,
+	std::string_view tag = std::string_view( ),
+	bool fold_stack = false
+);
+
+}
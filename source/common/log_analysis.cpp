@@ -0,0 +1,291 @@
+#include "log_analysis.hpp"
+#include "common.hpp"
+#include "fingerprint.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace common
+{
+
+// "L 10/17/2026 - 12:34:56: ", added to every line written by the log command
+static constexpr size_t log_prefix_size = 25;
+
+inline bool HasLogPrefix( std::string_view line )
+{
+	return line.size( ) >= log_prefix_size && line[0] == 'L' && line[1] == ' ' &&
+		line[4] == '/' && line[7] == '/' && line[12] == ' ' && line[13] == '-' && line[14] == ' ' &&
+		line[17] == ':' && line[20] == ':' && line[23] == ':' && line[24] == ' ';
+}
+
+// Removes the prefix of the log command and the carriage return of Windows line breaks.
+inline std::string_view StripLine( std::string_view line, std::string_view &time )
+{
+	if( HasLogPrefix( line ) )
+	{
+		time = line.substr( 2, log_prefix_size - 4 );
+		line.remove_prefix( log_prefix_size );
+	}
+
+	if( !line.empty( ) && line.back( ) == '\r' )
+		line.remove_suffix( 1 );
+
+	return line;
+}
+
+// First line of an error, "[addon] ..."
+inline bool IsErrorLine( std::string_view line )
+{
+	return line.size( ) >= 4 && line[0] == '[' && line.find( "] ", 2 ) != std::string_view::npos;
+}
+
+// Stack frame line, "  1. name - source:line"
+inline bool IsStackFrameLine( std::string_view line )
+{
+	size_t k = 0;
+	while( k < line.size( ) && ( line[k] == ' ' || line[k] == '\t' ) )
+		++k;
+
+	const size_t digits = k;
+	while( k < line.size( ) && line[k] >= '0' && line[k] <= '9' )
+		++k;
+
+	return digits != 0 && k != digits && k + 1 < line.size( ) && line[k] == '.' && line[k + 1] == ' ';
+}
+
+inline size_t FindLineEnd( std::string_view text, const size_t begin )
+{
+	const size_t end = text.find( '\n', begin );
+	return end != std::string_view::npos ? end : text.size( );
+}
+
+inline bool IsBefore( const LogAnalysis::Occurrence &lhs, const LogAnalysis::Occurrence &rhs )
+{
+	return lhs.file != rhs.file ? lhs.file < rhs.file : lhs.line < rhs.line;
+}
+
+void LogAnalysis::Analyze( std::string_view text, const size_t file, ThreadPool *pool, const size_t chunk_bytes )
+{
+	if( text.empty( ) )
+		return;
+
+	// a few chunks per thread, so the pool can even out chunks with more errors
+	const size_t concurrency = pool != nullptr ? pool->GetConcurrency( ) : 1;
+	const size_t chunk_count = std::max<size_t>( std::min( text.size( ) / std::max<size_t>( chunk_bytes, 1 ), concurrency * 8 ), 1 );
+
+	std::vector<Chunk> chunks( chunk_count );
+	const auto scan = [&]( const size_t begin, const size_t end )
+	{
+		for( size_t k = begin; k < end; ++k )
+			ScanChunk( text, text.size( ) / chunk_count * k, k + 1 == chunk_count ? text.size( ) : text.size( ) / chunk_count * ( k + 1 ), file, chunks[k] );
+	};
+
+	if( pool != nullptr && chunk_count > 1 )
+		pool->ParallelFor( chunk_count, 1, scan );
+	else
+		scan( 0, chunk_count );
+
+	uint64_t lines = 0;
+	for( Chunk &chunk : chunks )
+	{
+		Merge( chunk, lines + 1 );
+		lines += chunk.lines;
+	}
+}
+
+// Scans the lines starting in [begin, end), errors starting there may end past end.
+void LogAnalysis::ScanChunk( std::string_view text, const size_t begin, const size_t end, const size_t file, Chunk &chunk )
+{
+	size_t position = begin;
+	uint64_t line = 0;
+
+	// the line that was cut belongs to the previous chunk
+	if( position != 0 && text[position - 1] != '\n' )
+	{
+		position = FindLineEnd( text, position );
+		if( position >= end )
+			return;
+
+		++position;
+		++line;
+	}
+
+	while( position < end )
+	{
+		const size_t line_end = FindLineEnd( text, position );
+
+		std::string_view time;
+		const std::string_view header = StripLine( text.substr( position, line_end - position ), time );
+		if( IsErrorLine( header ) )
+			ScanError( text, line_end, header, time, line, file, chunk );
+
+		if( line_end >= end )
+			break;
+
+		// stack frames are scanned again as regular lines, they can't start an error anyway
+		++line;
+		position = line_end + 1;
+	}
+
+	chunk.lines = line;
+}
+
+void LogAnalysis::ScanError(
+	std::string_view text,
+	const size_t header_end,
+	const std::string_view header,
+	const std::string_view time,
+	const uint64_t line,
+	const size_t file,
+	Chunk &chunk
+)
+{
+	thread_local std::vector<std::string_view> frames;
+	thread_local std::string buffer;
+	thread_local ParsedErrorWithStackTraceView parsed_error;
+
+	// lines are only contiguous in the log if nothing was stripped from them
+	bool contiguous = header.size( ) == header_end - static_cast<size_t>( header.data( ) - text.data( ) );
+	size_t error_end = header_end;
+	frames.clear( );
+	for( size_t position = header_end + 1; position < text.size( ); )
+	{
+		const size_t line_end = FindLineEnd( text, position );
+		const std::string_view raw = text.substr( position, line_end - position );
+		std::string_view frame_time;
+		const std::string_view frame = StripLine( raw, frame_time );
+		if( !IsStackFrameLine( frame ) )
+			break;
+
+		contiguous = contiguous && frame.size( ) == raw.size( );
+		frames.push_back( frame );
+		error_end = line_end;
+		position = line_end + 1;
+	}
+
+	std::string_view error;
+	if( contiguous )
+		error = std::string_view( header.data( ), static_cast<size_t>( text.data( ) + error_end - header.data( ) ) );
+	else
+	{
+		buffer.assign( header.data( ), header.size( ) );
+		for( const std::string_view frame : frames )
+		{
+			buffer += '\n';
+			buffer.append( frame.data( ), frame.size( ) );
+		}
+
+		error = buffer;
+	}
+
+	// a mangled stack frame doesn't make the error any less of an error
+	if( !ParseErrorWithStackTrace( error, parsed_error ) &&
+		( frames.empty( ) || !ParseErrorWithStackTrace( header, parsed_error ) ) )
+		return;
+
+	// plenty of other console lines start with a tag, errors have a source or a stack
+	if( parsed_error.addon_name.empty( ) || ( parsed_error.source_file.empty( ) && parsed_error.stack_trace.empty( ) ) )
+		return;
+
+	const uint64_t fingerprint = FingerprintParsedError( parsed_error );
+	ErrorGroup &group = chunk.groups[fingerprint];
+	if( group.count == 0 )
+	{
+		group.fingerprint = fingerprint;
+		group.addon_name = parsed_error.addon_name;
+		group.source_file = parsed_error.source_file;
+		group.source_line = parsed_error.source_line;
+		group.error_string = parsed_error.error_string;
+		group.frames = parsed_error.stack_trace.size( );
+		group.first.file = file;
+		group.first.line = line;
+		group.first.time = time;
+	}
+
+	++group.count;
+	group.last.file = file;
+	group.last.line = line;
+	group.last.time = time;
+	++chunk.errors;
+}
+
+// Lines of the chunk are relative to its start, first_line is the line it starts at.
+void LogAnalysis::Merge( Chunk &chunk, const uint64_t first_line )
+{
+	errors += chunk.errors;
+	for( auto &entry : chunk.groups )
+	{
+		ErrorGroup &chunk_group = entry.second;
+		chunk_group.first.line += first_line;
+		chunk_group.last.line += first_line;
+
+		// chunks are merged in order, so an existing group has seen the first occurrence already
+		const auto group = groups.find( entry.first );
+		if( group == groups.end( ) )
+			groups.emplace( entry.first, std::move( chunk_group ) );
+		else
+		{
+			group->second.count += chunk_group.count;
+			group->second.last = std::move( chunk_group.last );
+		}
+	}
+}
+
+uint64_t LogAnalysis::GetErrorCount( ) const
+{
+	return errors;
+}
+
+std::vector<const LogAnalysis::ErrorGroup *> LogAnalysis::GetErrors( ) const
+{
+	std::vector<const ErrorGroup *> sorted;
+	sorted.reserve( groups.size( ) );
+	for( const auto &entry : groups )
+		sorted.push_back( &entry.second );
+
+	std::sort( sorted.begin( ), sorted.end( ), []( const ErrorGroup *lhs, const ErrorGroup *rhs )
+	{
+		return lhs->count != rhs->count ? lhs->count > rhs->count : IsBefore( lhs->first, rhs->first );
+	} );
+	return sorted;
+}
+
+std::vector<LogAnalysis::AddonGroup> LogAnalysis::GetAddons( ) const
+{
+	std::unordered_map<std::string_view, AddonGroup> addons;
+	for( const auto &entry : groups )
+	{
+		const ErrorGroup &group = entry.second;
+		AddonGroup &addon = addons[group.addon_name];
+		if( addon.errors == 0 )
+		{
+			addon.name = group.addon_name;
+			addon.first = group.first;
+			addon.last = group.last;
+		}
+		else
+		{
+			if( IsBefore( group.first, addon.first ) )
+				addon.first = group.first;
+
+			if( IsBefore( addon.last, group.last ) )
+				addon.last = group.last;
+		}
+
+		addon.count += group.count;
+		++addon.errors;
+	}
+
+	std::vector<AddonGroup> sorted;
+	sorted.reserve( addons.size( ) );
+	for( auto &entry : addons )
+		sorted.push_back( std::move( entry.second ) );
+
+	std::sort( sorted.begin( ), sorted.end( ), []( const AddonGroup &lhs, const AddonGroup &rhs )
+	{
+		return lhs.count != rhs.count ? lhs.count > rhs.count : lhs.name < rhs.name;
+	} );
+	return sorted;
+}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+
+class ThreadPool;
+
+// Finds the errors printed to server console logs (an "[addon] source:line: error" line followed
+// by its stack frames, as handled by ParseErrorWithStackTrace) and groups them by fingerprint.
+// Lines may carry the "L MM/DD/YYYY - HH:MM:SS: " prefix of the log command and Windows line breaks.
+class LogAnalysis
+{
+public:
+	struct Occurrence
+	{
+		// index of the file given to Analyze
+		size_t file = 0;
+		// 1 based line of the first line of the error
+		uint64_t line = 0;
+		// "MM/DD/YYYY - HH:MM:SS" if the line had the prefix of the log command, empty otherwise
+		std::string time;
+	};
+
+	struct ErrorGroup
+	{
+		uint64_t fingerprint = 0;
+		uint64_t count = 0;
+		// as seen on the first occurrence
+		std::string addon_name;
+		std::string source_file;
+		int32_t source_line = -1;
+		std::string error_string;
+		size_t frames = 0;
+		Occurrence first;
+		Occurrence last;
+	};
+
+	struct AddonGroup
+	{
+		std::string name;
+		uint64_t count = 0;
+		// distinct fingerprints
+		size_t errors = 0;
+		Occurrence first;
+		Occurrence last;
+	};
+
+	// Analyzes text, the contents of file number file. Files must be analyzed in order for first and
+	// last occurrences to be right. The text is split in chunks of at least chunk_bytes, which are
+	// scanned and parsed in parallel over pool when one is given.
+	void Analyze( std::string_view text, size_t file, ThreadPool *pool = nullptr, size_t chunk_bytes = 1024 * 1024 );
+
+	// Errors found in every file.
+	uint64_t GetErrorCount( ) const;
+
+	// Most frequent first, valid until the next Analyze.
+	std::vector<const ErrorGroup *> GetErrors( ) const;
+	std::vector<AddonGroup> GetAddons( ) const;
+
+private:
+	struct Chunk
+	{
+		std::unordered_map<uint64_t, ErrorGroup> groups;
+		// line breaks in the chunk
+		uint64_t lines = 0;
+		uint64_t errors = 0;
+	};
+
+	static void ScanChunk( std::string_view text, size_t begin, size_t end, size_t file, Chunk &chunk );
+	static void ScanError(
+		std::string_view text,
+		size_t header_end,
+		std::string_view header,
+		std::string_view time,
+		uint64_t line,
+		size_t file,
+		Chunk &chunk
+	);
+	void Merge( Chunk &chunk, uint64_t first_line );
+
+	uint64_t errors = 0;
+	std::unordered_map<uint64_t, ErrorGroup> groups;
+};
+
+}
@@ -0,0 +1,132 @@
+#include "mapped_file.hpp"
+
+#if defined _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+namespace common
+{
+
+MappedFile::~MappedFile( )
+{
+	Close( );
+}
+
+bool MappedFile::Open( const char *path )
+{
+	Close( );
+
+#if defined _WIN32
+
+	const HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER file_size;
+	if( !GetFileSizeEx( file, &file_size ) )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	// empty files can't be mapped
+	if( file_size.QuadPart != 0 )
+	{
+		mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if( mapping == nullptr )
+		{
+			CloseHandle( file );
+			return false;
+		}
+
+		data = static_cast<const char *>( MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+		if( data == nullptr )
+		{
+			CloseHandle( mapping );
+			mapping = nullptr;
+			CloseHandle( file );
+			return false;
+		}
+	}
+
+	// the mapping keeps the file open
+	CloseHandle( file );
+	size = static_cast<size_t>( file_size.QuadPart );
+
+#else
+
+	const int file = ::open( path, O_RDONLY );
+	if( file == -1 )
+		return false;
+
+	struct stat status;
+	if( fstat( file, &status ) != 0 || !S_ISREG( status.st_mode ) )
+	{
+		::close( file );
+		return false;
+	}
+
+	// empty files can't be mapped
+	if( status.st_size != 0 )
+	{
+		void *address = mmap( nullptr, static_cast<size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+		if( address == MAP_FAILED )
+		{
+			::close( file );
+			return false;
+		}
+
+		// it's read front to back, once
+		madvise( address, static_cast<size_t>( status.st_size ), MADV_SEQUENTIAL );
+		data = static_cast<const char *>( address );
+	}
+
+	// the mapping keeps the file open
+	::close( file );
+	size = static_cast<size_t>( status.st_size );
+
+#endif
+
+	open = true;
+	return true;
+}
+
+void MappedFile::Close( )
+{
+	if( data != nullptr )
+	{
+#if defined _WIN32
+		UnmapViewOfFile( data );
+		CloseHandle( mapping );
+		mapping = nullptr;
+#else
+		munmap( const_cast<char *>( data ), size );
+#endif
+	}
+
+	data = nullptr;
+	size = 0;
+	open = false;
+}
+
+bool MappedFile::IsOpen( ) const
+{
+	return open;
+}
+
+std::string_view MappedFile::GetContents( ) const
+{
+	return data != nullptr ? std::string_view( data, size ) : std::string_view( );
+}
+
+}
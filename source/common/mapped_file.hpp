@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace common
+{
+
+// Read only memory mapping of a whole file, so files far larger than memory can be scanned
+// without reading them into buffers first.
+class MappedFile
+{
+public:
+	MappedFile( ) = default;
+	~MappedFile( );
+
+	MappedFile( const MappedFile & ) = delete;
+	MappedFile &operator=( const MappedFile & ) = delete;
+
+	// Maps path, unmapping whatever was mapped before. Empty files succeed with empty contents.
+	bool Open( const char *path );
+	void Close( );
+
+	bool IsOpen( ) const;
+
+	// Valid until the file is closed.
+	std::string_view GetContents( ) const;
+
+private:
+	const char *data = nullptr;
+	size_t size = 0;
+	bool open = false;
+#if defined _WIN32
+	void *mapping = nullptr;
+#endif
+};
+
+}
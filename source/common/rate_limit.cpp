@@ -0,0 +1,140 @@
+#include "rate_limit.hpp"
+
+#include <cstring>
+
+namespace common
+{
+
+void TokenBucket::Configure( const double new_rate, const double new_burst )
+{
+	rate = new_rate > 0.0 ? new_rate : 0.0;
+	burst = new_burst > 1.0 ? new_burst : 1.0;
+	Reset( );
+}
+
+bool TokenBucket::Consume( const Clock::time_point now )
+{
+	if( rate <= 0.0 )
+		return true;
+
+	if( now > last_refill )
+	{
+		tokens += std::chrono::duration<double>( now - last_refill ).count( ) * rate;
+		if( tokens > burst )
+			tokens = burst;
+
+		last_refill = now;
+	}
+
+	if( tokens < 1.0 )
+		return false;
+
+	tokens -= 1.0;
+	return true;
+}
+
+void TokenBucket::Reset( )
+{
+	tokens = burst;
+	last_refill = Clock::time_point( );
+}
+
+ClientErrorLimiter::ClientErrorLimiter( const size_t slots ) :
+	clients( slots != 0 ? slots : 1 )
+{
+	SetLimits( limits );
+}
+
+void ClientErrorLimiter::SetLimits( const Limits &new_limits )
+{
+	limits = new_limits;
+	for( auto &client : clients )
+		client.bucket.Configure( limits.rate, limits.burst );
+}
+
+const ClientErrorLimiter::Limits &ClientErrorLimiter::GetLimits( ) const
+{
+	return limits;
+}
+
+ClientErrorLimiter::Verdict ClientErrorLimiter::Check(
+	const size_t client_index,
+	const char *payload,
+	const Clock::time_point now
+)
+{
+	Client &client = GetClient( client_index );
+	if( !client.bucket.Consume( now ) )
+	{
+		++client.dropped.rate_limited;
+		return Verdict::RateLimited;
+	}
+
+	size_t size = 0;
+	if( limits.max_bytes != 0 )
+	{
+		const void *end = std::memchr( payload, '\0', limits.max_bytes + 1 );
+		if( end == nullptr )
+		{
+			++client.dropped.too_large;
+			return Verdict::TooLarge;
+		}
+
+		size = static_cast<size_t>( static_cast<const char *>( end ) - payload );
+	}
+	else
+		size = std::strlen( payload );
+
+	if( limits.max_frames != 0 )
+	{
+		// besides one line per frame, there's the error line and possibly an empty first line
+		const size_t max_lines = limits.max_frames + 2;
+		size_t lines = 0;
+		for(
+			const char *line = static_cast<const char *>( std::memchr( payload, '\n', size ) );
+			line != nullptr;
+			line = static_cast<const char *>( std::memchr( line + 1, '\n', size - ( line + 1 - payload ) ) )
+		)
+			if( ++lines > max_lines )
+			{
+				++client.dropped.too_many_frames;
+				return Verdict::TooManyFrames;
+			}
+	}
+
+	return Verdict::Accept;
+}
+
+const ClientErrorLimiter::Dropped &ClientErrorLimiter::GetDropped( const size_t client ) const
+{
+	return GetClient( client ).dropped;
+}
+
+void ClientErrorLimiter::Reset( const size_t client_index )
+{
+	Client &client = GetClient( client_index );
+	client.bucket.Reset( );
+	client.dropped = Dropped( );
+}
+
+void ClientErrorLimiter::SetOwner( const size_t client_index, const int32_t owner )
+{
+	Client &client = GetClient( client_index );
+	if( client.owner == owner )
+		return;
+
+	Reset( client_index );
+	client.owner = owner;
+}
+
+ClientErrorLimiter::Client &ClientErrorLimiter::GetClient( const size_t client )
+{
+	return clients[client < clients.size( ) ? client : 0];
+}
+
+const ClientErrorLimiter::Client &ClientErrorLimiter::GetClient( const size_t client ) const
+{
+	return clients[client < clients.size( ) ? client : 0];
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace common
+{
+
+// Classic token bucket: holds up to burst tokens and gains rate tokens per second.
+class TokenBucket
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Starts full. A rate of zero (or less) disables limiting.
+	void Configure( double rate, double burst );
+
+	// Refills the bucket up to now and takes a token if there's one.
+	bool Consume( Clock::time_point now );
+
+	void Reset( );
+
+private:
+	double rate = 0.0;
+	double burst = 0.0;
+	double tokens = 0.0;
+	Clock::time_point last_refill;
+};
+
+// Per client guard for error payloads sent by clients, meant to run before any parsing.
+// Clients are identified by their entity index, which must be lower than the amount of slots
+// given to the constructor (anything else shares slot 0, the world, which no player can use).
+class ClientErrorLimiter
+{
+public:
+	typedef TokenBucket::Clock Clock;
+
+	enum class Verdict
+	{
+		Accept,
+		RateLimited,
+		TooLarge,
+		TooManyFrames
+	};
+
+	// Nothing is limited by default.
+	struct Limits
+	{
+		// payloads per second and how many can be sent in a burst, zero rate disables it
+		double rate = 0.0;
+		double burst = 10.0;
+		// zero disables each of these
+		size_t max_bytes = 0;
+		size_t max_frames = 0;
+	};
+
+	struct Dropped
+	{
+		uint64_t rate_limited = 0;
+		uint64_t too_large = 0;
+		uint64_t too_many_frames = 0;
+
+		inline uint64_t Total( ) const
+		{
+			return rate_limited + too_large + too_many_frames;
+		}
+	};
+
+	explicit ClientErrorLimiter( size_t slots = 256 );
+
+	// Also refills every bucket, so new limits apply right away.
+	void SetLimits( const Limits &limits );
+	const Limits &GetLimits( ) const;
+
+	// Reads at most max_bytes + 1 bytes of payload (a C string) and stops counting lines once
+	// over the frame limit, so the cost of rejecting a payload doesn't depend on its size.
+	// Payloads rejected for their size still took a token.
+	Verdict Check( size_t client, const char *payload, Clock::time_point now );
+
+	const Dropped &GetDropped( size_t client ) const;
+
+	// Refills the bucket and clears the dropped counts of a client, for when its slot is reused.
+	void Reset( size_t client );
+
+	// Resets the slot of client when owner (what identifies the connection, like the UserID of the
+	// player) isn't the one it had, so whoever takes the slot of a player that left starts over.
+	void SetOwner( size_t client, int32_t owner );
+
+	template<typename Function>
+	void ForEach( Function function ) const
+	{
+		for( size_t k = 0; k < clients.size( ); ++k )
+			if( clients[k].dropped.Total( ) != 0 )
+				function( k, clients[k].dropped );
+	}
+
+private:
+	struct Client
+	{
+		TokenBucket bucket;
+		Dropped dropped;
+		int32_t owner = -1;
+	};
+
+	Client &GetClient( size_t client );
+	const Client &GetClient( size_t client ) const;
+
+	Limits limits;
+	std::vector<Client> clients;
+};
+
+}
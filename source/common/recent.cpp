@@ -0,0 +1,91 @@
+#include "recent.hpp"
+
+#include <cstring>
+
+namespace common
+{
+
+void RecentErrors::Configure( const size_t capacity, const size_t bytes, const size_t frames_per_slot )
+{
+	recorded = 0;
+	slot_bytes = capacity != 0 ? bytes : 0;
+	max_frames = capacity != 0 ? frames_per_slot : 0;
+
+	// swapping actually frees the memory when disabling
+	std::vector<Entry>( capacity ).swap( entries );
+	std::vector<char>( capacity * slot_bytes ).swap( storage );
+	std::vector<Frame>( capacity * max_frames ).swap( frames );
+}
+
+bool RecentErrors::IsEnabled( ) const
+{
+	return !entries.empty( );
+}
+
+size_t RecentErrors::GetCapacity( ) const
+{
+	return entries.size( );
+}
+
+size_t RecentErrors::GetSlotBytes( ) const
+{
+	return slot_bytes;
+}
+
+void RecentErrors::Record( const Error &error, Span<const ParsedErrorWithStackTraceView::StackFrame> stack )
+{
+	if( entries.empty( ) )
+		return;
+
+	const size_t slot = static_cast<size_t>( recorded % entries.size( ) );
+	char *data = storage.data( ) + slot * slot_bytes;
+	size_t used = 0;
+	bool truncated = false;
+	const auto copy = [data, &used, &truncated, this]( std::string_view text )
+	{
+		const size_t size = text.size( ) < slot_bytes - used ? text.size( ) : slot_bytes - used;
+		truncated = truncated || size != text.size( );
+		if( size != 0 )
+			std::memcpy( data + used, text.data( ), size );
+
+		const std::string_view copied( data + used, size );
+		used += size;
+		return copied;
+	};
+
+	Entry &entry = entries[slot];
+	static_cast<Error &>( entry ) = error;
+	entry.sequence = ++recorded;
+
+	// the short fields go first, the full error (which holds them too) is the first to be cut
+	entry.source_file = copy( error.source_file );
+	entry.error_string = copy( error.error_string );
+	entry.addon_title = copy( error.addon_title );
+
+	Frame *slot_frames = frames.data( ) + slot * max_frames;
+	size_t frame_count = 0;
+	for( ; frame_count < stack.size( ) && frame_count < max_frames; ++frame_count )
+	{
+		const auto &stack_frame = stack[frame_count];
+		Frame &frame = slot_frames[frame_count];
+		frame.name = copy( stack_frame.name );
+		frame.source = copy( stack_frame.source );
+		frame.currentline = stack_frame.currentline;
+	}
+
+	entry.frames = Span<const Frame>( slot_frames, frame_count );
+	entry.error = copy( error.error );
+	entry.truncated = truncated || frame_count != stack.size( );
+}
+
+size_t RecentErrors::GetCount( ) const
+{
+	return recorded < entries.size( ) ? static_cast<size_t>( recorded ) : entries.size( );
+}
+
+uint64_t RecentErrors::GetRecorded( ) const
+{
+	return recorded;
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "common.hpp"
+#include "span.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// The last errors seen, in a ring of slots allocated up front. Recording copies the strings of
+// the error into the storage of the oldest slot (truncating what doesn't fit), so it's O(1) and
+// never allocates. Game thread only.
+class RecentErrors
+{
+public:
+	struct Frame
+	{
+		std::string_view name;
+		std::string_view source;
+		int32_t currentline = -1;
+	};
+
+	struct Error
+	{
+		// milliseconds since the Unix epoch
+		uint64_t time = 0;
+		bool runtime = false;
+		// entity index of the player that sent it, -1 for errors of this realm
+		int32_t client = -1;
+		uint64_t fingerprint = 0;
+		std::string_view error;
+		std::string_view source_file;
+		int32_t source_line = -1;
+		std::string_view error_string;
+		std::string_view addon_title;
+		uint64_t addon_wsid = 0;
+	};
+
+	// A recorded error, its strings and frames point into its slot and are valid until the slot
+	// is reused by a later error.
+	struct Entry : public Error
+	{
+		// 1 for the first error recorded, increasing by one with every error
+		uint64_t sequence = 0;
+		// whether anything didn't fit the slot
+		bool truncated = false;
+		Span<const Frame> frames;
+	};
+
+	RecentErrors( ) = default;
+
+	RecentErrors( const RecentErrors & ) = delete;
+	RecentErrors &operator=( const RecentErrors & ) = delete;
+
+	// Allocates capacity slots of slot_bytes bytes of strings and max_frames frames each,
+	// forgetting every error. A capacity of zero frees the slots and disables recording.
+	void Configure( size_t capacity, size_t slot_bytes = 2048, size_t max_frames = 16 );
+
+	bool IsEnabled( ) const;
+	size_t GetCapacity( ) const;
+	size_t GetSlotBytes( ) const;
+
+	void Record( const Error &error, Span<const ParsedErrorWithStackTraceView::StackFrame> stack = Span<const ParsedErrorWithStackTraceView::StackFrame>( ) );
+
+	// Errors still in the ring, at most GetCapacity.
+	size_t GetCount( ) const;
+	// Errors recorded since the last Configure.
+	uint64_t GetRecorded( ) const;
+
+	// Calls function with the entries still in the ring, newest first, until it returns false.
+	template<typename Function>
+	void ForEach( Function function ) const
+	{
+		const size_t count = GetCount( );
+		for( size_t k = 0; k < count; ++k )
+			if( !function( entries[static_cast<size_t>( ( recorded - 1 - k ) % entries.size( ) )] ) )
+				return;
+	}
+
+private:
+	size_t slot_bytes = 0;
+	size_t max_frames = 0;
+	uint64_t recorded = 0;
+	std::vector<Entry> entries;
+	std::vector<char> storage;
+	std::vector<Frame> frames;
+};
+
+}
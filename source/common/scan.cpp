@@ -0,0 +1,373 @@
+#include "scan.hpp"
+
+#include <atomic>
+
+#if defined __i386__ || defined __x86_64__ || defined _M_IX86 || defined _M_X64
+
+#define LUAERROR_SCAN_X86
+
+#include <immintrin.h>
+
+#if defined _MSC_VER
+
+#include <intrin.h>
+
+#define LUAERROR_TARGET( isa )
+
+#else
+
+#define LUAERROR_TARGET( isa ) __attribute__( ( target( isa ) ) )
+
+#endif
+
+#endif
+
+namespace common
+{
+
+namespace scan
+{
+
+// Tracks the delimiters of the line being scanned, shared by every implementation
+// so they only differ in how fast they find the interesting characters.
+class LineState
+{
+public:
+	explicit LineState( LineDelimitersBuffer &lines ) :
+		lines( lines )
+	{ }
+
+	inline void Colon( const uint32_t position )
+	{
+		last_colon = position;
+	}
+
+	inline void Separator( const uint32_t position )
+	{
+		previous_separator = last_separator;
+		last_separator = position;
+	}
+
+	inline void CarriageReturn( const uint32_t position )
+	{
+		last_carriage_return = position;
+	}
+
+	inline void Newline( const uint32_t position )
+	{
+		LineDelimiters &delimiters = lines.emplace_back( );
+		delimiters.begin = begin;
+		delimiters.end = position;
+		delimiters.last_colon = last_colon;
+		delimiters.last_carriage_return = last_carriage_return;
+
+		if( last_colon != npos && ( last_separator == npos || last_separator < last_colon ) )
+		{
+			if( last_separator != npos && last_separator + 3 < last_colon )
+				delimiters.separator = last_separator;
+			else if( previous_separator != npos && previous_separator + 3 < last_colon )
+				delimiters.separator = previous_separator;
+		}
+
+		begin = position + 1;
+		last_colon = npos;
+		last_separator = npos;
+		previous_separator = npos;
+		last_carriage_return = npos;
+	}
+
+	// Scalar scan of [position, size), also used for the tails of the vectorized scans.
+	inline void Scan( const char *text, uint32_t position, const uint32_t size )
+	{
+		for( ; position < size; ++position )
+			switch( text[position] )
+			{
+				case '\n':
+					Newline( position );
+					break;
+
+				case ':':
+					Colon( position );
+					break;
+
+				case '\r':
+					CarriageReturn( position );
+					break;
+
+				case ' ':
+					if( position + 2 < size && text[position + 1] == '-' && text[position + 2] == ' ' )
+						Separator( position );
+
+					break;
+			}
+	}
+
+	// Handles every set bit of a block mask, in order.
+	inline void Events( const char *text, const uint32_t block, uint32_t mask )
+	{
+		while( mask != 0 )
+		{
+			const uint32_t position = block + CountTrailingZeros( mask );
+			mask &= mask - 1;
+
+			switch( text[position] )
+			{
+				case '\n':
+					Newline( position );
+					break;
+
+				case ':':
+					Colon( position );
+					break;
+
+				case '\r':
+					CarriageReturn( position );
+					break;
+
+				default:
+					Separator( position );
+					break;
+			}
+		}
+	}
+
+private:
+	static inline uint32_t CountTrailingZeros( const uint32_t mask )
+	{
+
+#if defined _MSC_VER
+
+		unsigned long index = 0;
+		_BitScanForward( &index, mask );
+		return index;
+
+#else
+
+		return static_cast<uint32_t>( __builtin_ctz( mask ) );
+
+#endif
+
+	}
+
+	LineDelimitersBuffer &lines;
+	uint32_t begin = 0;
+	uint32_t last_colon = npos;
+	uint32_t last_separator = npos;
+	uint32_t previous_separator = npos;
+	uint32_t last_carriage_return = npos;
+};
+
+static void FindLineDelimitersScalar( const char *text, const uint32_t size, LineState &state )
+{
+	state.Scan( text, 0, size );
+}
+
+#if defined LUAERROR_SCAN_X86
+
+// Separators need the 2 characters after each block, hence the + 2 on every bound.
+LUAERROR_TARGET( "sse2" ) static void FindLineDelimitersSSE2( const char *text, const uint32_t size, LineState &state )
+{
+	const __m128i newline = _mm_set1_epi8( '\n' );
+	const __m128i colon = _mm_set1_epi8( ':' );
+	const __m128i carriage_return = _mm_set1_epi8( '\r' );
+	const __m128i space = _mm_set1_epi8( ' ' );
+	const __m128i dash = _mm_set1_epi8( '-' );
+
+	uint32_t block = 0;
+	for( ; block + 16 + 2 <= size; block += 16 )
+	{
+		const __m128i chars = _mm_loadu_si128( reinterpret_cast<const __m128i *>( text + block ) );
+		const __m128i next = _mm_loadu_si128( reinterpret_cast<const __m128i *>( text + block + 1 ) );
+		const __m128i after_next = _mm_loadu_si128( reinterpret_cast<const __m128i *>( text + block + 2 ) );
+
+		const __m128i separators = _mm_and_si128(
+			_mm_and_si128( _mm_cmpeq_epi8( chars, space ), _mm_cmpeq_epi8( next, dash ) ),
+			_mm_cmpeq_epi8( after_next, space )
+		);
+		const __m128i events = _mm_or_si128(
+			_mm_or_si128( _mm_cmpeq_epi8( chars, newline ), _mm_cmpeq_epi8( chars, colon ) ),
+			_mm_or_si128( _mm_cmpeq_epi8( chars, carriage_return ), separators )
+		);
+
+		state.Events( text, block, static_cast<uint32_t>( _mm_movemask_epi8( events ) ) );
+	}
+
+	state.Scan( text, block, size );
+}
+
+LUAERROR_TARGET( "avx2" ) static void FindLineDelimitersAVX2( const char *text, const uint32_t size, LineState &state )
+{
+	const __m256i newline = _mm256_set1_epi8( '\n' );
+	const __m256i colon = _mm256_set1_epi8( ':' );
+	const __m256i carriage_return = _mm256_set1_epi8( '\r' );
+	const __m256i space = _mm256_set1_epi8( ' ' );
+	const __m256i dash = _mm256_set1_epi8( '-' );
+
+	uint32_t block = 0;
+	for( ; block + 32 + 2 <= size; block += 32 )
+	{
+		const __m256i chars = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( text + block ) );
+		const __m256i next = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( text + block + 1 ) );
+		const __m256i after_next = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( text + block + 2 ) );
+
+		const __m256i separators = _mm256_and_si256(
+			_mm256_and_si256( _mm256_cmpeq_epi8( chars, space ), _mm256_cmpeq_epi8( next, dash ) ),
+			_mm256_cmpeq_epi8( after_next, space )
+		);
+		const __m256i events = _mm256_or_si256(
+			_mm256_or_si256( _mm256_cmpeq_epi8( chars, newline ), _mm256_cmpeq_epi8( chars, colon ) ),
+			_mm256_or_si256( _mm256_cmpeq_epi8( chars, carriage_return ), separators )
+		);
+
+		state.Events( text, block, static_cast<uint32_t>( _mm256_movemask_epi8( events ) ) );
+	}
+
+	state.Scan( text, block, size );
+}
+
+static bool CPUSupports( const InstructionSet instruction_set )
+{
+
+#if defined _MSC_VER
+
+	int info[4] = { 0 };
+	__cpuid( info, 0 );
+	const int max_leaf = info[0];
+
+	__cpuid( info, 1 );
+	if( instruction_set == InstructionSet::SSE2 )
+		return ( info[3] & ( 1 << 26 ) ) != 0;
+
+	// AVX2 also needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1 and 2)
+	if( max_leaf < 7 || ( info[2] & ( 1 << 27 ) ) == 0 || ( _xgetbv( 0 ) & 6 ) != 6 )
+		return false;
+
+	__cpuidex( info, 7, 0 );
+	return ( info[1] & ( 1 << 5 ) ) != 0;
+
+#else
+
+	__builtin_cpu_init( );
+	if( instruction_set == InstructionSet::SSE2 )
+		return __builtin_cpu_supports( "sse2" ) != 0;
+
+	return __builtin_cpu_supports( "avx2" ) != 0;
+
+#endif
+
+}
+
+#endif
+
+bool IsSupported( const InstructionSet instruction_set )
+{
+	switch( instruction_set )
+	{
+		case InstructionSet::Scalar:
+			return true;
+
+#if defined LUAERROR_SCAN_X86
+
+		case InstructionSet::SSE2:
+		case InstructionSet::AVX2:
+		{
+			static const bool sse2 = CPUSupports( InstructionSet::SSE2 );
+			static const bool avx2 = sse2 && CPUSupports( InstructionSet::AVX2 );
+			return instruction_set == InstructionSet::SSE2 ? sse2 : avx2;
+		}
+
+#endif
+
+		default:
+			return false;
+	}
+}
+
+const char *GetName( const InstructionSet instruction_set )
+{
+	switch( instruction_set )
+	{
+		case InstructionSet::Scalar:
+			return "scalar";
+
+		case InstructionSet::SSE2:
+			return "SSE2";
+
+		case InstructionSet::AVX2:
+			return "AVX2";
+
+		default:
+			return "unknown";
+	}
+}
+
+static InstructionSet BestInstructionSet( )
+{
+	if( IsSupported( InstructionSet::AVX2 ) )
+		return InstructionSet::AVX2;
+
+	if( IsSupported( InstructionSet::SSE2 ) )
+		return InstructionSet::SSE2;
+
+	return InstructionSet::Scalar;
+}
+
+// read by every thread that scans, so it can be changed while the thread pool is busy
+static std::atomic<InstructionSet> current_instruction_set( BestInstructionSet( ) );
+
+InstructionSet GetInstructionSet( )
+{
+	return current_instruction_set.load( std::memory_order_relaxed );
+}
+
+bool SetInstructionSet( const InstructionSet instruction_set )
+{
+	if( !IsSupported( instruction_set ) )
+		return false;
+
+	current_instruction_set.store( instruction_set, std::memory_order_relaxed );
+	return true;
+}
+
+bool FindLineDelimiters( std::string_view text, LineDelimitersBuffer &lines )
+{
+	return FindLineDelimiters( text, lines, current_instruction_set.load( std::memory_order_relaxed ) );
+}
+
+bool FindLineDelimiters( std::string_view text, LineDelimitersBuffer &lines, const InstructionSet instruction_set )
+{
+	lines.clear( );
+
+	if( text.size( ) >= npos || !IsSupported( instruction_set ) )
+		return false;
+
+	const uint32_t size = static_cast<uint32_t>( text.size( ) );
+	LineState state( lines );
+	switch( instruction_set )
+	{
+
+#if defined LUAERROR_SCAN_X86
+
+		case InstructionSet::SSE2:
+			FindLineDelimitersSSE2( text.data( ), size, state );
+			break;
+
+		case InstructionSet::AVX2:
+			FindLineDelimitersAVX2( text.data( ), size, state );
+			break;
+
+#endif
+
+		default:
+			FindLineDelimitersScalar( text.data( ), size, state );
+			break;
+	}
+
+	// the last line doesn't end with a newline
+	state.Newline( size );
+	return true;
+}
+
+}
+
+}
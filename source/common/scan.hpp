@@ -0,0 +1,64 @@
+#pragma once
+
+#include "small_vector.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+namespace common
+{
+
+namespace scan
+{
+
+static constexpr uint32_t npos = UINT32_MAX;
+
+// Positions of the characters the stack frame grammar cares about, for a single line.
+// All positions are relative to the start of the scanned text.
+struct LineDelimiters
+{
+	uint32_t begin = 0;
+	// position of the '\n' ending this line or the size of the text
+	uint32_t end = 0;
+	uint32_t last_colon = npos;
+	// start of the rightmost " - " that still leaves at least one character before
+	// last_colon, npos if there's none or if there's a " - " after last_colon
+	uint32_t separator = npos;
+	uint32_t last_carriage_return = npos;
+
+	inline bool operator==( const LineDelimiters &rhs ) const
+	{
+		return begin == rhs.begin &&
+			end == rhs.end &&
+			last_colon == rhs.last_colon &&
+			separator == rhs.separator &&
+			last_carriage_return == rhs.last_carriage_return;
+	}
+};
+
+typedef SmallVector<LineDelimiters, 64> LineDelimitersBuffer;
+
+enum class InstructionSet
+{
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+bool IsSupported( InstructionSet instruction_set );
+const char *GetName( InstructionSet instruction_set );
+
+// The instruction set used by FindLineDelimiters when none is given,
+// defaults to the best one supported by the running CPU.
+InstructionSet GetInstructionSet( );
+bool SetInstructionSet( InstructionSet instruction_set );
+
+// Fills lines with the delimiters of every '\n' separated line of text, in order
+// (a trailing newline results in an empty last line).
+// Fails on texts of 4GiB or more, since positions are 32 bits wide.
+bool FindLineDelimiters( std::string_view text, LineDelimitersBuffer &lines );
+bool FindLineDelimiters( std::string_view text, LineDelimitersBuffer &lines, InstructionSet instruction_set );
+
+}
+
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace common
+{
+
+// Vector that keeps its first N elements inline and only touches the heap once it grows past them.
+// Only meant for trivially copyable types, since elements are moved around with memcpy.
+// clear( ) keeps whatever capacity was obtained so a reused instance stops allocating once warm.
+template<typename T, size_t N>
+class SmallVector
+{
+	static_assert( std::is_trivially_copyable<T>::value, "SmallVector only supports trivially copyable types" );
+
+public:
+	SmallVector( ) = default;
+
+	SmallVector( const SmallVector &rhs )
+	{
+		*this = rhs;
+	}
+
+	~SmallVector( )
+	{
+		if( elements != Inline( ) )
+			::operator delete( elements );
+	}
+
+	SmallVector &operator=( const SmallVector &rhs )
+	{
+		if( this == &rhs )
+			return *this;
+
+		reserve( rhs.count );
+		std::memcpy( static_cast<void *>( elements ), rhs.elements, rhs.count * sizeof( T ) );
+		count = rhs.count;
+		return *this;
+	}
+
+	T *begin( )
+	{
+		return elements;
+	}
+
+	const T *begin( ) const
+	{
+		return elements;
+	}
+
+	T *end( )
+	{
+		return elements + count;
+	}
+
+	const T *end( ) const
+	{
+		return elements + count;
+	}
+
+	T &operator[]( const size_t index )
+	{
+		return elements[index];
+	}
+
+	const T &operator[]( const size_t index ) const
+	{
+		return elements[index];
+	}
+
+	T &back( )
+	{
+		return elements[count - 1];
+	}
+
+	const T &back( ) const
+	{
+		return elements[count - 1];
+	}
+
+	size_t size( ) const
+	{
+		return count;
+	}
+
+	size_t capacity( ) const
+	{
+		return allocated;
+	}
+
+	bool empty( ) const
+	{
+		return count == 0;
+	}
+
+	bool is_inline( ) const
+	{
+		return elements == Inline( );
+	}
+
+	void clear( )
+	{
+		count = 0;
+	}
+
+	void reserve( const size_t wanted )
+	{
+		if( wanted <= allocated )
+			return;
+
+		size_t new_allocated = allocated * 2;
+		if( new_allocated < wanted )
+			new_allocated = wanted;
+
+		T *new_elements = static_cast<T *>( ::operator new( new_allocated * sizeof( T ) ) );
+		std::memcpy( static_cast<void *>( new_elements ), elements, count * sizeof( T ) );
+		if( elements != Inline( ) )
+			::operator delete( elements );
+
+		elements = new_elements;
+		allocated = new_allocated;
+	}
+
+	void resize( const size_t wanted )
+	{
+		reserve( wanted );
+		for( size_t k = count; k < wanted; ++k )
+			new( &elements[k] ) T( );
+
+		count = wanted;
+	}
+
+	void push_back( const T &value )
+	{
+		if( count == allocated )
+		{
+			const T copy = value; // value might live inside our storage
+			reserve( count + 1 );
+			elements[count++] = copy;
+			return;
+		}
+
+		elements[count++] = value;
+	}
+
+	template<typename... Args>
+	T &emplace_back( Args &&... args )
+	{
+		reserve( count + 1 );
+		return *new( &elements[count++] ) T{ std::forward<Args>( args )... };
+	}
+
+	void pop_back( )
+	{
+		--count;
+	}
+
+	bool operator==( const SmallVector &rhs ) const
+	{
+		if( count != rhs.count )
+			return false;
+
+		for( size_t k = 0; k < count; ++k )
+			if( !( elements[k] == rhs.elements[k] ) )
+				return false;
+
+		return true;
+	}
+
+private:
+	T *Inline( )
+	{
+		return reinterpret_cast<T *>( storage );
+	}
+
+	const T *Inline( ) const
+	{
+		return reinterpret_cast<const T *>( storage );
+	}
+
+	alignas( T ) unsigned char storage[N * sizeof( T )];
+	T *elements = reinterpret_cast<T *>( storage );
+	size_t count = 0;
+	size_t allocated = N;
+};
+
+}
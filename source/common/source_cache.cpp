@@ -0,0 +1,167 @@
+#include "source_cache.hpp"
+#include "hash.hpp"
+
+#include <iterator>
+
+namespace common
+{
+
+SourceCache::File::File( std::string_view file_path, const int64_t modification_time, std::string &&file_content, const Clock::time_point checked_time ) :
+	path( file_path ),
+	mtime( modification_time ),
+	checked( checked_time ),
+	content( std::move( file_content ) )
+{
+	if( content.empty( ) )
+		return;
+
+	lines.push_back( 0 );
+	for( size_t k = 0; k < content.size( ); ++k )
+		if( content[k] == '\n' && k + 1 < content.size( ) )
+			lines.push_back( static_cast<uint32_t>( k + 1 ) );
+}
+
+const std::string &SourceCache::File::GetPath( ) const
+{
+	return path;
+}
+
+int64_t SourceCache::File::GetModificationTime( ) const
+{
+	return mtime;
+}
+
+SourceCache::Clock::time_point SourceCache::File::GetChecked( ) const
+{
+	return checked;
+}
+
+void SourceCache::File::SetChecked( const Clock::time_point checked_time )
+{
+	checked = checked_time;
+}
+
+size_t SourceCache::File::GetLineCount( ) const
+{
+	return lines.size( );
+}
+
+std::string_view SourceCache::File::GetLine( const size_t line ) const
+{
+	if( line == 0 || line > lines.size( ) )
+		return std::string_view( );
+
+	const size_t begin = lines[line - 1];
+	size_t end = line < lines.size( ) ? lines[line] : content.size( );
+	if( end > begin && content[end - 1] == '\n' )
+		--end;
+
+	if( end > begin && content[end - 1] == '\r' )
+		--end;
+
+	return std::string_view( content.data( ) + begin, end - begin );
+}
+
+size_t SourceCache::File::GetSize( ) const
+{
+	return sizeof( File ) + path.size( ) + content.size( ) + lines.size( ) * sizeof( uint32_t );
+}
+
+SourceCache::SourceCache( const size_t bytes_limit, const size_t files_limit ) :
+	max_bytes( bytes_limit ),
+	max_files( files_limit )
+{ }
+
+void SourceCache::SetLimits( const size_t bytes_limit, const size_t files_limit )
+{
+	max_bytes = bytes_limit;
+	max_files = files_limit;
+	Shrink( 0, 0 );
+}
+
+size_t SourceCache::GetMaxBytes( ) const
+{
+	return max_bytes;
+}
+
+size_t SourceCache::GetMaxFiles( ) const
+{
+	return max_files;
+}
+
+SourceCache::File *SourceCache::Find( std::string_view path )
+{
+	const auto entry = index.find( Hash( path ) );
+	if( entry == index.end( ) || entry->second->GetPath( ) != path )
+	{
+		++misses;
+		return nullptr;
+	}
+
+	++hits;
+	files.splice( files.begin( ), files, entry->second );
+	return &files.front( );
+}
+
+SourceCache::File *SourceCache::Insert( std::string_view path, const int64_t mtime, std::string content, const Clock::time_point checked )
+{
+	const uint64_t hash = Hash( path );
+	const auto entry = index.find( hash );
+	if( entry != index.end( ) )
+		Erase( entry->second );
+
+	File file( path, mtime, std::move( content ), checked );
+	const size_t size = file.GetSize( );
+	if( size > max_bytes || max_files == 0 )
+		return nullptr;
+
+	Shrink( size, 1 );
+	files.push_front( std::move( file ) );
+	index[hash] = files.begin( );
+	bytes += size;
+	return &files.front( );
+}
+
+void SourceCache::Clear( )
+{
+	files.clear( );
+	index.clear( );
+	bytes = 0;
+}
+
+size_t SourceCache::GetBytes( ) const
+{
+	return bytes;
+}
+
+size_t SourceCache::GetFileCount( ) const
+{
+	return files.size( );
+}
+
+uint64_t SourceCache::GetHits( ) const
+{
+	return hits;
+}
+
+uint64_t SourceCache::GetMisses( ) const
+{
+	return misses;
+}
+
+void SourceCache::Erase( const std::list<File>::iterator file )
+{
+	bytes -= file->GetSize( );
+	index.erase( Hash( file->GetPath( ) ) );
+	files.erase( file );
+}
+
+// Evicts the least recently used files until extra_bytes more in extra_files more files fit.
+void SourceCache::Shrink( const size_t extra_bytes, const size_t extra_files )
+{
+	while( !files.empty( ) &&
+		( bytes + extra_bytes > max_bytes || files.size( ) + extra_files > max_files ) )
+		Erase( std::prev( files.end( ) ) );
+}
+
+}
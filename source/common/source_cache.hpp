@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+
+// Least recently used cache of source files split into lines, keyed by path and modification
+// time, so showing the lines around an error doesn't read the file again while it's unchanged.
+// Bounded by the bytes and number of files it holds. Not thread safe.
+class SourceCache
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	class File
+	{
+	public:
+		File( std::string_view path, int64_t mtime, std::string &&content, Clock::time_point checked );
+
+		const std::string &GetPath( ) const;
+		int64_t GetModificationTime( ) const;
+
+		// When the modification time was last compared with the one on disk.
+		Clock::time_point GetChecked( ) const;
+		void SetChecked( Clock::time_point checked );
+
+		size_t GetLineCount( ) const;
+
+		// Text of line (1 based) without its line break, empty if there's no such line.
+		std::string_view GetLine( size_t line ) const;
+
+		// Bytes charged to the cache for this file.
+		size_t GetSize( ) const;
+
+	private:
+		std::string path;
+		int64_t mtime;
+		Clock::time_point checked;
+		std::string content;
+		// offset of the start of every line
+		std::vector<uint32_t> lines;
+	};
+
+	explicit SourceCache( size_t max_bytes = 4 * 1024 * 1024, size_t max_files = 256 );
+
+	SourceCache( const SourceCache & ) = delete;
+	SourceCache &operator=( const SourceCache & ) = delete;
+
+	// Evicts files until the cache fits the new limits.
+	void SetLimits( size_t max_bytes, size_t max_files );
+	size_t GetMaxBytes( ) const;
+	size_t GetMaxFiles( ) const;
+
+	// Cached file for path whatever its modification time, marked as the most recently used.
+	// nullptr if it's not cached. Pointers are valid until the next Insert, SetLimits or Clear.
+	File *Find( std::string_view path );
+
+	// Caches content as path at modification time mtime, replacing what was cached for path and
+	// evicting the least recently used files past the limits. Returns nullptr if the file alone
+	// doesn't fit the cache.
+	File *Insert( std::string_view path, int64_t mtime, std::string content, Clock::time_point checked );
+
+	void Clear( );
+
+	size_t GetBytes( ) const;
+	size_t GetFileCount( ) const;
+
+	// Lookups since the cache was created.
+	uint64_t GetHits( ) const;
+	uint64_t GetMisses( ) const;
+
+private:
+	void Erase( std::list<File>::iterator file );
+	void Shrink( size_t bytes, size_t files );
+
+	size_t max_bytes;
+	size_t max_files;
+	size_t bytes = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	// most recently used first
+	std::list<File> files;
+	// hash of the path to the file, paths are compared on lookups
+	std::unordered_map<uint64_t, std::list<File>::iterator> index;
+};
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace common
+{
+
+// Non-owning view over contiguous elements, until std::span is available.
+template<typename T>
+class Span
+{
+public:
+	Span( ) = default;
+
+	Span( T *data, const size_t size ) :
+		elements( data ),
+		count( size )
+	{ }
+
+	template<typename U>
+	Span( std::vector<U> &vector ) :
+		elements( vector.data( ) ),
+		count( vector.size( ) )
+	{ }
+
+	template<typename U>
+	Span( const std::vector<U> &vector ) :
+		elements( vector.data( ) ),
+		count( vector.size( ) )
+	{ }
+
+	T *begin( ) const
+	{
+		return elements;
+	}
+
+	T *end( ) const
+	{
+		return elements + count;
+	}
+
+	T *data( ) const
+	{
+		return elements;
+	}
+
+	T &operator[]( const size_t index ) const
+	{
+		return elements[index];
+	}
+
+	size_t size( ) const
+	{
+		return count;
+	}
+
+	bool empty( ) const
+	{
+		return count == 0;
+	}
+
+	Span subspan( const size_t offset, const size_t size ) const
+	{
+		return Span( elements + offset, size );
+	}
+
+private:
+	T *elements = nullptr;
+	size_t count = 0;
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace common
+{
+
+// Lock-free, fixed capacity ring buffer for exactly one producer thread and one consumer thread.
+// Every slot is constructed up front and elements are filled and consumed in place, so types
+// holding buffers (like strings) keep their capacity as slots are reused.
+template<typename T>
+class SpscQueue
+{
+public:
+	// capacity is rounded up to a power of two
+	explicit SpscQueue( size_t capacity )
+	{
+		size_t size = 2;
+		while( size < capacity )
+			size *= 2;
+
+		slots.reset( new T[size] );
+		mask = size - 1;
+	}
+
+	SpscQueue( const SpscQueue & ) = delete;
+	SpscQueue &operator=( const SpscQueue & ) = delete;
+
+	size_t GetCapacity( ) const
+	{
+		return mask + 1;
+	}
+
+	// Producer only. Returns the slot to fill next or nullptr when the queue is full.
+	// The slot holds whatever was left in it by the consumer, until Push is called it isn't visible.
+	T *Prepare( )
+	{
+		const size_t current_tail = tail.load( std::memory_order_relaxed );
+		if( current_tail - cached_head > mask )
+		{
+			cached_head = head.load( std::memory_order_acquire );
+			if( current_tail - cached_head > mask )
+				return nullptr;
+		}
+
+		return &slots[current_tail & mask];
+	}
+
+	// Producer only. Publishes the slot returned by the last Prepare.
+	void Push( )
+	{
+		tail.store( tail.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+	}
+
+	// Consumer only. Returns the oldest published slot or nullptr when the queue is empty.
+	T *Front( )
+	{
+		const size_t current_head = head.load( std::memory_order_relaxed );
+		if( current_head == cached_tail )
+		{
+			cached_tail = tail.load( std::memory_order_acquire );
+			if( current_head == cached_tail )
+				return nullptr;
+		}
+
+		return &slots[current_head & mask];
+	}
+
+	// Consumer only. Hands the slot returned by Front back to the producer.
+	void Pop( )
+	{
+		head.store( head.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+	}
+
+	// Approximate when called while the other thread is working on the queue.
+	bool IsEmpty( ) const
+	{
+		return head.load( std::memory_order_acquire ) == tail.load( std::memory_order_acquire );
+	}
+
+private:
+	std::unique_ptr<T[]> slots;
+	size_t mask = 0;
+
+	// head and tail live on their own cache lines, next to the copy of the other index
+	// that their thread keeps to avoid touching the other line on every call
+	alignas( 64 ) std::atomic<size_t> head{ 0 };
+	size_t cached_tail = 0;
+	alignas( 64 ) std::atomic<size_t> tail{ 0 };
+	size_t cached_head = 0;
+};
+
+}
@@ -0,0 +1,59 @@
+#include "stack_groups.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+
+namespace common
+{
+
+uint64_t HashStackFrame( std::string_view name, std::string_view source, const int32_t currentline )
+{
+	// the size keeps ("ab", "c") and ("a", "bc") apart
+	uint64_t hash = Hash( static_cast<uint64_t>( name.size( ) ) );
+	hash = Hash( name, hash );
+	hash = Hash( source, hash );
+	return Hash( static_cast<uint64_t>( static_cast<uint32_t>( currentline ) ), hash );
+}
+
+void FoldStackRepeats( Span<const uint64_t> frames, std::vector<StackGroup> &groups, const size_t max_period )
+{
+	groups.clear( );
+
+	const size_t count = frames.size( );
+	size_t k = 0;
+	while( k < count )
+	{
+		size_t best_period = 0, best_repeats = 1;
+		for( size_t period = 1; period <= max_period && k + 2 * period <= count; ++period )
+		{
+			const uint64_t *sequence = frames.data( ) + k;
+			size_t repeats = 1;
+			while( k + ( repeats + 1 ) * period <= count &&
+				std::equal( sequence, sequence + period, sequence + repeats * period ) )
+				++repeats;
+
+			if( repeats >= 2 && period * repeats > best_period * best_repeats )
+			{
+				best_period = period;
+				best_repeats = repeats;
+			}
+		}
+
+		if( best_period != 0 )
+		{
+			groups.push_back( { k, best_period, best_repeats } );
+			k += best_period * best_repeats;
+			continue;
+		}
+
+		// frames that don't repeat go into the group of the previous ones
+		if( !groups.empty( ) && groups.back( ).repeats == 1 )
+			++groups.back( ).length;
+		else
+			groups.push_back( { k, 1, 1 } );
+
+		++k;
+	}
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "span.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// Frames [first, first + length) of a stack (0 based), repeated back to back repeats times.
+// Frames that don't repeat are grouped together with repeats = 1.
+struct StackGroup
+{
+	size_t first = 0;
+	size_t length = 0;
+	size_t repeats = 1;
+
+	inline bool operator==( const StackGroup &rhs ) const
+	{
+		return first == rhs.first && length == rhs.length && repeats == rhs.repeats;
+	}
+};
+
+// Recursion cycles longer than this many frames are left unfolded.
+static constexpr size_t stack_group_max_period = 16;
+
+// Identity of a frame when looking for repeats: the function it's in and where it is.
+uint64_t HashStackFrame( std::string_view name, std::string_view source, int32_t currentline );
+
+// Folds runs of a sequence of up to max_period frames repeated back to back (recursion, like
+// A B C A B C A B C) into groups, given the hash of every frame. At each frame the sequence that
+// covers the most frames is picked, the shortest one on ties. groups is cleared first, so a reused
+// vector doesn't allocate once it's large enough.
+void FoldStackRepeats(
+	Span<const uint64_t> frames,
+	std::vector<StackGroup> &groups,
+	size_t max_period = stack_group_max_period
+);
+
+// FoldStackRepeats over frames with name, source and currentline members, hashes is scratch space.
+template<typename Frames>
+void FoldStackTrace(
+	const Frames &frames,
+	std::vector<uint64_t> &hashes,
+	std::vector<StackGroup> &groups,
+	const size_t max_period = stack_group_max_period
+)
+{
+	hashes.clear( );
+	for( const auto &frame : frames )
+		hashes.push_back( HashStackFrame( frame.name, frame.source, frame.currentline ) );
+
+	FoldStackRepeats( Span<const uint64_t>( hashes ), groups, max_period );
+}
+
+}
@@ -0,0 +1,229 @@
+#include "staging.hpp"
+#include "fingerprint.hpp"
+#include "bytes.hpp"
+
+namespace common
+{
+
+size_t GetStagedErrorSize( std::string_view error, Span<const ParsedErrorWithStackTraceView::StackFrame> stack )
+{
+	size_t size = 4 + 8 + 1 + 4 + 4 + error.size( ) + 4;
+	for( const auto &frame : stack )
+		size += 4 + frame.name.size( ) + 4 + frame.source.size( ) + 4;
+
+	return size;
+}
+
+void StageError(
+	std::vector<uint8_t> &buffer,
+	const uint64_t time,
+	const bool runtime,
+	const int32_t client,
+	std::string_view error,
+	Span<const ParsedErrorWithStackTraceView::StackFrame> stack
+)
+{
+	PutBytes( buffer, GetStagedErrorSize( error, stack ) - 4, 4 );
+	PutBytes( buffer, time, 8 );
+	PutBytes( buffer, ( runtime ? ErrorRecord::Runtime : 0 ) | ( client >= 0 ? ErrorRecord::Client : 0 ), 1 );
+	PutBytes( buffer, static_cast<uint32_t>( client ), 4 );
+	PutString( buffer, error );
+	PutBytes( buffer, stack.size( ), 4 );
+	for( const auto &frame : stack )
+	{
+		PutString( buffer, frame.name );
+		PutString( buffer, frame.source );
+		PutBytes( buffer, static_cast<uint32_t>( frame.currentline ), 4 );
+	}
+}
+
+StagedErrorReader::StagedErrorReader( const uint8_t *data, const size_t size, const AddonResolver *resolver ) :
+	current( data ),
+	end( data + size ),
+	addon_resolver( resolver != nullptr && *resolver ? resolver : nullptr )
+{ }
+
+bool StagedErrorReader::Next( ErrorRecord &record )
+{
+	while( end - current >= 4 )
+	{
+		const size_t size = static_cast<size_t>( GetBytes( current, 4 ) );
+		if( static_cast<size_t>( end - current ) - 4 < size )
+			break;
+
+		ByteReader reader( current + 4, size );
+		current += 4 + size;
+
+		uint64_t flags = 0, client = 0, frame_count = 0;
+		std::string_view error;
+		if( !reader.Read( record.time, 8 ) || !reader.Read( flags, 1 ) || !reader.Read( client, 4 ) ||
+			!reader.ReadString( error ) || !reader.Read( frame_count, 4 ) )
+			continue;
+
+		record.client = static_cast<int32_t>( static_cast<uint32_t>( client ) );
+
+		ParsedErrorWithStackTraceView &parsed_error = record.error;
+		bool parsed = false;
+		if( ( flags & ErrorRecord::Client ) != 0 )
+		{
+			parsed = ParseErrorWithStackTrace( error, parsed_error );
+			if( !parsed )
+			{
+				parsed_error = ParsedErrorWithStackTraceView( );
+				parsed_error.error_string = error;
+			}
+		}
+		else
+		{
+			parsed_error.addon_name = std::string_view( );
+			parsed_error.stack_trace.clear( );
+			parsed = ParseError( error, static_cast<ParsedErrorView &>( parsed_error ) );
+			if( !parsed )
+			{
+				static_cast<ParsedErrorView &>( parsed_error ) = ParsedErrorView( );
+				parsed_error.error_string = error;
+			}
+
+			bool valid = true;
+			for( uint64_t k = 0; k < frame_count && valid; ++k )
+			{
+				ParsedErrorWithStackTraceView::StackFrame frame;
+				uint64_t currentline = 0;
+				valid = reader.ReadString( frame.name ) && reader.ReadString( frame.source ) && reader.Read( currentline, 4 );
+				frame.level = static_cast<int32_t>( k + 1 );
+				frame.currentline = static_cast<int32_t>( static_cast<uint32_t>( currentline ) );
+				parsed_error.stack_trace.push_back( frame );
+			}
+
+			if( !valid )
+				continue;
+
+			uint64_t wsid = 0;
+			addon_title.clear( );
+			if( addon_resolver != nullptr && !parsed_error.source_file.empty( ) &&
+				( *addon_resolver )( parsed_error.source_file, addon_title, wsid ) )
+				parsed_error.addon_name = addon_title;
+		}
+
+		record.flags = static_cast<uint8_t>( flags | ( parsed ? ErrorRecord::Parsed : 0 ) );
+		record.fingerprint = FingerprintParsedError( parsed_error );
+		return true;
+	}
+
+	return false;
+}
+
+void ErrorStager::Open( const size_t new_buffer_bytes, const size_t new_wake_records )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	buffer_bytes = new_buffer_bytes;
+	wake_records = new_wake_records != 0 ? new_wake_records : 1;
+	staging.clear( );
+	staging.reserve( buffer_bytes );
+	staged_records = 0;
+	open = true;
+	flush_requested = false;
+	staged_generation = released_generation = 0;
+}
+
+void ErrorStager::Close( )
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		open = false;
+	}
+
+	wake_condition.notify_one( );
+}
+
+bool ErrorStager::Append(
+	const uint64_t time,
+	const bool runtime,
+	const int32_t client,
+	std::string_view error,
+	Span<const ParsedErrorWithStackTraceView::StackFrame> stack
+)
+{
+	const size_t size = GetStagedErrorSize( error, stack );
+
+	bool wake = false;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if( !open || staging.size( ) + size > buffer_bytes )
+		{
+			++dropped;
+			return false;
+		}
+
+		const size_t half = buffer_bytes / 2;
+		wake = ( staging.size( ) < half && staging.size( ) + size >= half ) || staged_records + 1 == wake_records;
+
+		// staging has buffer_bytes of capacity reserved, so this never allocates
+		StageError( staging, time, runtime, client, error, stack );
+		++staged_records;
+		++staged_generation;
+		++appended;
+	}
+
+	if( wake )
+		wake_condition.notify_one( );
+
+	return true;
+}
+
+void ErrorStager::Take( Batch &batch, const std::chrono::milliseconds timeout )
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	wake_condition.wait_for( lock, timeout, [this]
+	{
+		return !open || flush_requested || staging.size( ) >= buffer_bytes / 2 || staged_records >= wake_records;
+	} );
+
+	batch.rows.clear( );
+	if( batch.rows.capacity( ) < buffer_bytes )
+		batch.rows.reserve( buffer_bytes );
+
+	batch.rows.swap( staging );
+	batch.records = staged_records;
+	batch.last = !open;
+	batch.generation = staged_generation;
+	staged_records = 0;
+	flush_requested = false;
+}
+
+void ErrorStager::Release( const Batch &batch )
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if( batch.generation > released_generation )
+			released_generation = batch.generation;
+	}
+
+	released_condition.notify_all( );
+}
+
+bool ErrorStager::Flush( const std::chrono::milliseconds timeout )
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	if( !open )
+		return false;
+
+	const uint64_t target = staged_generation;
+	flush_requested = true;
+	wake_condition.notify_one( );
+	return released_condition.wait_for( lock, timeout, [this, target] { return released_generation >= target; } );
+}
+
+uint64_t ErrorStager::GetAppended( ) const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	return appended;
+}
+
+uint64_t ErrorStager::GetDropped( ) const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	return dropped;
+}
+
+}
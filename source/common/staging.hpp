@@ -0,0 +1,135 @@
+#pragma once
+
+#include "common.hpp"
+#include "span.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// Looks up the workshop addon that owns source, for sinks that attribute errors on their own threads.
+typedef std::function<bool( std::string_view source, std::string &title, uint64_t &wsid )> AddonResolver;
+
+// A parsed and fingerprinted error, as handed over by the background sinks (journal, exporter).
+// Strings point into whatever buffer the record was read from.
+struct ErrorRecord
+{
+	enum Flags : uint8_t
+	{
+		Runtime = 1 << 0,
+		// Errors that couldn't be parsed have the whole error in error_string
+		Parsed = 1 << 1,
+		Client = 1 << 2
+	};
+
+	uint64_t time = 0;
+	uint8_t flags = 0;
+	int32_t client = -1;
+	uint64_t fingerprint = 0;
+	ParsedErrorWithStackTraceView error;
+};
+
+// Background sinks have producers copy raw errors into a byte buffer, as rows of: size (32 bits,
+// not counting itself), time (64 bits), flags (8 bits), client (32 bits), error (string), frame
+// count (32 bits) and, for each frame, name (string), source (string) and current line (32 bits).
+// Strings are a 32 bits size followed by their bytes. Staging is just copying bytes, the parsing
+// happens when the sink's thread reads the rows back.
+size_t GetStagedErrorSize( std::string_view error, Span<const ParsedErrorWithStackTraceView::StackFrame> stack );
+
+// Appends a row to buffer, which doesn't allocate if it has GetStagedErrorSize bytes of spare capacity.
+// Client errors carry their stack trace in error, errors of this realm have theirs captured by the caller.
+void StageError(
+	std::vector<uint8_t> &buffer,
+	uint64_t time,
+	bool runtime,
+	int32_t client,
+	std::string_view error,
+	Span<const ParsedErrorWithStackTraceView::StackFrame> stack
+);
+
+// Reads staged rows back, parsing, fingerprinting and (for errors of this realm) attributing them.
+class StagedErrorReader
+{
+public:
+	StagedErrorReader( const uint8_t *data, size_t size, const AddonResolver *addon_resolver = nullptr );
+
+	// Returns false once every complete row was read. The record is valid until the next call.
+	bool Next( ErrorRecord &record );
+
+private:
+	const uint8_t *current;
+	const uint8_t *end;
+	const AddonResolver *addon_resolver;
+	std::string addon_title;
+};
+
+// Double buffered staging area between the producers of a sink and its background thread.
+// Producers stage rows under a short lock that only copies bytes, the sink thread swaps the
+// whole buffer out when it wakes up and reads it back without holding the lock.
+class ErrorStager
+{
+public:
+	struct Batch
+	{
+		std::vector<uint8_t> rows;
+		size_t records = 0;
+		// Set on the last batch, taken after Close was called
+		bool last = false;
+		uint64_t generation = 0;
+	};
+
+	// Reserves buffer_bytes for staged rows (errors that don't fit are dropped) and wakes the sink
+	// thread once half of it, or wake_records rows, are staged. Must not be called while in use.
+	void Open( size_t buffer_bytes, size_t wake_records = SIZE_MAX );
+
+	// Makes the next Take return the last batch, Append drops everything from now on.
+	void Close( );
+
+	// Any thread. Returns false (and counts it as dropped) if the buffer is full or closed.
+	bool Append(
+		uint64_t time,
+		bool runtime,
+		int32_t client,
+		std::string_view error,
+		Span<const ParsedErrorWithStackTraceView::StackFrame> stack = Span<const ParsedErrorWithStackTraceView::StackFrame>( )
+	);
+
+	// Sink thread. Waits up to timeout for a reason to wake up and swaps the staged rows into batch,
+	// whose previous rows are discarded (its capacity is what producers will stage into next).
+	void Take( Batch &batch, std::chrono::milliseconds timeout );
+
+	// Sink thread. Tells Flush callers the rows of batch were handled.
+	void Release( const Batch &batch );
+
+	// Blocks until every row staged so far was released.
+	bool Flush( std::chrono::milliseconds timeout );
+
+	uint64_t GetAppended( ) const;
+	uint64_t GetDropped( ) const;
+
+private:
+	mutable std::mutex mutex;
+	std::condition_variable wake_condition;
+	std::condition_variable released_condition;
+	std::vector<uint8_t> staging;
+	size_t buffer_bytes = 0;
+	size_t wake_records = SIZE_MAX;
+	size_t staged_records = 0;
+	bool open = false;
+	bool flush_requested = false;
+	uint64_t staged_generation = 0;
+	uint64_t released_generation = 0;
+	uint64_t appended = 0;
+	uint64_t dropped = 0;
+};
+
+}
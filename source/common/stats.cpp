@@ -0,0 +1,97 @@
+#include "stats.hpp"
+
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace common
+{
+
+static inline size_t GetBucketIndex( const uint64_t nanoseconds )
+{
+	if( nanoseconds == 0 )
+		return 0;
+
+#if defined _MSC_VER
+
+	unsigned long index = 0;
+	_BitScanReverse64( &index, nanoseconds );
+	const size_t bucket = static_cast<size_t>( index ) + 1;
+
+#else
+
+	const size_t bucket = static_cast<size_t>( 64 - __builtin_clzll( nanoseconds ) );
+
+#endif
+
+	return bucket < LatencyHistogram::bucket_count ? bucket : LatencyHistogram::bucket_count - 1;
+}
+
+void LatencyHistogram::Add( const Clock::duration duration )
+{
+	const int64_t signed_nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>( duration ).count( );
+	const uint64_t nanoseconds = signed_nanoseconds > 0 ? static_cast<uint64_t>( signed_nanoseconds ) : 0;
+
+	++buckets[GetBucketIndex( nanoseconds )];
+	++count;
+	total += nanoseconds;
+	if( nanoseconds > max )
+		max = nanoseconds;
+}
+
+uint64_t LatencyHistogram::GetCount( ) const
+{
+	return count;
+}
+
+LatencyHistogram::Clock::duration LatencyHistogram::GetTotal( ) const
+{
+	return std::chrono::duration_cast<Clock::duration>( std::chrono::nanoseconds( total ) );
+}
+
+LatencyHistogram::Clock::duration LatencyHistogram::GetMax( ) const
+{
+	return std::chrono::duration_cast<Clock::duration>( std::chrono::nanoseconds( max ) );
+}
+
+LatencyHistogram::Clock::duration LatencyHistogram::GetQuantile( const double quantile ) const
+{
+	if( count == 0 )
+		return Clock::duration::zero( );
+
+	const double clamped = quantile < 0.0 ? 0.0 : ( quantile > 1.0 ? 1.0 : quantile );
+	uint64_t target = static_cast<uint64_t>( clamped * static_cast<double>( count ) + 0.5 );
+	if( target == 0 )
+		target = 1;
+
+	uint64_t seen = 0;
+	for( size_t k = 0; k < bucket_count; ++k )
+	{
+		seen += buckets[k];
+		if( seen >= target )
+		{
+			// the last bucket has no upper bound, the longest sample is the best guess
+			const uint64_t bound = k + 1 < bucket_count ? ( uint64_t( 1 ) << k ) : max;
+			return std::chrono::duration_cast<Clock::duration>( std::chrono::nanoseconds( bound < max ? bound : max ) );
+		}
+	}
+
+	return GetMax( );
+}
+
+uint64_t LatencyHistogram::GetBucket( const size_t bucket ) const
+{
+	return bucket < bucket_count ? buckets[bucket] : 0;
+}
+
+void LatencyHistogram::Reset( )
+{
+	*this = LatencyHistogram( );
+}
+
+void ErrorPathStats::Reset( )
+{
+	*this = ErrorPathStats( );
+}
+
+}
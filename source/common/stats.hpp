@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace common
+{
+
+// Fixed size latency histogram with power of two buckets: bucket k holds durations of less than
+// 2^k nanoseconds (and at least 2^(k-1)), the last one everything longer. Adding a sample is a
+// few integer operations and never allocates, so it can stay on in production.
+class LatencyHistogram
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static constexpr size_t bucket_count = 36;
+
+	void Add( Clock::duration duration );
+
+	uint64_t GetCount( ) const;
+	Clock::duration GetTotal( ) const;
+	Clock::duration GetMax( ) const;
+
+	// Upper bound of the bucket holding the quantile (0 to 1) of the samples, zero without samples.
+	Clock::duration GetQuantile( double quantile ) const;
+
+	uint64_t GetBucket( size_t bucket ) const;
+
+	void Reset( );
+
+private:
+	uint64_t buckets[bucket_count] = { };
+	uint64_t count = 0;
+	uint64_t total = 0;
+	uint64_t max = 0;
+};
+
+// Adds the time spent in its scope to a histogram.
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer( LatencyHistogram &target ) :
+		histogram( target ),
+		start( LatencyHistogram::Clock::now( ) )
+	{ }
+
+	~ScopedTimer( )
+	{
+		histogram.Add( LatencyHistogram::Clock::now( ) - start );
+	}
+
+	ScopedTimer( const ScopedTimer & ) = delete;
+	ScopedTimer &operator=( const ScopedTimer & ) = delete;
+
+private:
+	LatencyHistogram &histogram;
+	LatencyHistogram::Clock::time_point start;
+};
+
+// What an error path (errors of this realm or from clients) costs, updated by the thread that
+// runs it, which is always the game thread.
+struct ErrorPathStats
+{
+	enum Timer : size_t
+	{
+		Parse,
+		StackCapture,
+		AddonLookup,
+		HookCall,
+		TimerCount
+	};
+
+	uint64_t seen = 0;
+	// repeats filtered out by the duplicate filter
+	uint64_t suppressed = 0;
+	// errors dropped by rate limits or full queues
+	uint64_t dropped = 0;
+	// size of every error seen
+	uint64_t bytes = 0;
+	LatencyHistogram timers[TimerCount];
+	// stack tables built for hooks and the Lua memory building them allocated, split by whether
+	// they came from the pool (luaerror.EnableStackPool). Builds during which the collector freed
+	// more than they allocated aren't counted.
+	uint64_t stacks = 0;
+	uint64_t stack_bytes = 0;
+	uint64_t pooled_stacks = 0;
+	uint64_t pooled_stack_bytes = 0;
+
+	void Reset( );
+};
+
+}
@@ -0,0 +1,195 @@
+#include "string_pool.hpp"
+#include "hash.hpp"
+
+#include <cstring>
+
+namespace common
+{
+
+static constexpr size_t minimum_block_size = 64 * 1024;
+static constexpr size_t initial_slots = 256;
+
+StringPool::StringPool( )
+{
+	Clear( );
+}
+
+uint32_t StringPool::Hash( std::string_view text )
+{
+	const uint64_t hash = common::Hash( text );
+	return static_cast<uint32_t>( hash ^ ( hash >> 32 ) );
+}
+
+StringPool::Id StringPool::Intern( std::string_view text )
+{
+	if( text.empty( ) )
+		return empty_id;
+
+	const uint32_t hash = Hash( text );
+	const size_t slot = FindSlot( text, hash );
+	if( slots[slot] != 0 )
+		return slots[slot] - 1;
+
+	if( entries.size( ) >= invalid_id - 1 )
+		return invalid_id;
+
+	const Id id = static_cast<Id>( entries.size( ) );
+	entries.push_back( { Store( text ), static_cast<uint32_t>( text.size( ) ), hash } );
+	slots[slot] = id + 1;
+
+	// keep the load factor under 1/2
+	if( entries.size( ) * 2 > slots.size( ) )
+		Grow( );
+
+	return id;
+}
+
+StringPool::Id StringPool::Find( std::string_view text ) const
+{
+	if( text.empty( ) )
+		return empty_id;
+
+	const size_t slot = FindSlot( text, Hash( text ) );
+	return slots[slot] != 0 ? slots[slot] - 1 : invalid_id;
+}
+
+std::string_view StringPool::Get( const Id id ) const
+{
+	if( id >= entries.size( ) )
+		return std::string_view( );
+
+	const Entry &entry = entries[id];
+	return std::string_view( entry.text, entry.size );
+}
+
+const char *StringPool::GetCString( const Id id ) const
+{
+	if( id >= entries.size( ) )
+		return "";
+
+	return entries[id].text;
+}
+
+size_t StringPool::GetCount( ) const
+{
+	return entries.size( );
+}
+
+size_t StringPool::GetMemoryUsage( ) const
+{
+	return blocks.size( ) * sizeof( blocks[0] ) + text_bytes +
+		entries.capacity( ) * sizeof( Entry ) +
+		slots.capacity( ) * sizeof( uint32_t );
+}
+
+void StringPool::Clear( )
+{
+	blocks.clear( );
+	block_used = 0;
+	block_size = 0;
+	text_bytes = 0;
+
+	entries.clear( );
+	entries.push_back( { "", 0, Hash( std::string_view( ) ) } );
+
+	slots.assign( initial_slots, 0 );
+}
+
+size_t StringPool::FindSlot( std::string_view text, const uint32_t hash ) const
+{
+	const size_t mask = slots.size( ) - 1;
+	size_t slot = hash & mask;
+	while( slots[slot] != 0 )
+	{
+		const Entry &entry = entries[slots[slot] - 1];
+		if( entry.hash == hash && std::string_view( entry.text, entry.size ) == text )
+			break;
+
+		slot = ( slot + 1 ) & mask;
+	}
+
+	return slot;
+}
+
+const char *StringPool::Store( std::string_view text )
+{
+	const size_t needed = text.size( ) + 1;
+	if( block_size - block_used < needed )
+	{
+		block_size = needed > minimum_block_size ? needed : minimum_block_size;
+		block_used = 0;
+		blocks.emplace_back( new char[block_size] );
+		text_bytes += block_size;
+	}
+
+	char *stored = blocks.back( ).get( ) + block_used;
+	std::memcpy( stored, text.data( ), text.size( ) );
+	stored[text.size( )] = '\0';
+	block_used += needed;
+	return stored;
+}
+
+void StringPool::Grow( )
+{
+	slots.assign( slots.size( ) * 2, 0 );
+
+	const size_t mask = slots.size( ) - 1;
+	for( size_t k = 1; k < entries.size( ); ++k )
+	{
+		size_t slot = entries[k].hash & mask;
+		while( slots[slot] != 0 )
+			slot = ( slot + 1 ) & mask;
+
+		slots[slot] = static_cast<uint32_t>( k + 1 );
+	}
+}
+
+template<typename ParsedErrorType>
+inline void InternParsedErrorGeneric( StringPool &pool, const ParsedErrorType &parsed_error, InternedErrorWithStackTrace &interned_error )
+{
+	interned_error.source_file = pool.Intern( parsed_error.source_file );
+	interned_error.source_line = parsed_error.source_line;
+	interned_error.error_string = pool.Intern( parsed_error.error_string );
+	interned_error.addon_name = pool.Intern( parsed_error.addon_name );
+
+	interned_error.stack_trace.resize( parsed_error.stack_trace.size( ) );
+	for( size_t k = 0; k < parsed_error.stack_trace.size( ); ++k )
+	{
+		const auto &frame = parsed_error.stack_trace[k];
+		auto &interned_frame = interned_error.stack_trace[k];
+		interned_frame.level = frame.level;
+		interned_frame.name = pool.Intern( frame.name );
+		interned_frame.source = pool.Intern( frame.source );
+		interned_frame.currentline = frame.currentline;
+	}
+}
+
+void InternParsedError( StringPool &pool, const ParsedErrorWithStackTraceView &parsed_error, InternedErrorWithStackTrace &interned_error )
+{
+	InternParsedErrorGeneric( pool, parsed_error, interned_error );
+}
+
+void InternParsedError( StringPool &pool, const ParsedErrorWithStackTrace &parsed_error, InternedErrorWithStackTrace &interned_error )
+{
+	InternParsedErrorGeneric( pool, parsed_error, interned_error );
+}
+
+void ResolveInternedError( const StringPool &pool, const InternedErrorWithStackTrace &interned_error, ParsedErrorWithStackTraceView &parsed_error )
+{
+	parsed_error.source_file = pool.Get( interned_error.source_file );
+	parsed_error.source_line = interned_error.source_line;
+	parsed_error.error_string = pool.Get( interned_error.error_string );
+	parsed_error.addon_name = pool.Get( interned_error.addon_name );
+
+	parsed_error.stack_trace.clear( );
+	for( const auto &interned_frame : interned_error.stack_trace )
+	{
+		auto &frame = parsed_error.stack_trace.emplace_back( );
+		frame.level = interned_frame.level;
+		frame.name = pool.Get( interned_frame.name );
+		frame.source = pool.Get( interned_frame.source );
+		frame.currentline = interned_frame.currentline;
+	}
+}
+
+}
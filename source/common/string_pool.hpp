@@ -0,0 +1,110 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+// Interns strings into compact identifiers. Interned text is stored null terminated in large
+// blocks that never move, so views (and c_str-like pointers) returned by Get stay valid until
+// Clear is called. Identifier 0 is always the empty string.
+class StringPool
+{
+public:
+	typedef uint32_t Id;
+
+	static constexpr Id empty_id = 0;
+	static constexpr Id invalid_id = UINT32_MAX;
+
+	StringPool( );
+
+	// Returns the identifier of text, adding it to the pool if needed.
+	Id Intern( std::string_view text );
+
+	// Returns the identifier of text if it was interned before, invalid_id otherwise.
+	Id Find( std::string_view text ) const;
+
+	std::string_view Get( Id id ) const;
+
+	// Same as Get, for APIs that need null terminated strings (like pushing to Lua).
+	const char *GetCString( Id id ) const;
+
+	size_t GetCount( ) const;
+
+	// Bytes used by interned text and bookkeeping.
+	size_t GetMemoryUsage( ) const;
+
+	void Clear( );
+
+private:
+	struct Entry
+	{
+		const char *text;
+		uint32_t size;
+		uint32_t hash;
+	};
+
+	static uint32_t Hash( std::string_view text );
+
+	size_t FindSlot( std::string_view text, uint32_t hash ) const;
+	const char *Store( std::string_view text );
+	void Grow( );
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	size_t block_used = 0;
+	size_t block_size = 0;
+	size_t text_bytes = 0;
+
+	std::vector<Entry> entries;
+	// open addressing table of entry indices + 1, 0 means an empty slot
+	std::vector<uint32_t> slots;
+};
+
+// StackFrame with its strings interned, comparing two of these is a few integer compares.
+struct InternedStackFrame
+{
+	int32_t level = 0;
+	StringPool::Id name = StringPool::empty_id;
+	StringPool::Id source = StringPool::empty_id;
+	int32_t currentline = -1;
+
+	inline bool operator==( const InternedStackFrame &rhs ) const
+	{
+		return level == rhs.level &&
+			name == rhs.name &&
+			source == rhs.source &&
+			currentline == rhs.currentline;
+	}
+};
+
+struct InternedErrorWithStackTrace
+{
+	StringPool::Id source_file = StringPool::empty_id;
+	int32_t source_line = -1;
+	StringPool::Id error_string = StringPool::empty_id;
+	StringPool::Id addon_name = StringPool::empty_id;
+	std::vector<InternedStackFrame> stack_trace;
+
+	inline bool operator==( const InternedErrorWithStackTrace &rhs ) const
+	{
+		return source_file == rhs.source_file &&
+			source_line == rhs.source_line &&
+			error_string == rhs.error_string &&
+			addon_name == rhs.addon_name &&
+			stack_trace == rhs.stack_trace;
+	}
+};
+
+void InternParsedError( StringPool &pool, const ParsedErrorWithStackTraceView &parsed_error, InternedErrorWithStackTrace &interned_error );
+void InternParsedError( StringPool &pool, const ParsedErrorWithStackTrace &parsed_error, InternedErrorWithStackTrace &interned_error );
+
+// Resolves every identifier back into views that point into the pool.
+void ResolveInternedError( const StringPool &pool, const InternedErrorWithStackTrace &interned_error, ParsedErrorWithStackTraceView &parsed_error );
+
+}
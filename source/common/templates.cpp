@@ -0,0 +1,291 @@
+#include "templates.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+
+namespace common
+{
+
+inline bool IsParameter( std::string_view token )
+{
+	for( const char c : token )
+		if( c >= '0' && c <= '9' )
+			return true;
+
+	return false;
+}
+
+// Tokens with digits compare as wildcards.
+inline std::string_view NormalizeToken( std::string_view token )
+{
+	return IsParameter( token ) ? TemplateMiner::wildcard : token;
+}
+
+TemplateMiner::TemplateMiner( )
+{
+	Configure( Options( ) );
+}
+
+TemplateMiner::TemplateMiner( const Options &new_options )
+{
+	Configure( new_options );
+}
+
+void TemplateMiner::Configure( const Options &new_options )
+{
+	options = new_options;
+	options.max_group_templates = std::max<size_t>( options.max_group_templates, 1 );
+
+	// swapping actually frees the memory when disabling
+	std::vector<Slot>( ).swap( slots );
+	std::vector<uint32_t>( ).swap( free_slots );
+	groups.clear( );
+	ids.clear( );
+	head = tail = none;
+	evictions = 0;
+	slots.reserve( options.max_templates );
+}
+
+const TemplateMiner::Options &TemplateMiner::GetOptions( ) const
+{
+	return options;
+}
+
+bool TemplateMiner::IsEnabled( ) const
+{
+	return options.max_templates != 0;
+}
+
+uint32_t TemplateMiner::Add( std::string_view message, Parameters *parameters )
+{
+	if( parameters != nullptr )
+		parameters->clear( );
+
+	if( options.max_templates == 0 )
+		return 0;
+
+	tokens.clear( );
+	size_t position = 0;
+	while( position < message.size( ) )
+	{
+		position = message.find_first_not_of( ' ', position );
+		if( position == std::string_view::npos )
+			break;
+
+		size_t end = message.find( ' ', position );
+		if( end == std::string_view::npos || tokens.size( ) + 1 == max_tokens )
+			end = message.size( );
+
+		tokens.push_back( message.substr( position, end - position ) );
+		position = end;
+	}
+
+	uint64_t group = Hash( static_cast<uint64_t>( tokens.size( ) ) );
+	for( size_t k = 0; k < tokens.size( ) && k < options.depth; ++k )
+		group = Hash( NormalizeToken( tokens[k] ), group );
+
+	std::vector<uint32_t> &members = groups[group];
+
+	// the most similar template, the one with more wildcards on ties
+	uint32_t best = none;
+	size_t best_equal = 0, best_wildcards = 0;
+	for( const uint32_t member : members )
+	{
+		const Slot &slot = slots[member];
+		if( slot.tokens.size( ) != tokens.size( ) )
+			continue;
+
+		size_t equal = 0, wildcards = 0;
+		for( size_t k = 0; k < tokens.size( ); ++k )
+			if( slot.tokens[k] == wildcard )
+				++wildcards;
+			else if( slot.tokens[k] == NormalizeToken( tokens[k] ) )
+				++equal;
+
+		if( best == none || equal > best_equal || ( equal == best_equal && wildcards > best_wildcards ) )
+		{
+			best = member;
+			best_equal = equal;
+			best_wildcards = wildcards;
+		}
+	}
+
+	uint32_t index = none;
+	if( best != none && static_cast<double>( best_equal ) >= options.similarity * static_cast<double>( tokens.size( ) ) )
+	{
+		index = best;
+		Slot &slot = slots[index];
+		bool changed = false;
+		for( size_t k = 0; k < tokens.size( ); ++k )
+			if( slot.tokens[k] != wildcard && slot.tokens[k] != NormalizeToken( tokens[k] ) )
+			{
+				slot.tokens[k] = wildcard;
+				changed = true;
+			}
+
+		if( changed )
+			BuildText( slot );
+	}
+	else
+	{
+		index = Create( group, members );
+		Slot &slot = slots[index];
+		slot.tokens.resize( tokens.size( ) );
+		for( size_t k = 0; k < tokens.size( ); ++k )
+			slot.tokens[k] = NormalizeToken( tokens[k] );
+
+		BuildText( slot );
+	}
+
+	Slot &slot = slots[index];
+	++slot.data.count;
+	Touch( index );
+
+	if( parameters != nullptr )
+		for( size_t k = 0; k < tokens.size( ); ++k )
+			if( slot.tokens[k] == wildcard )
+				parameters->push_back( tokens[k] );
+
+	return slot.data.id;
+}
+
+const TemplateMiner::Template *TemplateMiner::Find( const uint32_t id ) const
+{
+	const auto entry = ids.find( id );
+	return entry != ids.end( ) ? &slots[entry->second].data : nullptr;
+}
+
+void TemplateMiner::GetTop( const size_t k, std::vector<const Template *> &top ) const
+{
+	top.clear( );
+	for( const auto &entry : ids )
+		top.push_back( &slots[entry.second].data );
+
+	const size_t count = std::min( k, top.size( ) );
+	std::partial_sort( top.begin( ), top.begin( ) + static_cast<std::ptrdiff_t>( count ), top.end( ),
+		[]( const Template *lhs, const Template *rhs )
+		{
+			return lhs->count != rhs->count ? lhs->count > rhs->count : lhs->id < rhs->id;
+		}
+	);
+	top.resize( count );
+}
+
+size_t TemplateMiner::GetCount( ) const
+{
+	return ids.size( );
+}
+
+uint64_t TemplateMiner::GetEvictions( ) const
+{
+	return evictions;
+}
+
+// Takes a slot for a new template of group, replacing the least recently used template of the
+// group or of the whole miner when either is full.
+uint32_t TemplateMiner::Create( const uint64_t group, std::vector<uint32_t> &members )
+{
+	if( members.size( ) >= options.max_group_templates )
+	{
+		const auto oldest = std::min_element( members.begin( ), members.end( ), [this]( const uint32_t lhs, const uint32_t rhs )
+		{
+			return slots[lhs].used < slots[rhs].used;
+		} );
+		Evict( *oldest );
+	}
+	else if( ids.size( ) >= options.max_templates )
+		Evict( tail );
+
+	uint32_t index = none;
+	if( !free_slots.empty( ) )
+	{
+		index = free_slots.back( );
+		free_slots.pop_back( );
+	}
+	else
+	{
+		index = static_cast<uint32_t>( slots.size( ) );
+		slots.emplace_back( );
+	}
+
+	Slot &slot = slots[index];
+	// ids only wrap after 4 billion templates, 0 is never used
+	if( ++last_id == 0 )
+		++last_id;
+
+	slot.data.id = last_id;
+	slot.data.count = 0;
+	slot.group = group;
+	ids[slot.data.id] = index;
+	// the group may have been replaced by an eviction
+	groups[group].push_back( index );
+	return index;
+}
+
+void TemplateMiner::Evict( const uint32_t index )
+{
+	Slot &slot = slots[index];
+	Unlink( index );
+	ids.erase( slot.data.id );
+
+	const auto group = groups.find( slot.group );
+	if( group != groups.end( ) )
+	{
+		std::vector<uint32_t> &members = group->second;
+		members.erase( std::find( members.begin( ), members.end( ), index ) );
+		if( members.empty( ) )
+			groups.erase( group );
+	}
+
+	free_slots.push_back( index );
+	++evictions;
+}
+
+void TemplateMiner::Touch( const uint32_t index )
+{
+	slots[index].used = ++tick;
+	if( head == index )
+		return;
+
+	Unlink( index );
+
+	Slot &slot = slots[index];
+	slot.previous = none;
+	slot.next = head;
+	if( head != none )
+		slots[head].previous = index;
+
+	head = index;
+	if( tail == none )
+		tail = index;
+}
+
+void TemplateMiner::Unlink( const uint32_t index )
+{
+	Slot &slot = slots[index];
+	if( slot.previous != none )
+		slots[slot.previous].next = slot.next;
+	else if( head == index )
+		head = slot.next;
+
+	if( slot.next != none )
+		slots[slot.next].previous = slot.previous;
+	else if( tail == index )
+		tail = slot.previous;
+
+	slot.previous = slot.next = none;
+}
+
+void TemplateMiner::BuildText( Slot &slot )
+{
+	slot.data.text.clear( );
+	for( const std::string &token : slot.tokens )
+	{
+		if( !slot.data.text.empty( ) )
+			slot.data.text += ' ';
+
+		slot.data.text += token;
+	}
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "small_vector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace common
+{
+
+// Online clustering of error messages into templates, in the style of Drain (He et al., 2017).
+// Messages are split in space separated tokens, tokens with digits are parameters from the start.
+// The number of tokens and the leading tokens pick a small group of templates, the message joins
+// the most similar one (turning the tokens that differ into wildcards) or starts a new one. The
+// least recently used template is replaced once there are too many, so memory is bounded and
+// every message costs a fixed amount of work. Not thread safe.
+class TemplateMiner
+{
+public:
+	struct Options
+	{
+		// 0 disables mining
+		size_t max_templates = 1024;
+		// leading tokens that pick the group of templates a message is compared with
+		size_t depth = 2;
+		// share of equal tokens a message needs to join a template
+		double similarity = 0.5;
+		// templates compared with a message, the least recently used of the group is replaced
+		size_t max_group_templates = 32;
+	};
+
+	struct Template
+	{
+		// never 0, not reused while the miner lives
+		uint32_t id = 0;
+		uint64_t count = 0;
+		// tokens separated by spaces, with wildcard for the parameters
+		std::string text;
+	};
+
+	static constexpr std::string_view wildcard = "<*>";
+	// tokens past this are part of the last one
+	static constexpr size_t max_tokens = 64;
+
+	typedef SmallVector<std::string_view, 16> Parameters;
+
+	TemplateMiner( );
+	explicit TemplateMiner( const Options &options );
+
+	TemplateMiner( const TemplateMiner & ) = delete;
+	TemplateMiner &operator=( const TemplateMiner & ) = delete;
+
+	// Forgets every template.
+	void Configure( const Options &options );
+	const Options &GetOptions( ) const;
+	bool IsEnabled( ) const;
+
+	// Returns the id of the template message belongs to, after updating it, 0 when disabled.
+	// parameters (if given) gets the tokens of message where the template has wildcards.
+	uint32_t Add( std::string_view message, Parameters *parameters = nullptr );
+
+	// nullptr if there's no template with that id (anymore).
+	const Template *Find( uint32_t id ) const;
+
+	// Replaces the contents of top with the k templates with the highest counts, highest first.
+	void GetTop( size_t k, std::vector<const Template *> &top ) const;
+
+	size_t GetCount( ) const;
+	// templates replaced to make room for new ones
+	uint64_t GetEvictions( ) const;
+
+private:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	struct Slot
+	{
+		Template data;
+		std::vector<std::string> tokens;
+		uint64_t group = 0;
+		uint64_t used = 0;
+		// least recently used list, head is the most recent
+		uint32_t previous = none;
+		uint32_t next = none;
+	};
+
+	uint32_t Create( uint64_t group, std::vector<uint32_t> &members );
+	void Evict( uint32_t slot );
+	void Touch( uint32_t slot );
+	void Unlink( uint32_t slot );
+	static void BuildText( Slot &slot );
+
+	Options options;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> free_slots;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> groups;
+	std::unordered_map<uint32_t, uint32_t> ids;
+	uint32_t head = none;
+	uint32_t tail = none;
+	uint32_t last_id = 0;
+	uint64_t tick = 0;
+	uint64_t evictions = 0;
+	SmallVector<std::string_view, max_tokens> tokens;
+};
+
+}
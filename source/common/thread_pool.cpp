@@ -0,0 +1,151 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace common
+{
+
+ThreadPool::ThreadPool( const size_t threads )
+{
+	queues.reserve( threads + 1 );
+	for( size_t k = 0; k < threads + 1; ++k )
+		queues.emplace_back( new Queue );
+
+	workers.reserve( threads );
+	for( size_t k = 0; k < threads; ++k )
+		workers.emplace_back( &ThreadPool::WorkerLoop, this, k + 1 );
+}
+
+ThreadPool::~ThreadPool( )
+{
+	{
+		std::lock_guard<std::mutex> lock( state_mutex );
+		stopping = true;
+	}
+
+	start_condition.notify_all( );
+
+	for( auto &worker : workers )
+		worker.join( );
+}
+
+size_t ThreadPool::GetConcurrency( ) const
+{
+	return workers.size( ) + 1;
+}
+
+void ThreadPool::ParallelFor( const size_t count, size_t grain, const Task &task )
+{
+	if( count == 0 )
+		return;
+
+	if( grain == 0 )
+		grain = 1;
+
+	const size_t chunks = ( count + grain - 1 ) / grain;
+	if( workers.empty( ) || chunks == 1 )
+	{
+		for( size_t begin = 0; begin < count; begin += grain )
+			task( begin, std::min( count, begin + grain ) );
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> job_lock( job_mutex );
+
+	const size_t participants = queues.size( );
+	for( size_t k = 0; k < participants; ++k )
+	{
+		Queue &queue = *queues[k];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		queue.front = chunks * k / participants;
+		queue.back = chunks * ( k + 1 ) / participants;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( state_mutex );
+		this->task = &task;
+		this->count = count;
+		this->grain = grain;
+		busy_workers = workers.size( );
+		++generation;
+	}
+
+	start_condition.notify_all( );
+
+	Work( 0 );
+
+	std::unique_lock<std::mutex> lock( state_mutex );
+	finish_condition.wait( lock, [this] { return busy_workers == 0; } );
+	this->task = nullptr;
+}
+
+ThreadPool &ThreadPool::GetDefault( )
+{
+	static ThreadPool pool( std::max( std::thread::hardware_concurrency( ), 1u ) - 1 );
+	return pool;
+}
+
+void ThreadPool::WorkerLoop( const size_t participant )
+{
+	size_t seen_generation = 0;
+	while( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( state_mutex );
+			start_condition.wait( lock, [this, seen_generation] { return stopping || generation != seen_generation; } );
+			if( stopping )
+				return;
+
+			seen_generation = generation;
+		}
+
+		Work( participant );
+
+		{
+			std::lock_guard<std::mutex> lock( state_mutex );
+			if( --busy_workers == 0 )
+				finish_condition.notify_all( );
+		}
+	}
+}
+
+void ThreadPool::Work( const size_t participant )
+{
+	size_t chunk = 0;
+	while( Pop( participant, chunk ) || Steal( participant, chunk ) )
+	{
+		const size_t begin = chunk * grain;
+		( *task )( begin, std::min( count, begin + grain ) );
+	}
+}
+
+bool ThreadPool::Pop( const size_t participant, size_t &chunk )
+{
+	Queue &queue = *queues[participant];
+	std::lock_guard<std::mutex> lock( queue.mutex );
+	if( queue.front == queue.back )
+		return false;
+
+	chunk = queue.front++;
+	return true;
+}
+
+bool ThreadPool::Steal( const size_t participant, size_t &chunk )
+{
+	const size_t participants = queues.size( );
+	for( size_t k = 1; k < participants; ++k )
+	{
+		Queue &queue = *queues[( participant + k ) % participants];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		if( queue.front != queue.back )
+		{
+			chunk = --queue.back;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}
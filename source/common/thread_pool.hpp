@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace common
+{
+
+// Small work-stealing pool for data parallel jobs. The thread calling ParallelFor takes part in
+// the job too, so a pool created with 0 threads simply runs everything on the caller.
+class ThreadPool
+{
+public:
+	typedef std::function<void( size_t begin, size_t end )> Task;
+
+	explicit ThreadPool( size_t threads );
+	~ThreadPool( );
+
+	ThreadPool( const ThreadPool & ) = delete;
+	ThreadPool &operator=( const ThreadPool & ) = delete;
+
+	// Number of threads that work on a job, including the caller.
+	size_t GetConcurrency( ) const;
+
+	// Calls task on chunks of up to grain indices until [0, count) is covered and then returns.
+	// Every participant starts with an even share of chunks and steals from the others once
+	// it runs out. Jobs are serialized if several threads call this at the same time.
+	void ParallelFor( size_t count, size_t grain, const Task &task );
+
+	// Pool with a worker for every hardware thread but one, shared by the whole process.
+	static ThreadPool &GetDefault( );
+
+private:
+	// Chunks [front, back) that haven't been taken yet, the owner pops from the front
+	// and thieves from the back.
+	struct Queue
+	{
+		std::mutex mutex;
+		size_t front = 0;
+		size_t back = 0;
+	};
+
+	void WorkerLoop( size_t participant );
+	void Work( size_t participant );
+	bool Pop( size_t participant, size_t &chunk );
+	bool Steal( size_t participant, size_t &chunk );
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	std::mutex job_mutex;
+
+	std::mutex state_mutex;
+	std::condition_variable start_condition;
+	std::condition_variable finish_condition;
+	size_t generation = 0;
+	size_t busy_workers = 0;
+	bool stopping = false;
+
+	const Task *task = nullptr;
+	size_t count = 0;
+	size_t grain = 1;
+};
+
+}
@@ -0,0 +1,119 @@
+#include <journal.hpp>
+#include <fingerprint.hpp>
+#include <json.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+static void format_time( const uint64_t time, char ( &buffer )[32] )
+{
+	const std::time_t seconds = static_cast<std::time_t>( time / 1000 );
+	std::tm utc = { };
+#if defined _WIN32
+	gmtime_s( &utc, &seconds );
+#else
+	gmtime_r( &seconds, &utc );
+#endif
+	const size_t size = std::strftime( buffer, sizeof( buffer ), "%Y-%m-%dT%H:%M:%S", &utc );
+	std::snprintf( buffer + size, sizeof( buffer ) - size, ".%03uZ", static_cast<unsigned int>( time % 1000 ) );
+}
+
+static const char *get_kind( const common::JournalRecord &record )
+{
+	if( ( record.flags & common::JournalRecord::Client ) != 0 )
+		return "client";
+
+	return ( record.flags & common::JournalRecord::Runtime ) != 0 ? "runtime" : "compiletime";
+}
+
+static void print_text( const common::JournalRecord &record )
+{
+	char time[32], fingerprint[17];
+	format_time( record.time, time );
+	common::FormatFingerprint( record.fingerprint, fingerprint );
+
+	const common::ParsedErrorWithStackTraceView &error = record.error;
+	std::printf( "%s %s %s", time, get_kind( record ), fingerprint );
+	if( record.client >= 0 )
+		std::printf( " client=%d", record.client );
+
+	if( !error.addon_name.empty( ) )
+		std::printf( " addon=%.*s", static_cast<int>( error.addon_name.size( ) ), error.addon_name.data( ) );
+
+	if( error.source_file.empty( ) )
+		std::printf( "\n  %.*s\n", static_cast<int>( error.error_string.size( ) ), error.error_string.data( ) );
+	else
+		std::printf(
+			"\n  %.*s:%d: %.*s\n",
+			static_cast<int>( error.source_file.size( ) ), error.source_file.data( ),
+			error.source_line,
+			static_cast<int>( error.error_string.size( ) ), error.error_string.data( )
+		);
+
+	for( const auto &frame : error.stack_trace )
+		std::printf(
+			"    %d. %.*s - %.*s:%d\n",
+			frame.level,
+			static_cast<int>( frame.name.size( ) ), frame.name.data( ),
+			static_cast<int>( frame.source.size( ) ), frame.source.data( ),
+			frame.currentline
+		);
+}
+
+static void print_json( const common::JournalRecord &record )
+{
+	static std::string line;
+	line.clear( );
+	common::AppendErrorJson( line, record );
+	line += '\n';
+	std::fwrite( line.data( ), 1, line.size( ), stdout );
+}
+
+int main( const int argc, const char *argv[] )
+{
+	bool json = false;
+	int first = 1;
+	if( argc >= 2 && std::strcmp( argv[1], "--json" ) == 0 )
+	{
+		json = true;
+		first = 2;
+	}
+
+	if( first >= argc )
+	{
+		std::fprintf( stderr, "usage: %s [--json] <journal> [journal...]\n", argv[0] );
+		return 1;
+	}
+
+	// rotated files are standalone, decode them in the order given
+	int ret = 0;
+	common::JournalReader reader;
+	common::JournalRecord record;
+	for( int k = first; k < argc; ++k )
+	{
+		if( !reader.Open( argv[k] ) )
+		{
+			std::fprintf( stderr, "%s: unable to open journal or unknown format\n", argv[k] );
+			ret = 2;
+			continue;
+		}
+
+		while( reader.Next( record ) )
+			if( json )
+				print_json( record );
+			else
+				print_text( record );
+
+		if( reader.IsCorrupted( ) )
+		{
+			std::fprintf( stderr, "%s: truncated or corrupted journal, stopped decoding\n", argv[k] );
+			ret = 3;
+		}
+
+		reader.Close( );
+	}
+
+	return ret;
+}
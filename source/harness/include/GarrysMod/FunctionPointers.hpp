@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Lua/Interface.h"
+
+class CBasePlayer;
+
+// Stand-ins for the engine functions luaerror detours, instead of sigscanning them.
+namespace FunctionPointers
+{
+
+typedef void ( *CBasePlayer_HandleClientLuaError_t )( CBasePlayer *player, const char *error );
+
+GarrysMod::Lua::CFunc AdvancedLuaErrorReporter( );
+CBasePlayer_HandleClientLuaError_t CBasePlayer_HandleClientLuaError( );
+
+}
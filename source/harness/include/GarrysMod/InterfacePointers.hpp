@@ -0,0 +1,13 @@
+#pragma once
+
+class IFileSystem;
+class IVEngineServer;
+
+// Interfaces the harness stands in for, instead of the ones exported by the engine.
+namespace InterfacePointers
+{
+
+IFileSystem *FileSystem( );
+IVEngineServer *VEngineServer( );
+
+}
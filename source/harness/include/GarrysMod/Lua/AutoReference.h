@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Interface.h"
+
+namespace GarrysMod
+{
+
+namespace Lua
+{
+
+// Registry reference freed on destruction, like the garrysmod_common one.
+class AutoReference
+{
+public:
+	AutoReference( ) = default;
+
+	explicit AutoReference( ILuaBase *lua ) :
+		lua_base( lua )
+	{ }
+
+	~AutoReference( )
+	{
+		Free( );
+	}
+
+	AutoReference( const AutoReference & ) = delete;
+	AutoReference &operator=( const AutoReference & ) = delete;
+
+	void Setup( ILuaBase *lua )
+	{
+		Free( );
+		lua_base = lua;
+	}
+
+	bool IsValid( ) const
+	{
+		return lua_base != nullptr && reference != LUA_NOREF && reference != LUA_REFNIL;
+	}
+
+	// Pops the value on top of the stack into the reference.
+	bool Create( )
+	{
+		if( lua_base == nullptr )
+			return false;
+
+		Free( );
+		reference = lua_base->ReferenceCreate( );
+		return IsValid( );
+	}
+
+	bool Push( ) const
+	{
+		if( !IsValid( ) )
+			return false;
+
+		lua_base->ReferencePush( reference );
+		return true;
+	}
+
+	void Free( )
+	{
+		if( IsValid( ) )
+			lua_base->ReferenceFree( reference );
+
+		reference = LUA_NOREF;
+	}
+
+private:
+	ILuaBase *lua_base = nullptr;
+	int reference = LUA_NOREF;
+};
+
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "LuaInterface.h"
+
+#include <cstdint>
+
+namespace LuaHelpers
+{
+
+// Pushes hook.Run and the hook name, returns how many values were pushed (0 if there's no
+// hook.Run).
+int32_t PushHookRun( GarrysMod::Lua::ILuaInterface *lua, const char *hook );
+
+// Calls hook.Run with the hook name and the args values above it, leaving results values on the
+// stack if it succeeds. Errors are printed and popped.
+bool CallHookRun( GarrysMod::Lua::ILuaInterface *lua, int32_t args, int32_t results );
+
+}
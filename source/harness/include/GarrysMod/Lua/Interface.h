@@ -0,0 +1,147 @@
+#pragma once
+
+// Stand-in for the garrysmod_common header of the same name, covering what luaerror uses. The
+// harness implements it over a plain LuaJIT or Lua 5.1 state instead of the engine's.
+
+#include <lua.hpp>
+
+namespace GarrysMod
+{
+
+namespace Lua
+{
+
+typedef int ( *CFunc )( lua_State *L );
+
+enum
+{
+	INDEX_GLOBAL = LUA_GLOBALSINDEX,
+	INDEX_REGISTRY = LUA_REGISTRYINDEX
+};
+
+enum
+{
+	SPECIAL_GLOB,
+	SPECIAL_ENV,
+	SPECIAL_REG
+};
+
+namespace Type
+{
+
+enum
+{
+	NONE = LUA_TNONE,
+	NIL = LUA_TNIL,
+	BOOL = LUA_TBOOLEAN,
+	LIGHTUSERDATA = LUA_TLIGHTUSERDATA,
+	NUMBER = LUA_TNUMBER,
+	STRING = LUA_TSTRING,
+	TABLE = LUA_TTABLE,
+	FUNCTION = LUA_TFUNCTION,
+	USERDATA = LUA_TUSERDATA,
+	THREAD = LUA_TTHREAD
+};
+
+}
+
+class ILuaBase
+{
+public:
+	virtual ~ILuaBase( ) = default;
+
+	virtual int Top( ) = 0;
+	virtual void Push( int stack_pos ) = 0;
+	virtual void Pop( int amount = 1 ) = 0;
+	virtual void GetTable( int stack_pos ) = 0;
+	virtual void GetField( int stack_pos, const char *name ) = 0;
+	virtual void SetField( int stack_pos, const char *name ) = 0;
+	virtual void CreateTable( ) = 0;
+	virtual void SetTable( int stack_pos ) = 0;
+	virtual void SetMetaTable( int stack_pos ) = 0;
+	virtual bool GetMetaTable( int stack_pos ) = 0;
+	virtual void Call( int args, int results ) = 0;
+	virtual int PCall( int args, int results, int error_func ) = 0;
+	virtual int Equal( int a, int b ) = 0;
+	virtual int RawEqual( int a, int b ) = 0;
+	virtual void Insert( int stack_pos ) = 0;
+	virtual void Remove( int stack_pos ) = 0;
+	virtual int Next( int stack_pos ) = 0;
+	virtual void ThrowError( const char *error ) = 0;
+	virtual void CheckType( int stack_pos, int type ) = 0;
+	virtual void ArgError( int arg_num, const char *message ) = 0;
+	virtual void RawGet( int stack_pos ) = 0;
+	virtual void RawSet( int stack_pos ) = 0;
+	virtual const char *GetString( int stack_pos = -1, unsigned int *length = nullptr ) = 0;
+	virtual double GetNumber( int stack_pos = -1 ) = 0;
+	virtual bool GetBool( int stack_pos = -1 ) = 0;
+	virtual void *GetUserdata( int stack_pos = -1 ) = 0;
+	virtual void PushNil( ) = 0;
+	virtual void PushString( const char *value, unsigned int length = 0 ) = 0;
+	virtual void PushNumber( double value ) = 0;
+	virtual void PushBool( bool value ) = 0;
+	virtual void PushCFunction( CFunc value ) = 0;
+	virtual void PushCClosure( CFunc value, int upvalues ) = 0;
+	virtual void PushUserdata( void *value ) = 0;
+	virtual int ReferenceCreate( ) = 0;
+	virtual void ReferenceFree( int reference ) = 0;
+	virtual void ReferencePush( int reference ) = 0;
+	virtual void PushSpecial( int type ) = 0;
+	virtual bool IsType( int stack_pos, int type ) = 0;
+	virtual int GetType( int stack_pos ) = 0;
+	virtual const char *GetTypeName( int type ) = 0;
+	virtual const char *CheckString( int stack_pos = -1 ) = 0;
+	virtual double CheckNumber( int stack_pos = -1 ) = 0;
+	virtual int ObjLen( int stack_pos = -1 ) = 0;
+
+	lua_State *GetState( ) const
+	{
+		return state;
+	}
+
+	void SetState( lua_State *L )
+	{
+		state = L;
+	}
+
+protected:
+	lua_State *state = nullptr;
+};
+
+// The engine's lua_State points back to its interface, a plain one doesn't, so the harness keeps
+// the interface that owns each state.
+ILuaBase *GetInterface( lua_State *L );
+
+}
+
+}
+
+#define LUA_FUNCTION_STATIC( FUNC ) \
+	static int FUNC##__Imp( GarrysMod::Lua::ILuaBase *LUA ); \
+	static int FUNC( lua_State *L ) \
+	{ \
+		GarrysMod::Lua::ILuaBase *LUA = GarrysMod::Lua::GetInterface( L ); \
+		LUA->SetState( L ); \
+		return FUNC##__Imp( LUA ); \
+	} \
+	static int FUNC##__Imp( GarrysMod::Lua::ILuaBase *LUA )
+
+#define GMOD_MODULE_OPEN( ) \
+	int gmod13_open__Imp( GarrysMod::Lua::ILuaBase *LUA ); \
+	extern "C" int gmod13_open( lua_State *L ) \
+	{ \
+		GarrysMod::Lua::ILuaBase *LUA = GarrysMod::Lua::GetInterface( L ); \
+		LUA->SetState( L ); \
+		return gmod13_open__Imp( LUA ); \
+	} \
+	int gmod13_open__Imp( GarrysMod::Lua::ILuaBase *LUA )
+
+#define GMOD_MODULE_CLOSE( ) \
+	int gmod13_close__Imp( GarrysMod::Lua::ILuaBase *LUA ); \
+	extern "C" int gmod13_close( lua_State *L ) \
+	{ \
+		GarrysMod::Lua::ILuaBase *LUA = GarrysMod::Lua::GetInterface( L ); \
+		LUA->SetState( L ); \
+		return gmod13_close__Imp( LUA ); \
+	} \
+	int gmod13_close__Imp( GarrysMod::Lua::ILuaBase *LUA )
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct Color
+{
+	unsigned char r, g, b, a;
+};
+
+class CLuaError
+{
+public:
+	struct StackEntry
+	{
+		std::string source;
+		std::string function;
+		int line = -1;
+	};
+
+	std::string message;
+	std::string side;
+	std::vector<StackEntry> stack;
+};
+
+namespace GarrysMod
+{
+
+namespace Lua
+{
+
+class ILuaObject;
+class ILuaInterface;
+
+class ILuaGameCallback
+{
+public:
+	virtual ~ILuaGameCallback( ) = default;
+
+	virtual ILuaObject *CreateLuaObject( ) = 0;
+	virtual void DestroyLuaObject( ILuaObject *obj ) = 0;
+	virtual void ErrorPrint( const char *error, bool print ) = 0;
+	virtual void Msg( const char *msg, bool useless ) = 0;
+	virtual void MsgColour( const char *msg, const Color &color ) = 0;
+	virtual void LuaError( const CLuaError *error ) = 0;
+	virtual void InterfaceCreated( ILuaInterface *iface ) = 0;
+};
+
+}
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Interface.h"
+
+namespace GarrysMod
+{
+
+namespace Lua
+{
+
+class ILuaGameCallback;
+
+class ILuaInterface : public ILuaBase
+{
+public:
+	virtual int GetStack( int level, lua_Debug *dbg ) = 0;
+	virtual int GetInfo( const char *what, lua_Debug *dbg ) = 0;
+	virtual const char *GetLocal( lua_Debug *dbg, int n ) = 0;
+	virtual const char *GetUpvalue( int func_index, int n ) = 0;
+	virtual void ErrorNoHalt( const char *format, ... ) = 0;
+	virtual void Msg( const char *format, ... ) = 0;
+	virtual ILuaGameCallback *GetLuaGameCallback( ) const = 0;
+	virtual void SetLuaGameCallback( ILuaGameCallback *callback ) = 0;
+	virtual bool IsServer( ) = 0;
+	virtual bool IsClient( ) = 0;
+	virtual bool RunString( const char *filename, const char *path, const char *code, bool run, bool show_errors ) = 0;
+};
+
+// The interface of a state created by the harness. Errors are reported to the game callback like
+// the engine does: compile errors by RunString and runtime errors by AdvancedLuaErrorReporter,
+// which the harness sets as the message handler of the code it runs.
+class CLuaInterface : public ILuaInterface
+{
+public:
+	// Opens the standard libraries on a new state, the callback receives the errors.
+	CLuaInterface( ILuaGameCallback *callback, bool server );
+	~CLuaInterface( );
+
+	CLuaInterface( const CLuaInterface & ) = delete;
+	CLuaInterface &operator=( const CLuaInterface & ) = delete;
+
+	// Closes the state. Modules keep pointers to the interface until they're unloaded, so like the
+	// engine's it has to outlive them, even if that's past the end of main.
+	void Close( );
+
+	int Top( );
+	void Push( int stack_pos );
+	void Pop( int amount = 1 );
+	void GetTable( int stack_pos );
+	void GetField( int stack_pos, const char *name );
+	void SetField( int stack_pos, const char *name );
+	void CreateTable( );
+	void SetTable( int stack_pos );
+	void SetMetaTable( int stack_pos );
+	bool GetMetaTable( int stack_pos );
+	void Call( int args, int results );
+	int PCall( int args, int results, int error_func );
+	int Equal( int a, int b );
+	int RawEqual( int a, int b );
+	void Insert( int stack_pos );
+	void Remove( int stack_pos );
+	int Next( int stack_pos );
+	void ThrowError( const char *error );
+	void CheckType( int stack_pos, int type );
+	void ArgError( int arg_num, const char *message );
+	void RawGet( int stack_pos );
+	void RawSet( int stack_pos );
+	const char *GetString( int stack_pos = -1, unsigned int *length = nullptr );
+	double GetNumber( int stack_pos = -1 );
+	bool GetBool( int stack_pos = -1 );
+	void *GetUserdata( int stack_pos = -1 );
+	void PushNil( );
+	void PushString( const char *value, unsigned int length = 0 );
+	void PushNumber( double value );
+	void PushBool( bool value );
+	void PushCFunction( CFunc value );
+	void PushCClosure( CFunc value, int upvalues );
+	void PushUserdata( void *value );
+	int ReferenceCreate( );
+	void ReferenceFree( int reference );
+	void ReferencePush( int reference );
+	void PushSpecial( int type );
+	bool IsType( int stack_pos, int type );
+	int GetType( int stack_pos );
+	const char *GetTypeName( int type );
+	const char *CheckString( int stack_pos = -1 );
+	double CheckNumber( int stack_pos = -1 );
+	int ObjLen( int stack_pos = -1 );
+
+	int GetStack( int level, lua_Debug *dbg );
+	int GetInfo( const char *what, lua_Debug *dbg );
+	const char *GetLocal( lua_Debug *dbg, int n );
+	const char *GetUpvalue( int func_index, int n );
+	void ErrorNoHalt( const char *format, ... );
+	void Msg( const char *format, ... );
+	ILuaGameCallback *GetLuaGameCallback( ) const;
+	void SetLuaGameCallback( ILuaGameCallback *callback );
+	bool IsServer( );
+	bool IsClient( );
+
+	// Compile errors go to the game callback, runtime errors to AdvancedLuaErrorReporter (or its
+	// detour) and then the game callback. show_errors is ignored, the callback decides.
+	bool RunString( const char *filename, const char *path, const char *code, bool run, bool show_errors );
+
+	// Calls the function below its args arguments with AdvancedLuaErrorReporter as the message
+	// handler, like the engine calls hooks and timers. Returns whether it succeeded, the error is
+	// popped otherwise.
+	bool CallFunctionProtected( int args, int results );
+
+private:
+	lua_State *main_state;
+	ILuaGameCallback *game_callback;
+	bool is_server;
+};
+
+}
+
+}
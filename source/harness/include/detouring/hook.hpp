@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Detouring
+{
+
+// Stand-in for the detouring library. Nothing is patched: the harness calls the functions it
+// stands in for through Resolve, which goes to the detour of the enabled hook on them.
+class Hook
+{
+public:
+	struct Target
+	{
+		explicit Target( void *target ) :
+			pointer( target )
+		{ }
+
+		void *pointer;
+	};
+
+	Hook( ) = default;
+	~Hook( );
+
+	Hook( const Hook & ) = delete;
+	Hook &operator=( const Hook & ) = delete;
+
+	bool Create( const Target &target, void *detour );
+	bool Create( void *target, void *detour );
+
+	bool Enable( );
+	bool Disable( );
+	bool Destroy( );
+
+	bool IsValid( ) const;
+	bool IsEnabled( ) const;
+
+	template<typename Function>
+	Function GetTrampoline( ) const
+	{
+		return reinterpret_cast<Function>( target_pointer );
+	}
+
+private:
+	void *target_pointer = nullptr;
+	void *detour_pointer = nullptr;
+	bool enabled = false;
+};
+
+// The detour of the enabled hook on target, target itself if there's none.
+void *Resolve( void *target );
+
+template<typename Function>
+Function Resolve( Function target )
+{
+	return reinterpret_cast<Function>( Resolve( reinterpret_cast<void *>( target ) ) );
+}
+
+}
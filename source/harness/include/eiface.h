@@ -0,0 +1,14 @@
+#pragma once
+
+// Players are their entity index, the edict of a player holds it and doubles as its UserID.
+struct edict_t
+{
+	int index;
+};
+
+class IVEngineServer
+{
+public:
+	edict_t *PEntityOfEntIndex( int index );
+	int GetPlayerUserId( const edict_t *edict );
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+
+class IFileSystem
+{
+public:
+	virtual ~IFileSystem( ) = default;
+};
+
+typedef void *FileHandle_t;
+
+namespace IAddonSystem
+{
+
+struct Information
+{
+	std::string title;
+	std::string file;
+	std::string placeholder;
+	uint64_t wsid = 0;
+	uint64_t timeupdated = 0;
+	uint64_t size = 0;
+};
+
+}
+
+namespace Addon
+{
+
+// Mounted addons, none unless the harness adds them.
+class FileSystem
+{
+public:
+	const IAddonSystem::Information *FindFileOwner( const std::string &path );
+	const std::list<IAddonSystem::Information> &GetList( ) const;
+
+	// file is the path to the .gma, absolute or relative to the working directory.
+	void Add( const IAddonSystem::Information &info );
+
+private:
+	std::list<IAddonSystem::Information> addons;
+};
+
+}
+
+// Filesystem over stdio, every path ID reads from the root directory.
+class CFileSystem_Stdio : public IFileSystem
+{
+public:
+	explicit CFileSystem_Stdio( std::string root = "." );
+
+	Addon::FileSystem *Addons( );
+
+	FileHandle_t Open( const char *path, const char *options, const char *path_id = nullptr );
+	void Close( FileHandle_t handle );
+	int Read( void *output, int size, FileHandle_t handle );
+	unsigned int Size( FileHandle_t handle );
+	long GetFileTime( const char *path, const char *path_id = nullptr );
+	bool FileExists( const char *path, const char *path_id = nullptr );
+	// Copies the path of an existing file to full_path, nullptr if it doesn't exist or doesn't fit.
+	const char *RelativePathToFullPath( const char *path, const char *path_id, char *full_path, int size );
+
+private:
+	std::string GetFullPath( const char *path ) const;
+
+	std::string root_path;
+	Addon::FileSystem addons;
+};
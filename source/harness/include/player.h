@@ -0,0 +1,17 @@
+#pragma once
+
+class CBasePlayer
+{
+public:
+	explicit CBasePlayer( const int index ) :
+		entity_index( index )
+	{ }
+
+	int entindex( ) const
+	{
+		return entity_index;
+	}
+
+private:
+	int entity_index;
+};
@@ -0,0 +1,439 @@
+#include <GarrysMod/Lua/Interface.h>
+#include <GarrysMod/Lua/LuaInterface.h>
+#include <GarrysMod/Lua/LuaGameCallback.h>
+#include <GarrysMod/FunctionPointers.hpp>
+#include <lua.hpp>
+
+#include <detouring/hook.hpp>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace GarrysMod
+{
+
+namespace Lua
+{
+
+// the harness only ever has one state
+static CLuaInterface *lua_interface = nullptr;
+
+ILuaBase *GetInterface( lua_State * )
+{
+	return lua_interface;
+}
+
+static void FillLuaError( lua_State *L, CLuaError &error, const char *message, const bool server, const int first_level )
+{
+	error.message = message != nullptr ? message : "unknown error";
+	error.side = server ? "server" : "client";
+
+	lua_Debug dbg;
+	for( int level = first_level; lua_getstack( L, level, &dbg ) == 1 && lua_getinfo( L, "Sln", &dbg ) != 0; ++level )
+	{
+		CLuaError::StackEntry entry;
+		entry.source = dbg.short_src;
+		entry.function = dbg.name != nullptr ? dbg.name : "unknown";
+		entry.line = dbg.currentline;
+		error.stack.push_back( std::move( entry ) );
+	}
+}
+
+// What the engine's AdvancedLuaErrorReporter does: hand the error and the stack it happened on
+// to the game callback, then return the message for the caller of pcall.
+static int AdvancedLuaErrorReporter( lua_State *L )
+{
+	CLuaInterface *lua = static_cast<CLuaInterface *>( GetInterface( L ) );
+
+	CLuaError error;
+	FillLuaError( L, error, lua_tostring( L, 1 ), lua->IsServer( ), 1 );
+
+	ILuaGameCallback *callback = lua->GetLuaGameCallback( );
+	if( callback != nullptr )
+		callback->LuaError( &error );
+
+	lua_pushvalue( L, 1 );
+	return 1;
+}
+
+// message handler of every protected call, goes through the detour when it's enabled
+static int ErrorHandler( lua_State *L )
+{
+	return Detouring::Resolve( &AdvancedLuaErrorReporter )( L );
+}
+
+CLuaInterface::CLuaInterface( ILuaGameCallback *callback, const bool server ) :
+	main_state( luaL_newstate( ) ),
+	game_callback( callback ),
+	is_server( server )
+{
+	state = main_state;
+	luaL_openlibs( state );
+	lua_interface = this;
+}
+
+CLuaInterface::~CLuaInterface( )
+{
+	Close( );
+}
+
+void CLuaInterface::Close( )
+{
+	if( main_state == nullptr )
+		return;
+
+	lua_close( main_state );
+	main_state = nullptr;
+	state = nullptr;
+}
+
+int CLuaInterface::Top( )
+{
+	return lua_gettop( state );
+}
+
+void CLuaInterface::Push( const int stack_pos )
+{
+	lua_pushvalue( state, stack_pos );
+}
+
+void CLuaInterface::Pop( const int amount )
+{
+	lua_pop( state, amount );
+}
+
+void CLuaInterface::GetTable( const int stack_pos )
+{
+	lua_gettable( state, stack_pos );
+}
+
+void CLuaInterface::GetField( const int stack_pos, const char *name )
+{
+	lua_getfield( state, stack_pos, name );
+}
+
+void CLuaInterface::SetField( const int stack_pos, const char *name )
+{
+	lua_setfield( state, stack_pos, name );
+}
+
+void CLuaInterface::CreateTable( )
+{
+	lua_createtable( state, 0, 0 );
+}
+
+void CLuaInterface::SetTable( const int stack_pos )
+{
+	lua_settable( state, stack_pos );
+}
+
+void CLuaInterface::SetMetaTable( const int stack_pos )
+{
+	lua_setmetatable( state, stack_pos );
+}
+
+bool CLuaInterface::GetMetaTable( const int stack_pos )
+{
+	return lua_getmetatable( state, stack_pos ) != 0;
+}
+
+void CLuaInterface::Call( const int args, const int results )
+{
+	lua_call( state, args, results );
+}
+
+int CLuaInterface::PCall( const int args, const int results, const int error_func )
+{
+	return lua_pcall( state, args, results, error_func );
+}
+
+int CLuaInterface::Equal( const int a, const int b )
+{
+	return lua_equal( state, a, b );
+}
+
+int CLuaInterface::RawEqual( const int a, const int b )
+{
+	return lua_rawequal( state, a, b );
+}
+
+void CLuaInterface::Insert( const int stack_pos )
+{
+	lua_insert( state, stack_pos );
+}
+
+void CLuaInterface::Remove( const int stack_pos )
+{
+	lua_remove( state, stack_pos );
+}
+
+int CLuaInterface::Next( const int stack_pos )
+{
+	return lua_next( state, stack_pos );
+}
+
+void CLuaInterface::ThrowError( const char *error )
+{
+	luaL_error( state, "%s", error );
+}
+
+void CLuaInterface::CheckType( const int stack_pos, const int type )
+{
+	luaL_checktype( state, stack_pos, type );
+}
+
+void CLuaInterface::ArgError( const int arg_num, const char *message )
+{
+	luaL_argerror( state, arg_num, message );
+}
+
+void CLuaInterface::RawGet( const int stack_pos )
+{
+	lua_rawget( state, stack_pos );
+}
+
+void CLuaInterface::RawSet( const int stack_pos )
+{
+	lua_rawset( state, stack_pos );
+}
+
+const char *CLuaInterface::GetString( const int stack_pos, unsigned int *length )
+{
+	size_t size = 0;
+	const char *value = lua_tolstring( state, stack_pos, &size );
+	if( length != nullptr )
+		*length = static_cast<unsigned int>( size );
+
+	return value;
+}
+
+double CLuaInterface::GetNumber( const int stack_pos )
+{
+	return lua_tonumber( state, stack_pos );
+}
+
+bool CLuaInterface::GetBool( const int stack_pos )
+{
+	return lua_toboolean( state, stack_pos ) != 0;
+}
+
+void *CLuaInterface::GetUserdata( const int stack_pos )
+{
+	return lua_touserdata( state, stack_pos );
+}
+
+void CLuaInterface::PushNil( )
+{
+	lua_pushnil( state );
+}
+
+void CLuaInterface::PushString( const char *value, const unsigned int length )
+{
+	if( length == 0 )
+		lua_pushstring( state, value );
+	else
+		lua_pushlstring( state, value, length );
+}
+
+void CLuaInterface::PushNumber( const double value )
+{
+	lua_pushnumber( state, value );
+}
+
+void CLuaInterface::PushBool( const bool value )
+{
+	lua_pushboolean( state, value ? 1 : 0 );
+}
+
+void CLuaInterface::PushCFunction( const CFunc value )
+{
+	lua_pushcfunction( state, value );
+}
+
+void CLuaInterface::PushCClosure( const CFunc value, const int upvalues )
+{
+	lua_pushcclosure( state, value, upvalues );
+}
+
+void CLuaInterface::PushUserdata( void *value )
+{
+	lua_pushlightuserdata( state, value );
+}
+
+int CLuaInterface::ReferenceCreate( )
+{
+	return luaL_ref( state, LUA_REGISTRYINDEX );
+}
+
+void CLuaInterface::ReferenceFree( const int reference )
+{
+	luaL_unref( state, LUA_REGISTRYINDEX, reference );
+}
+
+void CLuaInterface::ReferencePush( const int reference )
+{
+	lua_rawgeti( state, LUA_REGISTRYINDEX, reference );
+}
+
+void CLuaInterface::PushSpecial( const int type )
+{
+	switch( type )
+	{
+		case SPECIAL_GLOB:
+			lua_pushvalue( state, LUA_GLOBALSINDEX );
+			break;
+
+		case SPECIAL_ENV:
+			lua_pushvalue( state, LUA_ENVIRONINDEX );
+			break;
+
+		case SPECIAL_REG:
+			lua_pushvalue( state, LUA_REGISTRYINDEX );
+			break;
+
+		default:
+			lua_pushnil( state );
+			break;
+	}
+}
+
+bool CLuaInterface::IsType( const int stack_pos, const int type )
+{
+	return lua_type( state, stack_pos ) == type;
+}
+
+int CLuaInterface::GetType( const int stack_pos )
+{
+	return lua_type( state, stack_pos );
+}
+
+const char *CLuaInterface::GetTypeName( const int type )
+{
+	return lua_typename( state, type );
+}
+
+const char *CLuaInterface::CheckString( const int stack_pos )
+{
+	return luaL_checkstring( state, stack_pos );
+}
+
+double CLuaInterface::CheckNumber( const int stack_pos )
+{
+	return luaL_checknumber( state, stack_pos );
+}
+
+int CLuaInterface::ObjLen( const int stack_pos )
+{
+	return static_cast<int>( lua_objlen( state, stack_pos ) );
+}
+
+int CLuaInterface::GetStack( const int level, lua_Debug *dbg )
+{
+	return lua_getstack( state, level, dbg );
+}
+
+int CLuaInterface::GetInfo( const char *what, lua_Debug *dbg )
+{
+	return lua_getinfo( state, what, dbg );
+}
+
+const char *CLuaInterface::GetLocal( lua_Debug *dbg, const int n )
+{
+	return lua_getlocal( state, dbg, n );
+}
+
+const char *CLuaInterface::GetUpvalue( const int func_index, const int n )
+{
+	return lua_getupvalue( state, func_index, n );
+}
+
+void CLuaInterface::ErrorNoHalt( const char *format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	std::vfprintf( stderr, format, args );
+	va_end( args );
+}
+
+void CLuaInterface::Msg( const char *format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	std::vprintf( format, args );
+	va_end( args );
+}
+
+ILuaGameCallback *CLuaInterface::GetLuaGameCallback( ) const
+{
+	return game_callback;
+}
+
+void CLuaInterface::SetLuaGameCallback( ILuaGameCallback *callback )
+{
+	game_callback = callback;
+}
+
+bool CLuaInterface::IsServer( )
+{
+	return is_server;
+}
+
+bool CLuaInterface::IsClient( )
+{
+	return !is_server;
+}
+
+bool CLuaInterface::RunString( const char *filename, const char *, const char *code, const bool run, const bool )
+{
+	// chunks are named like the engine names files, so errors start with the path
+	std::string chunk_name = "@";
+	chunk_name += filename;
+	if( luaL_loadbuffer( state, code, std::strlen( code ), chunk_name.c_str( ) ) != 0 )
+	{
+		CLuaError error;
+		FillLuaError( state, error, lua_tostring( state, -1 ), is_server, 0 );
+		lua_pop( state, 1 );
+		if( game_callback != nullptr )
+			game_callback->LuaError( &error );
+
+		return false;
+	}
+
+	if( !run )
+	{
+		lua_pop( state, 1 );
+		return true;
+	}
+
+	return CallFunctionProtected( 0, 0 );
+}
+
+bool CLuaInterface::CallFunctionProtected( const int args, const int results )
+{
+	const int handler = lua_gettop( state ) - args;
+	lua_pushcfunction( state, ErrorHandler );
+	lua_insert( state, handler );
+
+	const bool success = lua_pcall( state, args, results, handler ) == 0;
+	lua_remove( state, handler );
+	if( !success )
+		lua_pop( state, 1 );
+
+	return success;
+}
+
+}
+
+}
+
+namespace FunctionPointers
+{
+
+GarrysMod::Lua::CFunc AdvancedLuaErrorReporter( )
+{
+	return &GarrysMod::Lua::AdvancedLuaErrorReporter;
+}
+
+}
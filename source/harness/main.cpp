@@ -0,0 +1,390 @@
+#include "stand_ins.hpp"
+
+#include <stats.hpp>
+
+#include <GarrysMod/Lua/Interface.h>
+#include <GarrysMod/Lua/LuaInterface.h>
+#include <player.h>
+#include <lua.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+extern "C" int gmod13_open( lua_State *L );
+extern "C" int gmod13_close( lua_State *L );
+
+// The parts of the game luaerror talks to: the hook library, Entity and functions to throw errors
+// from. Players are their entity index.
+static const char prelude[] = R"(
+local hooks = {}
+
+hook = {}
+
+function hook.Add( name, id, func )
+	hooks[name] = hooks[name] or {}
+	hooks[name][id] = func
+end
+
+function hook.Remove( name, id )
+	if hooks[name] ~= nil then
+		hooks[name][id] = nil
+	end
+end
+
+function hook.GetTable( )
+	return hooks
+end
+
+function hook.Run( name, ... )
+	local funcs = hooks[name]
+	if funcs == nil then
+		return
+	end
+
+	for _, func in pairs( funcs ) do
+		local a, b, c, d, e, f = func( ... )
+		if a ~= nil then
+			return a, b, c, d, e, f
+		end
+	end
+end
+
+function Entity( index )
+	return index
+end
+
+harness = { calls = 0 }
+
+function harness.Listen( name )
+	hook.Remove( "LuaError", "harness" )
+	hook.Remove( "ClientLuaError", "harness" )
+	if name ~= nil then
+		hook.Add( name, "harness", function( )
+			harness.calls = harness.calls + 1
+		end )
+	end
+end
+
+-- errors depth calls deep, the additions keep the calls from being tail calls
+function harness.Fail( depth )
+	if depth > 1 then
+		return harness.Fail( depth - 1 ) + 1
+	end
+
+	local values = nil
+	return values.count + 1
+end
+)";
+
+static const char setup[] = R"(
+luaerror.EnableRuntimeDetour( true )
+luaerror.EnableCompiletimeDetour( true )
+luaerror.EnableClientDetour( true )
+luaerror.SetClientErrorLimits( 1e9, 1e9 )
+)";
+
+static const char compile_error[] = "local value = = 1\n";
+
+enum class Kind
+{
+	Runtime,
+	Compile,
+	Client
+};
+
+struct Scenario
+{
+	const char *name;
+	Kind kind;
+	// hook that gets a listener, nullptr for none
+	const char *hook;
+};
+
+static const Scenario scenarios[] = {
+	{ "runtime", Kind::Runtime, nullptr },
+	{ "runtime+hook", Kind::Runtime, "LuaError" },
+	{ "compile", Kind::Compile, nullptr },
+	{ "compile+hook", Kind::Compile, "LuaError" },
+	{ "client", Kind::Client, nullptr },
+	{ "client+hook", Kind::Client, "ClientLuaError" }
+};
+
+struct Options
+{
+	size_t errors = 10000;
+	size_t depth = 8;
+	size_t batch = 1000;
+	size_t warmup = 100;
+	const char *only = nullptr;
+	const char *script = nullptr;
+	bool verbose = false;
+};
+
+class Harness
+{
+public:
+	explicit Harness( const Options &harness_options ) :
+		options( harness_options ),
+		lua( *new GarrysMod::Lua::CLuaInterface( &callback, true ) ),
+		player( 1 )
+	{
+		callback.verbose = options.verbose;
+
+		// a client payload as deep as the runtime errors
+		client_error = "[harness] lua/harness/client.lua:12: attempt to index local 'values' (a nil value)\n";
+		for( size_t k = 1; k <= options.depth; ++k )
+		{
+			client_error += "  " + std::to_string( k ) + ". ";
+			client_error += k == 1 ? "Fail" : "unknown";
+			client_error += " - lua/harness/client.lua:" + std::to_string( k == 1 ? 12 : 9 ) + "\n";
+		}
+	}
+
+	~Harness( )
+	{
+		if( opened )
+		{
+			lua_State *L = lua.GetState( );
+			lua_pushcfunction( L, gmod13_close );
+			if( lua_pcall( L, 0, 0, 0 ) != 0 )
+				lua_pop( L, 1 );
+		}
+
+		lua.Close( );
+	}
+
+	bool Open( )
+	{
+		if( !lua.RunString( "lua/harness/prelude.lua", "", prelude, true, true ) )
+		{
+			std::fprintf( stderr, "unable to run the harness prelude\n" );
+			return false;
+		}
+
+		lua_State *L = lua.GetState( );
+		lua_pushcfunction( L, gmod13_open );
+		if( lua_pcall( L, 0, 0, 0 ) != 0 )
+		{
+			std::fprintf( stderr, "unable to open luaerror: %s\n", lua_tostring( L, -1 ) );
+			lua_pop( L, 1 );
+			return false;
+		}
+
+		opened = true;
+		if( !lua.RunString( "lua/harness/setup.lua", "", setup, true, true ) )
+		{
+			std::fprintf( stderr, "unable to enable the luaerror detours\n" );
+			return false;
+		}
+
+		if( options.script != nullptr )
+		{
+			std::ifstream file( options.script, std::ios::binary );
+			const std::string code( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>( ) );
+			if( !file || !lua.RunString( options.script, "", code.c_str( ), true, true ) )
+			{
+				std::fprintf( stderr, "%s: unable to run script\n", options.script );
+				return false;
+			}
+		}
+
+		lua.GetField( GarrysMod::Lua::INDEX_GLOBAL, "harness" );
+		lua.GetField( -1, "Fail" );
+		fail_function = lua.ReferenceCreate( );
+		lua.Pop( 1 );
+		return true;
+	}
+
+	// Throws options.errors errors of the scenario and prints their latency and the Lua memory
+	// they allocated. Returns whether every error reached the listener and the engine.
+	bool Run( const Scenario &scenario )
+	{
+		lua_State *L = lua.GetState( );
+		lua.GetField( GarrysMod::Lua::INDEX_GLOBAL, "harness" );
+		lua.GetField( -1, "Listen" );
+		lua.Remove( -2 );
+		if( scenario.hook != nullptr )
+			lua.PushString( scenario.hook );
+		else
+			lua.PushNil( );
+
+		lua.Call( 1, 0 );
+
+		for( size_t k = 0; k < options.warmup; ++k )
+			Throw( scenario.kind );
+
+		const double calls_before = GetListenerCalls( );
+		const uint64_t engine_before = GetEngineErrors( scenario.kind );
+
+		// The collector is stopped during each batch, so the memory the batch leaves behind is what
+		// it allocated. Collections between batches aren't timed.
+		common::LatencyHistogram latency;
+		size_t garbage = 0;
+		for( size_t done = 0; done < options.errors; )
+		{
+			const size_t batch = options.batch < options.errors - done ? options.batch : options.errors - done;
+			lua_gc( L, LUA_GCCOLLECT, 0 );
+			lua_gc( L, LUA_GCSTOP, 0 );
+			const size_t memory = GetMemory( );
+			for( size_t k = 0; k < batch; ++k )
+			{
+				const auto start = common::LatencyHistogram::Clock::now( );
+				Throw( scenario.kind );
+				latency.Add( common::LatencyHistogram::Clock::now( ) - start );
+			}
+
+			const size_t used = GetMemory( );
+			garbage += used > memory ? used - memory : 0;
+			lua_gc( L, LUA_GCRESTART, 0 );
+			done += batch;
+		}
+
+		lua_gc( L, LUA_GCCOLLECT, 0 );
+
+		const size_t errors = options.errors;
+		const auto listener_calls = static_cast<size_t>( GetListenerCalls( ) - calls_before );
+		const auto engine_errors = static_cast<size_t>( GetEngineErrors( scenario.kind ) - engine_before );
+		const size_t expected_calls = scenario.hook != nullptr ? errors : 0;
+		const std::chrono::duration<double, std::micro> total = latency.GetTotal( );
+		std::printf(
+			"%-14s %8zu %9.2f %9.2f %9.2f %9.2f %9.2f %12.1f\n",
+			scenario.name,
+			errors,
+			ToMicroseconds( latency.GetQuantile( 0.5 ) ),
+			ToMicroseconds( latency.GetQuantile( 0.9 ) ),
+			ToMicroseconds( latency.GetQuantile( 0.99 ) ),
+			ToMicroseconds( latency.GetMax( ) ),
+			errors != 0 ? total.count( ) / static_cast<double>( errors ) : 0.0,
+			errors != 0 ? static_cast<double>( garbage ) / static_cast<double>( errors ) : 0.0
+		);
+
+		bool success = true;
+		if( listener_calls != expected_calls )
+		{
+			std::fprintf( stderr, "%s: the listener was called %zu times instead of %zu\n", scenario.name, listener_calls, expected_calls );
+			success = false;
+		}
+
+		if( engine_errors != errors )
+		{
+			std::fprintf( stderr, "%s: the engine got %zu errors instead of %zu\n", scenario.name, engine_errors, errors );
+			success = false;
+		}
+
+		if( lua.Top( ) != 0 )
+		{
+			std::fprintf( stderr, "%s: %d values were left on the stack\n", scenario.name, lua.Top( ) );
+			lua.Pop( lua.Top( ) );
+			success = false;
+		}
+
+		return success;
+	}
+
+private:
+	void Throw( const Kind kind )
+	{
+		switch( kind )
+		{
+			case Kind::Runtime:
+				lua.ReferencePush( fail_function );
+				lua.PushNumber( static_cast<double>( options.depth ) );
+				lua.CallFunctionProtected( 1, 0 );
+				break;
+
+			case Kind::Compile:
+				lua.RunString( "lua/harness/compile.lua", "", compile_error, true, true );
+				break;
+
+			case Kind::Client:
+				harness::HandleClientLuaError( &player, client_error.c_str( ) );
+				break;
+		}
+	}
+
+	double GetListenerCalls( )
+	{
+		lua.GetField( GarrysMod::Lua::INDEX_GLOBAL, "harness" );
+		lua.GetField( -1, "calls" );
+		const double calls = lua.GetNumber( -1 );
+		lua.Pop( 2 );
+		return calls;
+	}
+
+	uint64_t GetEngineErrors( const Kind kind ) const
+	{
+		return kind == Kind::Client ? harness::GetEngineClientErrors( ) : callback.errors;
+	}
+
+	size_t GetMemory( )
+	{
+		lua_State *L = lua.GetState( );
+		return static_cast<size_t>( lua_gc( L, LUA_GCCOUNT, 0 ) ) * 1024 + static_cast<size_t>( lua_gc( L, LUA_GCCOUNTB, 0 ) );
+	}
+
+	static double ToMicroseconds( const common::LatencyHistogram::Clock::duration duration )
+	{
+		return std::chrono::duration<double, std::micro>( duration ).count( );
+	}
+
+	const Options &options;
+	harness::GameCallback callback;
+	// never deleted, the statics of luaerror point to it until the program exits
+	GarrysMod::Lua::CLuaInterface &lua;
+	CBasePlayer player;
+	std::string client_error;
+	int fail_function = LUA_NOREF;
+	bool opened = false;
+};
+
+int main( const int argc, const char *argv[] )
+{
+	Options options;
+	int k = 1;
+	for( ; k < argc; ++k )
+		if( std::strcmp( argv[k], "--errors" ) == 0 && k + 1 < argc )
+			options.errors = std::strtoul( argv[++k], nullptr, 10 );
+		else if( std::strcmp( argv[k], "--depth" ) == 0 && k + 1 < argc )
+			options.depth = std::strtoul( argv[++k], nullptr, 10 );
+		else if( std::strcmp( argv[k], "--batch" ) == 0 && k + 1 < argc )
+			options.batch = std::strtoul( argv[++k], nullptr, 10 );
+		else if( std::strcmp( argv[k], "--only" ) == 0 && k + 1 < argc )
+			options.only = argv[++k];
+		else if( std::strcmp( argv[k], "--script" ) == 0 && k + 1 < argc )
+			options.script = argv[++k];
+		else if( std::strcmp( argv[k], "--verbose" ) == 0 )
+			options.verbose = true;
+		else
+			break;
+
+	if( k != argc || options.depth == 0 || options.batch == 0 )
+	{
+		std::fprintf(
+			stderr,
+			"usage: %s [--errors n] [--depth n] [--batch n] [--only runtime|compile|client] [--script file] [--verbose]\n",
+			argv[0]
+		);
+		return 1;
+	}
+
+	Harness harness( options );
+	if( !harness.Open( ) )
+		return 2;
+
+	std::printf(
+		"%-14s %8s %9s %9s %9s %9s %9s %12s\n",
+		"scenario", "errors", "p50 us", "p90 us", "p99 us", "max us", "mean us", "lua B/error"
+	);
+
+	bool success = true;
+	for( const Scenario &scenario : scenarios )
+		if( options.only == nullptr || std::strncmp( scenario.name, options.only, std::strlen( options.only ) ) == 0 )
+			success = harness.Run( scenario ) && success;
+
+	return success ? 0 : 1;
+}
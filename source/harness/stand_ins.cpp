@@ -0,0 +1,320 @@
+#include "stand_ins.hpp"
+
+#include <GarrysMod/Lua/Helpers.hpp>
+#include <GarrysMod/InterfacePointers.hpp>
+#include <GarrysMod/FunctionPointers.hpp>
+#include <detouring/hook.hpp>
+#include <filesystem_stdio.h>
+#include <eiface.h>
+#include <player.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+namespace Detouring
+{
+
+// Enabled hooks by the function they detour. Never destroyed, hooks can outlive it otherwise.
+static std::unordered_map<void *, void *> &detours = *new std::unordered_map<void *, void *>( );
+
+Hook::~Hook( )
+{
+	Destroy( );
+}
+
+bool Hook::Create( const Target &target, void *detour )
+{
+	return Create( target.pointer, detour );
+}
+
+bool Hook::Create( void *target, void *detour )
+{
+	if( target == nullptr || detour == nullptr )
+		return false;
+
+	Destroy( );
+	target_pointer = target;
+	detour_pointer = detour;
+	return true;
+}
+
+bool Hook::Enable( )
+{
+	if( !IsValid( ) )
+		return false;
+
+	detours[target_pointer] = detour_pointer;
+	enabled = true;
+	return true;
+}
+
+bool Hook::Disable( )
+{
+	if( !IsValid( ) )
+		return false;
+
+	if( enabled )
+		detours.erase( target_pointer );
+
+	enabled = false;
+	return true;
+}
+
+bool Hook::Destroy( )
+{
+	if( !IsValid( ) )
+		return false;
+
+	Disable( );
+	target_pointer = nullptr;
+	detour_pointer = nullptr;
+	return true;
+}
+
+bool Hook::IsValid( ) const
+{
+	return target_pointer != nullptr;
+}
+
+bool Hook::IsEnabled( ) const
+{
+	return enabled;
+}
+
+void *Resolve( void *target )
+{
+	const auto detour = detours.find( target );
+	return detour != detours.end( ) ? detour->second : target;
+}
+
+}
+
+namespace LuaHelpers
+{
+
+int32_t PushHookRun( GarrysMod::Lua::ILuaInterface *lua, const char *hook )
+{
+	lua->GetField( GarrysMod::Lua::INDEX_GLOBAL, "hook" );
+	if( !lua->IsType( -1, GarrysMod::Lua::Type::TABLE ) )
+	{
+		lua->Pop( 1 );
+		return 0;
+	}
+
+	lua->GetField( -1, "Run" );
+	lua->Remove( -2 );
+	if( !lua->IsType( -1, GarrysMod::Lua::Type::FUNCTION ) )
+	{
+		lua->Pop( 1 );
+		return 0;
+	}
+
+	lua->PushString( hook );
+	return 2;
+}
+
+bool CallHookRun( GarrysMod::Lua::ILuaInterface *lua, const int32_t args, const int32_t results )
+{
+	// errors in hooks are reported like any other error, the hook name is an argument too
+	return static_cast<GarrysMod::Lua::CLuaInterface *>( lua )->CallFunctionProtected( args + 1, results );
+}
+
+}
+
+namespace Addon
+{
+
+const IAddonSystem::Information *FileSystem::FindFileOwner( const std::string & )
+{
+	// the index built from the .gma files of the addons is complete or there's no telling
+	return nullptr;
+}
+
+const std::list<IAddonSystem::Information> &FileSystem::GetList( ) const
+{
+	return addons;
+}
+
+void FileSystem::Add( const IAddonSystem::Information &info )
+{
+	addons.push_back( info );
+}
+
+}
+
+CFileSystem_Stdio::CFileSystem_Stdio( std::string root ) :
+	root_path( std::move( root ) )
+{ }
+
+Addon::FileSystem *CFileSystem_Stdio::Addons( )
+{
+	return &addons;
+}
+
+FileHandle_t CFileSystem_Stdio::Open( const char *path, const char *options, const char * )
+{
+	return std::fopen( GetFullPath( path ).c_str( ), options );
+}
+
+void CFileSystem_Stdio::Close( FileHandle_t handle )
+{
+	std::fclose( static_cast<std::FILE *>( handle ) );
+}
+
+int CFileSystem_Stdio::Read( void *output, const int size, FileHandle_t handle )
+{
+	return static_cast<int>( std::fread( output, 1, static_cast<size_t>( size ), static_cast<std::FILE *>( handle ) ) );
+}
+
+unsigned int CFileSystem_Stdio::Size( FileHandle_t handle )
+{
+	std::FILE *file = static_cast<std::FILE *>( handle );
+	const long position = std::ftell( file );
+	std::fseek( file, 0, SEEK_END );
+	const long size = std::ftell( file );
+	std::fseek( file, position, SEEK_SET );
+	return size > 0 ? static_cast<unsigned int>( size ) : 0;
+}
+
+long CFileSystem_Stdio::GetFileTime( const char *path, const char * )
+{
+	struct stat info;
+	return stat( GetFullPath( path ).c_str( ), &info ) == 0 ? static_cast<long>( info.st_mtime ) : 0;
+}
+
+bool CFileSystem_Stdio::FileExists( const char *path, const char * )
+{
+	struct stat info;
+	return stat( GetFullPath( path ).c_str( ), &info ) == 0;
+}
+
+const char *CFileSystem_Stdio::RelativePathToFullPath( const char *path, const char *, char *full_path, const int size )
+{
+	const std::string file_path = GetFullPath( path );
+	struct stat info;
+	if( stat( file_path.c_str( ), &info ) != 0 || size <= 0 || file_path.size( ) >= static_cast<size_t>( size ) )
+		return nullptr;
+
+	std::memcpy( full_path, file_path.c_str( ), file_path.size( ) + 1 );
+	return full_path;
+}
+
+std::string CFileSystem_Stdio::GetFullPath( const char *path ) const
+{
+	return root_path + '/' + path;
+}
+
+// as many edicts as there are player slots
+static edict_t edicts[256];
+
+edict_t *IVEngineServer::PEntityOfEntIndex( const int index )
+{
+	if( index < 0 || index >= static_cast<int>( sizeof( edicts ) / sizeof( *edicts ) ) )
+		return nullptr;
+
+	edicts[index].index = index;
+	return &edicts[index];
+}
+
+int IVEngineServer::GetPlayerUserId( const edict_t *edict )
+{
+	return edict != nullptr ? edict->index : -1;
+}
+
+namespace harness
+{
+
+static CFileSystem_Stdio filesystem;
+static IVEngineServer engine_server;
+static uint64_t engine_client_errors = 0;
+
+GarrysMod::Lua::ILuaObject *GameCallback::CreateLuaObject( )
+{
+	return nullptr;
+}
+
+void GameCallback::DestroyLuaObject( GarrysMod::Lua::ILuaObject * )
+{ }
+
+void GameCallback::ErrorPrint( const char *error, const bool )
+{
+	std::fprintf( stderr, "%s\n", error );
+}
+
+void GameCallback::Msg( const char *msg, const bool )
+{
+	std::printf( "%s", msg );
+}
+
+void GameCallback::MsgColour( const char *msg, const Color & )
+{
+	std::printf( "%s", msg );
+}
+
+void GameCallback::LuaError( const CLuaError *error )
+{
+	++errors;
+	if( !verbose )
+		return;
+
+	std::fprintf( stderr, "[ERROR] %s\n", error->message.c_str( ) );
+	for( size_t k = 0; k < error->stack.size( ); ++k )
+	{
+		const CLuaError::StackEntry &entry = error->stack[k];
+		std::fprintf( stderr, "  %zu. %s - %s:%d\n", k + 1, entry.function.c_str( ), entry.source.c_str( ), entry.line );
+	}
+}
+
+void GameCallback::InterfaceCreated( GarrysMod::Lua::ILuaInterface * )
+{ }
+
+// What the engine's CBasePlayer::HandleClientLuaError does with the payloads it gets to see.
+static void HandleClientLuaErrorEngine( CBasePlayer *, const char * )
+{
+	++engine_client_errors;
+}
+
+void HandleClientLuaError( CBasePlayer *player, const char *error )
+{
+	Detouring::Resolve( &HandleClientLuaErrorEngine )( player, error );
+}
+
+uint64_t GetEngineClientErrors( )
+{
+	return engine_client_errors;
+}
+
+CFileSystem_Stdio &GetFileSystem( )
+{
+	return filesystem;
+}
+
+}
+
+namespace InterfacePointers
+{
+
+IFileSystem *FileSystem( )
+{
+	return &harness::filesystem;
+}
+
+IVEngineServer *VEngineServer( )
+{
+	return &harness::engine_server;
+}
+
+}
+
+namespace FunctionPointers
+{
+
+CBasePlayer_HandleClientLuaError_t CBasePlayer_HandleClientLuaError( )
+{
+	return &harness::HandleClientLuaErrorEngine;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GarrysMod/Lua/LuaGameCallback.h>
+
+#include <cstdint>
+
+class CBasePlayer;
+class CFileSystem_Stdio;
+
+namespace harness
+{
+
+// The engine's side of error handling, counting the errors that reach it instead of printing them.
+class GameCallback : public GarrysMod::Lua::ILuaGameCallback
+{
+public:
+	GarrysMod::Lua::ILuaObject *CreateLuaObject( );
+	void DestroyLuaObject( GarrysMod::Lua::ILuaObject *obj );
+	void ErrorPrint( const char *error, bool print );
+	void Msg( const char *msg, bool useless );
+	void MsgColour( const char *msg, const Color &color );
+	void LuaError( const CLuaError *error );
+	void InterfaceCreated( GarrysMod::Lua::ILuaInterface *iface );
+
+	// prints every error it receives
+	bool verbose = false;
+	uint64_t errors = 0;
+};
+
+// Hands a client error payload to CBasePlayer::HandleClientLuaError, or to its detour when it's
+// enabled, like the engine does when a client sends one.
+void HandleClientLuaError( CBasePlayer *player, const char *error );
+
+// Payloads that reached the engine's own HandleClientLuaError.
+uint64_t GetEngineClientErrors( );
+
+// The filesystem handed out by InterfacePointers::FileSystem.
+CFileSystem_Stdio &GetFileSystem( );
+
+}
@@ -1,5 +1,11 @@
 #include "server.hpp"
+#include "shared/shared.hpp"
 #include "common/common.hpp"
+#include "common/rate_limit.hpp"
+#include "common/async_pipeline.hpp"
+#include "common/stats.hpp"
+#include "common/arena.hpp"
+#include "common/stack_groups.hpp"
 
 #include <GarrysMod/Lua/Interface.h>
 #include <GarrysMod/Lua/LuaInterface.h>
@@ -9,18 +15,15 @@
 
 #include <detouring/hook.hpp>
 
+#include <chrono>
 #include <cstdint>
-#include <sstream>
+#include <cstring>
 #include <algorithm>
-#include <functional>
-#include <cctype>
-#include <regex>
+#include <vector>
 
 #include <eiface.h>
 #include <player.h>
 
-#undef isspace
-
 IVEngineServer *engine = nullptr;
 
 namespace server
@@ -32,13 +35,135 @@ typedef void ( *HandleClientLuaError_t )( CBasePlayer *player, const char *error
 
 static Detouring::Hook HandleClientLuaError_detour;
 
+// entity indices of players never go over 255 (ABSOLUTE_PLAYER_LIMIT)
+static common::ClientErrorLimiter client_limiter( 256 );
+
+// Reused by every client error, the parsed error points into the payload and the arena holds the
+// null terminated copies pushed to the ClientLuaError hook until it returns.
+static common::ParsedErrorWithStackTraceView client_parsed_error;
+static common::ErrorArena client_arena;
+// scratch space for folding client stacks
+static std::vector<uint64_t> client_frame_hashes;
+static std::vector<common::StackGroup> client_stack_groups;
+
+static void PushClientStackFrame( const common::ParsedErrorWithStackTraceView::StackFrame &stack_frame )
+{
+	shared::CreateStackTable( lua, shared::StackTable::Level, 0, 3 );
+
+	lua->PushString( client_arena.CopyString( stack_frame.name ) );
+	shared::SetStackField( lua, shared::StackKey::Name );
+
+	lua->PushNumber( stack_frame.currentline );
+	shared::SetStackField( lua, shared::StackKey::CurrentLine );
+
+	lua->PushString( client_arena.CopyString( stack_frame.source ) );
+	shared::SetStackField( lua, shared::StackKey::Source );
+}
+
+// Same layout as the stacks of LuaError, folded into groups of repeated frames when enabled.
+static void PushClientStack( const common::ParsedErrorWithStackTraceView &parsed_error )
+{
+	const auto &stack_trace = parsed_error.stack_trace;
+
+	if( !shared::IsStackFoldingEnabled( ) )
+	{
+		shared::CreateStackTable( lua, shared::StackTable::Stack, static_cast<int32_t>( stack_trace.size( ) ), 0 );
+		for( const auto &stack_frame : stack_trace )
+		{
+			lua->PushNumber( stack_frame.level );
+			PushClientStackFrame( stack_frame );
+			lua->SetTable( -3 );
+		}
+
+		return;
+	}
+
+	common::FoldStackTrace( stack_trace, client_frame_hashes, client_stack_groups );
+	shared::CreateStackTable( lua, shared::StackTable::Stack, static_cast<int32_t>( client_stack_groups.size( ) ), 0 );
+	for( size_t k = 0; k < client_stack_groups.size( ); ++k )
+	{
+		const common::StackGroup &group = client_stack_groups[k];
+
+		lua->PushNumber( static_cast<double>( k + 1 ) );
+		shared::CreateStackTable( lua, shared::StackTable::Group, static_cast<int32_t>( group.length ), 2 );
+
+		lua->PushNumber( stack_trace[group.first].level );
+		shared::SetStackField( lua, shared::StackKey::Level );
+
+		lua->PushNumber( static_cast<double>( group.repeats ) );
+		shared::SetStackField( lua, shared::StackKey::Repeats );
+
+		for( size_t l = 0; l < group.length; ++l )
+		{
+			lua->PushNumber( static_cast<double>( l + 1 ) );
+			PushClientStackFrame( stack_trace[group.first + l] );
+			lua->SetTable( -3 );
+		}
+
+		lua->SetTable( -3 );
+	}
+}
+
 static void HandleClientLuaError_d( CBasePlayer *player, const char *error )
 {
-	common::ParsedErrorWithStackTrace parsed_error;
-	if( !common::ParseErrorWithStackTrace( error, parsed_error ) )
+	common::ErrorPathStats &stats = shared::GetClientStats( );
+	++stats.seen;
+	stats.bytes += std::strlen( error );
+
+	// whoever joins in the slot of a player that left starts with a full bucket and no drops
+	const int entindex = player->entindex( );
+	client_limiter.SetOwner(
+		static_cast<size_t>( entindex ),
+		engine->GetPlayerUserId( engine->PEntityOfEntIndex( entindex ) )
+	);
+
+	// dropped payloads don't even reach the engine, otherwise they'd still spam the console
+	if( client_limiter.Check(
+		static_cast<size_t>( entindex ),
+		error,
+		common::ClientErrorLimiter::Clock::now( )
+	) != common::ClientErrorLimiter::Verdict::Accept )
+	{
+		++stats.dropped;
+		return;
+	}
+
+	// the threads of the journal and exporter parse it too
+	shared::RecordClientError( player->entindex( ), error );
+
+	// the payload is parsed on the pipeline worker and handed to ClientLuaErrorBatch on a later tick
+	common::AsyncErrorPipeline *async_pipeline = shared::GetAsyncPipeline( );
+	if( async_pipeline != nullptr )
+	{
+		common::AsyncErrorPipeline::Record *record = async_pipeline->Prepare( );
+		if( record != nullptr )
+		{
+			record->error = error;
+			record->runtime = false;
+			record->client = player->entindex( );
+			async_pipeline->Push( );
+		}
+		else
+			++stats.dropped;
+
 		return HandleClientLuaError_detour.GetTrampoline<HandleClientLuaError_t>( )( player, error );
+	}
+
+	// nothing would receive it, so it's not worth parsing
+	if( !shared::HasHookListeners( lua, "ClientLuaError" ) )
+		return HandleClientLuaError_detour.GetTrampoline<HandleClientLuaError_t>( )( player, error );
+
+	common::ParsedErrorWithStackTraceView &parsed_error = client_parsed_error;
+	bool parsed = false;
+	{
+		common::ScopedTimer timer( stats.timers[common::ErrorPathStats::Parse] );
+		parsed = common::ParseErrorWithStackTrace( std::string_view( error ), parsed_error );
+	}
 
-	const int32_t funcs = LuaHelpers::PushHookRun( lua, "ClientLuaError" );
+	if( !parsed )
+		return HandleClientLuaError_detour.GetTrampoline<HandleClientLuaError_t>( )( player, error );
+
+	const int32_t funcs = shared::PushHookRun( lua, "ClientLuaError" );
 	if( funcs == 0 )
 		return HandleClientLuaError_detour.GetTrampoline<HandleClientLuaError_t>( )( player, error );
 
@@ -52,36 +177,38 @@ static void HandleClientLuaError_d( CBasePlayer *player, const char *error )
 	lua->PushNumber( player->entindex( ) );
 	lua->Call( 1, 1 );
 
+	common::ErrorArena::Scope arena_scope( client_arena );
+
 	lua->PushString( error );
 
-	lua->PushString( parsed_error.source_file.c_str( ) );
+	lua->PushString( client_arena.CopyString( parsed_error.source_file ) );
 	lua->PushNumber( parsed_error.source_line );
-	lua->PushString( parsed_error.error_string.c_str( ) );
+	lua->PushString( client_arena.CopyString( parsed_error.error_string ) );
 
-	lua->CreateTable( );
-	for( const auto &stack_frame : parsed_error.stack_trace )
 	{
-		lua->PushNumber( stack_frame.level );
-		lua->CreateTable( );
-
-		lua->PushString( stack_frame.name.c_str( ) );
-		lua->SetField( -2, "name" );
-
-		lua->PushNumber( stack_frame.currentline );
-		lua->SetField( -2, "currentline" );
-
-		lua->PushString( stack_frame.source.c_str( ) );
-		lua->SetField( -2, "source" );
-
-		lua->SetTable( -3 );
+		common::ScopedTimer timer( stats.timers[common::ErrorPathStats::StackCapture] );
+		shared::StackTableScope stack_table_scope( lua, shared::StackPool::Client, stats );
+		PushClientStack( parsed_error );
 	}
 
 	if( parsed_error.addon_name.empty( ) )
 		lua->PushNil( );
 	else
-		lua->PushString( parsed_error.addon_name.c_str( ) );
+		lua->PushString( client_arena.CopyString( parsed_error.addon_name ) );
 
-	if( !LuaHelpers::CallHookRun( lua, 7, 1 ) )
+	// the server has its own copy of shared files, clientside only ones have no context
+	shared::PushSourceContext( lua, parsed_error.source_file, parsed_error.source_line );
+	shared::PushErrorTemplate( lua, parsed_error.error_string );
+
+	bool call_success = false;
+	{
+		common::ScopedTimer timer( stats.timers[common::ErrorPathStats::HookCall] );
+		call_success = LuaHelpers::CallHookRun( lua, 9, 1 );
+	}
+
+	shared::ReleaseStackPool( shared::StackPool::Client );
+
+	if( !call_success )
 		return HandleClientLuaError_detour.GetTrampoline<HandleClientLuaError_t>( )( player, error );
 
 	const bool proceed = !lua->IsType( -1, GarrysMod::Lua::Type::BOOL ) || !lua->GetBool( -1 );
@@ -99,6 +226,80 @@ LUA_FUNCTION_STATIC( EnableClientDetour )
 	return 1;
 }
 
+static double GetOptionalNumber( GarrysMod::Lua::ILuaBase *LUA, int32_t index, double current )
+{
+	if( LUA->IsType( index, GarrysMod::Lua::Type::NIL ) || LUA->IsType( index, GarrysMod::Lua::Type::NONE ) )
+		return current;
+
+	const double value = LUA->CheckNumber( index );
+	return value > 0.0 ? value : 0.0;
+}
+
+LUA_FUNCTION_STATIC( SetClientErrorLimits )
+{
+	common::ClientErrorLimiter::Limits limits = client_limiter.GetLimits( );
+	limits.rate = GetOptionalNumber( LUA, 1, limits.rate );
+	limits.burst = GetOptionalNumber( LUA, 2, limits.burst );
+	limits.max_bytes = static_cast<size_t>( GetOptionalNumber( LUA, 3, static_cast<double>( limits.max_bytes ) ) );
+	limits.max_frames = static_cast<size_t>( GetOptionalNumber( LUA, 4, static_cast<double>( limits.max_frames ) ) );
+	client_limiter.SetLimits( limits );
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetClientErrorLimits )
+{
+	const common::ClientErrorLimiter::Limits &limits = client_limiter.GetLimits( );
+	LUA->PushNumber( limits.rate );
+	LUA->PushNumber( limits.burst );
+	LUA->PushNumber( static_cast<double>( limits.max_bytes ) );
+	LUA->PushNumber( static_cast<double>( limits.max_frames ) );
+	return 4;
+}
+
+static void PushDroppedCounts( GarrysMod::Lua::ILuaBase *LUA, const common::ClientErrorLimiter::Dropped &dropped )
+{
+	LUA->CreateTable( );
+
+	LUA->PushNumber( static_cast<double>( dropped.rate_limited ) );
+	LUA->SetField( -2, "ratelimited" );
+
+	LUA->PushNumber( static_cast<double>( dropped.too_large ) );
+	LUA->SetField( -2, "toolarge" );
+
+	LUA->PushNumber( static_cast<double>( dropped.too_many_frames ) );
+	LUA->SetField( -2, "toomanyframes" );
+
+	LUA->PushNumber( static_cast<double>( dropped.Total( ) ) );
+	LUA->SetField( -2, "total" );
+}
+
+LUA_FUNCTION_STATIC( GetClientDroppedCounts )
+{
+	if( !LUA->IsType( 1, GarrysMod::Lua::Type::NONE ) )
+	{
+		PushDroppedCounts( LUA, client_limiter.GetDropped( static_cast<size_t>( LUA->CheckNumber( 1 ) ) ) );
+		return 1;
+	}
+
+	LUA->CreateTable( );
+
+	client_limiter.ForEach( [LUA]( size_t entindex, const common::ClientErrorLimiter::Dropped &dropped )
+	{
+		LUA->PushNumber( static_cast<double>( entindex ) );
+		PushDroppedCounts( LUA, dropped );
+		LUA->SetTable( -3 );
+	} );
+
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( ResetClientErrorLimits )
+{
+	client_limiter.Reset( static_cast<size_t>( LUA->CheckNumber( 1 ) ) );
+	return 0;
+}
+
 void Initialize( GarrysMod::Lua::ILuaBase *LUA )
 {
 	lua = static_cast<GarrysMod::Lua::ILuaInterface *>( LUA );
@@ -119,6 +320,18 @@ void Initialize( GarrysMod::Lua::ILuaBase *LUA )
 
 	LUA->PushCFunction( EnableClientDetour );
 	LUA->SetField( -2, "EnableClientDetour" );
+
+	LUA->PushCFunction( SetClientErrorLimits );
+	LUA->SetField( -2, "SetClientErrorLimits" );
+
+	LUA->PushCFunction( GetClientErrorLimits );
+	LUA->SetField( -2, "GetClientErrorLimits" );
+
+	LUA->PushCFunction( GetClientDroppedCounts );
+	LUA->SetField( -2, "GetClientDroppedCounts" );
+
+	LUA->PushCFunction( ResetClientErrorLimits );
+	LUA->SetField( -2, "ResetClientErrorLimits" );
 }
 
 void Deinitialize( GarrysMod::Lua::ILuaBase * )
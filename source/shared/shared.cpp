@@ -1,5 +1,20 @@
 #include "shared.hpp"
 #include "common/common.hpp"
+#include "common/fingerprint.hpp"
+#include "common/duplicates.hpp"
+#include "common/async_pipeline.hpp"
+#include "common/journal.hpp"
+#include "common/exporter.hpp"
+#include "common/addon_index.hpp"
+#include "common/hash.hpp"
+#include "common/stats.hpp"
+#include "common/arena.hpp"
+#include "common/stack_groups.hpp"
+#include "common/capture_budget.hpp"
+#include "common/source_cache.hpp"
+#include "common/recent.hpp"
+#include "common/heavy_hitters.hpp"
+#include "common/templates.hpp"
 
 #include <GarrysMod/Lua/Interface.h>
 #include <GarrysMod/Lua/Helpers.hpp>
@@ -12,10 +27,19 @@
 
 #include <detouring/hook.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
 #include <string>
-#include <sstream>
-#include <regex>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include <filesystem_stdio.h>
 
@@ -25,6 +49,29 @@ namespace shared
 static bool runtime = false;
 static std::string runtime_error;
 static GarrysMod::Lua::AutoReference runtime_stack;
+static bool lazy_stack = false;
+static GarrysMod::Lua::AutoReference stack_level_meta;
+// weak keyed, maps lazy stack level tables to their ids
+static GarrysMod::Lua::AutoReference stack_level_ids;
+static uint64_t runtime_fingerprint = 0;
+static uint32_t runtime_repeats = 0;
+static bool runtime_suppressed = false;
+static bool runtime_listening = false;
+static common::CaptureBudget capture_budget;
+// what the capture budget allowed for the stack of the runtime error being reported
+static common::CaptureBudget::Level runtime_capture = common::CaptureBudget::Level::Full;
+static common::DuplicateFilter duplicate_filter;
+static common::AsyncErrorPipeline async_pipeline;
+static bool async_enabled = false;
+static bool delivering_async = false;
+// most records handed to the batch hooks per tick, the rest wait for the next ticks
+static constexpr size_t async_batch_limit = 256;
+static common::JournalWriter journal;
+static common::ErrorExporter exporter;
+static common::ErrorPathStats lua_stats;
+static common::ErrorPathStats client_stats;
+// strings the LuaError hook is called with, reset once it returns
+static common::ErrorArena lua_arena;
 static CFileSystem_Stdio *filesystem = nullptr;
 static bool runtime_detoured = false;
 static bool compiletime_detoured = false;
@@ -100,303 +147,2924 @@ inline bool GetLocals( GarrysMod::Lua::ILuaInterface *lua, lua_Debug &dbg )
 	return true;
 }
 
+// Workshop addon attribution goes through an index of every file the mounted addons hold. A Tick
+// hook compares the addon list with the one the index was built from and, when it changed, builds
+// a new index on a background thread. Every thread (the game thread, async pipeline, journal and
+// exporter) only atomically loads whichever index is current and looks files up in it.
+static std::shared_ptr<const common::AddonIndex> addon_index;
+static bool addon_list_read = false;
+static uint64_t addon_list_signature = 0;
+static std::chrono::steady_clock::time_point addon_list_checked;
+// the addon list is only compared this often
+static constexpr std::chrono::seconds addon_list_check_interval( 1 );
+static std::thread addon_index_builder;
+static std::atomic<bool> addon_index_building( false );
+// game thread copy of the index addon_cache was filled from
+static std::shared_ptr<const common::AddonIndex> addon_cache_index;
+static common::AddonLookupCache addon_cache;
+// owner found by asking the filesystem, for addons whose file list couldn't be read
+static common::AddonIndex::Addon addon_fallback;
+
+// What the builder needs of a mounted addon, copied on the game thread.
+struct AddonFile
+{
+	std::string title;
+	uint64_t wsid = 0;
+	// full path of the .gma, empty if the filesystem couldn't resolve it
+	std::string path;
+};
+
+static uint64_t GetAddonListSignature( const std::list<IAddonSystem::Information> &list )
+{
+	uint64_t signature = common::Hash( static_cast<uint64_t>( list.size( ) ) );
+	for( const auto &info : list )
+	{
+		signature = common::Hash( info.wsid, signature );
+		signature = common::Hash( info.timeupdated, signature );
+		signature = common::Hash( info.file, signature );
+	}
+
+	return signature;
+}
+
+static bool IsAbsolutePath( const std::string &path )
+{
+	return ( !path.empty( ) && ( path[0] == '/' || path[0] == '\\' ) ) || ( path.size( ) > 1 && path[1] == ':' );
+}
+
+// Game thread. Addon files are either absolute or relative to the game directory, the filesystem
+// resolves the latter through its search paths.
+static std::vector<AddonFile> CopyAddonList( const std::list<IAddonSystem::Information> &list )
+{
+	std::vector<AddonFile> files;
+	files.reserve( list.size( ) );
+	for( const auto &info : list )
+	{
+		AddonFile file;
+		file.title = info.title;
+		file.wsid = info.wsid;
+
+		char full_path[512];
+		if( IsAbsolutePath( info.file ) )
+			file.path = info.file;
+		else if( filesystem->RelativePathToFullPath( info.file.c_str( ), "MOD", full_path, sizeof( full_path ) ) != nullptr )
+			file.path = full_path;
+
+		files.push_back( std::move( file ) );
+	}
+
+	return files;
+}
+
+// Builder thread, reads the file list of every addon.
+static std::shared_ptr<const common::AddonIndex> BuildAddonIndex( const std::vector<AddonFile> &files )
+{
+	auto index = std::make_shared<common::AddonIndex>( );
+	for( const AddonFile &addon_file : files )
+	{
+		const common::AddonIndex::AddonId addon = index->AddAddon( addon_file.title, addon_file.wsid );
+
+		std::FILE *file = !addon_file.path.empty( ) ? std::fopen( addon_file.path.c_str( ), "rb" ) : nullptr;
+		if( file == nullptr )
+		{
+			index->SetIncomplete( );
+			continue;
+		}
+
+		if( !common::ReadGmaFileList( file, [&index, addon]( std::string_view path ) { index->AddFile( addon, path ); } ) )
+			index->SetIncomplete( );
+
+		std::fclose( file );
+	}
+
+	return index;
+}
+
+static void JoinAddonIndexBuilder( )
+{
+	if( addon_index_builder.joinable( ) )
+		addon_index_builder.join( );
+}
+
+// Game thread. Starts building a new index if the addon list changed since the last build started,
+// a build in progress is left alone and the list is compared again once it's published.
+static void CheckAddonList( )
+{
+	addon_list_checked = std::chrono::steady_clock::now( );
+	if( addon_index_building )
+		return;
+
+	const auto addons = filesystem->Addons( );
+	if( addons == nullptr )
+		return;
+
+	const auto &list = addons->GetList( );
+	const uint64_t signature = GetAddonListSignature( list );
+	if( addon_list_read && signature == addon_list_signature )
+		return;
+
+	addon_list_read = true;
+	addon_list_signature = signature;
+
+	JoinAddonIndexBuilder( );
+	addon_index_building = true;
+	addon_index_builder = std::thread( []( std::vector<AddonFile> files )
+	{
+		std::atomic_store( &addon_index, BuildAddonIndex( files ) );
+		addon_index_building = false;
+	}, CopyAddonList( list ) );
+}
+
+LUA_FUNCTION_STATIC( AddonIndexTick )
+{
+	if( std::chrono::steady_clock::now( ) - addon_list_checked >= addon_list_check_interval )
+		CheckAddonList( );
+
+	return 0;
+}
+
+// Game thread. Returns the current index, nullptr until the first one is built.
+static const common::AddonIndex *GetAddonIndex( )
+{
+	std::shared_ptr<const common::AddonIndex> index = std::atomic_load( &addon_index );
+	if( index != addon_cache_index )
+	{
+		addon_cache.Clear( );
+		addon_cache_index = std::move( index );
+	}
+
+	return addon_cache_index.get( );
+}
+
+// Game thread. Sources of Lua functions (with a leading '@') are accepted too.
+static const common::AddonIndex::Addon *FindWorkshopAddonFromFile( std::string_view source )
+{
+	if( !source.empty( ) && source[0] == '@' )
+		source.remove_prefix( 1 );
+
+	if( source.empty( ) || source == "[C]" )
+		return nullptr;
+
+	const common::AddonIndex *index = GetAddonIndex( );
+	if( index != nullptr )
+	{
+		const common::AddonIndex::Addon *owner = addon_cache.Find( *index, source );
+		if( owner != nullptr || !index->IsIncomplete( ) )
+			return owner;
+	}
+
+	// only the game thread may ask the filesystem, while the first index is built or for addons
+	// whose file list couldn't be read
+	const auto addons = filesystem->Addons( );
+	if( addons == nullptr )
+		return nullptr;
+
+	const auto fallback = addons->FindFileOwner( std::string( source ) );
+	if( fallback == nullptr )
+		return nullptr;
+
+	addon_fallback.title = fallback->title;
+	addon_fallback.wsid = fallback->wsid;
+	return &addon_fallback;
+}
+
+// Addon attribution for the async pipeline, the journal and the exporter, runs on their background
+// threads. The filesystem isn't thread safe, so files the index doesn't have stay unattributed.
+static bool ResolveWorkshopAddon( std::string_view source, std::string &title, uint64_t &wsid )
+{
+	if( !source.empty( ) && source[0] == '@' )
+		source.remove_prefix( 1 );
+
+	if( source.empty( ) || source == "[C]" )
+		return false;
+
+	const std::shared_ptr<const common::AddonIndex> index = std::atomic_load( &addon_index );
+	if( index == nullptr )
+		return false;
+
+	const common::AddonIndex::Addon *owner = index->Find( source );
+	if( owner == nullptr )
+		return false;
+
+	title = owner->title;
+	wsid = owner->wsid;
+	return true;
+}
+
+// Lines around errors (luaerror.EnableSourceContext), read through the game filesystem once and
+// then served from the cache while the file stays unchanged.
+static size_t source_context_lines = 0;
+static common::SourceCache source_cache;
+// modification times of cached files are only compared with the disk this often
+static constexpr std::chrono::seconds source_check_interval( 1 );
+// larger files are never read for context
+static constexpr unsigned int source_size_limit = 1024 * 1024;
+// null terminated copy of the path being looked up
+static std::string source_path;
+
+// Game thread. Returns nullptr if the file can't be read or is empty.
+static const common::SourceCache::File *GetSourceFile( std::string_view source )
+{
+	if( !source.empty( ) && source[0] == '@' )
+		source.remove_prefix( 1 );
+
+	if( source.empty( ) || source == "[C]" )
+		return nullptr;
+
+	const auto now = common::SourceCache::Clock::now( );
+	common::SourceCache::File *file = source_cache.Find( source );
+	if( file != nullptr && now - file->GetChecked( ) < source_check_interval )
+		return file->GetLineCount( ) != 0 ? file : nullptr;
+
+	source_path.assign( source.data( ), source.size( ) );
+	const int64_t mtime = filesystem->GetFileTime( source_path.c_str( ), "GAME" );
+	if( file != nullptr && file->GetModificationTime( ) == mtime )
+	{
+		file->SetChecked( now );
+		return file->GetLineCount( ) != 0 ? file : nullptr;
+	}
+
+	// files that can't be read or don't fit the cache are cached empty, so they aren't opened
+	// again on every error
+	std::string content;
+	FileHandle_t handle = filesystem->Open( source_path.c_str( ), "rb", "GAME" );
+	if( handle != nullptr )
+	{
+		const unsigned int size = filesystem->Size( handle );
+		if( size != 0 && size <= std::min<size_t>( source_size_limit, source_cache.GetMaxBytes( ) ) )
+		{
+			content.resize( size );
+			if( filesystem->Read( &content[0], static_cast<int>( size ), handle ) != static_cast<int>( size ) )
+				content.clear( );
+		}
+
+		filesystem->Close( handle );
+	}
+
+	const bool empty = content.empty( );
+	file = source_cache.Insert( source, mtime, std::move( content ), now );
+	if( file == nullptr && !empty )
+		file = source_cache.Insert( source, mtime, std::string( ), now );
+
+	return file != nullptr && file->GetLineCount( ) != 0 ? file : nullptr;
+}
+
+static void PushStringView( GarrysMod::Lua::ILuaBase *LUA, const std::string_view text )
+{
+	LUA->PushString( text.empty( ) ? "" : text.data( ), static_cast<unsigned int>( text.size( ) ) );
+}
+
+void PushSourceContext( GarrysMod::Lua::ILuaBase *LUA, std::string_view source, const int32_t line )
+{
+	const common::SourceCache::File *file = source_context_lines != 0 && line > 0 ? GetSourceFile( source ) : nullptr;
+	if( file == nullptr || static_cast<size_t>( line ) > file->GetLineCount( ) )
+	{
+		LUA->PushNil( );
+		return;
+	}
+
+	const size_t first = static_cast<size_t>( line ) > source_context_lines ? line - source_context_lines : 1;
+	const size_t last = std::min( static_cast<size_t>( line ) + source_context_lines, file->GetLineCount( ) );
+
+	LUA->CreateTable( );
+
+	LUA->PushNumber( static_cast<double>( first ) );
+	LUA->SetField( -2, "firstline" );
+
+	for( size_t k = first; k <= last; ++k )
+	{
+		LUA->PushNumber( static_cast<double>( k - first + 1 ) );
+		PushStringView( LUA, file->GetLine( k ) );
+		LUA->SetTable( -3 );
+	}
+}
+
+// Messages of the errors given to the hooks, clustered into templates so errors that only differ
+// by the values in their messages can be told apart from different errors.
+static common::TemplateMiner error_templates;
+static std::vector<const common::TemplateMiner::Template *> top_templates;
+static constexpr size_t error_templates_limit = 65536;
+
+void PushErrorTemplate( GarrysMod::Lua::ILuaBase *LUA, std::string_view error_string )
+{
+	const uint32_t id = error_templates.Add( error_string );
+	if( id != 0 )
+		LUA->PushNumber( id );
+	else
+		LUA->PushNil( );
+}
+
+// Names of the StackKey fields, interned once in stack_keys.
+static const char *const stack_key_names[] = {
+	"event",
+	"name",
+	"namewhat",
+	"what",
+	"source",
+	"currentline",
+	"nups",
+	"linedefined",
+	"lastlinedefined",
+	"short_src",
+	"func",
+	"activelines",
+	"upvalues",
+	"locals",
+	"addontitle",
+	"addonwsid",
+	"level",
+	"repeats"
+};
+
+static_assert(
+	sizeof( stack_key_names ) / sizeof( *stack_key_names ) == static_cast<size_t>( StackKey::Count ) - 1,
+	"every stack key needs a name"
+);
+
+// fields only some stack levels have, a reused level table loses them before it's filled again
+static const StackKey optional_level_keys[] = {
+	StackKey::Func,
+	StackKey::ActiveLines,
+	StackKey::Upvalues,
+	StackKey::Locals,
+	StackKey::AddonTitle,
+	StackKey::AddonWorkshopId
+};
+
+static GarrysMod::Lua::AutoReference stack_keys;
+// {[StackTable] = {tables...}} for every StackPool
+static GarrysMod::Lua::AutoReference stack_pools[static_cast<size_t>( StackPool::Count )];
+static bool stack_pools_busy[static_cast<size_t>( StackPool::Count )] = { };
+// tables kept per StackTable of each pool, pooling is disabled with 0
+static size_t stack_pool_limit = 0;
+static constexpr size_t stack_pool_limit_max = 65536;
+
+// Lua stack indices of the keys and of the first pool table while a StackTableScope is alive, 0
+// otherwise. The pool tables of each StackTable follow the first one.
+static int32_t stack_keys_index = 0;
+static int32_t stack_pool_index = 0;
+static size_t stack_pool_next[static_cast<size_t>( StackTable::Count )] = { };
+
+static size_t GetLuaMemory( lua_State *L )
+{
+	return static_cast<size_t>( lua_gc( L, LUA_GCCOUNT, 0 ) ) * 1024 + static_cast<size_t>( lua_gc( L, LUA_GCCOUNTB, 0 ) );
+}
+
+// New (empty) pool tables for every StackPool, dropping the tables pooled so far.
+static void CreateStackPools( GarrysMod::Lua::ILuaBase *LUA )
+{
+	for( GarrysMod::Lua::AutoReference &stack_pool : stack_pools )
+	{
+		lua_createtable( LUA->GetState( ), static_cast<int>( StackTable::Count ), 0 );
+		for( size_t k = 0; k < static_cast<size_t>( StackTable::Count ); ++k )
+		{
+			LUA->PushNumber( static_cast<double>( k + 1 ) );
+			LUA->CreateTable( );
+			LUA->RawSet( -3 );
+		}
+
+		stack_pool.Setup( LUA );
+		stack_pool.Create( );
+	}
+}
+
+StackTableScope::StackTableScope( GarrysMod::Lua::ILuaBase *LUA, const StackPool pool, common::ErrorPathStats &path_stats ) :
+	lua( LUA ),
+	stats( path_stats ),
+	memory( GetLuaMemory( LUA->GetState( ) ) ),
+	keys_index( stack_keys_index ),
+	pool_index( stack_pool_index ),
+	pooled( false )
+{
+	std::copy( std::begin( stack_pool_next ), std::end( stack_pool_next ), pool_next );
+
+	lua_State *L = LUA->GetState( );
+	if( stack_keys.Push( ) )
+		stack_keys_index = LUA->Top( );
+	else
+		stack_keys_index = 0;
+
+	stack_pool_index = 0;
+	bool &busy = stack_pools_busy[static_cast<size_t>( pool )];
+	if( stack_keys_index == 0 || stack_pool_limit == 0 || busy || !stack_pools[static_cast<size_t>( pool )].Push( ) )
+		return;
+
+	for( size_t k = 1; k <= static_cast<size_t>( StackTable::Count ); ++k )
+		lua_rawgeti( L, -static_cast<int>( k ), static_cast<int>( k ) );
+
+	LUA->Remove( -static_cast<int32_t>( StackTable::Count ) - 1 );
+	stack_pool_index = LUA->Top( ) - static_cast<int32_t>( StackTable::Count ) + 1;
+	std::fill( std::begin( stack_pool_next ), std::end( stack_pool_next ), 1 );
+	busy = true;
+	pooled = true;
+}
+
+StackTableScope::~StackTableScope( )
+{
+	// the pool tables sit above the keys
+	if( stack_pool_index != 0 )
+		for( size_t k = 0; k < static_cast<size_t>( StackTable::Count ); ++k )
+			lua->Remove( stack_pool_index );
+
+	if( stack_keys_index != 0 )
+		lua->Remove( stack_keys_index );
+
+	stack_keys_index = keys_index;
+	stack_pool_index = pool_index;
+	std::copy( std::begin( pool_next ), std::end( pool_next ), stack_pool_next );
+
+	const size_t used = GetLuaMemory( lua->GetState( ) );
+	if( used < memory )
+		return;
+
+	if( pooled )
+	{
+		++stats.pooled_stacks;
+		stats.pooled_stack_bytes += used - memory;
+	}
+	else
+	{
+		++stats.stacks;
+		stats.stack_bytes += used - memory;
+	}
+}
+
+void ReleaseStackPool( const StackPool pool )
+{
+	stack_pools_busy[static_cast<size_t>( pool )] = false;
+}
+
+// Empties the pooled table at index for its next use as a table of the given role.
+static void ClearStackTable( GarrysMod::Lua::ILuaBase *LUA, const StackTable table, const int32_t index )
+{
+	lua_State *L = LUA->GetState( );
+	if( table == StackTable::Level )
+	{
+		// every level sets the other fields again, so their slots are just overwritten
+		for( const StackKey key : optional_level_keys )
+		{
+			lua_rawgeti( L, stack_keys_index, static_cast<int>( key ) );
+			LUA->Push( -1 );
+			LUA->RawGet( index );
+			if( LUA->IsType( -1, GarrysMod::Lua::Type::NIL ) )
+			{
+				LUA->Pop( 2 );
+				continue;
+			}
+
+			LUA->Pop( 1 );
+			LUA->PushNil( );
+			LUA->RawSet( index );
+		}
+
+		if( LUA->GetMetaTable( index ) )
+		{
+			LUA->Pop( 1 );
+			LUA->PushNil( );
+			LUA->SetMetaTable( index );
+		}
+
+		return;
+	}
+
+	// stacks and groups are lists (groups also have level and repeats, always set again), clearing
+	// the current key is allowed while traversing
+	LUA->PushNil( );
+	while( LUA->Next( index ) != 0 )
+	{
+		LUA->Pop( 1 );
+		if( !LUA->IsType( -1, GarrysMod::Lua::Type::NUMBER ) )
+			continue;
+
+		LUA->Push( -1 );
+		LUA->PushNil( );
+		LUA->RawSet( index );
+	}
+}
+
+void CreateStackTable( GarrysMod::Lua::ILuaBase *LUA, const StackTable table, const int32_t array_size, const int32_t fields )
+{
+	lua_State *L = LUA->GetState( );
+	if( stack_pool_index == 0 )
+	{
+		lua_createtable( L, array_size, fields );
+		return;
+	}
+
+	const int32_t pool_index = stack_pool_index + static_cast<int32_t>( table );
+	size_t &next = stack_pool_next[static_cast<size_t>( table )];
+	if( next > stack_pool_limit )
+	{
+		lua_createtable( L, array_size, fields );
+		return;
+	}
+
+	const auto slot = static_cast<int>( next++ );
+	lua_rawgeti( L, pool_index, slot );
+	if( LUA->IsType( -1, GarrysMod::Lua::Type::TABLE ) )
+	{
+		ClearStackTable( LUA, table, LUA->Top( ) );
+		return;
+	}
+
+	// the pool grows one table at a time, so this is the first slot without one
+	LUA->Pop( 1 );
+	lua_createtable( L, array_size, fields );
+	LUA->Push( -1 );
+	lua_rawseti( L, pool_index, slot );
+}
+
+void SetStackField( GarrysMod::Lua::ILuaBase *LUA, const StackKey key )
+{
+	if( stack_keys_index == 0 )
+	{
+		LUA->SetField( -2, stack_key_names[static_cast<size_t>( key ) - 1] );
+		return;
+	}
+
+	lua_rawgeti( LUA->GetState( ), stack_keys_index, static_cast<int>( key ) );
+	LUA->Insert( -2 );
+	LUA->RawSet( -3 );
+}
+
+// Sets the addontitle and addonwsid fields of the stack level table on top of the stack.
+static void SetStackLevelAddon( GarrysMod::Lua::ILuaBase *LUA, const char *source )
+{
+	const common::AddonIndex::Addon *owner = FindWorkshopAddonFromFile( source != nullptr ? source : "" );
+	if( owner == nullptr )
+		return;
+
+	char wsid[21];
+	LUA->PushString( owner->title.c_str( ) );
+	SetStackField( LUA, StackKey::AddonTitle );
+
+	LUA->PushString( common::FormatWorkshopId( owner->wsid, wsid ) );
+	SetStackField( LUA, StackKey::AddonWorkshopId );
+}
+
+// Source, current line and name of every level of the erroring Lua stack. These point into strings
+// owned by the functions on the stack, so they're only valid while the error is being reported.
+static common::SmallVector<common::ParsedErrorWithStackTraceView::StackFrame, 32> native_stack;
+
+static void CaptureNativeStack( GarrysMod::Lua::ILuaInterface *lua )
+{
+	native_stack.clear( );
+
+	int32_t lvl = 0;
+	lua_Debug dbg;
+	while( lua->GetStack( lvl, &dbg ) == 1 && lua->GetInfo( "Sln", &dbg ) == 1 )
+	{
+		common::ParsedErrorWithStackTraceView::StackFrame frame;
+		frame.level = ++lvl;
+		frame.name = dbg.name != nullptr ? dbg.name : "";
+		frame.source = dbg.source != nullptr ? dbg.source : "";
+		frame.currentline = dbg.currentline;
+		native_stack.push_back( frame );
+	}
+}
+
+// Bytes charged to the capture budget by the stack levels pushed since it was last cleared.
+static size_t captured_bytes = 0;
+
+// Room in the hash part of level tables: the lua_Debug fields, func, activelines, upvalues, locals
+// and the addon fields.
+static constexpr int32_t stack_level_fields = 16;
+
+// Sets the lua_Debug fields every stack level has on the table at the top of the stack.
+static void SetStackLevelFields( GarrysMod::Lua::ILuaInterface *lua, const lua_Debug &dbg )
+{
+	lua->PushNumber( dbg.event );
+	SetStackField( lua, StackKey::Event );
+
+	lua->PushString( dbg.name != nullptr ? dbg.name : "" );
+	SetStackField( lua, StackKey::Name );
+
+	lua->PushString( dbg.namewhat != nullptr ? dbg.namewhat : "" );
+	SetStackField( lua, StackKey::NameWhat );
+
+	lua->PushString( dbg.what != nullptr ? dbg.what : "" );
+	SetStackField( lua, StackKey::What );
+
+	lua->PushString( dbg.source != nullptr ? dbg.source : "" );
+	SetStackField( lua, StackKey::Source );
+
+	lua->PushNumber( dbg.currentline );
+	SetStackField( lua, StackKey::CurrentLine );
+
+	lua->PushNumber( dbg.nups );
+	SetStackField( lua, StackKey::Nups );
+
+	lua->PushNumber( dbg.linedefined );
+	SetStackField( lua, StackKey::LineDefined );
+
+	lua->PushNumber( dbg.lastlinedefined );
+	SetStackField( lua, StackKey::LastLineDefined );
+
+	lua->PushString( dbg.short_src );
+	SetStackField( lua, StackKey::ShortSource );
+
+	captured_bytes += sizeof( lua_Debug ) +
+		( dbg.name != nullptr ? std::strlen( dbg.name ) : 0 ) +
+		( dbg.source != nullptr ? std::strlen( dbg.source ) : 0 );
+}
+
+// Pushes the table of stack level lvl (0 based), returns false if there's no such level.
+static bool PushFullStackLevel( GarrysMod::Lua::ILuaInterface *lua, const int32_t lvl )
+{
+	lua_Debug dbg;
+	if( lua->GetStack( lvl, &dbg ) != 1 || lua->GetInfo( "SfLlnu", &dbg ) != 1 )
+		return false;
+
+	// GetInfo pushed the function and its activelines
+	CreateStackTable( lua, StackTable::Level, 0, stack_level_fields );
+
+	if( GetUpvalues( lua, -3 ) )
+		SetStackField( lua, StackKey::Upvalues );
+
+	if( GetLocals( lua, dbg ) )
+		SetStackField( lua, StackKey::Locals );
+
+	lua->Push( -3 );
+	SetStackField( lua, StackKey::Func );
+
+	lua->Push( -2 );
+	SetStackField( lua, StackKey::ActiveLines );
+
+	SetStackLevelFields( lua, dbg );
+
+	SetStackLevelAddon( lua, dbg.source );
+
+	// Move the level below activelines and func, then pop them
+	lua->Insert( -3 );
+	lua->Pop( 2 );
+	return true;
+}
+
+typedef bool ( *PushStackLevelFunction )( GarrysMod::Lua::ILuaInterface *lua, int32_t lvl );
+
+static bool fold_stack = false;
+static std::vector<uint64_t> stack_frame_hashes;
+static std::vector<common::StackGroup> stack_groups;
+
+// Number of levels of the Lua stack, to size the stack tables.
+static int32_t CountStackLevels( GarrysMod::Lua::ILuaInterface *lua )
+{
+	int32_t depth = 0;
+	lua_Debug dbg;
+	while( lua->GetStack( depth, &dbg ) == 1 )
+		++depth;
+
+	return depth;
+}
+
+// Pushes the stack levels as a list or, with folding enabled, as a list of groups of levels
+// repeated back to back: {level = first level, repeats = times repeated, [1] = level, ...}.
+// depth is how many levels push_level will find.
+static void PushStackLevels( GarrysMod::Lua::ILuaInterface *lua, const PushStackLevelFunction push_level, const int32_t depth )
+{
+	if( !fold_stack )
+	{
+		CreateStackTable( lua, StackTable::Stack, depth, 0 );
+
+		int32_t lvl = 0;
+		while( push_level( lua, lvl ) )
+		{
+			lua->PushNumber( ++lvl );
+			lua->Insert( -2 );
+			lua->SetTable( -3 );
+		}
+
+		return;
+	}
+
+	CaptureNativeStack( lua );
+	common::FoldStackTrace( native_stack, stack_frame_hashes, stack_groups );
+	CreateStackTable( lua, StackTable::Stack, static_cast<int32_t>( stack_groups.size( ) ), 0 );
+	for( size_t k = 0; k < stack_groups.size( ); ++k )
+	{
+		const common::StackGroup &group = stack_groups[k];
+
+		lua->PushNumber( static_cast<double>( k + 1 ) );
+		CreateStackTable( lua, StackTable::Group, static_cast<int32_t>( group.length ), 2 );
+
+		lua->PushNumber( static_cast<double>( group.first + 1 ) );
+		SetStackField( lua, StackKey::Level );
+
+		lua->PushNumber( static_cast<double>( group.repeats ) );
+		SetStackField( lua, StackKey::Repeats );
+
+		for( size_t l = 0; l < group.length && push_level( lua, static_cast<int32_t>( group.first + l ) ); ++l )
+		{
+			lua->PushNumber( static_cast<double>( l + 1 ) );
+			lua->Insert( -2 );
+			lua->SetTable( -3 );
+		}
+
+		lua->SetTable( -3 );
+	}
+}
+
+static void PushFullStackTable( GarrysMod::Lua::ILuaInterface *lua )
+{
+	PushStackLevels( lua, PushFullStackLevel, CountStackLevels( lua ) );
+}
+
+// Lazy stacks only copy the cheap lua_Debug fields into each level table, locals, upvalues and
+// activelines are built by the level metatable's __index when a handler first reads them.
+// Locals can only be read while the erroring frames are still alive, so the lua_Debug of every
+// level is kept natively until the error is done being reported (see LiveStackScope).
+struct LiveStack
+{
+	uint32_t generation = 0;
+	// the levels are only meaningful on the state they were captured on (i_ci indexes its calls)
+	lua_State *state = nullptr;
+	std::vector<lua_Debug> levels;
+};
+
+static std::vector<LiveStack> live_stacks;
+static size_t live_stacks_count = 0;
+static uint32_t live_stacks_generation = 0;
+
+// LuaJIT stacks hold at most 65500 slots, this just keeps level ids exact as Lua numbers.
+static constexpr uint64_t stack_level_limit = 1 << 20;
+
+// Ends the lifetime of every live stack captured since its construction.
+class LiveStackScope
+{
+public:
+	LiveStackScope( ) :
+		count( live_stacks_count )
+	{ }
+
+	~LiveStackScope( )
+	{
+		live_stacks_count = count;
+	}
+
+private:
+	size_t count;
+};
+
+// Pushes the table of level lvl (0 based) of the live stack captured last.
+static bool PushLazyStackLevel( GarrysMod::Lua::ILuaInterface *lua, const int32_t lvl )
+{
+	const LiveStack &live_stack = live_stacks[live_stacks_count - 1];
+	if( lvl < 0 || static_cast<size_t>( lvl ) >= live_stack.levels.size( ) )
+		return false;
+
+	// pushes the function of the level
+	lua_Debug dbg = live_stack.levels[lvl];
+	if( lua->GetInfo( "f", &dbg ) != 1 )
+		return false;
+
+	CreateStackTable( lua, StackTable::Level, 0, stack_level_fields );
+
+	lua->Push( -2 );
+	SetStackField( lua, StackKey::Func );
+
+	SetStackLevelFields( lua, dbg );
+
+	stack_level_meta.Push( );
+	lua->SetMetaTable( -2 );
+
+	// stack_level_ids[level] = generation * stack_level_limit + level number
+	stack_level_ids.Push( );
+	lua->Push( -2 );
+	lua->PushNumber( static_cast<double>( live_stack.generation * stack_level_limit + static_cast<uint64_t>( lvl ) + 1 ) );
+	lua->RawSet( -3 );
+	lua->Pop( 1 );
+
+	// Pop func
+	lua->Remove( -2 );
+	return true;
+}
+
+static void PushLazyStackTable( GarrysMod::Lua::ILuaInterface *lua )
+{
+	if( live_stacks_count == live_stacks.size( ) )
+		live_stacks.emplace_back( );
+
+	LiveStack &live_stack = live_stacks[live_stacks_count++];
+	live_stack.generation = ++live_stacks_generation;
+	live_stack.state = lua->GetState( );
+	live_stack.levels.clear( );
+
+	int32_t lvl = 0;
+	lua_Debug dbg;
+	while( lvl < static_cast<int32_t>( stack_level_limit ) - 1 &&
+		lua->GetStack( lvl, &dbg ) == 1 && lua->GetInfo( "Slnu", &dbg ) == 1 )
+	{
+		live_stack.levels.push_back( dbg );
+		++lvl;
+	}
+
+	PushStackLevels( lua, PushLazyStackLevel, static_cast<int32_t>( live_stack.levels.size( ) ) );
+}
+
 static void PushStackTable( GarrysMod::Lua::ILuaInterface *lua )
 {
-	lua->CreateTable( );
+	if( lazy_stack )
+		PushLazyStackTable( lua );
+	else
+		PushFullStackTable( lua );
+}
+
+// Only the fields of the level, for captures the budget stepped down from the full stack.
+static bool PushFrameStackLevel( GarrysMod::Lua::ILuaInterface *lua, const int32_t lvl )
+{
+	lua_Debug dbg;
+	if( lua->GetStack( lvl, &dbg ) != 1 || lua->GetInfo( "Slnu", &dbg ) != 1 )
+		return false;
+
+	CreateStackTable( lua, StackTable::Level, 0, stack_level_fields );
+	SetStackLevelFields( lua, dbg );
+	SetStackLevelAddon( lua, dbg.source );
+	return true;
+}
+
+// Only the level that raised the error, in the same layout PushStackLevels would use.
+static void PushTopStackTable( GarrysMod::Lua::ILuaInterface *lua )
+{
+	CreateStackTable( lua, StackTable::Stack, 1, 0 );
+	if( !PushFrameStackLevel( lua, 0 ) )
+		return;
+
+	if( fold_stack )
+	{
+		CreateStackTable( lua, StackTable::Group, 1, 2 );
+
+		lua->PushNumber( 1 );
+		SetStackField( lua, StackKey::Level );
+
+		lua->PushNumber( 1 );
+		SetStackField( lua, StackKey::Repeats );
+
+		lua->Insert( -2 );
+		lua->PushNumber( 1 );
+		lua->Insert( -2 );
+		lua->SetTable( -3 );
+	}
+
+	lua->PushNumber( 1 );
+	lua->Insert( -2 );
+	lua->SetTable( -3 );
+}
+
+// Pushes the stack at the level the capture budget allows for this tick and charges it.
+static common::CaptureBudget::Level PushCapturedStack( GarrysMod::Lua::ILuaInterface *lua )
+{
+	const common::CaptureBudget::Level level = capture_budget.Select( );
+	const auto start = common::CaptureBudget::Clock::now( );
+	captured_bytes = 0;
+
+	{
+		StackTableScope stack_table_scope( lua, StackPool::Lua, lua_stats );
+		switch( level )
+		{
+			case common::CaptureBudget::Level::Full:
+				PushStackTable( lua );
+				break;
+
+			case common::CaptureBudget::Level::Frames:
+				PushStackLevels( lua, PushFrameStackLevel, CountStackLevels( lua ) );
+				break;
+
+			case common::CaptureBudget::Level::TopFrame:
+				PushTopStackTable( lua );
+				break;
+		}
+	}
+
+	capture_budget.Spend( level, common::CaptureBudget::Clock::now( ) - start, captured_bytes );
+	return level;
+}
+
+// Finds the lua_Debug of a lazy stack level, only while its frame is alive.
+static const lua_Debug *FindLiveStackLevel( GarrysMod::Lua::ILuaBase *LUA, int32_t level_index )
+{
+	stack_level_ids.Push( );
+	LUA->Push( level_index );
+	LUA->RawGet( -2 );
+	const bool found = LUA->IsType( -1, GarrysMod::Lua::Type::NUMBER );
+	const uint64_t id = found ? static_cast<uint64_t>( LUA->GetNumber( -1 ) ) : 0;
+	LUA->Pop( 2 );
+	if( !found )
+		return nullptr;
+
+	const uint64_t generation = id / stack_level_limit;
+	const size_t level = static_cast<size_t>( id % stack_level_limit );
+	for( size_t k = 0; k < live_stacks_count; ++k )
+	{
+		const LiveStack &live_stack = live_stacks[k];
+		if( live_stack.generation != generation || level < 1 || level > live_stack.levels.size( ) )
+			continue;
+
+		// read from another coroutine, whose calls aren't the ones the level was captured from
+		return live_stack.state == LUA->GetState( ) ? &live_stack.levels[level - 1] : nullptr;
+	}
+
+	return nullptr;
+}
+
+LUA_FUNCTION_STATIC( StackLevelIndex )
+{
+	if( !LUA->IsType( 2, GarrysMod::Lua::Type::STRING ) )
+		return 0;
+
+	const auto lua = static_cast<GarrysMod::Lua::ILuaInterface *>( LUA );
+	const std::string_view key = LUA->GetString( 2 );
+	if( key == "locals" )
+	{
+		const lua_Debug *live_dbg = FindLiveStackLevel( LUA, 1 );
+		if( live_dbg == nullptr )
+			return 0;
+
+		lua_Debug dbg = *live_dbg;
+		if( !GetLocals( lua, dbg ) )
+			return 0;
+	}
+	else if( key == "addontitle" || key == "addonwsid" )
+	{
+		// attributed on first read too, most handlers only care about the addon of the error
+		LUA->PushString( "source" );
+		LUA->RawGet( 1 );
+		const char *source = LUA->IsType( -1, GarrysMod::Lua::Type::STRING ) ? LUA->GetString( -1 ) : nullptr;
+		LUA->Pop( 1 );
+
+		LUA->Push( 1 );
+		SetStackLevelAddon( LUA, source );
+		LUA->Pop( 1 );
+
+		LUA->Push( 2 );
+		LUA->RawGet( 1 );
+		return 1;
+	}
+	else if( key == "upvalues" || key == "activelines" )
+	{
+		LUA->PushString( "func" );
+		LUA->RawGet( 1 );
+		if( !LUA->IsType( -1, GarrysMod::Lua::Type::FUNCTION ) )
+			return 0;
+
+		if( key == "upvalues" )
+		{
+			const bool has_upvalues = GetUpvalues( lua, -1 );
+			LUA->Remove( has_upvalues ? -2 : -1 );
+			if( !has_upvalues )
+				return 0;
+		}
+		else
+		{
+			// pops the function and pushes its activelines table
+			lua_Debug dbg;
+			if( lua->GetInfo( ">L", &dbg ) != 1 )
+				return 0;
+		}
+	}
+	else
+		return 0;
+
+	// Cache it, so it's built only once per level
+	LUA->Push( 2 );
+	LUA->Push( -2 );
+	LUA->RawSet( 1 );
+	return 1;
+}
+
+// Fingerprints the error together with the source and current line of every stack level.
+static uint64_t FingerprintError( GarrysMod::Lua::ILuaInterface *lua, const std::string &error )
+{
+	common::ParsedErrorView parsed_error;
+	if( !common::ParseError( std::string_view( error ), parsed_error ) )
+		parsed_error.error_string = error;
+
+	uint64_t fingerprint = common::FingerprintError(
+		parsed_error.source_file,
+		parsed_error.source_line,
+		parsed_error.error_string
+	);
+
+	int32_t lvl = 0;
+	lua_Debug dbg;
+	while( lua->GetStack( lvl++, &dbg ) == 1 && lua->GetInfo( "Sl", &dbg ) == 1 )
+		fingerprint = common::FingerprintStackFrame(
+			fingerprint,
+			dbg.source != nullptr ? dbg.source : "",
+			dbg.currentline
+		);
+
+	return fingerprint;
+}
+
+// Copies the error and the last captured native stack into the async pipeline.
+// Parsing, fingerprinting and addon attribution happen on its worker thread.
+static void QueueAsyncError( const std::string &error, const bool is_runtime )
+{
+	common::AsyncErrorPipeline::Record *record = async_pipeline.Prepare( );
+	if( record == nullptr )
+	{
+		++lua_stats.dropped;
+		return;
+	}
+
+	record->error = error;
+	record->runtime = is_runtime;
+	record->client = -1;
+	record->parsed_error.addon_name.clear( );
+
+	auto &stack_trace = record->parsed_error.stack_trace;
+	if( stack_trace.size( ) < native_stack.size( ) )
+		stack_trace.resize( native_stack.size( ) );
+
+	for( size_t k = 0; k < native_stack.size( ); ++k )
+	{
+		const auto &native_frame = native_stack[k];
+		auto &frame = stack_trace[k];
+		frame.level = native_frame.level;
+		frame.name = native_frame.name;
+		frame.source = native_frame.source;
+		frame.currentline = native_frame.currentline;
+	}
+
+	// drop whatever is left from a deeper error that used this record before
+	stack_trace.erase( stack_trace.begin( ) + static_cast<std::ptrdiff_t>( native_stack.size( ) ), stack_trace.end( ) );
+	async_pipeline.Push( );
+}
+
+// hook.Run and the table of hooks are kept in the registry instead of being looked up by name on
+// every error. They're looked up again every second, in case the hook library gets replaced.
+static GarrysMod::Lua::AutoReference hook_run;
+static GarrysMod::Lua::AutoReference hook_table;
+static std::chrono::steady_clock::time_point hook_references_checked;
+static constexpr std::chrono::seconds hook_references_check_interval( 1 );
+// set by luaerror.SetHandler, receives every hook luaerror would call instead of hook.Run
+static GarrysMod::Lua::AutoReference error_handler;
+
+static void UpdateHookReferences( GarrysMod::Lua::ILuaInterface *lua )
+{
+	const auto now = std::chrono::steady_clock::now( );
+	if( hook_run.IsValid( ) && now - hook_references_checked < hook_references_check_interval )
+		return;
+
+	hook_references_checked = now;
+	hook_run.Free( );
+	hook_table.Free( );
+
+	lua->GetField( GarrysMod::Lua::INDEX_GLOBAL, "hook" );
+	if( !lua->IsType( -1, GarrysMod::Lua::Type::TABLE ) )
+	{
+		lua->Pop( 1 );
+		return;
+	}
+
+	lua->GetField( -1, "Run" );
+	if( lua->IsType( -1, GarrysMod::Lua::Type::FUNCTION ) )
+		hook_run.Create( );
+	else
+		lua->Pop( 1 );
+
+	// Only trust the table if hook.GetTable hands out the same one every time, some replacements
+	// of the hook library return a copy built from their own storage
+	lua->GetField( -1, "GetTable" );
+	if( lua->IsType( -1, GarrysMod::Lua::Type::FUNCTION ) )
+	{
+		lua->Push( -1 );
+		if( lua->PCall( 0, 1, 0 ) == 0 )
+		{
+			lua->Push( -2 );
+			const bool called = lua->PCall( 0, 1, 0 ) == 0;
+			const bool same = called && lua->IsType( -1, GarrysMod::Lua::Type::TABLE ) && lua->RawEqual( -1, -2 ) != 0;
+			lua->Pop( 1 );
+			if( same )
+				hook_table.Create( );
+			else
+				lua->Pop( 1 );
+		}
+		else
+			lua->Pop( 1 );
+	}
+
+	lua->Pop( 2 );
+}
+
+bool HasHookListeners( GarrysMod::Lua::ILuaInterface *lua, const char *name )
+{
+	if( error_handler.IsValid( ) )
+		return true;
+
+	UpdateHookReferences( lua );
+	if( !hook_run.IsValid( ) )
+		return false;
+
+	// without a table we can trust, there's no telling
+	if( !hook_table.IsValid( ) )
+		return true;
+
+	bool listening = false;
+	hook_table.Push( );
+	lua->GetField( -1, name );
+	if( lua->IsType( -1, GarrysMod::Lua::Type::TABLE ) )
+	{
+		lua->PushNil( );
+		if( lua->Next( -2 ) != 0 )
+		{
+			listening = true;
+			lua->Pop( 2 );
+		}
+	}
+
+	lua->Pop( 2 );
+	if( listening )
+		return true;
+
+	// hook.Run falls back to the gamemode function with the same name
+	lua->GetField( GarrysMod::Lua::INDEX_GLOBAL, "GAMEMODE" );
+	if( lua->IsType( -1, GarrysMod::Lua::Type::TABLE ) )
+	{
+		lua->GetField( -1, name );
+		listening = lua->IsType( -1, GarrysMod::Lua::Type::FUNCTION );
+		lua->Pop( 1 );
+	}
+
+	lua->Pop( 1 );
+	return listening;
+}
+
+int32_t PushHookRun( GarrysMod::Lua::ILuaInterface *lua, const char *name )
+{
+	if( error_handler.IsValid( ) )
+		error_handler.Push( );
+	else
+	{
+		UpdateHookReferences( lua );
+		if( !hook_run.IsValid( ) )
+			return LuaHelpers::PushHookRun( lua, name );
+
+		hook_run.Push( );
+	}
+
+	lua->PushString( name );
+	return 2;
+}
+
+// Whether any of the background sinks (journal, exporter) is taking errors.
+static bool HasErrorSinks( )
+{
+	return journal.IsOpen( ) || exporter.IsOpen( );
+}
+
+// Stages the error and the last captured native stack for the threads of the background sinks.
+static void AppendToErrorSinks( const std::string &error, const bool is_runtime )
+{
+	const uint64_t time = common::JournalWriter::Now( );
+	const common::Span<const common::ParsedErrorWithStackTraceView::StackFrame> stack( native_stack.begin( ), native_stack.size( ) );
+	if( journal.IsOpen( ) )
+		journal.Append( time, is_runtime, -1, error, stack );
+
+	if( exporter.IsOpen( ) )
+		exporter.Append( time, is_runtime, -1, error, stack );
+}
+
+// Ring of the last errors of this realm and the clients, read back with luaerror.GetRecent.
+static common::RecentErrors recent_errors;
+static constexpr size_t recent_errors_limit = 65536;
+static constexpr size_t recent_slot_bytes_min = 256;
+static constexpr size_t recent_slot_bytes_max = 65536;
+
+// Most frequent errors by fingerprint, source file and addon, read with luaerror.TopErrors.
+static common::HeavyHitters top_fingerprints;
+static common::HeavyHitters top_files;
+static common::HeavyHitters top_addons;
+static std::vector<const common::HeavyHitters::Counter *> top_counters;
+static constexpr size_t top_errors_limit = 4096;
+
+// Whether the recent errors or the top errors want to see every error.
+static bool IsRecordingErrors( )
+{
+	return recent_errors.IsEnabled( ) || top_fingerprints.IsEnabled( );
+}
+
+static void RecordError( const common::RecentErrors::Error &error, const common::Span<const common::ParsedErrorWithStackTraceView::StackFrame> stack )
+{
+	recent_errors.Record( error, stack );
+
+	if( !top_fingerprints.IsEnabled( ) )
+		return;
+
+	// the fingerprint itself says nothing, so it's labeled with the error it was computed from
+	char label[256];
+	const int length = error.source_file.empty( ) ?
+		std::snprintf( label, sizeof( label ), "%.*s", static_cast<int>( error.error_string.size( ) ), error.error_string.data( ) ) :
+		std::snprintf( label, sizeof( label ), "%.*s:%d: %.*s",
+			static_cast<int>( error.source_file.size( ) ), error.source_file.data( ),
+			error.source_line,
+			static_cast<int>( error.error_string.size( ) ), error.error_string.data( )
+		);
+	top_fingerprints.Add( error.fingerprint, std::string_view( label, std::min( static_cast<size_t>( std::max( length, 0 ) ), sizeof( label ) - 1 ) ) );
+
+	if( !error.source_file.empty( ) )
+		top_files.Add( common::Hash( error.source_file ), error.source_file );
+
+	// keyed by title so errors of the same addon from clients (which only send its name) add up
+	if( !error.addon_title.empty( ) )
+		top_addons.Add( common::Hash( error.addon_title ), error.addon_title );
+}
+
+// Records the error with the last captured native stack in the ring of recent errors and the top
+// errors.
+static void RecordLuaError( const std::string &error, const bool is_runtime )
+{
+	common::ParsedErrorView parsed_error;
+	if( !common::ParseError( std::string_view( error ), parsed_error ) )
+		parsed_error.error_string = error;
+
+	common::RecentErrors::Error recent;
+	recent.time = common::JournalWriter::Now( );
+	recent.runtime = is_runtime;
+	recent.error = error;
+	recent.source_file = parsed_error.source_file;
+	recent.source_line = parsed_error.source_line;
+	recent.error_string = parsed_error.error_string;
+
+	// same fingerprint as the duplicate filter computes from the live stack
+	recent.fingerprint = common::FingerprintError(
+		parsed_error.source_file,
+		parsed_error.source_line,
+		parsed_error.error_string
+	);
+	for( const auto &frame : native_stack )
+		recent.fingerprint = common::FingerprintStackFrame( recent.fingerprint, frame.source, frame.currentline );
+
+	const common::AddonIndex::Addon *owner = FindWorkshopAddonFromFile( parsed_error.source_file );
+	if( owner != nullptr )
+	{
+		recent.addon_title = owner->title;
+		recent.addon_wsid = owner->wsid;
+	}
+
+	RecordError( recent, common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( native_stack.begin( ), native_stack.size( ) ) );
+}
+
+LUA_FUNCTION_STATIC( AdvancedLuaErrorReporter_d )
+{
+	const char *errstr = LUA->GetString( 1 );
+
+	runtime = true;
+
+	if( errstr != nullptr )
+		runtime_error = errstr;
+	else
+		runtime_error.clear( );
+
+	++lua_stats.seen;
+	lua_stats.bytes += runtime_error.size( );
+
+	const auto lua = static_cast<GarrysMod::Lua::ILuaInterface *>( LUA );
+	const bool sinking = HasErrorSinks( );
+	const bool recording = IsRecordingErrors( );
+	if( async_enabled || sinking || recording )
+	{
+		common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::StackCapture] );
+		CaptureNativeStack( lua );
+	}
+
+	if( sinking )
+		AppendToErrorSinks( runtime_error, true );
+
+	if( recording )
+		RecordLuaError( runtime_error, true );
+
+	if( async_enabled )
+	{
+		// errors thrown by the batch hooks themselves aren't queued, just like the synchronous hook
+		if( !delivering_async )
+			QueueAsyncError( runtime_error, true );
+
+		return AdvancedLuaErrorReporter_detour.GetTrampoline<GarrysMod::Lua::CFunc>( )( LUA->GetState( ) );
+	}
+
+	// nothing would receive it, so there's no stack to capture or repeat to look for
+	runtime_listening = HasHookListeners( lua, "LuaError" );
+	if( !runtime_listening )
+		return AdvancedLuaErrorReporter_detour.GetTrampoline<GarrysMod::Lua::CFunc>( )( LUA->GetState( ) );
+
+	// Lazy stack levels can read their locals until the error has been reported
+	LiveStackScope live_stack_scope;
+
+	// Decide now whether this is a repeat, so we don't build a stack table just to throw it away
+	{
+		common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::Parse] );
+		runtime_fingerprint = FingerprintError( lua, runtime_error );
+	}
+
+	runtime_suppressed = !duplicate_filter.Check(
+		runtime_fingerprint,
+		common::DuplicateFilter::Clock::now( ),
+		runtime_repeats
+	);
+	if( runtime_suppressed )
+		++lua_stats.suppressed;
+	else
+	{
+		common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::StackCapture] );
+		runtime_capture = PushCapturedStack( lua );
+		runtime_stack.Create( );
+	}
+
+	return AdvancedLuaErrorReporter_detour.GetTrampoline<GarrysMod::Lua::CFunc>( )( LUA->GetState( ) );
+}
+
+// Releases a stack pool when it goes out of scope.
+class StackPoolRelease
+{
+public:
+	explicit StackPoolRelease( const StackPool stack_pool ) :
+		pool( stack_pool )
+	{ }
+
+	~StackPoolRelease( )
+	{
+		ReleaseStackPool( pool );
+	}
+
+	StackPoolRelease( const StackPoolRelease & ) = delete;
+	StackPoolRelease &operator=( const StackPoolRelease & ) = delete;
+
+private:
+	StackPool pool;
+};
+
+// Ends the runtime error AdvancedLuaErrorReporter_d handed to LuaError, however LuaError returns,
+// so the next error isn't taken for it.
+class RuntimeErrorScope
+{
+public:
+	RuntimeErrorScope( ) = default;
+
+	~RuntimeErrorScope( )
+	{
+		runtime = false;
+		runtime_stack.Free( );
+	}
+
+	RuntimeErrorScope( const RuntimeErrorScope & ) = delete;
+	RuntimeErrorScope &operator=( const RuntimeErrorScope & ) = delete;
+};
+
+class CLuaGameCallback : public GarrysMod::Lua::ILuaGameCallback
+{
+public:
+	CLuaGameCallback( ) :
+		lua( nullptr ),
+		callback( nullptr )
+	{ }
+
+	~CLuaGameCallback( )
+	{
+		Reset( );
+	}
+
+	GarrysMod::Lua::ILuaObject *CreateLuaObject( )
+	{
+		return callback->CreateLuaObject( );
+	}
+
+	void DestroyLuaObject( GarrysMod::Lua::ILuaObject *obj )
+	{
+		callback->DestroyLuaObject( obj );
+	}
+
+	void ErrorPrint( const char *error, bool print )
+	{
+		callback->ErrorPrint( error, print );
+	}
+
+	void Msg( const char *msg, bool useless )
+	{
+		callback->Msg( msg, useless );
+	}
+
+	void MsgColour( const char *msg, const Color &color )
+	{
+		callback->MsgColour( msg, color );
+	}
+
+	void LuaError( const CLuaError *error )
+	{
+		const RuntimeErrorScope runtime_error_scope;
+		const std::string &error_str = runtime ? runtime_error : error->message;
+
+		// runtime errors were counted and handed to the sinks by AdvancedLuaErrorReporter_d already
+		if( !runtime )
+		{
+			++lua_stats.seen;
+			lua_stats.bytes += error_str.size( );
+		}
+
+		const bool sinking = !runtime && HasErrorSinks( );
+		const bool recording = !runtime && IsRecordingErrors( );
+		if( sinking || recording || ( !runtime && async_enabled && !delivering_async ) )
+		{
+			common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::StackCapture] );
+			CaptureNativeStack( lua );
+		}
+
+		if( sinking )
+			AppendToErrorSinks( error_str, false );
+
+		if( recording )
+			RecordLuaError( error_str, false );
+
+		// Runtime errors were queued by AdvancedLuaErrorReporter_d already, the batch hook can't
+		// stop the engine from printing errors since it only runs on a later tick
+		if( async_enabled )
+		{
+			if( !runtime && !delivering_async )
+				QueueAsyncError( error_str, false );
+
+			return callback->LuaError( error );
+		}
+
+		if( entered_hook )
+			return callback->LuaError( error );
+
+		// the pooled runtime stack is done with once this returns, whether it reached the hook or not
+		StackPoolRelease stack_pool_release( StackPool::Lua );
+
+		// runtime errors were checked by AdvancedLuaErrorReporter_d, which skipped their stack
+		const bool listening = runtime ? runtime_listening && !runtime_suppressed : HasHookListeners( lua, "LuaError" );
+		if( !listening )
+			return callback->LuaError( error );
+
+		// views into error_str, which outlives the dispatch
+		common::ParsedErrorView parsed_error;
+		bool parsed = false;
+		{
+			common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::Parse] );
+			parsed = common::ParseError( std::string_view( error_str ), parsed_error );
+		}
+
+		if( !parsed )
+			return callback->LuaError( error );
+
+		uint64_t fingerprint = runtime_fingerprint;
+		uint32_t repeats = runtime_repeats;
+		if( !runtime )
+		{
+			{
+				common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::Parse] );
+				fingerprint = FingerprintError( lua, error_str );
+			}
+
+			if( !duplicate_filter.Check( fingerprint, common::DuplicateFilter::Clock::now( ), repeats ) )
+			{
+				++lua_stats.suppressed;
+				return callback->LuaError( error );
+			}
+		}
+
+		const int32_t funcs = PushHookRun( lua, "LuaError" );
+		if( funcs == 0 )
+			return callback->LuaError( error );
+
+		LiveStackScope live_stack_scope;
+		common::ErrorArena::Scope arena_scope( lua_arena );
+
+		lua->PushBool( runtime );
+		lua->PushString( error_str.c_str( ) );
+
+		lua->PushString( lua_arena.CopyString( parsed_error.source_file ) );
+		lua->PushNumber( parsed_error.source_line );
+		lua->PushString( lua_arena.CopyString( parsed_error.error_string ) );
+
+		common::CaptureBudget::Level capture = runtime_capture;
+		if( runtime )
+		{
+			runtime_stack.Push( );
+			runtime_stack.Free( );
+		}
+		else
+		{
+			common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::StackCapture] );
+			capture = PushCapturedStack( lua );
+		}
+
+		runtime = false;
+
+		const common::AddonIndex::Addon *source_addon = nullptr;
+		{
+			common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::AddonLookup] );
+			source_addon = FindWorkshopAddonFromFile( parsed_error.source_file );
+		}
+
+		if( source_addon == nullptr )
+		{
+			lua->PushNil( );
+			lua->PushNil( );
+		}
+		else
+		{
+			char wsid[21];
+			lua->PushString( source_addon->title.c_str( ) );
+			lua->PushString( common::FormatWorkshopId( source_addon->wsid, wsid ) );
+		}
+
+		lua->PushNumber( repeats );
+
+		char fingerprint_str[17];
+		common::FormatFingerprint( fingerprint, fingerprint_str );
+		lua->PushString( fingerprint_str );
+
+		lua->PushString( common::CaptureBudget::GetLevelName( capture ) );
+		PushSourceContext( lua, parsed_error.source_file, parsed_error.source_line );
+		PushErrorTemplate( lua, parsed_error.error_string );
+
+		entered_hook = true;
+		bool call_success = false;
+		{
+			common::ScopedTimer timer( lua_stats.timers[common::ErrorPathStats::HookCall] );
+			call_success = LuaHelpers::CallHookRun( lua, 13, 1 );
+		}
+		entered_hook = false;
+		if( !call_success )
+			return callback->LuaError( error );
+
+		const bool proceed = !lua->IsType( -1, GarrysMod::Lua::Type::BOOL ) || !lua->GetBool( -1 );
+		lua->Pop( 1 );
+		if( proceed )
+			return callback->LuaError( error );
+	}
+
+	void InterfaceCreated( GarrysMod::Lua::ILuaInterface *iface )
+	{
+		callback->InterfaceCreated( iface );
+	}
+
+	void SetLua( GarrysMod::Lua::ILuaInterface *iface )
+	{
+		lua = static_cast<GarrysMod::Lua::CLuaInterface *>( iface );
+		callback = lua->GetLuaGameCallback( );
+	}
+
+	void Detour( )
+	{
+		lua->SetLuaGameCallback( this );
+	}
+
+	void Reset( )
+	{
+		// the destructor runs even if the module was never opened
+		if( lua != nullptr )
+			lua->SetLuaGameCallback( callback );
+	}
+
+private:
+	GarrysMod::Lua::CLuaInterface *lua;
+	GarrysMod::Lua::ILuaGameCallback *callback;
+	bool entered_hook = false;
+};
+
+static CLuaGameCallback callback;
+
+inline void DetourCompiletime( )
+{
+	if( compiletime_detoured )
+		return;
+
+	if( !runtime_detoured )
+		callback.Detour( );
+
+	compiletime_detoured = true;
+}
+
+inline void ResetCompiletime( )
+{
+	if( !compiletime_detoured )
+		return;
+
+	if( !runtime_detoured )
+		callback.Reset( );
+
+	compiletime_detoured = false;
+}
+
+inline void DetourRuntime( )
+{
+	if( runtime_detoured )
+		return;
+
+	if( !compiletime_detoured )
+		callback.Detour( );
+
+	AdvancedLuaErrorReporter_detour.Enable( );
+	runtime_detoured = true;
+}
+
+inline void ResetRuntime( )
+{
+	if( !runtime_detoured )
+		return;
+
+	if( !compiletime_detoured )
+		callback.Reset( );
+
+	AdvancedLuaErrorReporter_detour.Disable( );
+	runtime_detoured = false;
+}
+
+LUA_FUNCTION_STATIC( EnableRuntimeDetour )
+{
+	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+
+	if( LUA->GetBool( 1 ) )
+		DetourRuntime( );
+	else
+		ResetRuntime( );
+
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( EnableCompiletimeDetour )
+{
+	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+
+	if( LUA->GetBool( 1 ) )
+		DetourCompiletime( );
+	else
+		ResetCompiletime( );
+
+	LUA->PushBool( true );
+	return 1;
+}
+
+static void PushAsyncStackFrame(
+	GarrysMod::Lua::ILuaBase *LUA,
+	const common::ParsedErrorWithStackTrace::StackFrame &stack_frame,
+	const bool attribute
+)
+{
+	LUA->CreateTable( );
+
+	LUA->PushString( stack_frame.name.c_str( ) );
+	LUA->SetField( -2, "name" );
+
+	LUA->PushNumber( stack_frame.currentline );
+	LUA->SetField( -2, "currentline" );
+
+	LUA->PushString( stack_frame.source.c_str( ) );
+	LUA->SetField( -2, "source" );
+
+	if( attribute )
+		SetStackLevelAddon( LUA, stack_frame.source.c_str( ) );
+}
+
+// Frames of this realm's errors are attributed too, client frames aren't files of this realm.
+// Folded the same way as PushStackLevels when enabled.
+static void PushAsyncStack( GarrysMod::Lua::ILuaBase *LUA, const common::ParsedErrorWithStackTrace &parsed_error, const bool attribute )
+{
+	const auto &stack_trace = parsed_error.stack_trace;
+
+	LUA->CreateTable( );
+
+	if( !fold_stack )
+	{
+		for( const auto &stack_frame : stack_trace )
+		{
+			LUA->PushNumber( stack_frame.level );
+			PushAsyncStackFrame( LUA, stack_frame, attribute );
+			LUA->SetTable( -3 );
+		}
+
+		return;
+	}
+
+	common::FoldStackTrace( stack_trace, stack_frame_hashes, stack_groups );
+	for( size_t k = 0; k < stack_groups.size( ); ++k )
+	{
+		const common::StackGroup &group = stack_groups[k];
+
+		LUA->PushNumber( static_cast<double>( k + 1 ) );
+		LUA->CreateTable( );
+
+		LUA->PushNumber( stack_trace[group.first].level );
+		LUA->SetField( -2, "level" );
+
+		LUA->PushNumber( static_cast<double>( group.repeats ) );
+		LUA->SetField( -2, "repeats" );
+
+		for( size_t l = 0; l < group.length; ++l )
+		{
+			LUA->PushNumber( static_cast<double>( l + 1 ) );
+			PushAsyncStackFrame( LUA, stack_trace[group.first + l], attribute );
+			LUA->SetTable( -3 );
+		}
+
+		LUA->SetTable( -3 );
+	}
+}
+
+// Same fields as the LuaError hook arguments.
+static void PushAsyncLuaError(
+	GarrysMod::Lua::ILuaBase *LUA,
+	const common::AsyncErrorPipeline::Record &record,
+	const uint32_t repeats
+)
+{
+	const common::ParsedErrorWithStackTrace &parsed_error = record.parsed_error;
+
+	LUA->CreateTable( );
+
+	LUA->PushBool( record.runtime );
+	LUA->SetField( -2, "isruntime" );
+
+	LUA->PushString( record.error.c_str( ) );
+	LUA->SetField( -2, "fullerror" );
+
+	LUA->PushString( parsed_error.source_file.c_str( ) );
+	LUA->SetField( -2, "sourcefile" );
+
+	LUA->PushNumber( parsed_error.source_line );
+	LUA->SetField( -2, "sourceline" );
+
+	LUA->PushString( parsed_error.error_string.c_str( ) );
+	LUA->SetField( -2, "errorstr" );
+
+	PushAsyncStack( LUA, parsed_error, true );
+	LUA->SetField( -2, "stack" );
+
+	if( !record.addon_title.empty( ) )
+	{
+		LUA->PushString( record.addon_title.c_str( ) );
+		LUA->SetField( -2, "addontitle" );
+
+		char wsid[21];
+		LUA->PushString( common::FormatWorkshopId( record.addon_wsid, wsid ) );
+		LUA->SetField( -2, "addonwsid" );
+	}
+
+	LUA->PushNumber( repeats );
+	LUA->SetField( -2, "repeats" );
+
+	char fingerprint_str[17];
+	common::FormatFingerprint( record.fingerprint, fingerprint_str );
+	LUA->PushString( fingerprint_str );
+	LUA->SetField( -2, "fingerprint" );
+
+	// the pipeline only copies the fields of every frame, never locals or upvalues
+	LUA->PushString( common::CaptureBudget::GetLevelName( common::CaptureBudget::Level::Frames ) );
+	LUA->SetField( -2, "capturelevel" );
+
+	PushSourceContext( LUA, parsed_error.source_file, parsed_error.source_line );
+	LUA->SetField( -2, "context" );
+
+	PushErrorTemplate( LUA, parsed_error.error_string );
+	LUA->SetField( -2, "templateid" );
+}
+
+// Same fields as the ClientLuaError hook arguments.
+static void PushAsyncClientError( GarrysMod::Lua::ILuaBase *LUA, const common::AsyncErrorPipeline::Record &record )
+{
+	const common::ParsedErrorWithStackTrace &parsed_error = record.parsed_error;
+
+	LUA->CreateTable( );
+
+	LUA->GetField( GarrysMod::Lua::INDEX_GLOBAL, "Entity" );
+	if( LUA->IsType( -1, GarrysMod::Lua::Type::FUNCTION ) )
+	{
+		LUA->PushNumber( record.client );
+		LUA->Call( 1, 1 );
+		LUA->SetField( -2, "player" );
+	}
+	else
+		LUA->Pop( 1 );
+
+	LUA->PushString( record.error.c_str( ) );
+	LUA->SetField( -2, "fullerror" );
+
+	LUA->PushString( parsed_error.source_file.c_str( ) );
+	LUA->SetField( -2, "sourcefile" );
+
+	LUA->PushNumber( parsed_error.source_line );
+	LUA->SetField( -2, "sourceline" );
+
+	LUA->PushString( parsed_error.error_string.c_str( ) );
+	LUA->SetField( -2, "errorstr" );
+
+	PushAsyncStack( LUA, parsed_error, false );
+	LUA->SetField( -2, "stack" );
+
+	if( !parsed_error.addon_name.empty( ) )
+	{
+		LUA->PushString( parsed_error.addon_name.c_str( ) );
+		LUA->SetField( -2, "addonname" );
+	}
+
+	char fingerprint_str[17];
+	common::FormatFingerprint( record.fingerprint, fingerprint_str );
+	LUA->PushString( fingerprint_str );
+	LUA->SetField( -2, "fingerprint" );
+
+	PushSourceContext( LUA, parsed_error.source_file, parsed_error.source_line );
+	LUA->SetField( -2, "context" );
+
+	PushErrorTemplate( LUA, parsed_error.error_string );
+	LUA->SetField( -2, "templateid" );
+}
+
+static void CallBatchHook(
+	GarrysMod::Lua::ILuaInterface *lua,
+	const char *name,
+	const int32_t errors_index,
+	common::ErrorPathStats &stats
+)
+{
+	if( PushHookRun( lua, name ) == 0 )
+		return;
+
+	lua->Push( errors_index );
+
+	common::ScopedTimer timer( stats.timers[common::ErrorPathStats::HookCall] );
+	LuaHelpers::CallHookRun( lua, 1, 0 );
+}
+
+// Hands up to max_records processed errors to LuaErrorBatch and ClientLuaErrorBatch.
+static void DeliverAsyncErrors( GarrysMod::Lua::ILuaInterface *lua, const size_t max_records )
+{
+	lua->CreateTable( );
+	lua->CreateTable( );
+	const int32_t client_errors = lua->Top( );
+	const int32_t lua_errors = client_errors - 1;
+
+	// records nobody would receive are drained all the same
+	const bool lua_listening = HasHookListeners( lua, "LuaErrorBatch" );
+	const bool client_listening = HasHookListeners( lua, "ClientLuaErrorBatch" );
+
+	size_t lua_count = 0, client_count = 0;
+	async_pipeline.Drain( [&]( const common::AsyncErrorPipeline::Record &record )
+	{
+		// the synchronous hooks aren't called for errors that can't be parsed either
+		if( !record.parsed || !( record.client >= 0 ? client_listening : lua_listening ) )
+			return;
+
+		if( record.client >= 0 )
+		{
+			lua->PushNumber( static_cast<double>( ++client_count ) );
+			PushAsyncClientError( lua, record );
+			lua->SetTable( client_errors );
+			return;
+		}
+
+		uint32_t repeats = 0;
+		if( !duplicate_filter.Check( record.fingerprint, common::DuplicateFilter::Clock::now( ), repeats ) )
+		{
+			++lua_stats.suppressed;
+			return;
+		}
+
+		lua->PushNumber( static_cast<double>( ++lua_count ) );
+		PushAsyncLuaError( lua, record, repeats );
+		lua->SetTable( lua_errors );
+	}, max_records );
+
+	delivering_async = true;
+
+	if( lua_count != 0 )
+		CallBatchHook( lua, "LuaErrorBatch", lua_errors, lua_stats );
+
+	if( client_count != 0 )
+		CallBatchHook( lua, "ClientLuaErrorBatch", client_errors, client_stats );
+
+	delivering_async = false;
+
+	lua->Pop( 2 );
+}
+
+LUA_FUNCTION_STATIC( AsyncPipelineTick )
+{
+	if( async_pipeline.HasOutput( ) )
+		DeliverAsyncErrors( static_cast<GarrysMod::Lua::ILuaInterface *>( LUA ), async_batch_limit );
+
+	return 0;
+}
+
+// Adds function as the Tick hook called identifier, or removes the hook if function is nullptr.
+static bool SetTickHook( GarrysMod::Lua::ILuaBase *LUA, const char *identifier, const GarrysMod::Lua::CFunc function )
+{
+	LUA->GetField( GarrysMod::Lua::INDEX_GLOBAL, "hook" );
+	if( !LUA->IsType( -1, GarrysMod::Lua::Type::TABLE ) )
+	{
+		LUA->Pop( 1 );
+		return false;
+	}
+
+	LUA->GetField( -1, function != nullptr ? "Add" : "Remove" );
+	if( !LUA->IsType( -1, GarrysMod::Lua::Type::FUNCTION ) )
+	{
+		LUA->Pop( 2 );
+		return false;
+	}
+
+	LUA->PushString( "Tick" );
+	LUA->PushString( identifier );
+	if( function != nullptr )
+	{
+		LUA->PushCFunction( function );
+		LUA->Call( 3, 0 );
+	}
+	else
+		LUA->Call( 2, 0 );
+
+	LUA->Pop( 1 );
+	return true;
+}
+
+static void DisableAsyncPipeline( GarrysMod::Lua::ILuaBase *LUA )
+{
+	if( !async_enabled )
+		return;
+
+	async_enabled = false;
+	SetTickHook( LUA, "luaerror.AsyncPipeline", nullptr );
+
+	// whatever was queued before disabling still gets delivered
+	async_pipeline.Flush( std::chrono::milliseconds( 100 ) );
+	async_pipeline.Stop( );
+	DeliverAsyncErrors( static_cast<GarrysMod::Lua::ILuaInterface *>( LUA ), SIZE_MAX );
+}
+
+LUA_FUNCTION_STATIC( EnableAsyncPipeline )
+{
+	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+
+	if( !LUA->GetBool( 1 ) )
+	{
+		DisableAsyncPipeline( LUA );
+		LUA->PushBool( true );
+		return 1;
+	}
+
+	if( !async_enabled )
+	{
+		if( !SetTickHook( LUA, "luaerror.AsyncPipeline", AsyncPipelineTick ) )
+		{
+			LUA->PushNil( );
+			LUA->PushString( "unable to add the Tick hook, hook library not available" );
+			return 2;
+		}
+
+		async_pipeline.Start( );
+		async_enabled = true;
+	}
+
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( CaptureBudgetTick )
+{
+	capture_budget.Reset( );
+	return 0;
+}
+
+LUA_FUNCTION_STATIC( SetCaptureBudget )
+{
+	const double seconds = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 0.0;
+	const double bytes = LUA->IsType( 2, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 2 ) : 0.0;
+
+	common::CaptureBudget::Limits limits;
+	limits.time = std::chrono::duration_cast<common::CaptureBudget::Clock::duration>(
+		std::chrono::duration<double>( seconds > 0.0 ? seconds : 0.0 )
+	);
+	limits.bytes = bytes >= 1.0 ? static_cast<size_t>( bytes ) : 0;
+
+	const bool enable = limits.time != common::CaptureBudget::Clock::duration::zero( ) || limits.bytes != 0;
+	if( enable != capture_budget.IsEnabled( ) &&
+		!SetTickHook( LUA, "luaerror.CaptureBudget", enable ? CaptureBudgetTick : nullptr ) && enable )
+	{
+		LUA->PushNil( );
+		LUA->PushString( "unable to add the Tick hook, hook library not available" );
+		return 2;
+	}
+
+	capture_budget.SetLimits( limits );
+	capture_budget.Reset( );
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetCaptureBudget )
+{
+	const common::CaptureBudget::Limits &limits = capture_budget.GetLimits( );
+	LUA->PushNumber( std::chrono::duration<double>( limits.time ).count( ) );
+	LUA->PushNumber( static_cast<double>( limits.bytes ) );
+
+	LUA->CreateTable( );
+	for( size_t k = 0; k < common::CaptureBudget::level_count; ++k )
+	{
+		const auto level = static_cast<common::CaptureBudget::Level>( k );
+		LUA->PushNumber( static_cast<double>( capture_budget.GetCount( level ) ) );
+		LUA->SetField( -2, common::CaptureBudget::GetLevelName( level ) );
+	}
+
+	return 3;
+}
+
+// Absolute path of garrysmod/data, resolved once through the game filesystem so the journal
+// doesn't depend on the working directory of the process.
+static std::string data_path;
+
+// Game thread. Empty if the filesystem can't find the data directory.
+static const std::string &GetDataPath( )
+{
+	if( data_path.empty( ) )
+	{
+		char full_path[512];
+		if( filesystem->RelativePathToFullPath( "data", "MOD", full_path, sizeof( full_path ) ) != nullptr )
+		{
+			data_path = full_path;
+			if( data_path.back( ) != '/' && data_path.back( ) != '\\' )
+				data_path += '/';
+		}
+	}
+
+	return data_path;
+}
+
+// Journal files live in garrysmod/data, their names can't hold anything that would leave it.
+static bool IsValidJournalName( std::string_view name )
+{
+	if( name.empty( ) || name.size( ) > 64 || name[0] == '.' )
+		return false;
+
+	for( const char c : name )
+		if( !( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) ||
+			c == '_' || c == '-' || c == '.' ) )
+			return false;
+
+	return true;
+}
+
+LUA_FUNCTION_STATIC( EnableJournal )
+{
+	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+
+	if( !LUA->GetBool( 1 ) )
+	{
+		journal.Close( );
+		LUA->PushBool( true );
+		return 1;
+	}
+
+	const char *name = LUA->IsType( 2, GarrysMod::Lua::Type::STRING ) ? LUA->GetString( 2 ) : "luaerror.journal";
+	if( !IsValidJournalName( name ) )
+	{
+		LUA->PushNil( );
+		LUA->PushString( "invalid journal name, only letters, digits, '_', '-' and '.' are allowed" );
+		return 2;
+	}
+
+	const std::string &directory = GetDataPath( );
+	if( directory.empty( ) )
+	{
+		LUA->PushNil( );
+		LUA->PushString( "unable to find the data directory" );
+		return 2;
+	}
+
+	common::JournalWriter::Options options;
+	options.path = directory + name;
+	if( LUA->IsType( 3, GarrysMod::Lua::Type::NUMBER ) && LUA->GetNumber( 3 ) >= 1.0 )
+		options.max_file_bytes = static_cast<size_t>( LUA->GetNumber( 3 ) );
+
+	if( LUA->IsType( 4, GarrysMod::Lua::Type::NUMBER ) && LUA->GetNumber( 4 ) >= 0.0 )
+		options.max_rotated_files = static_cast<size_t>( LUA->GetNumber( 4 ) );
+
+	// reopening applies the new options
+	journal.Close( );
+	LUA->PushBool( journal.Open( options ) );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetJournalStats )
+{
+	const common::JournalWriter::Stats stats = journal.GetStats( );
+
+	LUA->CreateTable( );
+
+	LUA->PushBool( journal.IsOpen( ) );
+	LUA->SetField( -2, "enabled" );
+
+	LUA->PushNumber( static_cast<double>( stats.appended ) );
+	LUA->SetField( -2, "appended" );
+
+	LUA->PushNumber( static_cast<double>( stats.dropped ) );
+	LUA->SetField( -2, "dropped" );
+
+	LUA->PushNumber( static_cast<double>( stats.written_records ) );
+	LUA->SetField( -2, "written" );
+
+	LUA->PushNumber( static_cast<double>( stats.written_bytes ) );
+	LUA->SetField( -2, "bytes" );
+
+	LUA->PushNumber( static_cast<double>( stats.rotations ) );
+	LUA->SetField( -2, "rotations" );
+
+	LUA->PushNumber( static_cast<double>( stats.write_errors ) );
+	LUA->SetField( -2, "errors" );
+
+	return 1;
+}
+
+// Reads an optional number field of the table at idx, leaving value untouched if it's missing.
+static bool GetNumberField( GarrysMod::Lua::ILuaBase *LUA, const int32_t idx, const char *name, double &value )
+{
+	LUA->GetField( idx, name );
+	const bool exists = LUA->IsType( -1, GarrysMod::Lua::Type::NUMBER );
+	if( exists )
+		value = LUA->GetNumber( -1 );
+
+	LUA->Pop( 1 );
+	return exists;
+}
+
+LUA_FUNCTION_STATIC( EnableExporter )
+{
+	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+
+	if( !LUA->GetBool( 1 ) )
+	{
+		exporter.Close( );
+		LUA->PushBool( true );
+		return 1;
+	}
+
+	common::ErrorExporter::Options options;
+	options.address = LUA->CheckString( 2 );
+
+	if( LUA->IsType( 3, GarrysMod::Lua::Type::TABLE ) )
+	{
+		LUA->GetField( 3, "tag" );
+		if( LUA->IsType( -1, GarrysMod::Lua::Type::STRING ) )
+			options.tag = LUA->GetString( -1 );
+
+		LUA->Pop( 1 );
+
+		LUA->GetField( 3, "fold_stack" );
+		options.fold_stack = LUA->IsType( -1, GarrysMod::Lua::Type::BOOL ) && LUA->GetBool( -1 );
+		LUA->Pop( 1 );
+
+		double value = 0.0;
+		if( GetNumberField( LUA, 3, "batch_size", value ) && value >= 1.0 )
+			options.max_batch_records = static_cast<size_t>( value );
+
+		if( GetNumberField( LUA, 3, "batch_delay", value ) && value >= 0.0 )
+			options.max_batch_delay = std::chrono::milliseconds( static_cast<int64_t>( value * 1000.0 ) );
+
+		if( GetNumberField( LUA, 3, "datagram_size", value ) && value >= 512.0 )
+			options.max_datagram_bytes = static_cast<size_t>( value );
+
+		if( GetNumberField( LUA, 3, "backpressure_timeout", value ) && value >= 0.0 )
+			options.backpressure_timeout = std::chrono::milliseconds( static_cast<int64_t>( value * 1000.0 ) );
+
+		if( GetNumberField( LUA, 3, "buffer_size", value ) && value >= 1.0 )
+			options.buffer_bytes = static_cast<size_t>( value );
+	}
+
+	// reopening applies the new options
+	exporter.Close( );
+
+	std::string error;
+	if( !exporter.Open( options, error ) )
+	{
+		LUA->PushNil( );
+		LUA->PushString( error.c_str( ) );
+		return 2;
+	}
+
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetExporterStats )
+{
+	const common::ErrorExporter::Stats stats = exporter.GetStats( );
+
+	LUA->CreateTable( );
+
+	LUA->PushBool( exporter.IsOpen( ) );
+	LUA->SetField( -2, "enabled" );
+
+	LUA->PushNumber( static_cast<double>( stats.appended ) );
+	LUA->SetField( -2, "appended" );
+
+	LUA->PushNumber( static_cast<double>( stats.dropped ) );
+	LUA->SetField( -2, "dropped" );
+
+	LUA->PushNumber( static_cast<double>( stats.sent_records ) );
+	LUA->SetField( -2, "sent" );
+
+	LUA->PushNumber( static_cast<double>( stats.sent_batches ) );
+	LUA->SetField( -2, "batches" );
+
+	LUA->PushNumber( static_cast<double>( stats.dropped_records ) );
+	LUA->SetField( -2, "unsent" );
+
+	LUA->PushNumber( static_cast<double>( stats.send_errors ) );
+	LUA->SetField( -2, "errors" );
+
+	return 1;
+}
+
+// Microseconds, the unit of every timer in luaerror.GetStats.
+static double ToMicroseconds( const common::LatencyHistogram::Clock::duration duration )
+{
+	return std::chrono::duration<double, std::micro>( duration ).count( );
+}
+
+static void PushLatencyHistogram( GarrysMod::Lua::ILuaBase *LUA, const common::LatencyHistogram &histogram )
+{
+	LUA->CreateTable( );
+
+	const uint64_t count = histogram.GetCount( );
+	LUA->PushNumber( static_cast<double>( count ) );
+	LUA->SetField( -2, "count" );
+
+	const double total = ToMicroseconds( histogram.GetTotal( ) );
+	LUA->PushNumber( total );
+	LUA->SetField( -2, "total" );
+
+	LUA->PushNumber( count != 0 ? total / static_cast<double>( count ) : 0.0 );
+	LUA->SetField( -2, "mean" );
+
+	LUA->PushNumber( ToMicroseconds( histogram.GetMax( ) ) );
+	LUA->SetField( -2, "max" );
+
+	LUA->PushNumber( ToMicroseconds( histogram.GetQuantile( 0.5 ) ) );
+	LUA->SetField( -2, "p50" );
+
+	LUA->PushNumber( ToMicroseconds( histogram.GetQuantile( 0.9 ) ) );
+	LUA->SetField( -2, "p90" );
+
+	LUA->PushNumber( ToMicroseconds( histogram.GetQuantile( 0.99 ) ) );
+	LUA->SetField( -2, "p99" );
+}
+
+static void PushErrorPathStats( GarrysMod::Lua::ILuaBase *LUA, const common::ErrorPathStats &stats )
+{
+	LUA->CreateTable( );
+
+	LUA->PushNumber( static_cast<double>( stats.seen ) );
+	LUA->SetField( -2, "seen" );
+
+	LUA->PushNumber( static_cast<double>( stats.suppressed ) );
+	LUA->SetField( -2, "suppressed" );
+
+	LUA->PushNumber( static_cast<double>( stats.dropped ) );
+	LUA->SetField( -2, "dropped" );
+
+	LUA->PushNumber( static_cast<double>( stats.bytes ) );
+	LUA->SetField( -2, "bytes" );
+
+	PushLatencyHistogram( LUA, stats.timers[common::ErrorPathStats::Parse] );
+	LUA->SetField( -2, "parse" );
+
+	PushLatencyHistogram( LUA, stats.timers[common::ErrorPathStats::StackCapture] );
+	LUA->SetField( -2, "stack" );
+
+	PushLatencyHistogram( LUA, stats.timers[common::ErrorPathStats::AddonLookup] );
+	LUA->SetField( -2, "addon" );
+
+	PushLatencyHistogram( LUA, stats.timers[common::ErrorPathStats::HookCall] );
+	LUA->SetField( -2, "hook" );
+
+	LUA->CreateTable( );
+
+	const double fresh_bytes = stats.stacks != 0 ?
+		static_cast<double>( stats.stack_bytes ) / static_cast<double>( stats.stacks ) : 0.0;
+	const double pooled_bytes = stats.pooled_stacks != 0 ?
+		static_cast<double>( stats.pooled_stack_bytes ) / static_cast<double>( stats.pooled_stacks ) : 0.0;
+
+	LUA->PushNumber( static_cast<double>( stats.stacks ) );
+	LUA->SetField( -2, "count" );
+
+	LUA->PushNumber( fresh_bytes );
+	LUA->SetField( -2, "bytes" );
+
+	LUA->PushNumber( static_cast<double>( stats.pooled_stacks ) );
+	LUA->SetField( -2, "pooled" );
+
+	LUA->PushNumber( pooled_bytes );
+	LUA->SetField( -2, "pooledbytes" );
+
+	// only known once stacks were built both ways
+	if( stats.stacks != 0 && stats.pooled_stacks != 0 )
+	{
+		LUA->PushNumber( fresh_bytes - pooled_bytes );
+		LUA->SetField( -2, "saved" );
+	}
+
+	LUA->SetField( -2, "stacktables" );
+}
+
+LUA_FUNCTION_STATIC( GetStats )
+{
+	LUA->CreateTable( );
+
+	PushErrorPathStats( LUA, lua_stats );
+	LUA->SetField( -2, "lua" );
+
+	PushErrorPathStats( LUA, client_stats );
+	LUA->SetField( -2, "client" );
+
+	LUA->CreateTable( );
+
+	LUA->PushNumber( static_cast<double>( error_templates.GetCount( ) ) );
+	LUA->SetField( -2, "count" );
+
+	LUA->PushNumber( static_cast<double>( error_templates.GetEvictions( ) ) );
+	LUA->SetField( -2, "evictions" );
+
+	LUA->SetField( -2, "templates" );
+
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( ResetStats )
+{
+	lua_stats.Reset( );
+	client_stats.Reset( );
+	capture_budget.ClearCounts( );
+	top_fingerprints.Clear( );
+	top_files.Clear( );
+	top_addons.Clear( );
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( SetDuplicateWindow )
+{
+	const double seconds = LUA->CheckNumber( 1 );
+	duplicate_filter.SetWindow( std::chrono::duration_cast<common::DuplicateFilter::Clock::duration>(
+		std::chrono::duration<double>( seconds > 0.0 ? seconds : 0.0 )
+	) );
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetDuplicateWindow )
+{
+	LUA->PushNumber( std::chrono::duration<double>( duplicate_filter.GetWindow( ) ).count( ) );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetSuppressedCounts )
+{
+	LUA->CreateTable( );
+
+	duplicate_filter.ForEach( [LUA]( const common::DuplicateFilter::Entry &entry )
+	{
+		if( entry.total_suppressed == 0 )
+			return;
+
+		char fingerprint_str[17];
+		common::FormatFingerprint( entry.fingerprint, fingerprint_str );
+
+		LUA->CreateTable( );
+
+		LUA->PushNumber( entry.suppressed );
+		LUA->SetField( -2, "pending" );
+
+		LUA->PushNumber( static_cast<double>( entry.total_suppressed ) );
+		LUA->SetField( -2, "total" );
+
+		LUA->SetField( -2, fingerprint_str );
+	} );
+
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( FindWorkshopAddonFileOwnerLua )
+{
+	const char *path = LUA->CheckString( 1 );
+
+	const auto owner = FindWorkshopAddonFromFile( path );
+	if( owner == nullptr )
+		return 0;
+
+	char wsid[21];
+	LUA->PushString( owner->title.c_str( ) );
+	LUA->PushString( common::FormatWorkshopId( owner->wsid, wsid ) );
+	return 2;
+}
+
+LUA_FUNCTION_STATIC( SetHandler )
+{
+	if( LUA->IsType( 1, GarrysMod::Lua::Type::NIL ) || LUA->IsType( 1, GarrysMod::Lua::Type::NONE ) )
+	{
+		error_handler.Free( );
+		LUA->PushBool( true );
+		return 1;
+	}
+
+	LUA->CheckType( 1, GarrysMod::Lua::Type::FUNCTION );
+	LUA->Push( 1 );
+	error_handler.Create( );
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( EnableSourceContext )
+{
+	const double lines = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 0.0;
+	source_context_lines = lines >= 1.0 ? static_cast<size_t>( std::min( lines, 100.0 ) ) : 0;
+	if( source_context_lines == 0 )
+		source_cache.Clear( );
+
+	if( LUA->IsType( 2, GarrysMod::Lua::Type::NUMBER ) )
+	{
+		const double bytes = LUA->GetNumber( 2 );
+		source_cache.SetLimits( bytes >= 0.0 ? static_cast<size_t>( bytes ) : 0, source_cache.GetMaxFiles( ) );
+	}
+
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( GetSourceContextStats )
+{
+	LUA->CreateTable( );
 
-	int32_t lvl = 0;
-	lua_Debug dbg;
-	while( lua->GetStack( lvl, &dbg ) == 1 && lua->GetInfo( "SfLlnu", &dbg ) == 1 )
-	{
-		lua->PushNumber( ++lvl );
-		lua->CreateTable( );
+	LUA->PushNumber( static_cast<double>( source_context_lines ) );
+	LUA->SetField( -2, "lines" );
 
-		if( GetUpvalues( lua, -4 ) )
-			lua->SetField( -2, "upvalues" );
+	LUA->PushNumber( static_cast<double>( source_cache.GetFileCount( ) ) );
+	LUA->SetField( -2, "files" );
 
-		if( GetLocals( lua, dbg ) )
-			lua->SetField( -2, "locals" );
+	LUA->PushNumber( static_cast<double>( source_cache.GetBytes( ) ) );
+	LUA->SetField( -2, "bytes" );
 
-		lua->Push( -4 );
-		lua->SetField( -2, "func" );
+	LUA->PushNumber( static_cast<double>( source_cache.GetMaxBytes( ) ) );
+	LUA->SetField( -2, "maxbytes" );
 
-		lua->Push( -3 );
-		lua->SetField( -2, "activelines" );
+	LUA->PushNumber( static_cast<double>( source_cache.GetHits( ) ) );
+	LUA->SetField( -2, "hits" );
 
-		lua->PushNumber( dbg.event );
-		lua->SetField( -2, "event" );
+	LUA->PushNumber( static_cast<double>( source_cache.GetMisses( ) ) );
+	LUA->SetField( -2, "misses" );
 
-		lua->PushString( dbg.name != nullptr ? dbg.name : "" );
-		lua->SetField( -2, "name" );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( EnableRecent )
+{
+	const double count = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 0.0;
+	const size_t capacity = count >= 1.0 ? static_cast<size_t>( std::min( count, static_cast<double>( recent_errors_limit ) ) ) : 0;
+
+	size_t slot_bytes = recent_errors.GetSlotBytes( ) != 0 ? recent_errors.GetSlotBytes( ) : 2048;
+	if( LUA->IsType( 2, GarrysMod::Lua::Type::NUMBER ) )
+		slot_bytes = static_cast<size_t>( std::clamp(
+			LUA->GetNumber( 2 ),
+			static_cast<double>( recent_slot_bytes_min ),
+			static_cast<double>( recent_slot_bytes_max )
+		) );
+
+	recent_errors.Configure( capacity, slot_bytes );
+	LUA->PushBool( true );
+	return 1;
+}
 
-		lua->PushString( dbg.namewhat != nullptr ? dbg.namewhat : "" );
-		lua->SetField( -2, "namewhat" );
+static void PushRecentError( GarrysMod::Lua::ILuaBase *LUA, const common::RecentErrors::Entry &entry )
+{
+	LUA->CreateTable( );
 
-		lua->PushString( dbg.what != nullptr ? dbg.what : "" );
-		lua->SetField( -2, "what" );
+	LUA->PushNumber( static_cast<double>( entry.sequence ) );
+	LUA->SetField( -2, "sequence" );
 
-		lua->PushString( dbg.source != nullptr ? dbg.source : "" );
-		lua->SetField( -2, "source" );
+	LUA->PushNumber( static_cast<double>( entry.time ) / 1000.0 );
+	LUA->SetField( -2, "time" );
 
-		lua->PushNumber( dbg.currentline );
-		lua->SetField( -2, "currentline" );
+	LUA->PushBool( entry.runtime );
+	LUA->SetField( -2, "isruntime" );
 
-		lua->PushNumber( dbg.nups );
-		lua->SetField( -2, "nups" );
+	if( entry.client != -1 )
+	{
+		LUA->PushNumber( entry.client );
+		LUA->SetField( -2, "client" );
+	}
 
-		lua->PushNumber( dbg.linedefined );
-		lua->SetField( -2, "linedefined" );
+	PushStringView( LUA, entry.error );
+	LUA->SetField( -2, "fullerror" );
 
-		lua->PushNumber( dbg.lastlinedefined );
-		lua->SetField( -2, "lastlinedefined" );
+	PushStringView( LUA, entry.source_file );
+	LUA->SetField( -2, "sourcefile" );
 
-		lua->PushString( dbg.short_src );
-		lua->SetField( -2, "short_src" );
+	LUA->PushNumber( entry.source_line );
+	LUA->SetField( -2, "sourceline" );
 
-		lua->SetTable( -5 );
+	PushStringView( LUA, entry.error_string );
+	LUA->SetField( -2, "errorstr" );
 
-		// Pop activelines and func
-		lua->Pop( 2 );
+	if( entry.client != -1 )
+	{
+		if( !entry.addon_title.empty( ) )
+		{
+			PushStringView( LUA, entry.addon_title );
+			LUA->SetField( -2, "addonname" );
+		}
 	}
-}
+	else if( entry.addon_wsid != 0 )
+	{
+		char wsid[21];
+		PushStringView( LUA, entry.addon_title );
+		LUA->SetField( -2, "addontitle" );
 
-inline const IAddonSystem::Information *FindWorkshopAddonFromFile( const std::string &source )
-{
-	if( source.empty( ) || source == "[C]" )
-		return nullptr;
+		LUA->PushString( common::FormatWorkshopId( entry.addon_wsid, wsid ) );
+		LUA->SetField( -2, "addonwsid" );
+	}
 
-	const auto addons = filesystem->Addons( );
-	if( addons == nullptr )
-		return nullptr;
+	char fingerprint_str[17];
+	common::FormatFingerprint( entry.fingerprint, fingerprint_str );
+	LUA->PushString( fingerprint_str );
+	LUA->SetField( -2, "fingerprint" );
 
-	return addons->FindFileOwner( source );
-}
+	LUA->PushBool( entry.truncated );
+	LUA->SetField( -2, "truncated" );
 
-LUA_FUNCTION_STATIC( AdvancedLuaErrorReporter_d )
-{
-	const char *errstr = LUA->GetString( 1 );
+	LUA->CreateTable( );
+	for( size_t k = 0; k < entry.frames.size( ); ++k )
+	{
+		const common::RecentErrors::Frame &frame = entry.frames[k];
+		LUA->PushNumber( static_cast<double>( k + 1 ) );
+		LUA->CreateTable( );
 
-	runtime = true;
+		PushStringView( LUA, frame.name );
+		LUA->SetField( -2, "name" );
 
-	if( errstr != nullptr )
-		runtime_error = errstr;
-	else
-		runtime_error.clear( );
+		PushStringView( LUA, frame.source );
+		LUA->SetField( -2, "source" );
 
-	PushStackTable( static_cast<GarrysMod::Lua::ILuaInterface *>( LUA ) );
-	runtime_stack.Create( );
+		LUA->PushNumber( frame.currentline );
+		LUA->SetField( -2, "currentline" );
 
-	return AdvancedLuaErrorReporter_detour.GetTrampoline<GarrysMod::Lua::CFunc>( )( LUA->GetState( ) );
+		LUA->SetTable( -3 );
+	}
+
+	LUA->SetField( -2, "stack" );
 }
 
-class CLuaGameCallback : public GarrysMod::Lua::ILuaGameCallback
+LUA_FUNCTION_STATIC( GetRecent )
 {
-public:
-	CLuaGameCallback( ) :
-		lua( nullptr ),
-		callback( nullptr )
-	{ }
-
-	~CLuaGameCallback( )
+	size_t limit = recent_errors.GetCount( );
+	if( LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) )
 	{
-		Reset( );
+		const double count = LUA->GetNumber( 1 );
+		limit = count >= 1.0 ? static_cast<size_t>( std::min( count, static_cast<double>( limit ) ) ) : 0;
 	}
 
-	GarrysMod::Lua::ILuaObject *CreateLuaObject( )
+	// the filter is only read once, entries have to match every field that was given
+	enum class Kind
 	{
-		return callback->CreateLuaObject( );
-	}
-
-	void DestroyLuaObject( GarrysMod::Lua::ILuaObject *obj )
+		Any,
+		Runtime,
+		Compiletime,
+		Client
+	};
+
+	Kind kind = Kind::Any;
+	bool match_fingerprint = false;
+	uint64_t fingerprint = 0;
+	std::string source_file;
+	std::string addon_wsid;
+	double since = 0.0;
+	if( LUA->IsType( 2, GarrysMod::Lua::Type::TABLE ) )
 	{
-		callback->DestroyLuaObject( obj );
-	}
+		LUA->GetField( 2, "kind" );
+		if( LUA->IsType( -1, GarrysMod::Lua::Type::STRING ) )
+		{
+			const std::string_view name = LUA->GetString( -1 );
+			if( name == "runtime" )
+				kind = Kind::Runtime;
+			else if( name == "compiletime" )
+				kind = Kind::Compiletime;
+			else if( name == "client" )
+				kind = Kind::Client;
+			else
+				LUA->ArgError( 2, "kind must be \"runtime\", \"compiletime\" or \"client\"" );
+		}
 
-	void ErrorPrint( const char *error, bool print )
-	{
-		callback->ErrorPrint( error, print );
-	}
+		LUA->Pop( 1 );
 
-	void Msg( const char *msg, bool useless )
-	{
-		callback->Msg( msg, useless );
-	}
+		LUA->GetField( 2, "fingerprint" );
+		if( LUA->IsType( -1, GarrysMod::Lua::Type::STRING ) )
+		{
+			if( !common::ParseFingerprint( LUA->GetString( -1 ), fingerprint ) )
+				LUA->ArgError( 2, "fingerprint must be 16 hexadecimal digits" );
 
-	void MsgColour( const char *msg, const Color &color )
-	{
-		callback->MsgColour( msg, color );
+			match_fingerprint = true;
+		}
+
+		LUA->Pop( 1 );
+
+		LUA->GetField( 2, "sourcefile" );
+		if( LUA->IsType( -1, GarrysMod::Lua::Type::STRING ) )
+			source_file = LUA->GetString( -1 );
+
+		LUA->Pop( 1 );
+
+		LUA->GetField( 2, "addonwsid" );
+		if( LUA->IsType( -1, GarrysMod::Lua::Type::STRING ) )
+			addon_wsid = LUA->GetString( -1 );
+
+		LUA->Pop( 1 );
+
+		GetNumberField( LUA, 2, "since", since );
 	}
 
-	void LuaError( const CLuaError *error )
+	LUA->CreateTable( );
+
+	size_t count = 0;
+	char wsid[21];
+	recent_errors.ForEach( [&]( const common::RecentErrors::Entry &entry )
 	{
-		const std::string &error_str = runtime ? runtime_error : error->message;
+		// newest first, so everything after this was seen already
+		if( count >= limit || static_cast<double>( entry.sequence ) <= since )
+			return false;
 
-		common::ParsedError parsed_error;
-		if( entered_hook || !common::ParseError( error_str, parsed_error ) )
-			return callback->LuaError( error );
+		switch( kind )
+		{
+			case Kind::Runtime:
+				if( entry.client != -1 || !entry.runtime )
+					return true;
 
-		const int32_t funcs = LuaHelpers::PushHookRun( lua, "LuaError" );
-		if( funcs == 0 )
-			return callback->LuaError( error );
+				break;
 
-		lua->PushBool( runtime );
-		lua->PushString( error_str.c_str( ) );
+			case Kind::Compiletime:
+				if( entry.client != -1 || entry.runtime )
+					return true;
 
-		lua->PushString( parsed_error.source_file.c_str( ) );
-		lua->PushNumber( parsed_error.source_line );
-		lua->PushString( parsed_error.error_string.c_str( ) );
+				break;
 
-		if( runtime )
-		{
-			runtime_stack.Push( );
-			runtime_stack.Free( );
-		}
-		else
-			PushStackTable( lua );
+			case Kind::Client:
+				if( entry.client == -1 )
+					return true;
 
-		runtime = false;
+				break;
 
-		const auto source_addon = FindWorkshopAddonFromFile( parsed_error.source_file );
-		if( source_addon == nullptr )
-		{
-			lua->PushNil( );
-			lua->PushNil( );
-		}
-		else
-		{
-			lua->PushString( source_addon->title.c_str( ) );
-			lua->PushString( std::to_string( source_addon->wsid ).c_str( ) );
+			default:
+				break;
 		}
 
-		entered_hook = true;
-		const bool call_success = LuaHelpers::CallHookRun( lua, 8, 1 );
-		entered_hook = false;
-		if( !call_success )
-			return callback->LuaError( error );
+		if( match_fingerprint && entry.fingerprint != fingerprint )
+			return true;
 
-		const bool proceed = !lua->IsType( -1, GarrysMod::Lua::Type::BOOL ) || !lua->GetBool( -1 );
-		lua->Pop( 1 );
-		if( proceed )
-			return callback->LuaError( error );
-	}
+		if( !source_file.empty( ) && entry.source_file.find( source_file ) == std::string_view::npos )
+			return true;
 
-	void InterfaceCreated( GarrysMod::Lua::ILuaInterface *iface )
+		if( !addon_wsid.empty( ) &&
+			( entry.addon_wsid == 0 || addon_wsid != common::FormatWorkshopId( entry.addon_wsid, wsid ) ) )
+			return true;
+
+		LUA->PushNumber( static_cast<double>( ++count ) );
+		PushRecentError( LUA, entry );
+		LUA->SetTable( -3 );
+		return true;
+	} );
+
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( EnableTopErrors )
+{
+	const double count = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 0.0;
+	const size_t capacity = count >= 1.0 ? static_cast<size_t>( std::min( count, static_cast<double>( top_errors_limit ) ) ) : 0;
+	top_fingerprints.Configure( capacity, 256 );
+	top_files.Configure( capacity );
+	top_addons.Configure( capacity );
+	LUA->PushBool( true );
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( TopErrors )
+{
+	const double count = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 10.0;
+	const size_t k = count >= 1.0 ? static_cast<size_t>( std::min( count, static_cast<double>( top_errors_limit ) ) ) : 0;
+
+	const char *dimension = LUA->IsType( 2, GarrysMod::Lua::Type::STRING ) ? LUA->GetString( 2 ) : "fingerprint";
+	const common::HeavyHitters *top = nullptr;
+	const char *field = nullptr;
+	if( std::strcmp( dimension, "fingerprint" ) == 0 )
 	{
-		callback->InterfaceCreated( iface );
+		top = &top_fingerprints;
+		field = "errorstr";
 	}
-
-	void SetLua( GarrysMod::Lua::ILuaInterface *iface )
+	else if( std::strcmp( dimension, "file" ) == 0 )
 	{
-		lua = static_cast<GarrysMod::Lua::CLuaInterface *>( iface );
-		callback = lua->GetLuaGameCallback( );
+		top = &top_files;
+		field = "sourcefile";
 	}
-
-	void Detour( )
+	else if( std::strcmp( dimension, "addon" ) == 0 )
 	{
-		lua->SetLuaGameCallback( this );
+		top = &top_addons;
+		field = "addon";
 	}
+	else
+		LUA->ArgError( 2, "dimension must be \"fingerprint\", \"file\" or \"addon\"" );
 
-	void Reset( )
+	top->GetTop( k, top_counters );
+
+	LUA->CreateTable( );
+	for( size_t n = 0; n < top_counters.size( ); ++n )
 	{
-		lua->SetLuaGameCallback( callback );
-	}
+		const common::HeavyHitters::Counter &counter = *top_counters[n];
+		LUA->PushNumber( static_cast<double>( n + 1 ) );
+		LUA->CreateTable( );
 
-private:
-	GarrysMod::Lua::CLuaInterface *lua;
-	GarrysMod::Lua::ILuaGameCallback *callback;
-	bool entered_hook = false;
-};
+		PushStringView( LUA, counter.label );
+		LUA->SetField( -2, field );
 
-static CLuaGameCallback callback;
+		if( top == &top_fingerprints )
+		{
+			char fingerprint_str[17];
+			common::FormatFingerprint( counter.key, fingerprint_str );
+			LUA->PushString( fingerprint_str );
+			LUA->SetField( -2, "fingerprint" );
+		}
 
-inline void DetourCompiletime( )
-{
-	if( compiletime_detoured )
-		return;
+		LUA->PushNumber( static_cast<double>( counter.count ) );
+		LUA->SetField( -2, "count" );
 
-	if( !runtime_detoured )
-		callback.Detour( );
+		LUA->PushNumber( static_cast<double>( counter.error ) );
+		LUA->SetField( -2, "overcount" );
 
-	compiletime_detoured = true;
+		LUA->SetTable( -3 );
+	}
+
+	LUA->PushNumber( static_cast<double>( top->GetTotal( ) ) );
+	return 2;
 }
 
-inline void ResetCompiletime( )
+LUA_FUNCTION_STATIC( EnableTemplates )
 {
-	if( !compiletime_detoured )
-		return;
+	const double count = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 0.0;
 
-	if( !runtime_detoured )
-		callback.Reset( );
+	common::TemplateMiner::Options options = error_templates.GetOptions( );
+	options.max_templates = count >= 1.0 ? static_cast<size_t>( std::min( count, static_cast<double>( error_templates_limit ) ) ) : 0;
+	if( LUA->IsType( 2, GarrysMod::Lua::Type::NUMBER ) )
+		options.similarity = std::clamp( LUA->GetNumber( 2 ), 0.0, 1.0 );
 
-	compiletime_detoured = false;
+	error_templates.Configure( options );
+	LUA->PushBool( true );
+	return 1;
 }
 
-inline void DetourRuntime( )
+static void PushErrorTemplateTable( GarrysMod::Lua::ILuaBase *LUA, const common::TemplateMiner::Template &error_template )
 {
-	if( runtime_detoured )
-		return;
+	LUA->CreateTable( );
 
-	if( !compiletime_detoured )
-		callback.Detour( );
+	LUA->PushNumber( error_template.id );
+	LUA->SetField( -2, "id" );
 
-	AdvancedLuaErrorReporter_detour.Enable( );
-	runtime_detoured = true;
+	LUA->PushString( error_template.text.c_str( ), static_cast<unsigned int>( error_template.text.size( ) ) );
+	LUA->SetField( -2, "template" );
+
+	LUA->PushNumber( static_cast<double>( error_template.count ) );
+	LUA->SetField( -2, "count" );
 }
 
-inline void ResetRuntime( )
+LUA_FUNCTION_STATIC( GetTemplate )
 {
-	if( !runtime_detoured )
-		return;
-
-	if( !compiletime_detoured )
-		callback.Reset( );
+	const common::TemplateMiner::Template *error_template = error_templates.Find( static_cast<uint32_t>( LUA->CheckNumber( 1 ) ) );
+	if( error_template == nullptr )
+		return 0;
 
-	AdvancedLuaErrorReporter_detour.Disable( );
-	runtime_detoured = false;
+	PushErrorTemplateTable( LUA, *error_template );
+	return 1;
 }
 
-LUA_FUNCTION_STATIC( EnableRuntimeDetour )
+LUA_FUNCTION_STATIC( GetTemplates )
 {
-	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+	const double count = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 10.0;
+	error_templates.GetTop( count >= 1.0 ? static_cast<size_t>( std::min( count, static_cast<double>( error_templates_limit ) ) ) : 0, top_templates );
 
-	if( LUA->GetBool( 1 ) )
-		DetourRuntime( );
-	else
-		ResetRuntime( );
+	LUA->CreateTable( );
+	for( size_t k = 0; k < top_templates.size( ); ++k )
+	{
+		LUA->PushNumber( static_cast<double>( k + 1 ) );
+		PushErrorTemplateTable( LUA, *top_templates[k] );
+		LUA->SetTable( -3 );
+	}
 
+	return 1;
+}
+
+LUA_FUNCTION_STATIC( EnableStackFolding )
+{
+	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+	fold_stack = LUA->GetBool( 1 );
 	LUA->PushBool( true );
 	return 1;
 }
 
-LUA_FUNCTION_STATIC( EnableCompiletimeDetour )
+LUA_FUNCTION_STATIC( EnableLazyStack )
 {
 	LUA->CheckType( 1, GarrysMod::Lua::Type::BOOL );
+	lazy_stack = LUA->GetBool( 1 );
+	LUA->PushBool( true );
+	return 1;
+}
 
-	if( LUA->GetBool( 1 ) )
-		DetourCompiletime( );
-	else
-		ResetCompiletime( );
+LUA_FUNCTION_STATIC( EnableStackPool )
+{
+	const double tables = LUA->IsType( 1, GarrysMod::Lua::Type::NUMBER ) ? LUA->GetNumber( 1 ) : 0.0;
+	stack_pool_limit = tables >= 1.0 ? static_cast<size_t>( std::min( tables, static_cast<double>( stack_pool_limit_max ) ) ) : 0;
 
+	// stacks handed out already keep their tables, the pools start over
+	CreateStackPools( LUA );
 	LUA->PushBool( true );
 	return 1;
 }
 
-LUA_FUNCTION_STATIC( FindWorkshopAddonFileOwnerLua )
+common::ErrorPathStats &GetClientStats( )
 {
-	const char *path = LUA->CheckString( 1 );
+	return client_stats;
+}
 
-	const auto owner = FindWorkshopAddonFromFile( path );
-	if( owner == nullptr )
-		return 0;
+bool IsStackFoldingEnabled( )
+{
+	return fold_stack;
+}
 
-	LUA->PushString( owner->title.c_str( ) );
-	LUA->PushString( std::to_string( owner->wsid ).c_str( ) );
-	return 2;
+common::AsyncErrorPipeline *GetAsyncPipeline( )
+{
+	return async_enabled ? &async_pipeline : nullptr;
+}
+
+void RecordClientError( const int32_t client, const char *error )
+{
+	const uint64_t time = common::JournalWriter::Now( );
+	if( journal.IsOpen( ) )
+		journal.Append( time, false, client, error );
+
+	if( exporter.IsOpen( ) )
+		exporter.Append( time, false, client, error );
+
+	if( !IsRecordingErrors( ) )
+		return;
+
+	static common::ParsedErrorWithStackTraceView parsed_error;
+	const std::string_view error_view( error );
+	if( !common::ParseErrorWithStackTrace( error_view, parsed_error ) )
+	{
+		parsed_error = common::ParsedErrorWithStackTraceView( );
+		parsed_error.error_string = error_view;
+	}
+
+	common::RecentErrors::Error recent;
+	recent.time = time;
+	recent.client = client;
+	recent.fingerprint = common::FingerprintParsedError( parsed_error );
+	recent.error = error_view;
+	recent.source_file = parsed_error.source_file;
+	recent.source_line = parsed_error.source_line;
+	recent.error_string = parsed_error.error_string;
+	// clients only send the name of the addon
+	recent.addon_title = parsed_error.addon_name;
+	RecordError( recent, common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( parsed_error.stack_trace.begin( ), parsed_error.stack_trace.size( ) ) );
 }
 
 void Initialize( GarrysMod::Lua::ILuaBase *LUA )
 {
 	runtime_stack.Setup( LUA );
+	hook_run.Setup( LUA );
+	hook_table.Setup( LUA );
+	error_handler.Setup( LUA );
+
+	LUA->CreateTable( );
+	LUA->PushCFunction( StackLevelIndex );
+	LUA->SetField( -2, "__index" );
+	stack_level_meta.Setup( LUA );
+	stack_level_meta.Create( );
+
+	LUA->CreateTable( );
+	LUA->CreateTable( );
+	LUA->PushString( "k" );
+	LUA->SetField( -2, "__mode" );
+	LUA->SetMetaTable( -2 );
+	stack_level_ids.Setup( LUA );
+	stack_level_ids.Create( );
+
+	lua_createtable( LUA->GetState( ), static_cast<int>( StackKey::Count ) - 1, 0 );
+	for( size_t k = 0; k < static_cast<size_t>( StackKey::Count ) - 1; ++k )
+	{
+		LUA->PushNumber( static_cast<double>( k + 1 ) );
+		LUA->PushString( stack_key_names[k] );
+		LUA->RawSet( -3 );
+	}
+
+	stack_keys.Setup( LUA );
+	stack_keys.Create( );
+	CreateStackPools( LUA );
 
 	callback.SetLua( static_cast<GarrysMod::Lua::ILuaInterface *>( LUA ) );
 
@@ -414,21 +3082,137 @@ void Initialize( GarrysMod::Lua::ILuaBase *LUA )
 	if( filesystem == nullptr )
 		LUA->ThrowError( "unable to initialize IFileSystem" );
 
+	// the first errors shouldn't pay for reading the file lists of every addon, the Tick hook
+	// rebuilds the index when the list changes (without the hook library it's only built now)
+	CheckAddonList( );
+	SetTickHook( LUA, "luaerror.AddonIndex", AddonIndexTick );
+
+	async_pipeline.SetAddonResolver( ResolveWorkshopAddon );
+	journal.SetAddonResolver( ResolveWorkshopAddon );
+	exporter.SetAddonResolver( ResolveWorkshopAddon );
+
 	LUA->PushCFunction( EnableRuntimeDetour );
 	LUA->SetField( -2, "EnableRuntimeDetour" );
 
 	LUA->PushCFunction( EnableCompiletimeDetour );
 	LUA->SetField( -2, "EnableCompiletimeDetour" );
 
+	LUA->PushCFunction( EnableAsyncPipeline );
+	LUA->SetField( -2, "EnableAsyncPipeline" );
+
 	LUA->PushCFunction( FindWorkshopAddonFileOwnerLua );
 	LUA->SetField( -2, "FindWorkshopAddonFileOwner" );
+
+	LUA->PushCFunction( SetDuplicateWindow );
+	LUA->SetField( -2, "SetDuplicateWindow" );
+
+	LUA->PushCFunction( GetDuplicateWindow );
+	LUA->SetField( -2, "GetDuplicateWindow" );
+
+	LUA->PushCFunction( GetSuppressedCounts );
+	LUA->SetField( -2, "GetSuppressedCounts" );
+
+	LUA->PushCFunction( EnableLazyStack );
+	LUA->SetField( -2, "EnableLazyStack" );
+
+	LUA->PushCFunction( EnableStackFolding );
+	LUA->SetField( -2, "EnableStackFolding" );
+
+	LUA->PushCFunction( EnableStackPool );
+	LUA->SetField( -2, "EnableStackPool" );
+
+	LUA->PushCFunction( EnableSourceContext );
+	LUA->SetField( -2, "EnableSourceContext" );
+
+	LUA->PushCFunction( GetSourceContextStats );
+	LUA->SetField( -2, "GetSourceContextStats" );
+
+	LUA->PushCFunction( EnableRecent );
+	LUA->SetField( -2, "EnableRecent" );
+
+	LUA->PushCFunction( GetRecent );
+	LUA->SetField( -2, "GetRecent" );
+
+	LUA->PushCFunction( EnableTopErrors );
+	LUA->SetField( -2, "EnableTopErrors" );
+
+	LUA->PushCFunction( TopErrors );
+	LUA->SetField( -2, "TopErrors" );
+
+	LUA->PushCFunction( EnableTemplates );
+	LUA->SetField( -2, "EnableTemplates" );
+
+	LUA->PushCFunction( GetTemplate );
+	LUA->SetField( -2, "GetTemplate" );
+
+	LUA->PushCFunction( GetTemplates );
+	LUA->SetField( -2, "GetTemplates" );
+
+	LUA->PushCFunction( SetCaptureBudget );
+	LUA->SetField( -2, "SetCaptureBudget" );
+
+	LUA->PushCFunction( GetCaptureBudget );
+	LUA->SetField( -2, "GetCaptureBudget" );
+
+	LUA->PushCFunction( SetHandler );
+	LUA->SetField( -2, "SetHandler" );
+
+	LUA->PushCFunction( EnableJournal );
+	LUA->SetField( -2, "EnableJournal" );
+
+	LUA->PushCFunction( GetJournalStats );
+	LUA->SetField( -2, "GetJournalStats" );
+
+	LUA->PushCFunction( EnableExporter );
+	LUA->SetField( -2, "EnableExporter" );
+
+	LUA->PushCFunction( GetExporterStats );
+	LUA->SetField( -2, "GetExporterStats" );
+
+	LUA->PushCFunction( GetStats );
+	LUA->SetField( -2, "GetStats" );
+
+	LUA->PushCFunction( ResetStats );
+	LUA->SetField( -2, "ResetStats" );
 }
 
-void Deinitialize( GarrysMod::Lua::ILuaBase * )
+void Deinitialize( GarrysMod::Lua::ILuaBase *LUA )
 {
+	DisableAsyncPipeline( LUA );
+	if( capture_budget.IsEnabled( ) )
+	{
+		SetTickHook( LUA, "luaerror.CaptureBudget", nullptr );
+		capture_budget.SetLimits( common::CaptureBudget::Limits( ) );
+	}
+
+	journal.Close( );
+	exporter.Close( );
 	ResetRuntime( );
 	ResetCompiletime( );
 	AdvancedLuaErrorReporter_detour.Destroy( );
+	source_cache.Clear( );
+	recent_errors.Configure( 0 );
+	top_fingerprints.Configure( 0 );
+	top_files.Configure( 0 );
+	top_addons.Configure( 0 );
+	error_templates.Configure( common::TemplateMiner::Options( ) );
+	SetTickHook( LUA, "luaerror.AddonIndex", nullptr );
+	JoinAddonIndexBuilder( );
+	addon_index_building = false;
+	addon_list_read = false;
+	std::atomic_store( &addon_index, std::shared_ptr<const common::AddonIndex>( ) );
+	addon_cache_index.reset( );
+	addon_cache.Clear( );
+	for( GarrysMod::Lua::AutoReference &stack_pool : stack_pools )
+		stack_pool.Free( );
+
+	stack_pool_limit = 0;
+	stack_keys.Free( );
+	stack_level_ids.Free( );
+	stack_level_meta.Free( );
+	error_handler.Free( );
+	hook_table.Free( );
+	hook_run.Free( );
 }
 
 }
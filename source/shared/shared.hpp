@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
 namespace GarrysMod
 {
 	namespace Lua
@@ -9,9 +13,128 @@ namespace GarrysMod
 	}
 }
 
+namespace common
+{
+	class AsyncErrorPipeline;
+	struct ErrorPathStats;
+}
+
 namespace shared
 {
 
+// Counters and timers of the client error path, game thread only.
+common::ErrorPathStats &GetClientStats( );
+
+// Whether stacks handed to Lua are folded into groups of repeated frames (luaerror.EnableStackFolding).
+bool IsStackFoldingEnabled( );
+
+// The pipeline errors are queued into when the async mode is enabled, nullptr otherwise.
+// Game thread only, it's the single producer of the pipeline.
+common::AsyncErrorPipeline *GetAsyncPipeline( );
+
+// Hands a client error to the background sinks that are enabled (journal, exporter), the recent
+// errors and the top errors.
+void RecordClientError( int32_t client, const char *error );
+
+// Whether anything would receive the hook called name: the handler set by luaerror.SetHandler,
+// hooks added with hook.Add or the gamemode function with that name. Game thread only.
+bool HasHookListeners( GarrysMod::Lua::ILuaInterface *lua, const char *name );
+
+// Pushes the function that dispatches the hook called name (the handler or a cached hook.Run)
+// followed by name, returns how many values were pushed (0 if there's nothing to call).
+// Call it with LuaHelpers::CallHookRun.
+int32_t PushHookRun( GarrysMod::Lua::ILuaInterface *lua, const char *name );
+
+// Pushes the lines around line of source as {firstline = number, [1] = text, ...}, or nil if source
+// context is disabled (luaerror.EnableSourceContext) or the file can't be read. Game thread only.
+void PushSourceContext( GarrysMod::Lua::ILuaBase *LUA, std::string_view source, int32_t line );
+
+// Adds error_string to the error templates and pushes the id of its template, or nil if templates
+// are disabled (luaerror.EnableTemplates). Game thread only.
+void PushErrorTemplate( GarrysMod::Lua::ILuaBase *LUA, std::string_view error_string );
+
+// The errors of this realm and client errors build their stack tables from separate pools.
+enum class StackPool : size_t
+{
+	Lua,
+	Client,
+	Count
+};
+
+// What a table of a stack is, tables are only reused for the same role.
+enum class StackTable : size_t
+{
+	// the list of levels (or groups)
+	Stack,
+	// a group of folded levels
+	Group,
+	Level,
+	Count
+};
+
+// Fields of stack level and group tables. Their names are interned in the registry once, so
+// SetStackField doesn't push a new string for every field of every level.
+enum class StackKey : int32_t
+{
+	Event = 1,
+	Name,
+	NameWhat,
+	What,
+	Source,
+	CurrentLine,
+	Nups,
+	LineDefined,
+	LastLineDefined,
+	ShortSource,
+	Func,
+	ActiveLines,
+	Upvalues,
+	Locals,
+	AddonTitle,
+	AddonWorkshopId,
+	Level,
+	Repeats,
+	Count
+};
+
+// Alive while a stack table for a hook is built. The cached field names (and the pool, when
+// luaerror.EnableStackPool is on and the pool isn't in use by a stack handed to a hook already)
+// sit on the Lua stack below everything pushed after it, so the stack table has to be the only
+// value left above them when it ends. Adds the Lua memory building it allocated to stats.
+// Game thread only.
+class StackTableScope
+{
+public:
+	StackTableScope( GarrysMod::Lua::ILuaBase *LUA, StackPool pool, common::ErrorPathStats &stats );
+	~StackTableScope( );
+
+	StackTableScope( const StackTableScope & ) = delete;
+	StackTableScope &operator=( const StackTableScope & ) = delete;
+
+private:
+	GarrysMod::Lua::ILuaBase *lua;
+	common::ErrorPathStats &stats;
+	size_t memory;
+	// state of the scope this one is nested in, restored when it ends
+	int32_t keys_index;
+	int32_t pool_index;
+	size_t pool_next[static_cast<size_t>( StackTable::Count )];
+	bool pooled;
+};
+
+// Lets the stacks of pool be built from pooled tables again, once the hook they were handed to
+// returned (or wasn't called). Game thread only.
+void ReleaseStackPool( StackPool pool );
+
+// Pushes a table with room for array_size elements and fields fields, reused from the pool when a
+// StackTableScope took it. Reused tables are emptied, except for level tables which only lose the
+// fields that not every level has, the caller sets the rest again.
+void CreateStackTable( GarrysMod::Lua::ILuaBase *LUA, StackTable table, int32_t array_size, int32_t fields );
+
+// Sets field key of the table below the value on top of the stack, popping the value. Stack
+// tables never have a __newindex, so it's a raw set inside a StackTableScope.
+void SetStackField( GarrysMod::Lua::ILuaBase *LUA, StackKey key );
+
 void Initialize( GarrysMod::Lua::ILuaBase *LUA );
 void Deinitialize( GarrysMod::Lua::ILuaBase *LUA );
 
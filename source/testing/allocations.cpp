@@ -0,0 +1,67 @@
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace allocations
+{
+
+static std::atomic<size_t> count( 0 );
+
+size_t Count( )
+{
+	return count.load( std::memory_order_relaxed );
+}
+
+inline void *Allocate( const size_t size )
+{
+	count.fetch_add( 1, std::memory_order_relaxed );
+	return std::malloc( size != 0 ? size : 1 );
+}
+
+}
+
+void *operator new( const size_t size )
+{
+	void *ptr = allocations::Allocate( size );
+	if( ptr == nullptr )
+		throw std::bad_alloc( );
+
+	return ptr;
+}
+
+void *operator new[]( const size_t size )
+{
+	return operator new( size );
+}
+
+void *operator new( const size_t size, const std::nothrow_t & ) noexcept
+{
+	return allocations::Allocate( size );
+}
+
+void *operator new[]( const size_t size, const std::nothrow_t & ) noexcept
+{
+	return allocations::Allocate( size );
+}
+
+void operator delete( void *ptr ) noexcept
+{
+	std::free( ptr );
+}
+
+void operator delete[]( void *ptr ) noexcept
+{
+	std::free( ptr );
+}
+
+void operator delete( void *ptr, size_t ) noexcept
+{
+	std::free( ptr );
+}
+
+void operator delete[]( void *ptr, size_t ) noexcept
+{
+	std::free( ptr );
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts every call to the global allocation functions made by this process.
+namespace allocations
+{
+
+size_t Count( );
+
+}
@@ -0,0 +1,331 @@
+#include "benchmark.hpp"
+#include "allocations.hpp"
+#include "reference.hpp"
+
+#include <common.hpp>
+#include <scan.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+
+struct Corpus
+{
+	const char *name;
+	// Full client payloads, for the stack trace parsers
+	std::vector<std::string> errors;
+	// The "source:line: error" part of each payload, for the single line parsers
+	std::vector<std::string> lines;
+};
+
+class Random
+{
+public:
+	explicit Random( const uint32_t seed ) :
+		state( seed )
+	{ }
+
+	uint32_t Next( )
+	{
+		state = state * 1664525 + 1013904223;
+		return state >> 8;
+	}
+
+	uint32_t Next( const uint32_t max )
+	{
+		return Next( ) % max;
+	}
+
+private:
+	uint32_t state;
+};
+
+static const char *addon_names[] = {
+	"gcad", "glib", "wire", "ulx", "pac3", "darkrp", "advdupe2", "acf"
+};
+
+static const char *function_names[] = {
+	"Add", "unknown", "dtor", "DispatchEvent", "UnloadSystem", "Think", "Paint", "callback", "xpcall", "pcall", "error"
+};
+
+static const char *error_messages[] = {
+	"attempt to index a nil value (field 'x')",
+	"attempt to call a nil value (method 'GetPos')",
+	"bad argument #3 to 'Add' (function expected, got nil)",
+	"attempt to perform arithmetic on a nil value (local 'count')",
+	"'end' expected (to close 'function' at line 12) near '<eof>'",
+	"'=' expected near '<eof>'"
+};
+
+template<typename Array>
+inline const char *Pick( Random &random, const Array &array )
+{
+	return array[random.Next( sizeof( array ) / sizeof( *array ) )];
+}
+
+inline std::string RandomSource( Random &random )
+{
+	const char *addon = Pick( random, addon_names );
+	return std::string( "addons/" ) + addon + "/lua/" + addon + "/file" + std::to_string( random.Next( 64 ) ) + ".lua";
+}
+
+inline void AppendFrame( std::string &error, const size_t level, const std::string &name, const std::string &source, const int32_t line )
+{
+	error.append( level + 1, ' ' );
+	error += std::to_string( level ) + ". " + name + " - " + source + ":" + std::to_string( line ) + "\n";
+}
+
+static Corpus ShortCompileErrors( const size_t size )
+{
+	Corpus corpus = { "short compile", { }, { } };
+	Random random( 1 );
+	for( size_t k = 0; k < size; ++k )
+	{
+		const std::string line = RandomSource( random ) + ":" + std::to_string( random.Next( 500 ) ) + ": " +
+			error_messages[4 + random.Next( 2 )];
+		corpus.lines.emplace_back( line );
+		corpus.errors.emplace_back( "\n[ERROR] " + line + "\n  1. unknown - lua_run:1\n\n" );
+	}
+
+	return corpus;
+}
+
+static Corpus DeepRecursiveTraces( const size_t size )
+{
+	Corpus corpus = { "deep recursive", { }, { } };
+	Random random( 2 );
+	for( size_t k = 0; k < size; ++k )
+	{
+		const std::string line = Pick( random, error_messages );
+		std::string error = "\n[gcad] " + line + "\n";
+		AppendFrame( error, 1, "Add", "lua/includes/modules/hook.lua", 31 );
+		AppendFrame( error, 2, "DispatchEvent", "addons/glib/lua/glib/events/eventprovider.lua", 86 );
+
+		const size_t depth = 16 + random.Next( 48 );
+		for( size_t level = 3; level <= depth; level += 3 )
+		{
+			AppendFrame( error, level, "RunPackFile", "addons/glib/lua/glib/loader/loader.lua", 296 );
+			AppendFrame( error, level + 1, "runNextPackFile", "addons/glib/lua/glib/loader/loader.lua", 494 );
+			AppendFrame( error, level + 2, "callback", "addons/glib/lua/glib/loader/loader.lua", 497 );
+		}
+
+		error += "\n";
+		corpus.lines.emplace_back( "addons/glib/lua/glib/loader/loader.lua:497: " + line );
+		corpus.errors.emplace_back( std::move( error ) );
+	}
+
+	return corpus;
+}
+
+static Corpus AddonAndCFrames( const size_t size )
+{
+	Corpus corpus = { "addon and [C]", { }, { } };
+	Random random( 3 );
+	for( size_t k = 0; k < size; ++k )
+	{
+		const std::string source = RandomSource( random );
+		const std::string line = source + ":" + std::to_string( random.Next( 2000 ) ) + ": " + Pick( random, error_messages );
+		std::string error = std::string( "\n[" ) + Pick( random, addon_names ) + "] " + line + "\n";
+
+		const size_t depth = 2 + random.Next( 10 );
+		for( size_t level = 1; level <= depth; ++level )
+			if( random.Next( 3 ) == 0 )
+				AppendFrame( error, level, Pick( random, function_names ), "[C]", -1 );
+			else
+				AppendFrame( error, level, Pick( random, function_names ), RandomSource( random ), random.Next( 2000 ) );
+
+		error += "\n";
+		corpus.lines.emplace_back( line );
+		corpus.errors.emplace_back( std::move( error ) );
+	}
+
+	return corpus;
+}
+
+static Corpus LongLines( const size_t size )
+{
+	Corpus corpus = { "long lines", { }, { } };
+	Random random( 4 );
+	for( size_t k = 0; k < size; ++k )
+	{
+		// Kept under 16KiB, the std::regex reference exhausts the stack on much longer lines
+		const std::string long_source = "addons/" + std::string( 256 + random.Next( 768 ), 'p' ) + ".lua";
+		const std::string line = long_source + ":1: " + std::string( 4096 + random.Next( 12288 ), 'm' );
+		std::string error = "\n[ERROR] " + line + "\n";
+		AppendFrame( error, 1, std::string( 512 + random.Next( 1024 ), 'n' ), long_source, 1 );
+		AppendFrame( error, 2, "xpcall", "[C]", -1 );
+		error += "\n";
+		corpus.lines.emplace_back( line );
+		corpus.errors.emplace_back( std::move( error ) );
+	}
+
+	return corpus;
+}
+
+struct Parser
+{
+	std::string name;
+	bool stack_trace;
+	std::function<bool( const std::string & )> parse;
+	common::scan::InstructionSet instruction_set = common::scan::GetInstructionSet( );
+};
+
+static std::vector<Parser> CreateParsers( )
+{
+	static common::ParsedError parsed_error;
+	static common::ParsedErrorView parsed_error_view;
+	static common::ParsedErrorWithStackTrace parsed_error_with_stacktrace;
+	static common::ParsedErrorWithStackTraceView parsed_error_with_stacktrace_view;
+
+	std::vector<Parser> parsers = {
+		{ "reference::ParseError", false, [] ( const std::string &error )
+		{
+			return reference::ParseError( error, parsed_error );
+		} },
+		{ "ParseError", false, [] ( const std::string &error )
+		{
+			return common::ParseError( error, parsed_error );
+		} },
+		{ "ParseError (view)", false, [] ( const std::string &error )
+		{
+			return common::ParseError( std::string_view( error ), parsed_error_view );
+		} },
+		{ "reference::ParseErrorWithStackTrace", true, [] ( const std::string &error )
+		{
+			return reference::ParseErrorWithStackTrace( error, parsed_error_with_stacktrace );
+		} },
+		{ "ParseErrorWithStackTrace", true, [] ( const std::string &error )
+		{
+			return common::ParseErrorWithStackTrace( error, parsed_error_with_stacktrace );
+		} },
+		{ "ParseErrorWithStackTrace (view)", true, [] ( const std::string &error )
+		{
+			return common::ParseErrorWithStackTrace( std::string_view( error ), parsed_error_with_stacktrace_view );
+		} }
+	};
+
+	// The view parser again, with every other supported line scanning implementation
+	for( const auto instruction_set : {
+		common::scan::InstructionSet::Scalar,
+		common::scan::InstructionSet::SSE2,
+		common::scan::InstructionSet::AVX2
+	} )
+		if( instruction_set != common::scan::GetInstructionSet( ) && common::scan::IsSupported( instruction_set ) )
+		{
+			Parser parser = parsers.back( );
+			parser.name = std::string( "ParseErrorWithStackTrace (view, " ) + common::scan::GetName( instruction_set ) + ")";
+			parser.instruction_set = instruction_set;
+			parsers.emplace_back( std::move( parser ) );
+		}
+
+	return parsers;
+}
+
+struct Result
+{
+	double errors_per_second = 0.0;
+	double megabytes_per_second = 0.0;
+	double p50 = 0.0;
+	double p99 = 0.0;
+	double allocations_per_parse = 0.0;
+	size_t failures = 0;
+};
+
+static Result Measure( const Parser &parser, const std::vector<std::string> &inputs, const size_t rounds )
+{
+	typedef std::chrono::steady_clock clock;
+
+	Result result;
+
+	const auto previous_instruction_set = common::scan::GetInstructionSet( );
+	common::scan::SetInstructionSet( parser.instruction_set );
+
+	size_t bytes = 0;
+	for( const auto &input : inputs )
+		bytes += input.size( );
+
+	// Warm up, so reused outputs already have their capacity
+	for( const auto &input : inputs )
+		if( !parser.parse( input ) )
+			++result.failures;
+
+	const size_t allocations_before = allocations::Count( );
+	const auto start = clock::now( );
+	for( size_t round = 0; round < rounds; ++round )
+		for( const auto &input : inputs )
+			parser.parse( input );
+
+	const double elapsed = std::chrono::duration<double>( clock::now( ) - start ).count( );
+	const size_t parses = rounds * inputs.size( );
+	result.allocations_per_parse = static_cast<double>( allocations::Count( ) - allocations_before ) / parses;
+	result.errors_per_second = parses / elapsed;
+	result.megabytes_per_second = rounds * bytes / elapsed / ( 1024.0 * 1024.0 );
+
+	std::vector<double> latencies;
+	latencies.reserve( inputs.size( ) );
+	for( const auto &input : inputs )
+	{
+		const auto parse_start = clock::now( );
+		parser.parse( input );
+		latencies.push_back( std::chrono::duration<double, std::nano>( clock::now( ) - parse_start ).count( ) );
+	}
+
+	const auto percentile = [&latencies] ( const double fraction )
+	{
+		const size_t index = std::min( latencies.size( ) - 1, static_cast<size_t>( fraction * latencies.size( ) ) );
+		std::nth_element( latencies.begin( ), latencies.begin( ) + index, latencies.end( ) );
+		return latencies[index];
+	};
+	result.p50 = percentile( 0.50 );
+	result.p99 = percentile( 0.99 );
+
+	common::scan::SetInstructionSet( previous_instruction_set );
+	return result;
+}
+
+int Run( const size_t rounds )
+{
+	const size_t corpus_size = 512;
+	const std::vector<Corpus> corpora = {
+		ShortCompileErrors( corpus_size ),
+		DeepRecursiveTraces( corpus_size ),
+		AddonAndCFrames( corpus_size ),
+		LongLines( corpus_size / 8 )
+	};
+
+	printf( "Line scanning with %s\n", common::scan::GetName( common::scan::GetInstructionSet( ) ) );
+	printf(
+		"%-42s %-16s %12s %10s %10s %10s %12s\n",
+		"function", "corpus", "errors/s", "MB/s", "p50 (ns)", "p99 (ns)", "allocs/parse"
+	);
+
+	int ret = 0;
+	for( const auto &parser : CreateParsers( ) )
+		for( const auto &corpus : corpora )
+		{
+			const Result result = Measure( parser, parser.stack_trace ? corpus.errors : corpus.lines, rounds );
+			printf(
+				"%-42s %-16s %12.0f %10.1f %10.0f %10.0f %12.2f\n",
+				parser.name.c_str( ), corpus.name,
+				result.errors_per_second, result.megabytes_per_second,
+				result.p50, result.p99, result.allocations_per_parse
+			);
+
+			if( result.failures != 0 )
+			{
+				printf( "%s failed to parse %zu errors of the %s corpus!\n", parser.name.c_str( ), result.failures, corpus.name );
+				ret = 5;
+			}
+		}
+
+	return ret;
+}
+
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace benchmark
+{
+
+// Parses a generated corpus with every parser variant and prints throughput, latency and allocations.
+int Run( size_t rounds );
+
+}
@@ -1,27 +1,1785 @@
 #include <common.hpp>
+#include <scan.hpp>
+#include <batch.hpp>
+#include <thread_pool.hpp>
+#include <string_pool.hpp>
+#include <fingerprint.hpp>
+#include <duplicates.hpp>
+#include <rate_limit.hpp>
+#include <async_pipeline.hpp>
+#include <journal.hpp>
+#include <json.hpp>
+#include <exporter.hpp>
+#include <addon_index.hpp>
+#include <stats.hpp>
+#include <arena.hpp>
+#include <stack_groups.hpp>
+#include <capture_budget.hpp>
+#include <source_cache.hpp>
+#include <recent.hpp>
+#include <heavy_hitters.hpp>
+#include <log_analysis.hpp>
+#include <templates.hpp>
+
+#include "reference.hpp"
+#include "benchmark.hpp"
+#include "allocations.hpp"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined _WIN32
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#endif
+
+static bool test_parsed_error( const std::string &error, const common::ParsedError &control_parsed_error )
+{
+	common::ParsedError parsed_error;
+	if( !common::ParseError( error, parsed_error ) )
+		return false;
+
+	return parsed_error == control_parsed_error;
+}
+
+static bool test_parsed_error_with_stacktrace( const std::string &error, const common::ParsedErrorWithStackTrace &control_parsed_error )
+{
+	common::ParsedErrorWithStackTrace parsed_error;
+	if( !common::ParseErrorWithStackTrace( error, parsed_error ) )
+		return false;
+
+	return parsed_error == control_parsed_error;
+}
+
+static bool test_parse_error_equivalence( const std::string &error )
+{
+	common::ParsedError control_parsed_error;
+	const bool control_success = reference::ParseError( error, control_parsed_error );
+
+	common::ParsedError parsed_error;
+	if( common::ParseError( error, parsed_error ) != control_success )
+		return false;
+
+	common::ParsedErrorView parsed_error_view;
+	if( common::ParseError( std::string_view( error ), parsed_error_view ) != control_success )
+		return false;
+
+	if( !control_success )
+		return true;
+
+	return parsed_error == control_parsed_error &&
+		parsed_error_view.source_file == control_parsed_error.source_file &&
+		parsed_error_view.source_line == control_parsed_error.source_line &&
+		parsed_error_view.error_string == control_parsed_error.error_string;
+}
+
+static bool test_parse_error_with_stacktrace_equivalence( const std::string &error )
+{
+	common::ParsedErrorWithStackTrace control_parsed_error;
+	const bool control_success = reference::ParseErrorWithStackTrace( error, control_parsed_error );
+
+	common::ParsedErrorWithStackTrace parsed_error;
+	if( common::ParseErrorWithStackTrace( error, parsed_error ) != control_success )
+		return false;
+
+	common::ParsedErrorWithStackTraceView parsed_error_view;
+	if( common::ParseErrorWithStackTrace( std::string_view( error ), parsed_error_view ) != control_success )
+		return false;
+
+	if( !control_success )
+		return true;
+
+	if( !( parsed_error == control_parsed_error ) ||
+		parsed_error_view.source_file != control_parsed_error.source_file ||
+		parsed_error_view.source_line != control_parsed_error.source_line ||
+		parsed_error_view.error_string != control_parsed_error.error_string ||
+		parsed_error_view.addon_name != control_parsed_error.addon_name ||
+		parsed_error_view.stack_trace.size( ) != control_parsed_error.stack_trace.size( ) )
+		return false;
+
+	for( size_t k = 0; k < parsed_error_view.stack_trace.size( ); ++k )
+	{
+		const auto &frame_view = parsed_error_view.stack_trace[k];
+		const auto &control_frame = control_parsed_error.stack_trace[k];
+		if( frame_view.level != control_frame.level ||
+			frame_view.name != control_frame.name ||
+			frame_view.source != control_frame.source ||
+			frame_view.currentline != control_frame.currentline )
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_line_delimiters_equivalence( const std::string &text )
+{
+	common::scan::LineDelimitersBuffer control_lines;
+	if( !common::scan::FindLineDelimiters( text, control_lines, common::scan::InstructionSet::Scalar ) )
+		return false;
+
+	for( const auto instruction_set : { common::scan::InstructionSet::SSE2, common::scan::InstructionSet::AVX2 } )
+	{
+		if( !common::scan::IsSupported( instruction_set ) )
+			continue;
+
+		common::scan::LineDelimitersBuffer lines;
+		if( !common::scan::FindLineDelimiters( text, lines, instruction_set ) || !( lines == control_lines ) )
+			return false;
+	}
+
+	return true;
+}
+
+static const char *parse_error_with_stacktrace_equivalence_cases[] = {
+	"\n[ERROR] lua_run:1: yes\n  1. error - [C]:-1\n   2. err - lua_run:1\n\n",
+	"[addon] x\n  1. a - b:1",
+	"[a] [b] c:1: d\n 1. f - g:2",
+	"[] x",
+	"[a]x",
+	"[a\r] x",
+	"[a] x\r\n  1. f - s:1",
+	"[ERROR] lua_run:1: x\n  1. f - s:1\r",
+	"[ERROR] lua_run:1: x\n\r 1. f - s:1",
+	"[ERROR] lua_run:1: x\n\n  1. f - s:1",
+	"[ERROR] x\n  1. f - - s:1",
+	"[ERROR] x\n  1. f - s - :1",
+	"[ERROR] x\n  1. f -  - :1",
+	"[ERROR] x\n  1. - s:1",
+	"[ERROR] x\n  1.  - s:1",
+	"[ERROR] x\n  1. f - s:",
+	"[ERROR] x\n  1. f - s:-",
+	"[ERROR] x\n  1. f - s:--1",
+	"[ERROR] x\n  1. f - s:1a",
+	"[ERROR] x\n  1. f - C:\\s.lua:10",
+	"[ERROR] x\n  1. f - s:99999999999",
+	"[ERROR] x\n1. f - s:1",
+	"[ERROR] x\n  a. f - s:1",
+	"[ERROR] x\n  1.f - s:1",
+	"\t\v\f\r\n ",
+	"",
+	"single line without anything"
+};
+
+static const char *parse_error_equivalence_cases[] = {
+	"lua_run:1: '=' expected near '<eof>'",
+	"addons/test/lua/autorun/test.lua:42: attempt to index a nil value (field 'x')",
+	"lua/a.lua:1: lua/b.lua:2: nested error",
+	"lua/a.lua:1: lua/b.lua:2: ",
+	"lua/a.lua:1:2: x",
+	"lua/a.lua::1: x",
+	":1: x",
+	"a:1: x",
+	"a:1: ",
+	"a:1:",
+	"a:: x",
+	"a:1x: y",
+	"a:01: y",
+	"a:99999999999: too big",
+	"a:2147483647: max",
+	"a:2147483648: overflow",
+	"a:1: multi\nline",
+	"a:1: carriage\rreturn",
+	"no separators at all",
+	"",
+	":",
+	"a:1:  double space",
+	"C:\\path\\file.lua:10: windows path"
+};
+
+static int run_equivalence_tests( )
+{
+	for( size_t k = 0; k < sizeof( parse_error_equivalence_cases ) / sizeof( *parse_error_equivalence_cases ); ++k )
+		if( !test_parse_error_equivalence( parse_error_equivalence_cases[k] ) )
+		{
+			printf( "Failed on ParseError equivalence case %zu!\n", k + 1 );
+			return 5;
+		}
+
+	for( size_t k = 0; k < sizeof( parse_error_with_stacktrace_equivalence_cases ) / sizeof( *parse_error_with_stacktrace_equivalence_cases ); ++k )
+		if( !test_parse_error_with_stacktrace_equivalence( parse_error_with_stacktrace_equivalence_cases[k] ) )
+		{
+			printf( "Failed on ParseErrorWithStackTrace equivalence case %zu!\n", k + 1 );
+			return 5;
+		}
+
+	{
+		// Valid errors with a few random mutations applied, from a fixed seed
+		static const char mutations[] = { ' ', '-', ':', '.', '1', 'a', '[', ']', '\n', '\r', '\t' };
+		const std::string base =
+			"\n[gcad] bad argument #3 to 'Add' (function expected, got nil)\n"
+			"  1. Add - lua/includes/modules/hook.lua:31\n"
+			"   2. xpcall - [C]:-1\n"
+			"    3. a - b - c:d:4\n";
+		uint32_t seed = 0x87654321;
+		std::string error;
+		for( size_t k = 0; k < 50000; ++k )
+		{
+			error = base;
+			seed = seed * 1664525 + 1013904223;
+			const size_t count = seed % 4;
+			for( size_t m = 0; m < count; ++m )
+			{
+				seed = seed * 1664525 + 1013904223;
+				const size_t position = ( seed >> 8 ) % error.size( );
+				const char c = mutations[( seed >> 24 ) % sizeof( mutations )];
+				switch( seed % 3 )
+				{
+					case 0:
+						error[position] = c;
+						break;
+
+					case 1:
+						error.insert( position, 1, c );
+						break;
+
+					default:
+						error.erase( position, 1 );
+						break;
+				}
+			}
+
+			if( !test_parse_error_with_stacktrace_equivalence( error ) )
+			{
+				printf( "Failed on ParseErrorWithStackTrace random equivalence case %zu!\n", k + 1 );
+				return 5;
+			}
+		}
+	}
+
+	{
+		// Short strings over the alphabet that matters to the grammar, from a fixed seed
+		static const char alphabet[] = { 'a', ':', '1', '0', ' ', '-', '\n', '\r' };
+		uint32_t seed = 0x12345678;
+		std::string error;
+		for( size_t k = 0; k < 50000; ++k )
+		{
+			seed = seed * 1664525 + 1013904223;
+			error.resize( seed % 12 );
+			for( char &c : error )
+			{
+				seed = seed * 1664525 + 1013904223;
+				c = alphabet[( seed >> 16 ) % sizeof( alphabet )];
+			}
+
+			if( !test_parse_error_equivalence( error ) )
+			{
+				printf( "Failed on ParseError random equivalence case %zu!\n", k + 1 );
+				return 5;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int run_batch_tests( )
+{
+	std::vector<std::string> storage;
+	for( size_t k = 0; k < 1000; ++k )
+	{
+		std::string error = "\n[addon" + std::to_string( k % 7 ) + "] lua/file" + std::to_string( k ) + ".lua:" + std::to_string( k ) + ": error\n";
+		for( size_t level = 1; level <= k % 40; ++level )
+			error += "  " + std::to_string( level ) + ". func" + std::to_string( level ) + " - lua/file" + std::to_string( level ) + ".lua:" + std::to_string( level ) + "\n";
+
+		// sprinkle some failures in
+		if( k % 13 == 0 )
+			error += "  not a frame\n";
+
+		storage.emplace_back( std::move( error ) );
+	}
+
+	const std::vector<std::string_view> errors( storage.begin( ), storage.end( ) );
+
+	std::vector<common::BatchParseResult> control_results( errors.size( ) );
+	size_t control_parsed = 0;
+	for( size_t k = 0; k < errors.size( ); ++k )
+	{
+		control_results[k].success = common::ParseErrorWithStackTrace( storage[k], control_results[k].parsed_error );
+		if( control_results[k].success )
+			++control_parsed;
+	}
+
+	for( const size_t threads : { 0, 1, 3 } )
+	{
+		common::ThreadPool pool( threads );
+		std::vector<common::BatchParseResult> results( errors.size( ) );
+		for( size_t round = 0; round < 3; ++round )
+		{
+			const size_t allocations_before = allocations::Count( );
+			if( common::ParseErrorsBatch( errors, results, &pool ) != control_parsed )
+			{
+				printf( "Failed on ParseErrorsBatch count with %zu threads!\n", threads );
+				return 5;
+			}
+
+			// Past the first round, only the job itself and threads that haven't parsed a deep trace yet may allocate
+			if( round != 0 && allocations::Count( ) - allocations_before > pool.GetConcurrency( ) * 2 + 2 )
+			{
+				printf( "Failed on ParseErrorsBatch allocations with %zu threads!\n", threads );
+				return 5;
+			}
+
+			for( size_t k = 0; k < errors.size( ); ++k )
+				if( results[k].success != control_results[k].success ||
+					( results[k].success && !( results[k].parsed_error == control_results[k].parsed_error ) ) )
+				{
+					printf( "Failed on ParseErrorsBatch result %zu with %zu threads!\n", k + 1, threads );
+					return 5;
+				}
+		}
+	}
+
+	return 0;
+}
+
+static int run_string_pool_tests( const std::string &error )
+{
+	common::ParsedErrorWithStackTrace parsed_error;
+	if( !common::ParseErrorWithStackTrace( error, parsed_error ) )
+	{
+		printf( "Failed on StringPool parsing!\n" );
+		return 5;
+	}
+
+	common::StringPool pool;
+	common::InternedErrorWithStackTrace interned_error;
+	common::InternParsedError( pool, parsed_error, interned_error );
+
+	// 16 frames, but only 9 different names and 7 different sources, plus the error and addon names
+	if( pool.GetCount( ) != 1 + 2 + 9 + 7 )
+	{
+		printf( "Failed on StringPool count (%zu)!\n", pool.GetCount( ) );
+		return 5;
+	}
+
+	// frames 10 and 13 only differ in level
+	const auto &frame10 = interned_error.stack_trace[9];
+	const auto &frame13 = interned_error.stack_trace[12];
+	if( frame10.name != frame13.name || frame10.source != frame13.source || frame10.currentline != frame13.currentline )
+	{
+		printf( "Failed on StringPool frame identifiers!\n" );
+		return 5;
+	}
+
+	common::ParsedErrorWithStackTraceView resolved_error;
+	common::ResolveInternedError( pool, interned_error, resolved_error );
+	common::ParsedErrorWithStackTrace resolved_copy;
+	common::CopyParsedError( resolved_error, resolved_copy );
+	if( !( resolved_copy == parsed_error ) )
+	{
+		printf( "Failed on StringPool resolving!\n" );
+		return 5;
+	}
+
+	const char *first = pool.GetCString( interned_error.stack_trace[0].source );
+	for( size_t k = 0; k < 100000; ++k )
+		pool.Intern( "string number " + std::to_string( k ) );
+
+	if( pool.GetCString( interned_error.stack_trace[0].source ) != first ||
+		pool.Find( "lua/includes/modules/hook.lua" ) != interned_error.stack_trace[0].source ||
+		pool.Find( "string number 99999" ) == common::StringPool::invalid_id ||
+		pool.Find( "never interned" ) != common::StringPool::invalid_id ||
+		pool.Intern( "" ) != common::StringPool::empty_id ||
+		pool.Get( pool.Intern( "string number 1234" ) ) != "string number 1234" )
+	{
+		printf( "Failed on StringPool lookups!\n" );
+		return 5;
+	}
+
+	return 0;
+}
+
+static int run_duplicate_tests( const std::string &error )
+{
+	common::ParsedErrorWithStackTraceView parsed_error;
+	if( !common::ParseErrorWithStackTrace( std::string_view( error ), parsed_error ) )
+	{
+		printf( "Failed on fingerprint parsing!\n" );
+		return 5;
+	}
+
+	const uint64_t fingerprint = common::FingerprintParsedError( parsed_error );
+	parsed_error.stack_trace.back( ).currentline += 1;
+	const uint64_t other_fingerprint = common::FingerprintParsedError( parsed_error );
+	parsed_error.stack_trace.back( ).currentline -= 1;
+
+	char formatted[17];
+	common::FormatFingerprint( fingerprint, formatted );
+	uint64_t parsed_fingerprint = 0;
+	if( fingerprint == other_fingerprint ||
+		common::FingerprintParsedError( parsed_error ) != fingerprint ||
+		!common::ParseFingerprint( formatted, parsed_fingerprint ) ||
+		parsed_fingerprint != fingerprint )
+	{
+		printf( "Failed on fingerprints!\n" );
+		return 5;
+	}
+
+	typedef common::DuplicateFilter::Clock Clock;
+	const Clock::time_point start;
+	common::DuplicateFilter filter( 8 );
+	uint32_t repeats = 0;
+
+	// disabled by default
+	if( !filter.Check( fingerprint, start, repeats ) || !filter.Check( fingerprint, start, repeats ) || repeats != 0 )
+	{
+		printf( "Failed on disabled DuplicateFilter!\n" );
+		return 5;
+	}
+
+	filter.SetWindow( std::chrono::seconds( 1 ) );
+	if( !filter.Check( fingerprint, start, repeats ) || repeats != 0 )
+	{
+		printf( "Failed on first DuplicateFilter check!\n" );
+		return 5;
+	}
+
+	// 66 ticks worth of the same error, plus a different one that must go through
+	for( size_t k = 1; k <= 66; ++k )
+		if( filter.Check( fingerprint, start + std::chrono::milliseconds( k * 15 ), repeats ) )
+		{
+			printf( "Failed on DuplicateFilter suppression %zu!\n", k );
+			return 5;
+		}
+
+	if( !filter.Check( other_fingerprint, start + std::chrono::milliseconds( 10 ), repeats ) || repeats != 0 )
+	{
+		printf( "Failed on DuplicateFilter distinct fingerprint!\n" );
+		return 5;
+	}
+
+	if( !filter.Check( fingerprint, start + std::chrono::seconds( 1 ), repeats ) || repeats != 66 )
+	{
+		printf( "Failed on DuplicateFilter summary (%u repeats)!\n", repeats );
+		return 5;
+	}
+
+	// flood the table so the original fingerprint gets evicted and is dispatched again
+	for( uint64_t k = 1; k <= 64; ++k )
+		filter.Check( k << 32, start + std::chrono::seconds( 1 ) + std::chrono::milliseconds( k ), repeats );
+
+	if( !filter.Check( fingerprint, start + std::chrono::milliseconds( 1100 ), repeats ) || repeats != 0 )
+	{
+		printf( "Failed on DuplicateFilter eviction!\n" );
+		return 5;
+	}
+
+	return 0;
+}
+
+static int run_rate_limit_tests( )
+{
+	const std::string error =
+		"\n"
+		"[ERROR] lua_run:1: yes\n"
+		"  1. a - lua_run:1\n"
+		"   2. b - lua_run:1\n"
+		"    3. c - lua_run:1\n"
+		"     4. d - lua_run:1\n";
+
+	typedef common::ClientErrorLimiter::Verdict Verdict;
+	typedef common::ClientErrorLimiter::Clock Clock;
+	const Clock::time_point start = Clock::now( );
+
+	common::ClientErrorLimiter limiter( 4 );
+	common::ClientErrorLimiter::Limits limits;
+	limits.rate = 1.0;
+	limits.burst = 3.0;
+	limits.max_bytes = 256;
+	limits.max_frames = 4;
+	limiter.SetLimits( limits );
+
+	// a full burst, then client 1 is limited while client 2 isn't
+	for( size_t k = 0; k < 3; ++k )
+		if( limiter.Check( 1, error.c_str( ), start ) != Verdict::Accept )
+		{
+			printf( "Failed on ClientErrorLimiter burst %zu!\n", k );
+			return 6;
+		}
+
+	if( limiter.Check( 1, error.c_str( ), start ) != Verdict::RateLimited ||
+		limiter.Check( 2, error.c_str( ), start ) != Verdict::Accept ||
+		limiter.Check( 1, error.c_str( ), start + std::chrono::milliseconds( 500 ) ) != Verdict::RateLimited ||
+		limiter.Check( 1, error.c_str( ), start + std::chrono::milliseconds( 1000 ) ) != Verdict::Accept )
+	{
+		printf( "Failed on ClientErrorLimiter rate!\n" );
+		return 6;
+	}
+
+	const std::string large( 257, 'x' );
+	const std::string deep = error + "  5. e - a.lua:1\n  6. f - a.lua:1\n";
+	if( limiter.Check( 2, large.c_str( ), start ) != Verdict::TooLarge ||
+		limiter.Check( 2, large.c_str( ) + 1, start ) != Verdict::Accept ||
+		limiter.Check( 3, deep.c_str( ), start ) != Verdict::TooManyFrames )
+	{
+		printf( "Failed on ClientErrorLimiter payload limits!\n" );
+		return 6;
+	}
+
+	// out of range clients share slot 0
+	const common::ClientErrorLimiter::Dropped &dropped = limiter.GetDropped( 1 );
+	if( dropped.rate_limited != 2 || dropped.Total( ) != 2 ||
+		limiter.GetDropped( 2 ).too_large != 1 ||
+		limiter.GetDropped( 3 ).too_many_frames != 1 ||
+		&limiter.GetDropped( 1000 ) != &limiter.GetDropped( 0 ) )
+	{
+		printf( "Failed on ClientErrorLimiter dropped counts!\n" );
+		return 6;
+	}
+
+	limiter.Reset( 1 );
+	if( limiter.GetDropped( 1 ).Total( ) != 0 || limiter.Check( 1, error.c_str( ), start ) != Verdict::Accept )
+	{
+		printf( "Failed on ClientErrorLimiter reset!\n" );
+		return 6;
+	}
+
+	// the same player keeps its counts, another one in the slot starts over
+	limiter.SetOwner( 2, 7 );
+	limiter.Check( 2, large.c_str( ), start );
+	limiter.SetOwner( 2, 7 );
+	const bool kept = limiter.GetDropped( 2 ).Total( ) == 1;
+	limiter.SetOwner( 2, 8 );
+	if( !kept || limiter.GetDropped( 2 ).Total( ) != 0 )
+	{
+		printf( "Failed on ClientErrorLimiter owners!\n" );
+		return 6;
+	}
+
+	if( common::ClientErrorLimiter( 1 ).Check( 0, deep.c_str( ), start ) != Verdict::Accept )
+	{
+		printf( "Failed on ClientErrorLimiter defaults!\n" );
+		return 6;
+	}
+
+	return 0;
+}
+
+static int run_async_pipeline_tests( const std::string &client_error )
+{
+	common::ParsedErrorWithStackTraceView control_client_error;
+	if( !common::ParseErrorWithStackTrace( std::string_view( client_error ), control_client_error ) )
+	{
+		printf( "Failed on AsyncErrorPipeline control parsing!\n" );
+		return 7;
+	}
+
+	typedef common::AsyncErrorPipeline::Record Record;
+
+	common::AsyncErrorPipeline pipeline( 8 );
+	pipeline.SetAddonResolver( []( std::string_view source, std::string &title, uint64_t &wsid )
+	{
+		if( source.compare( 0, 12, "addons/glib/" ) != 0 )
+			return false;
+
+		title = "GLib";
+		wsid = 1234;
+		return true;
+	} );
+
+	// records queue up while the worker is stopped, until the queue is full
+	for( size_t k = 0; k < 8; ++k )
+	{
+		Record *record = pipeline.Prepare( );
+		if( record == nullptr )
+		{
+			printf( "Failed on AsyncErrorPipeline prepare %zu!\n", k + 1 );
+			return 7;
+		}
+
+		record->runtime = k % 2 == 0;
+		if( k % 4 == 3 )
+		{
+			record->error = client_error;
+			record->client = static_cast<int32_t>( k );
+		}
+		else
+		{
+			record->error = "addons/glib/lua/glib/stage1.lua:" + std::to_string( k ) + ": attempt to call a nil value";
+			record->client = -1;
+			record->parsed_error.stack_trace = { { 1, "UnloadSystem", "@addons/glib/lua/glib/stage1.lua", 380 } };
+		}
+
+		pipeline.Push( );
+	}
+
+	if( pipeline.Prepare( ) != nullptr || pipeline.GetStats( ).dropped != 1 )
+	{
+		printf( "Failed on AsyncErrorPipeline full queue!\n" );
+		return 7;
+	}
+
+	pipeline.Start( );
+	if( !pipeline.Flush( std::chrono::seconds( 5 ) ) )
+	{
+		printf( "Failed on AsyncErrorPipeline flush!\n" );
+		return 7;
+	}
+
+	size_t index = 0;
+	bool valid = true;
+	pipeline.Drain( [&]( const Record &record )
+	{
+		if( index % 4 == 3 )
+		{
+			common::ParsedErrorWithStackTrace control_copy;
+			common::CopyParsedError( control_client_error, control_copy );
+			valid = valid && record.parsed && record.client == static_cast<int32_t>( index ) &&
+				record.parsed_error == control_copy &&
+				record.fingerprint == common::FingerprintParsedError( control_client_error ) &&
+				record.addon_title.empty( );
+		}
+		else
+		{
+			uint64_t fingerprint = common::FingerprintError(
+				"addons/glib/lua/glib/stage1.lua",
+				static_cast<int32_t>( index ),
+				"attempt to call a nil value"
+			);
+			fingerprint = common::FingerprintStackFrame( fingerprint, "@addons/glib/lua/glib/stage1.lua", 380 );
+			valid = valid && record.parsed && record.runtime == ( index % 2 == 0 ) &&
+				record.parsed_error.source_line == static_cast<int32_t>( index ) &&
+				record.parsed_error.error_string == "attempt to call a nil value" &&
+				record.fingerprint == fingerprint &&
+				record.addon_title == "GLib" && record.addon_wsid == 1234;
+		}
+
+		++index;
+	} );
+
+	if( !valid || index != 8 )
+	{
+		printf( "Failed on AsyncErrorPipeline results!\n" );
+		return 7;
+	}
+
+	// the same thread producing and draining, like the game thread does, with the worker in between
+	const std::string other_error = "lua_run:1: yes";
+	size_t produced = 0, consumed = 0;
+	valid = true;
+	while( consumed < 20000 )
+	{
+		Record *record = nullptr;
+		if( produced < 20000 && ( record = pipeline.Prepare( ) ) != nullptr )
+		{
+			record->error = produced % 3 == 0 ? client_error : other_error;
+			record->client = produced % 3 == 0 ? 1 : -1;
+			record->parsed_error.stack_trace.clear( );
+			pipeline.Push( );
+			++produced;
+		}
+
+		pipeline.Drain( [&]( const Record &result )
+		{
+			const bool is_client = consumed % 3 == 0;
+			valid = valid && result.parsed && ( result.client == 1 ) == is_client &&
+				result.error == ( is_client ? client_error : other_error );
+			++consumed;
+		} );
+	}
+
+	const common::AsyncErrorPipeline::Stats stats = pipeline.GetStats( );
+	if( !valid || stats.pushed != 20008 || stats.processed != 20008 || stats.delivered != 20008 )
+	{
+		printf( "Failed on AsyncErrorPipeline ordering!\n" );
+		return 7;
+	}
+
+	pipeline.Stop( );
+	return 0;
+}
+
+static int run_journal_tests( const std::string &client_error )
+{
+	const std::string path = "luaerror_testing.journal";
+	std::remove( path.c_str( ) );
+	std::remove( ( path + ".1" ).c_str( ) );
+	std::remove( ( path + ".2" ).c_str( ) );
+
+	const common::ParsedErrorWithStackTraceView::StackFrame stack[] = {
+		{ 1, "error", "=[C]", -1 },
+		{ 2, "UnloadSystem", "@addons/glib/lua/glib/stage1.lua", 380 }
+	};
+	const std::string lua_error = "addons/glib/lua/glib/stage1.lua:380: attempt to call a nil value";
+
+	common::JournalWriter::Options options;
+	options.path = path;
+	options.max_file_bytes = 4096;
+	options.max_rotated_files = 1;
+	options.flush_interval = std::chrono::milliseconds( 10 );
+
+	common::JournalWriter writer;
+	writer.SetAddonResolver( []( std::string_view source, std::string &title, uint64_t &wsid )
+	{
+		if( source.compare( 0, 12, "addons/glib/" ) != 0 )
+			return false;
+
+		title = "GLib";
+		wsid = 1234;
+		return true;
+	} );
+
+	if( !writer.Open( options ) ||
+		!writer.Append( 1000, true, -1, lua_error, common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( stack, 2 ) ) ||
+		!writer.Append( 2000, false, 3, client_error ) ||
+		!writer.Append( 3000, false, -1, "not an error we can parse" ) ||
+		!writer.Flush( std::chrono::seconds( 5 ) ) )
+	{
+		printf( "Failed on JournalWriter writes!\n" );
+		return 8;
+	}
+
+	common::JournalReader reader;
+	common::JournalRecord record;
+	common::ParsedErrorWithStackTraceView control_client_error;
+	common::ParseErrorWithStackTrace( std::string_view( client_error ), control_client_error );
+	if( !reader.Open( path ) || !reader.Next( record ) ||
+		record.time != 1000 || record.flags != ( common::JournalRecord::Runtime | common::JournalRecord::Parsed ) ||
+		record.client != -1 || record.error.source_file != "addons/glib/lua/glib/stage1.lua" ||
+		record.error.source_line != 380 || record.error.addon_name != "GLib" ||
+		record.error.stack_trace.size( ) != 2 || !( record.error.stack_trace[1] == stack[1] ) )
+	{
+		printf( "Failed on JournalReader runtime record!\n" );
+		return 8;
+	}
+
+	if( !reader.Next( record ) ||
+		record.flags != ( common::JournalRecord::Client | common::JournalRecord::Parsed ) ||
+		record.client != 3 || !( record.error == control_client_error ) ||
+		record.fingerprint != common::FingerprintParsedError( control_client_error ) )
+	{
+		printf( "Failed on JournalReader client record!\n" );
+		return 8;
+	}
+
+	if( !reader.Next( record ) || record.flags != 0 || record.error.error_string != "not an error we can parse" ||
+		reader.Next( record ) || reader.IsCorrupted( ) )
+	{
+		printf( "Failed on JournalReader unparsed record!\n" );
+		return 8;
+	}
+
+	reader.Close( );
+
+	// past 4096 bytes the file is rotated, and only one rotated file is kept
+	for( size_t k = 0; k < 200; ++k )
+	{
+		writer.Append( 4000 + k, true, -1, lua_error + std::to_string( k ), common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( stack, 2 ) );
+		if( k % 20 == 19 )
+			writer.Flush( std::chrono::seconds( 5 ) );
+	}
+
+	writer.Close( );
+
+	const common::JournalWriter::Stats stats = writer.GetStats( );
+	if( stats.appended != 203 || stats.written_records != 203 || stats.rotations == 0 || stats.write_errors != 0 )
+	{
+		printf( "Failed on JournalWriter stats!\n" );
+		return 8;
+	}
+
+	size_t records = 0;
+	uint64_t last_time = 0;
+	for( const std::string &file : { path + ".1", path } )
+	{
+		if( !reader.Open( file ) )
+		{
+			printf( "Failed on JournalReader rotated file %s!\n", file.c_str( ) );
+			return 8;
+		}
+
+		while( reader.Next( record ) )
+		{
+			if( record.time <= last_time || record.error.addon_name != "GLib" )
+			{
+				printf( "Failed on JournalReader rotated record!\n" );
+				return 8;
+			}
+
+			last_time = record.time;
+			++records;
+		}
+
+		if( reader.IsCorrupted( ) )
+		{
+			printf( "Failed on JournalReader rotated file %s corruption!\n", file.c_str( ) );
+			return 8;
+		}
+	}
+
+	reader.Close( );
+	std::remove( path.c_str( ) );
+	std::remove( ( path + ".1" ).c_str( ) );
+
+	if( records == 0 || records >= 203 || last_time != 4199 )
+	{
+		printf( "Failed on JournalReader rotated records (%zu)!\n", records );
+		return 8;
+	}
+
+	return 0;
+}
+
+#if !defined _WIN32
+
+// Reads every datagram the collector stand-in has queued, returns the amount of them.
+static size_t receive_datagrams( const int collector, std::string &lines )
+{
+	size_t datagrams = 0;
+	char buffer[65536];
+	ssize_t size = 0;
+	while( ( size = recv( collector, buffer, sizeof( buffer ), MSG_DONTWAIT ) ) > 0 )
+	{
+		lines.append( buffer, static_cast<size_t>( size ) );
+		++datagrams;
+	}
+
+	return datagrams;
+}
+
+static size_t count_lines( const std::string &lines )
+{
+	size_t count = 0;
+	for( const char c : lines )
+		count += c == '\n' ? 1 : 0;
+
+	return count;
+}
+
+#endif
+
+static int run_exporter_tests( const std::string &client_error )
+{
+	common::ErrorExporter exporter;
+	common::ErrorExporter::Options options;
+	std::string error;
+
+	options.address = "tcp:127.0.0.1:1234";
+	if( exporter.Open( options, error ) || error.empty( ) )
+	{
+		printf( "Failed on ErrorExporter address validation!\n" );
+		return 9;
+	}
+
+#if defined _WIN32
+
+	return 0;
+
+#else
+
+	const common::ParsedErrorWithStackTraceView::StackFrame stack[] = {
+		{ 1, "error", "=[C]", -1 },
+		{ 2, "UnloadSystem", "@addons/glib/lua/glib/stage1.lua", 380 }
+	};
+	const std::string lua_error = "addons/glib/lua/glib/stage1.lua:380: attempt to call a nil value";
+
+	// a local datagram socket stands in for the collector
+	const std::string path = "luaerror_testing.sock";
+	unlink( path.c_str( ) );
+	const int collector = socket( AF_UNIX, SOCK_DGRAM, 0 );
+	sockaddr_un address = { };
+	address.sun_family = AF_UNIX;
+	std::strcpy( address.sun_path, path.c_str( ) );
+	if( collector == -1 || bind( collector, reinterpret_cast<const sockaddr *>( &address ), sizeof( address ) ) != 0 )
+	{
+		printf( "Failed on ErrorExporter collector setup!\n" );
+		return 9;
+	}
+
+	exporter.SetAddonResolver( []( std::string_view source, std::string &title, uint64_t &wsid )
+	{
+		if( source.compare( 0, 12, "addons/glib/" ) != 0 )
+			return false;
+
+		title = "GLib";
+		wsid = 1234;
+		return true;
+	} );
+
+	options.address = "unix:" + path;
+	options.tag = "test";
+	options.max_batch_records = 2;
+	options.max_batch_delay = std::chrono::milliseconds( 10 );
+	if( !exporter.Open( options, error ) ||
+		!exporter.Append( 1000, true, -1, lua_error, common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( stack, 2 ) ) ||
+		!exporter.Append( 2000, false, 3, client_error ) ||
+		!exporter.Append( 3000, false, -1, "not an error we can parse" ) ||
+		!exporter.Flush( std::chrono::seconds( 5 ) ) )
+	{
+		printf( "Failed on ErrorExporter sends (%s)!\n", error.c_str( ) );
+		return 9;
+	}
+
+	// two errors per batch, the last one alone
+	std::string lines;
+	const size_t datagrams = receive_datagrams( collector, lines );
+
+	common::ErrorRecord record;
+	record.time = 2000;
+	record.flags = common::ErrorRecord::Client | common::ErrorRecord::Parsed;
+	record.client = 3;
+	common::ParseErrorWithStackTrace( std::string_view( client_error ), record.error );
+	record.fingerprint = common::FingerprintParsedError( record.error );
+	std::string client_line;
+	common::AppendErrorJson( client_line, record, "test" );
+
+	if( datagrams != 2 || count_lines( lines ) != 3 ||
+		lines.find( "\"addon\":\"GLib\"" ) == std::string::npos ||
+		lines.find( client_line + '\n' ) == std::string::npos ||
+		lines.find( "\"errorstr\":\"not an error we can parse\"" ) == std::string::npos )
+	{
+		printf( "Failed on ErrorExporter batches (%zu datagrams)!\n%s", datagrams, lines.c_str( ) );
+		return 9;
+	}
+
+	// a collector that doesn't read: once its queue fills up batches are dropped and counted
+	exporter.Close( );
+	const uint64_t sent_before = exporter.GetStats( ).sent_records;
+	options.max_batch_records = 1;
+	options.backpressure_timeout = std::chrono::milliseconds( 0 );
+	if( !exporter.Open( options, error ) )
+	{
+		printf( "Failed on ErrorExporter reopen (%s)!\n", error.c_str( ) );
+		return 9;
+	}
+
+	for( size_t k = 0; k < 2000; ++k )
+	{
+		if( !exporter.Append( 4000 + k, true, -1, lua_error, common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( stack, 2 ) ) )
+			exporter.Flush( std::chrono::seconds( 5 ) );
+	}
+
+	exporter.Flush( std::chrono::seconds( 5 ) );
+	exporter.Close( );
+
+	lines.clear( );
+	receive_datagrams( collector, lines );
+	close( collector );
+	unlink( path.c_str( ) );
+
+	const common::ErrorExporter::Stats stats = exporter.GetStats( );
+	if( stats.dropped_records == 0 || stats.sent_records - sent_before != count_lines( lines ) ||
+		stats.appended != stats.sent_records + stats.dropped_records || stats.send_errors != 0 )
+	{
+		printf( "Failed on ErrorExporter backpressure stats!\n" );
+		return 9;
+	}
+
+	// UDP to a local port
+	const int udp_collector = socket( AF_INET, SOCK_DGRAM, 0 );
+	sockaddr_in udp_address = { };
+	udp_address.sin_family = AF_INET;
+	udp_address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	socklen_t udp_address_size = sizeof( udp_address );
+	if( udp_collector == -1 ||
+		bind( udp_collector, reinterpret_cast<const sockaddr *>( &udp_address ), sizeof( udp_address ) ) != 0 ||
+		getsockname( udp_collector, reinterpret_cast<sockaddr *>( &udp_address ), &udp_address_size ) != 0 )
+	{
+		printf( "Failed on ErrorExporter UDP collector setup!\n" );
+		return 9;
+	}
+
+	options.address = "udp:127.0.0.1:" + std::to_string( ntohs( udp_address.sin_port ) );
+	options.backpressure_timeout = std::chrono::milliseconds( 100 );
+	lines.clear( );
+	if( !exporter.Open( options, error ) ||
+		!exporter.Append( 2000, false, 3, client_error ) ||
+		!exporter.Flush( std::chrono::seconds( 5 ) ) ||
+		receive_datagrams( udp_collector, lines ) != 1 || lines != client_line + '\n' )
+	{
+		printf( "Failed on ErrorExporter UDP sends!\n" );
+		return 9;
+	}
+
+	exporter.Close( );
+	close( udp_collector );
+	return 0;
+
+#endif
+}
+
+// Writes a .gma holding paths, the same layout gmad writes.
+static bool write_gma( const std::string &path, const std::vector<std::string> &paths, const bool truncate )
+{
+	std::string data( "GMAD\3", 5 );
+	data.append( 16, '\0' );
+	data.append( "content\0\0", 9 );
+	data.append( "name\0description\0author\0", 24 );
+	data.append( "\1\0\0\0", 4 );
+	uint32_t number = 0;
+	for( const std::string &file : paths )
+	{
+		++number;
+		data.append( reinterpret_cast<const char *>( &number ), 4 );
+		data.append( file.c_str( ), file.size( ) + 1 );
+		data.append( 12, '\0' );
+	}
+
+	data.append( 4, '\0' );
+	if( truncate )
+		data.resize( data.size( ) - 10 );
+
+	std::FILE *file = std::fopen( path.c_str( ), "wb" );
+	if( file == nullptr )
+		return false;
+
+	const bool written = std::fwrite( data.data( ), 1, data.size( ), file ) == data.size( );
+	return std::fclose( file ) == 0 && written;
+}
+
+static int run_addon_index_tests( )
+{
+	const std::string path = "luaerror_testing.gma";
+	const std::vector<std::string> glib_files = {
+		"lua/glib/stage1.lua",
+		"lua/glib/oop/oop.lua",
+		"lua/autorun/glib.lua"
+	};
+
+	common::AddonIndex index;
+	const common::AddonIndex::AddonId glib = index.AddAddon( "GLib", 1234 );
+	const common::AddonIndex::AddonId gcad = index.AddAddon( "GCAD", 5678 );
+
+	std::vector<std::string> read_files;
+	std::FILE *file = nullptr;
+	if( !write_gma( path, glib_files, false ) || ( file = std::fopen( path.c_str( ), "rb" ) ) == nullptr ||
+		!common::ReadGmaFileList( file, [&]( std::string_view file_path )
+		{
+			read_files.emplace_back( file_path );
+			index.AddFile( glib, file_path );
+		} ) || read_files != glib_files )
+	{
+		if( file != nullptr )
+			std::fclose( file );
+
+		std::remove( path.c_str( ) );
+		printf( "Failed on ReadGmaFileList!\n" );
+		return 10;
+	}
+
+	std::fclose( file );
+
+	// a truncated header still reports the files read until then
+	read_files.clear( );
+	bool truncated_read = false;
+	if( write_gma( path, glib_files, true ) && ( file = std::fopen( path.c_str( ), "rb" ) ) != nullptr )
+	{
+		truncated_read = common::ReadGmaFileList( file, [&]( std::string_view file_path ) { read_files.emplace_back( file_path ); } );
+		std::fclose( file );
+	}
+
+	std::remove( path.c_str( ) );
+	if( truncated_read || read_files.size( ) != 2 )
+	{
+		printf( "Failed on ReadGmaFileList truncated header!\n" );
+		return 10;
+	}
+
+	// the first addon to have a file keeps it
+	index.AddFile( gcad, "lua/autorun/glib.lua" );
+	index.AddFile( gcad, "lua/gcad/ui/contextmenu/contextmenueventhandler.lua" );
+
+	const common::AddonIndex::Addon *owner = index.Find( "lua/glib/oop/oop.lua" );
+	if( owner == nullptr || owner->title != "GLib" || owner->wsid != 1234 ||
+		index.Find( "@lua/GLib/Stage1.lua" ) != owner || index.Find( "lua\\glib\\stage1.lua" ) != owner ||
+		index.Find( "lua/autorun/glib.lua" ) != owner ||
+		index.Find( "lua/gcad/ui/contextmenu/contextmenueventhandler.lua" )->wsid != 5678 ||
+		index.Find( "lua/glib" ) != nullptr || index.Find( "lua/glib/missing.lua" ) != nullptr ||
+		index.Find( "" ) != nullptr || index.Find( "[C]" ) != nullptr ||
+		index.GetAddonCount( ) != 2 || index.GetFileCount( ) != 4 || index.IsIncomplete( ) )
+	{
+		printf( "Failed on AddonIndex lookups!\n" );
+		return 10;
+	}
 
-static bool test_parsed_error( const std::string &error, const common::ParsedError &control_parsed_error )
+	common::AddonLookupCache cache( 4 );
+	for( size_t k = 0; k < 3; ++k )
+		if( cache.Find( index, "@lua/glib/stage1.lua" ) != owner || cache.Find( index, "lua/gcad/missing.lua" ) != nullptr ||
+			cache.Find( index, glib_files[k] ) != owner )
+		{
+			printf( "Failed on AddonLookupCache!\n" );
+			return 10;
+		}
+
+	// a rebuilt index invalidates whatever the cache remembers
+	common::AddonIndex rebuilt;
+	rebuilt.AddFile( rebuilt.AddAddon( "GCAD", 5678 ), "lua/glib/stage1.lua" );
+	cache.Clear( );
+	if( cache.Find( rebuilt, "lua/glib/stage1.lua" )->wsid != 5678 )
+	{
+		printf( "Failed on AddonLookupCache invalidation!\n" );
+		return 10;
+	}
+
+	return 0;
+}
+
+static int run_stats_tests( )
 {
-	common::ParsedError parsed_error;
-	if( !common::ParseError( error, parsed_error ) )
-		return false;
+	common::LatencyHistogram histogram;
+	if( histogram.GetCount( ) != 0 || histogram.GetQuantile( 0.5 ) != common::LatencyHistogram::Clock::duration::zero( ) )
+	{
+		printf( "Failed on LatencyHistogram empty state!\n" );
+		return 11;
+	}
 
-	return parsed_error == control_parsed_error;
+	// 90 samples of 100ns (bucket of 64 to 127ns), 9 of 10us and a single 1ms one
+	for( size_t k = 0; k < 90; ++k )
+		histogram.Add( std::chrono::nanoseconds( 100 ) );
+
+	for( size_t k = 0; k < 9; ++k )
+		histogram.Add( std::chrono::microseconds( 10 ) );
+
+	histogram.Add( std::chrono::milliseconds( 1 ) );
+	histogram.Add( std::chrono::nanoseconds( -5 ) );
+
+	if( histogram.GetCount( ) != 101 || histogram.GetBucket( 7 ) != 90 || histogram.GetBucket( 14 ) != 9 ||
+		histogram.GetBucket( 0 ) != 1 ||
+		histogram.GetTotal( ) != std::chrono::nanoseconds( 90 * 100 + 9 * 10000 + 1000000 ) ||
+		histogram.GetMax( ) != std::chrono::milliseconds( 1 ) ||
+		histogram.GetQuantile( 0.5 ) != std::chrono::nanoseconds( 128 ) ||
+		histogram.GetQuantile( 0.95 ) != std::chrono::nanoseconds( 16384 ) ||
+		histogram.GetQuantile( 1.0 ) != std::chrono::milliseconds( 1 ) )
+	{
+		printf( "Failed on LatencyHistogram samples!\n" );
+		return 11;
+	}
+
+	common::ErrorPathStats stats;
+	stats.seen = 3;
+	stats.bytes = 100;
+	{
+		common::ScopedTimer timer( stats.timers[common::ErrorPathStats::HookCall] );
+	}
+
+	if( stats.timers[common::ErrorPathStats::HookCall].GetCount( ) != 1 ||
+		stats.timers[common::ErrorPathStats::Parse].GetCount( ) != 0 )
+	{
+		printf( "Failed on ScopedTimer!\n" );
+		return 11;
+	}
+
+	stats.Reset( );
+	if( stats.seen != 0 || stats.bytes != 0 || stats.timers[common::ErrorPathStats::HookCall].GetCount( ) != 0 )
+	{
+		printf( "Failed on ErrorPathStats reset!\n" );
+		return 11;
+	}
+
+	return 0;
 }
 
-static bool test_parsed_error_with_stacktrace( const std::string &error, const common::ParsedErrorWithStackTrace &control_parsed_error )
+// Recursion cycles (like the loader frames of test case 2) fold into groups, frames that don't
+// repeat stay in groups of their own.
+static int run_stack_group_tests( const std::string &error )
 {
-	common::ParsedErrorWithStackTrace parsed_error;
-	if( !common::ParseErrorWithStackTrace( error, parsed_error ) )
-		return false;
+	common::ParsedErrorWithStackTraceView parsed_error;
+	if( !common::ParseErrorWithStackTrace( std::string_view( error ), parsed_error ) )
+	{
+		printf( "Failed on stack groups parsing!\n" );
+		return 13;
+	}
 
-	return parsed_error == control_parsed_error;
+	std::vector<uint64_t> hashes;
+	std::vector<common::StackGroup> groups;
+	common::FoldStackTrace( parsed_error.stack_trace, hashes, groups );
+	const std::vector<common::StackGroup> loader_groups = { { 0, 8, 1 }, { 8, 3, 2 }, { 14, 2, 1 } };
+	if( groups != loader_groups )
+	{
+		printf( "Failed on stack groups of test case 2!\n" );
+		return 13;
+	}
+
+	// one frame, 300 times the same two frames (a stack overflow) and another frame
+	hashes.assign( 1, 1 );
+	for( size_t k = 0; k < 300; ++k )
+	{
+		hashes.push_back( 2 );
+		hashes.push_back( 3 );
+	}
+
+	hashes.push_back( 4 );
+	common::FoldStackRepeats( common::Span<const uint64_t>( hashes ), groups );
+	const std::vector<common::StackGroup> overflow_groups = { { 0, 1, 1 }, { 1, 2, 300 }, { 601, 1, 1 } };
+	if( groups != overflow_groups )
+	{
+		printf( "Failed on stack groups of a deep recursion!\n" );
+		return 13;
+	}
+
+	// the shortest sequence wins ties, cycles longer than max_period aren't folded
+	hashes = { 5, 5, 5, 5 };
+	common::FoldStackRepeats( common::Span<const uint64_t>( hashes ), groups );
+	const std::vector<common::StackGroup> tie_groups = { { 0, 1, 4 } };
+	hashes = { 1, 2, 3, 1, 2, 3 };
+	std::vector<common::StackGroup> long_groups;
+	common::FoldStackRepeats( common::Span<const uint64_t>( hashes ), long_groups, 2 );
+	const std::vector<common::StackGroup> unfolded_groups = { { 0, 6, 1 } };
+	if( groups != tie_groups || long_groups != unfolded_groups )
+	{
+		printf( "Failed on stack groups periods!\n" );
+		return 13;
+	}
+
+	common::ErrorRecord record;
+	record.flags = common::ErrorRecord::Client | common::ErrorRecord::Parsed;
+	record.error = parsed_error;
+	std::string full_json, folded_json;
+	common::AppendErrorJson( full_json, record );
+	common::AppendErrorJson( folded_json, record, std::string_view( ), true );
+	if( folded_json.size( ) >= full_json.size( ) ||
+		folded_json.find( "{\"level\":9,\"name\":\"runNextPackFile\"" ) == std::string::npos ||
+		folded_json.find( "\"repeats\":2,\"period\":3}" ) == std::string::npos ||
+		folded_json.find( "\"level\":12," ) != std::string::npos ||
+		folded_json.find( "\"level\":16," ) == std::string::npos )
+	{
+		printf( "Failed on folded stack JSON!\n%s\n", folded_json.c_str( ) );
+		return 13;
+	}
+
+	return 0;
+}
+
+static int run_capture_budget_tests( )
+{
+	typedef common::CaptureBudget::Level Level;
+
+	common::CaptureBudget budget;
+	budget.Spend( Level::Full, std::chrono::seconds( 10 ), 1024 * 1024 );
+	if( budget.IsEnabled( ) || budget.Select( ) != Level::Full )
+	{
+		printf( "Failed on CaptureBudget without limits!\n" );
+		return 14;
+	}
+
+	common::CaptureBudget::Limits limits;
+	limits.time = std::chrono::milliseconds( 2 );
+	limits.bytes = 1000;
+	budget.SetLimits( limits );
+	budget.Reset( );
+
+	// full until either limit is spent, frames until it's spent again, then the top frame
+	budget.Spend( Level::Full, std::chrono::microseconds( 500 ), 400 );
+	const Level first = budget.Select( );
+	budget.Spend( Level::Full, std::chrono::microseconds( 500 ), 700 );
+	const Level second = budget.Select( );
+	budget.Spend( Level::Frames, std::chrono::microseconds( 1500 ), 100 );
+	const Level third = budget.Select( );
+	budget.Spend( Level::Frames, std::chrono::microseconds( 1500 ), 10 );
+	const Level fourth = budget.Select( );
+	if( first != Level::Full || second != Level::Frames || third != Level::Frames || fourth != Level::TopFrame )
+	{
+		printf( "Failed on CaptureBudget step downs!\n" );
+		return 14;
+	}
+
+	budget.Reset( );
+	if( budget.Select( ) != Level::Full || budget.GetCount( Level::Full ) != 3 ||
+		budget.GetCount( Level::Frames ) != 2 || budget.GetCount( Level::TopFrame ) != 0 ||
+		std::strcmp( common::CaptureBudget::GetLevelName( Level::TopFrame ), "top" ) != 0 )
+	{
+		printf( "Failed on CaptureBudget tick reset!\n" );
+		return 14;
+	}
+
+	budget.ClearCounts( );
+	if( budget.GetCount( Level::Full ) != 0 )
+	{
+		printf( "Failed on CaptureBudget counts!\n" );
+		return 14;
+	}
+
+	return 0;
+}
+
+static int run_source_cache_tests( )
+{
+	const auto now = common::SourceCache::Clock::now( );
+	common::SourceCache cache( 64 * 1024, 2 );
+
+	const common::SourceCache::File *file = cache.Insert( "lua/a.lua", 10, "local a = 1\r\n\nerror( a )", now );
+	if( file == nullptr || file->GetLineCount( ) != 3 || file->GetLine( 1 ) != "local a = 1" ||
+		file->GetLine( 2 ) != "" || file->GetLine( 3 ) != "error( a )" || file->GetLine( 4 ) != "" ||
+		file->GetLine( 0 ) != "" )
+	{
+		printf( "Failed on SourceCache lines!\n" );
+		return 15;
+	}
+
+	cache.Insert( "lua/b.lua", 20, "b\n", now );
+	if( cache.Find( "lua/a.lua" ) == nullptr || cache.Find( "lua/c.lua" ) != nullptr ||
+		cache.GetHits( ) != 1 || cache.GetMisses( ) != 1 )
+	{
+		printf( "Failed on SourceCache lookups!\n" );
+		return 15;
+	}
+
+	// b is the least recently used, a was just looked up
+	cache.Insert( "lua/c.lua", 30, "c\n", now );
+	if( cache.GetFileCount( ) != 2 || cache.Find( "lua/b.lua" ) != nullptr || cache.Find( "lua/a.lua" ) == nullptr )
+	{
+		printf( "Failed on SourceCache eviction!\n" );
+		return 15;
+	}
+
+	// a changed file replaces the cached one
+	cache.Insert( "lua/a.lua", 11, "changed\n", now );
+	file = cache.Find( "lua/a.lua" );
+	if( cache.GetFileCount( ) != 2 || file == nullptr || file->GetModificationTime( ) != 11 ||
+		file->GetLineCount( ) != 1 || file->GetLine( 1 ) != "changed" )
+	{
+		printf( "Failed on SourceCache replacement!\n" );
+		return 15;
+	}
+
+	const size_t bytes = cache.GetBytes( );
+	if( cache.Insert( "lua/huge.lua", 1, std::string( 128 * 1024, 'x' ), now ) != nullptr || cache.GetBytes( ) != bytes )
+	{
+		printf( "Failed on SourceCache size limit!\n" );
+		return 15;
+	}
+
+	cache.SetLimits( 0, 2 );
+	if( cache.GetFileCount( ) != 0 || cache.GetBytes( ) != 0 )
+	{
+		printf( "Failed on SourceCache limits!\n" );
+		return 15;
+	}
+
+	return 0;
+}
+
+static int run_recent_tests( )
+{
+	common::RecentErrors recent;
+	common::RecentErrors::Error error;
+	error.error = "lua/a.lua:1: boom";
+	recent.Record( error );
+	if( recent.IsEnabled( ) || recent.GetCount( ) != 0 || recent.GetRecorded( ) != 0 )
+	{
+		printf( "Failed on RecentErrors disabled state!\n" );
+		return 16;
+	}
+
+	const common::ParsedErrorWithStackTraceView::StackFrame stack[] = {
+		{ 1, "error", "=[C]", -1 },
+		{ 2, "Think", "@lua/a.lua", 1 },
+		{ 3, "", "@lua/b.lua", 7 }
+	};
+	const common::Span<const common::ParsedErrorWithStackTraceView::StackFrame> frames( stack, 3 );
+
+	recent.Configure( 3, 256, 2 );
+	const std::string messages[] = { "lua/a.lua:1: first", "lua/a.lua:1: second", "lua/a.lua:1: third", "lua/a.lua:1: fourth" };
+
+	// recording reuses the slots allocated by Configure
+	const size_t allocations_before = allocations::Count( );
+	for( size_t k = 0; k < 4; ++k )
+	{
+		error.error = messages[k];
+		error.source_file = "lua/a.lua";
+		error.source_line = 1;
+		error.error_string = std::string_view( messages[k] ).substr( 13 );
+		error.fingerprint = k;
+		recent.Record( error, frames );
+	}
+
+	if( allocations::Count( ) != allocations_before )
+	{
+		printf( "Failed on RecentErrors allocations!\n" );
+		return 16;
+	}
+
+	// the first error was overwritten by the fourth, newest first
+	std::vector<uint64_t> sequences;
+	recent.ForEach( [&sequences]( const common::RecentErrors::Entry &entry )
+	{
+		sequences.push_back( entry.sequence );
+		return entry.error == "lua/a.lua:1: " + std::string( entry.error_string ) &&
+			entry.fingerprint == entry.sequence - 1 &&
+			entry.frames.size( ) == 2 && entry.frames[1].name == "Think" && entry.frames[1].currentline == 1 &&
+			entry.truncated;
+	} );
+	if( recent.GetCount( ) != 3 || recent.GetRecorded( ) != 4 || sequences != std::vector<uint64_t>{ 4, 3, 2 } )
+	{
+		printf( "Failed on RecentErrors ring!\n" );
+		return 16;
+	}
+
+	// the full error is cut first, the short fields are kept
+	recent.Configure( 1, 16, 0 );
+	error.error = messages[0];
+	error.error_string = "first";
+	recent.Record( error );
+	bool truncated = false;
+	recent.ForEach( [&truncated]( const common::RecentErrors::Entry &entry )
+	{
+		truncated = entry.truncated && entry.source_file == "lua/a.lua" && entry.error_string == "first" &&
+			entry.error == "lu" && entry.frames.size( ) == 0;
+		return true;
+	} );
+	if( !truncated )
+	{
+		printf( "Failed on RecentErrors truncation!\n" );
+		return 16;
+	}
+
+	recent.Configure( 0 );
+	if( recent.IsEnabled( ) || recent.GetCount( ) != 0 )
+	{
+		printf( "Failed on RecentErrors disabling!\n" );
+		return 16;
+	}
+
+	return 0;
+}
+
+static int run_heavy_hitters_tests( )
+{
+	common::HeavyHitters hitters( 16, 8 );
+
+	// three keys flooding between a lot of keys seen only once
+	uint64_t noise = 1000;
+	const size_t allocations_before = allocations::Count( );
+	for( size_t k = 0; k < 2000; ++k )
+	{
+		hitters.Add( 1, "first" );
+		if( k % 2 == 0 )
+			hitters.Add( 2, "second" );
+
+		if( k % 4 == 0 )
+			hitters.Add( 3, "a very long third label" );
+
+		hitters.Add( noise++, "noise" );
+		hitters.Add( noise++, "noise" );
+	}
+
+	if( allocations::Count( ) != allocations_before )
+	{
+		printf( "Failed on HeavyHitters allocations!\n" );
+		return 17;
+	}
+
+	const uint64_t expected[] = { 2000, 1000, 500 };
+	std::vector<const common::HeavyHitters::Counter *> top;
+	hitters.GetTop( 3, top );
+	if( hitters.GetSize( ) != 16 || hitters.GetTotal( ) != 7500 || top.size( ) != 3 )
+	{
+		printf( "Failed on HeavyHitters size!\n" );
+		return 17;
+	}
+
+	for( size_t k = 0; k < 3; ++k )
+		if( top[k]->key != k + 1 || top[k]->count < expected[k] || top[k]->count - top[k]->error > expected[k] )
+		{
+			printf( "Failed on HeavyHitters estimates!\n" );
+			return 17;
+		}
+
+	if( top[0]->label != "first" || top[2]->label != "a very l" )
+	{
+		printf( "Failed on HeavyHitters labels!\n" );
+		return 17;
+	}
+
+	// every counter is still reachable after all the evictions
+	std::vector<const common::HeavyHitters::Counter *> all;
+	hitters.GetTop( 100, all );
+	for( const common::HeavyHitters::Counter *counter : all )
+	{
+		const uint64_t count = counter->count;
+		hitters.Add( counter->key, counter->label );
+		if( counter->count != count + 1 )
+		{
+			printf( "Failed on HeavyHitters lookups!\n" );
+			return 17;
+		}
+	}
+
+	hitters.Clear( );
+	hitters.GetTop( 3, top );
+	if( !top.empty( ) || hitters.GetTotal( ) != 0 )
+	{
+		printf( "Failed on HeavyHitters clearing!\n" );
+		return 17;
+	}
+
+	hitters.Configure( 0 );
+	hitters.Add( 1, "first" );
+	if( hitters.IsEnabled( ) || hitters.GetSize( ) != 0 )
+	{
+		printf( "Failed on HeavyHitters disabling!\n" );
+		return 17;
+	}
+
+	return 0;
+}
+
+static int run_log_analysis_tests( )
+{
+	const std::string log =
+		"Player 1 connected\n"
+		"[ERROR] addons/foo/lua/foo.lua:12: attempt to index a nil value\n"
+		"  1. Think - addons/foo/lua/foo.lua:12\n"
+		"   2. unknown - lua/includes/modules/hook.lua:84\n"
+		"[DarkRP] loaded module\n"
+		"L 10/17/2026 - 12:00:01: [Bar] lua/bar.lua:3: boom\r\n"
+		"L 10/17/2026 - 12:00:01:   1. unknown - lua/bar.lua:3\r\n"
+		"[ERROR] addons/foo/lua/foo.lua:12: attempt to index a nil value\n"
+		"  1. Think - addons/foo/lua/foo.lua:12\n"
+		"   2. unknown - lua/includes/modules/hook.lua:84\n"
+		"L 10/17/2026 - 12:00:02: [Bar] lua/bar.lua:3: boom\r\n"
+		"L 10/17/2026 - 12:00:02:   1. unknown - lua/bar.lua:3\r\n"
+		"[ERROR] addons/foo/lua/foo.lua:12: attempt to index a nil value\n"
+		"  1. Think - addons/foo/lua/foo.lua:12\n"
+		"   2. unknown - lua/includes/modules/hook.lua:84";
+
+	// tiny chunks split errors everywhere, the results must match a single chunk
+	common::ThreadPool pool( 3 );
+	common::LogAnalysis whole, split;
+	whole.Analyze( log, 0 );
+	for( size_t file = 0; file < 2; ++file )
+		split.Analyze( log, file, &pool, 7 );
+
+	const auto errors = split.GetErrors( );
+	if( whole.GetErrorCount( ) != 5 || split.GetErrorCount( ) != 10 || errors.size( ) != 2 || whole.GetErrors( ).size( ) != 2 )
+	{
+		printf( "Failed on LogAnalysis grouping!\n" );
+		return 18;
+	}
+
+	const common::LogAnalysis::ErrorGroup &foo = *errors[0], &bar = *errors[1];
+	if( foo.count != 6 || foo.addon_name != "ERROR" || foo.source_file != "addons/foo/lua/foo.lua" ||
+		foo.source_line != 12 || foo.frames != 2 || foo.first.file != 0 || foo.first.line != 2 ||
+		foo.last.file != 1 || foo.last.line != 13 || !foo.first.time.empty( ) ||
+		bar.count != 4 || bar.addon_name != "Bar" || bar.error_string != "boom" || bar.frames != 1 ||
+		bar.first.line != 6 || bar.first.time != "10/17/2026 - 12:00:01" ||
+		bar.last.file != 1 || bar.last.line != 11 || bar.last.time != "10/17/2026 - 12:00:02" )
+	{
+		printf( "Failed on LogAnalysis occurrences!\n" );
+		return 18;
+	}
+
+	const auto addons = split.GetAddons( );
+	if( addons.size( ) != 2 || addons[0].name != "ERROR" || addons[0].count != 6 || addons[0].errors != 1 ||
+		addons[1].name != "Bar" || addons[1].first.line != 6 || addons[1].last.line != 11 )
+	{
+		printf( "Failed on LogAnalysis addons!\n" );
+		return 18;
+	}
+
+	return 0;
+}
+
+static int run_template_tests( )
+{
+	common::TemplateMiner miner;
+	common::TemplateMiner::Parameters parameters;
+
+	const uint32_t index_x = miner.Add( "attempt to index a nil value (field 'x')" );
+	const uint32_t index_y = miner.Add( "attempt to index a nil value (field 'y')", &parameters );
+	const common::TemplateMiner::Template *index = miner.Find( index_x );
+	if( index_x == 0 || index_x != index_y || index == nullptr || index->count != 2 ||
+		index->text != "attempt to index a nil value (field <*>" ||
+		parameters.size( ) != 1 || parameters[0] != "'y')" )
+	{
+		printf( "Failed on TemplateMiner merging!\n" );
+		return 19;
+	}
+
+	// numbers are parameters from the first message, different lengths are different templates
+	const uint32_t entity = miner.Add( "Tried to use a NULL entity 1523", &parameters );
+	if( entity == index_x || miner.Add( "Tried to use a NULL entity 77" ) != entity ||
+		miner.Find( entity )->text != "Tried to use a NULL entity <*>" || parameters.size( ) != 1 || parameters[0] != "1523" ||
+		miner.Add( "attempt to call a nil value" ) == index_x || miner.GetCount( ) != 3 )
+	{
+		printf( "Failed on TemplateMiner grouping!\n" );
+		return 19;
+	}
+
+	// the least recently used template makes room
+	common::TemplateMiner::Options options;
+	options.max_templates = 2;
+	common::TemplateMiner small( options );
+	const uint32_t first = small.Add( "first message here" );
+	const uint32_t second = small.Add( "second thing" );
+	small.Add( "first message here" );
+	const uint32_t third = small.Add( "a third one entirely" );
+	std::vector<const common::TemplateMiner::Template *> top;
+	small.GetTop( 10, top );
+	if( small.GetCount( ) != 2 || small.GetEvictions( ) != 1 || small.Find( second ) != nullptr ||
+		small.Find( first ) == nullptr || third == second || top.size( ) != 2 || top[0]->id != first || top[0]->count != 2 )
+	{
+		printf( "Failed on TemplateMiner eviction!\n" );
+		return 19;
+	}
+
+	options.max_templates = 0;
+	small.Configure( options );
+	if( small.IsEnabled( ) || small.Add( "first message here" ) != 0 || small.GetCount( ) != 0 )
+	{
+		printf( "Failed on TemplateMiner disabling!\n" );
+		return 19;
+	}
+
+	return 0;
+}
+
+// The native work done by the LuaError and ClientLuaError paths (parsing, fingerprinting, repeat
+// filtering, addon lookup, staging for the sinks and the strings pushed to Lua) must stop
+// allocating once the module has seen an error of each size.
+static int run_allocation_tests( const std::string &client_error )
+{
+	const std::string lua_error = "addons/glib/lua/glib/stage1.lua:380: attempt to call a nil value";
+	const common::ParsedErrorWithStackTraceView::StackFrame stack[] = {
+		{ 1, "error", "=[C]", -1 },
+		{ 2, "UnloadSystem", "@addons/glib/lua/glib/stage1.lua", 380 }
+	};
+
+	common::AddonIndex index;
+	index.AddFile( index.AddAddon( "GLib", 1234 ), "addons/glib/lua/glib/stage1.lua" );
+	common::AddonLookupCache addon_cache;
+	common::DuplicateFilter duplicate_filter;
+	common::ErrorStager stager;
+	common::ErrorArena arena( 256 );
+	common::ErrorPathStats stats;
+	common::ParsedErrorWithStackTraceView client_parsed_error;
+	stager.Open( 1024 * 1024 );
+
+	uint64_t checksum = 0;
+	const auto dispatch = [&]( )
+	{
+		common::ParsedErrorView parsed_error;
+		{
+			common::ScopedTimer timer( stats.timers[common::ErrorPathStats::Parse] );
+			common::ParseError( std::string_view( lua_error ), parsed_error );
+		}
+
+		uint64_t fingerprint = common::FingerprintError( parsed_error.source_file, parsed_error.source_line, parsed_error.error_string );
+		for( const auto &frame : stack )
+			fingerprint = common::FingerprintStackFrame( fingerprint, frame.source, frame.currentline );
+
+		uint32_t repeats = 0;
+		duplicate_filter.Check( fingerprint, common::DuplicateFilter::Clock::now( ), repeats );
+		stager.Append( 0, true, -1, lua_error, common::Span<const common::ParsedErrorWithStackTraceView::StackFrame>( stack, 2 ) );
+
+		{
+			common::ErrorArena::Scope arena_scope( arena );
+			const common::AddonIndex::Addon *owner = addon_cache.Find( index, parsed_error.source_file );
+			char wsid[21], fingerprint_str[17];
+			common::FormatFingerprint( fingerprint, fingerprint_str );
+			checksum += std::strlen( arena.CopyString( parsed_error.source_file ) ) +
+				std::strlen( arena.CopyString( parsed_error.error_string ) ) +
+				std::strlen( common::FormatWorkshopId( owner != nullptr ? owner->wsid : 0, wsid ) );
+		}
+
+		common::ParseErrorWithStackTrace( std::string_view( client_error ), client_parsed_error );
+		stager.Append( 0, false, 1, client_error );
+		{
+			common::ErrorArena::Scope arena_scope( arena );
+			for( const auto &frame : client_parsed_error.stack_trace )
+				checksum += std::strlen( arena.CopyString( frame.name ) ) + std::strlen( arena.CopyString( frame.source ) );
+		}
+
+		++stats.seen;
+	};
+
+	// warm up every scratch buffer
+	dispatch( );
+
+	const size_t allocations_before = allocations::Count( );
+	for( size_t k = 0; k < 1000; ++k )
+		dispatch( );
+
+	const size_t allocated = allocations::Count( ) - allocations_before;
+	stager.Close( );
+
+	if( allocated != 0 || checksum == 0 || stats.seen != 1001 )
+	{
+		printf( "Failed on allocation free error dispatch (%zu allocations)!\n", allocated );
+		return 12;
+	}
+
+	// oversized strings get their own block, which is kept for the next error
+	const std::string large( 4096, 'x' );
+	for( size_t k = 0; k < 2; ++k )
+	{
+		const size_t capacity_before = arena.GetCapacity( );
+		const size_t arena_allocations_before = allocations::Count( );
+		{
+			common::ErrorArena::Scope arena_scope( arena );
+			arena.CopyString( lua_error );
+			if( std::strcmp( arena.CopyString( large ), large.c_str( ) ) != 0 )
+			{
+				printf( "Failed on ErrorArena copies!\n" );
+				return 12;
+			}
+		}
+
+		if( k == 1 && ( allocations::Count( ) != arena_allocations_before || arena.GetCapacity( ) != capacity_before ) )
+		{
+			printf( "Failed on ErrorArena reuse!\n" );
+			return 12;
+		}
+	}
+
+	return 0;
 }
 
-int main( const int, const char *[] )
+int main( const int argc, const char *argv[] )
 {
+	// testing --benchmark [rounds]
+	if( argc >= 2 && std::strcmp( argv[1], "--benchmark" ) == 0 )
+		return benchmark::Run( argc >= 3 ? std::strtoul( argv[2], nullptr, 10 ) : 20 );
+
+	{
+		// Texts dense in delimiters, of every length around the vector widths, from a fixed seed
+		static const char alphabet[] = { ' ', ' ', '-', ':', '\n', '\r', 'a' };
+		uint32_t seed = 0x0badf00d;
+		std::string text;
+		for( size_t k = 0; k < 20000; ++k )
+		{
+			seed = seed * 1664525 + 1013904223;
+			text.resize( k % 200 );
+			for( char &c : text )
+			{
+				seed = seed * 1664525 + 1013904223;
+				c = alphabet[( seed >> 16 ) % sizeof( alphabet )];
+			}
+
+			if( !test_line_delimiters_equivalence( text ) )
+			{
+				printf( "Failed on FindLineDelimiters random equivalence case %zu!\n", k + 1 );
+				return 5;
+			}
+		}
+	}
+
+	for( const auto instruction_set : {
+		common::scan::InstructionSet::Scalar,
+		common::scan::InstructionSet::SSE2,
+		common::scan::InstructionSet::AVX2
+	} )
+	{
+		if( !common::scan::SetInstructionSet( instruction_set ) )
+		{
+			printf( "Skipping unsupported instruction set %s\n", common::scan::GetName( instruction_set ) );
+			continue;
+		}
+
+		const int ret = run_equivalence_tests( );
+		if( ret != 0 )
+		{
+			printf( "Failed with instruction set %s!\n", common::scan::GetName( instruction_set ) );
+			return ret;
+		}
+	}
+
 	const std::string error1 = "lua_run:1: '=' expected near '<eof>'";
 	const common::ParsedError control_parsed_error1 =
 	{
@@ -86,6 +1844,70 @@ int main( const int, const char *[] )
 		return 5;
 	}
 
+	const int string_pool_ret = run_string_pool_tests( error2 );
+	if( string_pool_ret != 0 )
+		return string_pool_ret;
+
+	const int duplicate_ret = run_duplicate_tests( error2 );
+	if( duplicate_ret != 0 )
+		return duplicate_ret;
+
+	const int rate_limit_ret = run_rate_limit_tests( );
+	if( rate_limit_ret != 0 )
+		return rate_limit_ret;
+
+	const int async_pipeline_ret = run_async_pipeline_tests( error2 );
+	if( async_pipeline_ret != 0 )
+		return async_pipeline_ret;
+
+	const int journal_ret = run_journal_tests( error2 );
+	if( journal_ret != 0 )
+		return journal_ret;
+
+	const int exporter_ret = run_exporter_tests( error2 );
+	if( exporter_ret != 0 )
+		return exporter_ret;
+
+	const int addon_index_ret = run_addon_index_tests( );
+	if( addon_index_ret != 0 )
+		return addon_index_ret;
+
+	const int stats_ret = run_stats_tests( );
+	if( stats_ret != 0 )
+		return stats_ret;
+
+	const int allocation_ret = run_allocation_tests( error2 );
+	if( allocation_ret != 0 )
+		return allocation_ret;
+
+	const int stack_group_ret = run_stack_group_tests( error2 );
+	if( stack_group_ret != 0 )
+		return stack_group_ret;
+
+	const int capture_budget_ret = run_capture_budget_tests( );
+	if( capture_budget_ret != 0 )
+		return capture_budget_ret;
+
+	const int source_cache_ret = run_source_cache_tests( );
+	if( source_cache_ret != 0 )
+		return source_cache_ret;
+
+	const int recent_ret = run_recent_tests( );
+	if( recent_ret != 0 )
+		return recent_ret;
+
+	const int heavy_hitters_ret = run_heavy_hitters_tests( );
+	if( heavy_hitters_ret != 0 )
+		return heavy_hitters_ret;
+
+	const int log_analysis_ret = run_log_analysis_tests( );
+	if( log_analysis_ret != 0 )
+		return log_analysis_ret;
+
+	const int template_ret = run_template_tests( );
+	if( template_ret != 0 )
+		return template_ret;
+
 	const std::string error3 =
 		"\n"
 		"[ERROR] CompileString:1: '=' expected near '<eof>'\n"
@@ -150,6 +1972,10 @@ int main( const int, const char *[] )
 		return 5;
 	}
 
+	const int batch_ret = run_batch_tests( );
+	if( batch_ret != 0 )
+		return batch_ret;
+
 	printf( "Successfully ran all test cases!\n" );
 	return 0;
 }
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <common.hpp>
+
+// The original std::regex based parsers, kept around to validate and benchmark against.
+namespace reference
+{
+
+bool ParseError( const std::string &error, common::ParsedError &parsed_error );
+bool ParseErrorWithStackTrace( const std::string &error, common::ParsedErrorWithStackTrace &parsed_error );
+
+}